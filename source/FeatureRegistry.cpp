@@ -4,12 +4,68 @@
 #include "FeatureRegistry.h"
 #include "logging/LoggerFactory.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
 using namespace std;
 using namespace Aws::Iot::DeviceClient;
 using namespace Aws::Iot::DeviceClient::Util;
 using namespace Aws::Iot::DeviceClient::Logging;
 
 constexpr char FeatureRegistry::TAG[];
+constexpr size_t FeatureRegistry::DEFAULT_MAX_CONCURRENCY;
+constexpr chrono::milliseconds::rep FeatureRegistry::DEFAULT_DEADLINE_MILLIS;
+
+namespace
+{
+    enum class TaskStatus
+    {
+        PENDING,
+        QUEUED,
+        RUNNING,
+        SUCCEEDED,
+        FAILED,
+        TIMED_OUT,
+        SKIPPED
+    };
+
+    bool isFinished(TaskStatus status)
+    {
+        return status != TaskStatus::PENDING && status != TaskStatus::QUEUED && status != TaskStatus::RUNNING;
+    }
+
+    struct Task
+    {
+        shared_ptr<Feature> feature;
+        vector<string> waitsFor;
+        TaskStatus status{TaskStatus::PENDING};
+        chrono::steady_clock::time_point startedAt;
+    };
+
+    /**
+     * Shared with the worker threads, which outlive the run when a feature misses its deadline
+     */
+    struct RunState
+    {
+        mutex lock;
+        condition_variable changed;
+        map<string, Task> tasks;
+        deque<string> ready;
+        bool finished{false};
+    };
+
+    long long millisSince(chrono::steady_clock::time_point start)
+    {
+        return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    }
+} // namespace
+
+FeatureRegistry::FeatureRegistry(size_t maxConcurrency, chrono::milliseconds deadline)
+    : maxConcurrency(max<size_t>(maxConcurrency, 1)), deadline(deadline)
+{
+}
 
 std::shared_ptr<Feature> FeatureRegistry::get(const std::string &name) const
 {
@@ -22,12 +78,16 @@ std::shared_ptr<Feature> FeatureRegistry::get(const std::string &name) const
     return nullptr;
 }
 
-void FeatureRegistry::add(const std::string &name, std::shared_ptr<Feature> featureToAdd)
+void FeatureRegistry::add(
+    const std::string &name,
+    std::shared_ptr<Feature> featureToAdd,
+    const std::vector<std::string> &featureDependencies)
 {
     std::lock_guard<std::mutex> lock(featuresLock);
     if (!features.count(name))
     {
         features[name] = featureToAdd;
+        dependencies[name] = featureDependencies;
     }
     else
     {
@@ -55,31 +115,286 @@ std::size_t FeatureRegistry::getSize() const
     });
 }
 
+void FeatureRegistry::replace(const string &name, shared_ptr<Feature> feature)
+{
+    shared_ptr<Feature> previous;
+    {
+        std::lock_guard<std::mutex> lock(featuresLock);
+        previous = features[name];
+        features[name] = nullptr;
+    }
+
+    if (previous != nullptr)
+    {
+        runConcurrently("stop", {{name, previous}}, {}, false, [](Feature &feature) { return feature.stop(); });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(featuresLock);
+        features[name] = feature;
+    }
+
+    if (feature != nullptr)
+    {
+        runConcurrently("start", {{name, feature}}, {}, true, [](Feature &feature) { return feature.start(); });
+    }
+}
+
 void FeatureRegistry::stopAll()
 {
+    map<string, shared_ptr<Feature>> running;
+    map<string, vector<string>> dependents;
+    {
+        std::lock_guard<std::mutex> lock(featuresLock);
+        for (const auto &feature : features)
+        {
+            if (feature.second != nullptr)
+            {
+                running[feature.first] = feature.second;
+            }
+        }
+        // A feature is stopped once every feature depending on it has stopped
+        for (const auto &feature : running)
+        {
+            for (const auto &dependency : dependencies[feature.first])
+            {
+                dependents[dependency].push_back(feature.first);
+            }
+        }
+    }
+
+    runConcurrently("stop", running, dependents, false, [](Feature &feature) { return feature.stop(); });
+
     std::lock_guard<std::mutex> lock(featuresLock);
+    for (const auto &feature : running)
+    {
+        features[feature.first] = nullptr;
+    }
+}
 
-    for (const auto &feature : features)
+void FeatureRegistry::startAll() const
+{
+    map<string, shared_ptr<Feature>> enabled;
+    map<string, vector<string>> enabledDependencies;
     {
-        if (feature.second != nullptr)
+        std::lock_guard<std::mutex> lock(featuresLock);
+        for (const auto &feature : features)
         {
-            LOGM_DEBUG(TAG, "Attempting to stop %s", feature.first.c_str());
-            feature.second->stop();
-            features[feature.first] = nullptr;
+            if (feature.second != nullptr)
+            {
+                enabled[feature.first] = feature.second;
+                enabledDependencies[feature.first] = dependencies.at(feature.first);
+            }
         }
     }
+
+    runConcurrently("start", enabled, enabledDependencies, true, [](Feature &feature) { return feature.start(); });
 }
 
-void FeatureRegistry::startAll() const
+void FeatureRegistry::runConcurrently(
+    const char *action,
+    const map<string, shared_ptr<Feature>> &targets,
+    const map<string, vector<string>> &waitsFor,
+    bool requireSuccess,
+    const function<int(Feature &)> &run) const
 {
-    std::lock_guard<std::mutex> lock(featuresLock);
+    if (targets.empty())
+    {
+        return;
+    }
 
-    for (auto &feature : features)
+    auto runStartedAt = chrono::steady_clock::now();
+    auto state = make_shared<RunState>();
+    for (const auto &target : targets)
     {
-        if (feature.second != nullptr)
+        Task &task = state->tasks[target.first];
+        task.feature = target.second;
+        auto waits = waitsFor.find(target.first);
+        if (waits == waitsFor.end())
         {
-            LOGM_DEBUG(TAG, "Attempting to start %s", feature.first.c_str());
-            feature.second->start();
+            continue;
         }
+        for (const auto &other : waits->second)
+        {
+            if (targets.count(other))
+            {
+                task.waitsFor.push_back(other);
+            }
+            else
+            {
+                LOGM_DEBUG(
+                    TAG, "Ignoring dependency of %s on %s, which is not enabled", target.first.c_str(), other.c_str());
+            }
+        }
+    }
+
+    auto work = [state, action, run]() {
+        unique_lock<mutex> lock(state->lock);
+        while (true)
+        {
+            state->changed.wait(lock, [&state]() { return state->finished || !state->ready.empty(); });
+            if (state->ready.empty())
+            {
+                return;
+            }
+            string name = state->ready.front();
+            state->ready.pop_front();
+            Task &task = state->tasks[name];
+            task.status = TaskStatus::RUNNING;
+            task.startedAt = chrono::steady_clock::now();
+            shared_ptr<Feature> feature = task.feature;
+            // So that the deadline of the feature is waited for
+            state->changed.notify_all();
+            lock.unlock();
+
+            LOGM_DEBUG(TAG, "Attempting to %s %s", action, name.c_str());
+            int result = -1;
+            try
+            {
+                result = run(*feature);
+            }
+            catch (const std::exception &e)
+            {
+                LOGM_ERROR(TAG, "Exception while trying to %s %s: %s", action, name.c_str(), e.what());
+            }
+
+            lock.lock();
+            long long elapsedMillis = millisSince(task.startedAt);
+            if (task.status != TaskStatus::RUNNING)
+            {
+                // Another worker was started in place of this one when the deadline passed
+                LOGM_WARN(TAG, "%s took %lld ms to %s, past its deadline", name.c_str(), elapsedMillis, action);
+                return;
+            }
+            else if (result == Feature::SUCCESS)
+            {
+                LOGM_INFO(TAG, "%s took %lld ms to %s", name.c_str(), elapsedMillis, action);
+                task.status = TaskStatus::SUCCEEDED;
+            }
+            else
+            {
+                LOGM_ERROR(TAG, "%s failed to %s after %lld ms", name.c_str(), action, elapsedMillis);
+                task.status = TaskStatus::FAILED;
+            }
+            state->changed.notify_all();
+        }
+    };
+
+    // Detached so that a feature stuck past its deadline does not hold up the registry
+    size_t workerCount = min(maxConcurrency, targets.size());
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        thread(work).detach();
     }
+
+    unique_lock<mutex> lock(state->lock);
+    while (true)
+    {
+        // Queue the features that are no longer waiting on others, until nothing changes
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (auto &entry : state->tasks)
+            {
+                Task &task = entry.second;
+                if (task.status != TaskStatus::PENDING)
+                {
+                    continue;
+                }
+                bool waiting = false;
+                bool blocked = false;
+                for (const auto &other : task.waitsFor)
+                {
+                    TaskStatus otherStatus = state->tasks[other].status;
+                    waiting = waiting || !isFinished(otherStatus);
+                    blocked = blocked || (requireSuccess && isFinished(otherStatus) &&
+                                          otherStatus != TaskStatus::SUCCEEDED);
+                }
+                if (blocked)
+                {
+                    LOGM_ERROR(
+                        TAG,
+                        "Not attempting to %s %s since a feature it depends on did not %s",
+                        action,
+                        entry.first.c_str(),
+                        action);
+                    task.status = TaskStatus::SKIPPED;
+                    changed = true;
+                }
+                else if (!waiting)
+                {
+                    task.status = TaskStatus::QUEUED;
+                    state->ready.push_back(entry.first);
+                    state->changed.notify_all();
+                }
+            }
+        }
+
+        bool active = false;
+        bool timedOut = false;
+        bool hasDeadline = false;
+        chrono::steady_clock::time_point nextDeadline;
+        for (auto &entry : state->tasks)
+        {
+            Task &task = entry.second;
+            if (task.status == TaskStatus::QUEUED)
+            {
+                active = true;
+            }
+            else if (task.status == TaskStatus::RUNNING)
+            {
+                active = true;
+                if (chrono::steady_clock::now() - task.startedAt >= deadline)
+                {
+                    LOGM_ERROR(
+                        TAG,
+                        "%s did not %s within %lld ms, continuing without waiting for it",
+                        entry.first.c_str(),
+                        action,
+                        static_cast<long long>(deadline.count()));
+                    task.status = TaskStatus::TIMED_OUT;
+                    timedOut = true;
+                    // The worker stays with the feature, so another takes its place for the features still queued
+                    thread(work).detach();
+                }
+                else if (!hasDeadline || task.startedAt + deadline < nextDeadline)
+                {
+                    hasDeadline = true;
+                    nextDeadline = task.startedAt + deadline;
+                }
+            }
+        }
+
+        if (timedOut)
+        {
+            continue;
+        }
+        if (!active)
+        {
+            for (auto &entry : state->tasks)
+            {
+                if (entry.second.status == TaskStatus::PENDING)
+                {
+                    LOGM_ERROR(
+                        TAG, "Not attempting to %s %s due to a circular dependency", action, entry.first.c_str());
+                    entry.second.status = TaskStatus::SKIPPED;
+                }
+            }
+            break;
+        }
+
+        if (hasDeadline)
+        {
+            state->changed.wait_until(lock, nextDeadline);
+        }
+        else
+        {
+            state->changed.wait(lock);
+        }
+    }
+
+    state->finished = true;
+    state->changed.notify_all();
+    LOGM_INFO(TAG, "Took %lld ms to %s %zu features", millisSince(runStartedAt), action, targets.size());
 }
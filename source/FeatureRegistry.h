@@ -4,10 +4,13 @@
 #ifndef AWS_IOT_DEVICE_CLIENT_FEATURE_REGISTRY_H
 #define AWS_IOT_DEVICE_CLIENT_FEATURE_REGISTRY_H
 
+#include <chrono>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "Feature.h"
 #include "config/Config.h"
@@ -23,11 +26,30 @@ namespace Aws
 
                 /**
                  * @brief A class to keep track of and manage the features currently running on the device client.
+                 *
+                 * Features are started and stopped concurrently on a small pool of threads. A feature is only started
+                 * once the features it depends on have started successfully, and is stopped before them. Waiting for
+                 * a feature to start or stop is bounded by a deadline, after which the registry moves on without it.
                  */
                 class FeatureRegistry
                 {
                   public:
-                    FeatureRegistry() = default;
+                    /**
+                     * @brief The default number of features started or stopped at the same time
+                     */
+                    static constexpr std::size_t DEFAULT_MAX_CONCURRENCY = 4;
+                    /**
+                     * @brief The default time to wait for a single feature to start or stop
+                     */
+                    static constexpr std::chrono::milliseconds::rep DEFAULT_DEADLINE_MILLIS = 30 * 1000;
+
+                    /**
+                     * @param maxConcurrency the number of features started or stopped at the same time
+                     * @param deadline the time to wait for a single feature to start or stop
+                     */
+                    explicit FeatureRegistry(
+                        std::size_t maxConcurrency = DEFAULT_MAX_CONCURRENCY,
+                        std::chrono::milliseconds deadline = std::chrono::milliseconds(DEFAULT_DEADLINE_MILLIS));
 
                     /**
                      * @brief returns a shared pointer to a Feature, or nullptr if the requested Feature does not exist
@@ -41,9 +63,22 @@ namespace Aws
                      * @brief Adds a feature to the registry if it does not exist already
                      *
                      * @param feature A shared pointer to the feature to be added
+                     * @param dependencies The names of the features that must be started before this one. Features
+                     * that are disabled or not in the registry are ignored.
                      */
-                    void add(const std::string &name, std::shared_ptr<Feature> feature);
+                    void add(
+                        const std::string &name,
+                        std::shared_ptr<Feature> feature,
+                        const std::vector<std::string> &dependencies = {});
 
+                    /**
+                     * @brief Replaces a feature in the registry, stopping the feature it replaces before starting the
+                     * new one. The dependencies of the feature are kept.
+                     *
+                     * @param name The name of the feature to be replaced
+                     * @param feature A shared pointer to the new feature, or nullptr to leave the feature disabled
+                     */
+                    void replace(const std::string &name, std::shared_ptr<Feature> feature);
                     /**
                      * @brief Disables a feature in the registry
                      *
@@ -59,13 +94,15 @@ namespace Aws
                     std::size_t getSize() const;
 
                     /**
-                     * @brief Calls stop() on all features tracked by the registry
+                     * @brief Calls stop() on all features tracked by the registry, stopping each feature before the
+                     * features it depends on
                      *
                      */
                     void stopAll();
 
                     /**
-                     * @brief Calls start() on all features tracked by the registry
+                     * @brief Calls start() on all features tracked by the registry, starting each feature after the
+                     * features it depends on. Features whose dependencies fail to start are not started.
                      *
                      */
                     void startAll() const;
@@ -73,7 +110,27 @@ namespace Aws
                   private:
                     static constexpr char TAG[] = "FeatureRegistry.cpp";
                     std::map<std::string, std::shared_ptr<Feature>> features;
+                    std::map<std::string, std::vector<std::string>> dependencies;
                     mutable std::mutex featuresLock;
+                    std::size_t maxConcurrency;
+                    std::chrono::milliseconds deadline;
+
+                    /**
+                     * @brief Run start() or stop() on the given features concurrently
+                     *
+                     * @param action name of the action, used for logging
+                     * @param targets the features to run the action on
+                     * @param waitsFor for each feature, the features whose action must complete before its own
+                     * @param requireSuccess whether a feature is skipped when the action failed on a feature it
+                     * waits for
+                     * @param run the action
+                     */
+                    void runConcurrently(
+                        const char *action,
+                        const std::map<std::string, std::shared_ptr<Feature>> &targets,
+                        const std::map<std::string, std::vector<std::string>> &waitsFor,
+                        bool requireSuccess,
+                        const std::function<int(Feature &)> &run) const;
                 };
 
             } // namespace Util
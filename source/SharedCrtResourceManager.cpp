@@ -12,7 +12,16 @@
 
 #include <aws/crt/Api.h>
 #include <aws/crt/io/Pkcs11.h>
+#include <aws/io/event_loop.h>
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <random>
+#include <sched.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace Aws::Crt;
@@ -23,11 +32,24 @@ using namespace Aws::Iot::DeviceClient;
 using namespace Aws::Iot::DeviceClient::Util;
 using namespace Aws::Iot::DeviceClient::Logging;
 
+constexpr char SharedCrtResourceManager::TAG[];
 constexpr int SharedCrtResourceManager::DEFAULT_WAIT_TIME_SECONDS;
 constexpr char SharedCrtResourceManager::DEFAULT_SDK_LOG_FILE[];
 
 SharedCrtResourceManager::~SharedCrtResourceManager()
 {
+    // Release the CRT objects, in the reverse order of their declaration, before the allocator they were allocated from
+    publishJournal.reset();
+    publishGateway.reset();
+    atomic_store(&connection, shared_ptr<MqttConnection>());
+    mqttClient.reset();
+    dataPlaneClientBootstrap.reset();
+    clientBootstrap.reset();
+    defaultHostResolver.reset();
+    dataPlaneEventLoopGroup.reset();
+    eventLoopGroup.reset();
+    apiHandle.reset();
+
     if (memTraceLevel != AWS_MEMTRACE_NONE)
     {
         allocator = aws_mem_tracer_destroy(allocator);
@@ -199,6 +221,14 @@ void SharedCrtResourceManager::initializeAllocator()
     loadMemTraceLevelFromEnvironment();
     allocator = aws_default_allocator();
 
+    const char *allocatorName = std::getenv("AWS_CRT_ALLOCATOR");
+    if (allocatorName != nullptr && string(allocatorName) == "pool")
+    {
+        LOG_DEBUG(TAG, "Set AWS_CRT_ALLOCATOR=pool");
+        poolAllocator = unique_ptr<PoolAllocator>(new PoolAllocator(allocator));
+        allocator = poolAllocator->GetAllocator();
+    }
+
     if (memTraceLevel != AWS_MEMTRACE_NONE)
     {
         // If memTraceLevel == AWS_MEMTRACE_STACKS(2), then by default 8 frames per stack are used.
@@ -206,8 +236,8 @@ void SharedCrtResourceManager::initializeAllocator()
     }
 
     // We MUST declare an instance of the ApiHandle to perform global initialization
-    // of the SDK libraries
-    apiHandle = unique_ptr<ApiHandle>(new ApiHandle());
+    // of the SDK libraries. Every CRT object allocates from the allocator given to it.
+    apiHandle = unique_ptr<ApiHandle>(new ApiHandle(allocator));
 }
 
 int SharedCrtResourceManager::buildClient(const PlainConfig &config)
@@ -227,36 +257,63 @@ int SharedCrtResourceManager::buildClient(const PlainConfig &config)
             "logging::enable-sdk-logging in your configuration file");
     }
 
-    eventLoopGroup = unique_ptr<EventLoopGroup>(
-        new EventLoopGroup(1 // The number of threads used depends on your use-case. IF you have a maximum of less than
-                             // a few hundred connections 1 thread is the ideal threadCount.
-                           ));
+    // The number of threads used depends on your use-case. If you have a maximum of less than a few hundred
+    // connections 1 thread is the ideal threadCount, which is the default.
+    eventLoopGroup =
+        buildEventLoopGroup(PlainConfig::EventLoops::JSON_KEY_CONTROL_PLANE, config.eventLoops.controlPlane);
     if (!eventLoopGroup)
     {
-        // cppcheck-suppress nullPointerRedundantCheck
-        LOGM_ERROR(
-            TAG, "MQTT Event Loop Group Creation failed with error: %s", ErrorDebugString(eventLoopGroup->LastError()));
-        // cppcheck-suppress nullPointerRedundantCheck
-        return eventLoopGroup->LastError();
+        return SharedCrtResourceManager::ABORT;
+    }
+
+    if (config.eventLoops.dataPlane.has_value())
+    {
+        dataPlaneEventLoopGroup =
+            buildEventLoopGroup(PlainConfig::EventLoops::JSON_KEY_DATA_PLANE, config.eventLoops.dataPlane.value());
+        if (!dataPlaneEventLoopGroup)
+        {
+            return SharedCrtResourceManager::ABORT;
+        }
     }
 
     defaultHostResolver = unique_ptr<DefaultHostResolver>(new DefaultHostResolver(*eventLoopGroup, 2, 30));
     clientBootstrap = unique_ptr<ClientBootstrap>(new ClientBootstrap(*eventLoopGroup, *defaultHostResolver));
 
-    if (!clientBootstrap)
+    if (!*clientBootstrap)
     {
-        // cppcheck-suppress nullPointerRedundantCheck
         LOGM_ERROR(TAG, "MQTT ClientBootstrap failed with error: %s", ErrorDebugString(clientBootstrap->LastError()));
-        // cppcheck-suppress nullPointerRedundantCheck
         return clientBootstrap->LastError();
     }
 
+    if (dataPlaneEventLoopGroup)
+    {
+        dataPlaneClientBootstrap =
+            unique_ptr<ClientBootstrap>(new ClientBootstrap(*dataPlaneEventLoopGroup, *defaultHostResolver));
+        if (!*dataPlaneClientBootstrap)
+        {
+            LOGM_ERROR(
+                TAG,
+                "Data plane ClientBootstrap failed with error: %s",
+                ErrorDebugString(dataPlaneClientBootstrap->LastError()));
+            return dataPlaneClientBootstrap->LastError();
+        }
+    }
+
     /*
      * Now Create a client. This can not throw.
      * An instance of a client must outlive its connections.
      * It is the users responsibility to make sure of this.
      */
     mqttClient = unique_ptr<MqttClient>(new MqttClient(*clientBootstrap));
+
+    publishGateway = make_shared<PublishGateway>(
+        static_cast<uint32_t>(config.publishLimits.messagesPerSecond),
+        static_cast<uint32_t>(config.publishLimits.bytesPerSecond),
+        static_cast<size_t>(config.publishLimits.maxQueueDepth));
+    if (!buildPublishJournal(config))
+    {
+        LOG_ERROR(TAG, "Publish journal could not be opened, durable publishes will not survive a restart");
+    }
     return SharedCrtResourceManager::SUCCESS;
 }
 
@@ -276,7 +333,7 @@ void SharedCrtResourceManager::initializeAWSHttpLib()
     initializedAWSHttpLib = true;
 }
 
-int SharedCrtResourceManager::establishConnection(const PlainConfig &config)
+int SharedCrtResourceManager::buildConnection(const PlainConfig &config)
 {
     if (!locateCredentials(config))
     {
@@ -379,25 +436,53 @@ int SharedCrtResourceManager::establishConnection(const PlainConfig &config)
         return ABORT;
     }
 
-    connection = mqttClient->NewConnection(clientConfig);
+    shared_ptr<MqttConnection> newConnection = mqttClient->NewConnection(clientConfig);
 
-    if (!*connection)
+    if (!*newConnection)
     {
-        LOGM_ERROR(TAG, "MQTT Connection Creation failed with error: %s", ErrorDebugString(connection->LastError()));
+        LOGM_ERROR(
+            TAG, "MQTT Connection Creation failed with error: %s", ErrorDebugString(newConnection->LastError()));
         return ABORT;
     }
 
+    atomic_store(&connection, newConnection);
+    return SUCCESS;
+}
+
+int SharedCrtResourceManager::establishConnection(const PlainConfig &config)
+{
+    if (atomic_load(&connection))
+    {
+        LOG_DEBUG(TAG, "Reusing the MQTT connection and TLS context of the previous connection attempt");
+    }
+    else
+    {
+        int buildStatus = buildConnection(config);
+        if (buildStatus != SUCCESS)
+        {
+            return buildStatus;
+        }
+    }
+    shared_ptr<MqttConnection> mqttConnection = atomic_load(&connection);
+
     promise<int> connectionCompletedPromise;
+    chrono::steady_clock::time_point connectStartedAt;
     connectionClosedPromise = std::promise<void>();
 
     /*
      * This will execute when an mqtt connect has completed or failed.
      */
-    auto onConnectionCompleted = [this, &connectionCompletedPromise](
+    auto onConnectionCompleted = [this, &connectionCompletedPromise, &connectStartedAt](
                                      const Mqtt::MqttConnection &, int errorCode, Mqtt::ReturnCode returnCode, bool) {
+        long long elapsedMillis =
+            chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - connectStartedAt).count();
         if (errorCode)
         {
-            LOGM_ERROR(TAG, "MQTT Connection failed with error: %s", ErrorDebugString(errorCode));
+            LOGM_ERROR(
+                TAG,
+                "MQTT Connection failed after %lld ms with error: %s",
+                elapsedMillis,
+                ErrorDebugString(errorCode));
             if (AWS_ERROR_MQTT_UNEXPECTED_HANGUP == errorCode)
             {
                 LOG_ERROR(
@@ -410,7 +495,8 @@ int SharedCrtResourceManager::establishConnection(const PlainConfig &config)
         }
         else
         {
-            LOGM_INFO(TAG, "MQTT connection established with return code: %d", returnCode);
+            LOGM_INFO(
+                TAG, "MQTT connection established in %lld ms with return code: %d", elapsedMillis, returnCode);
             connectionCompletedPromise.set_value(0);
         }
     };
@@ -430,6 +516,7 @@ int SharedCrtResourceManager::establishConnection(const PlainConfig &config)
      */
     auto OnConnectionInterrupted = [this](const Mqtt::MqttConnection &, int errorCode) {
         {
+            connectionInterruptedAt = chrono::steady_clock::now();
             if (errorCode)
             {
                 LOGM_ERROR(
@@ -446,24 +533,33 @@ int SharedCrtResourceManager::establishConnection(const PlainConfig &config)
      */
     auto OnConnectionResumed = [this](const Mqtt::MqttConnection &, int returnCode, bool) {
         {
-            LOGM_INFO(TAG, "MQTT connection resumed with return code: %d", returnCode);
+            long long outageMillis =
+                chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - connectionInterruptedAt)
+                    .count();
+            LOGM_INFO(TAG, "MQTT connection resumed after %lld ms with return code: %d", outageMillis, returnCode);
+            replayPublishJournal();
         }
     };
 
-    connection->OnConnectionCompleted = move(onConnectionCompleted);
-    connection->OnDisconnect = move(onDisconnect);
-    connection->OnConnectionInterrupted = move(OnConnectionInterrupted);
-    connection->OnConnectionResumed = move(OnConnectionResumed);
+    mqttConnection->OnConnectionCompleted = move(onConnectionCompleted);
+    mqttConnection->OnDisconnect = move(onDisconnect);
+    mqttConnection->OnConnectionInterrupted = move(OnConnectionInterrupted);
+    mqttConnection->OnConnectionResumed = move(OnConnectionResumed);
 
     LOGM_INFO(TAG, "Establishing MQTT connection with client id %s...", config.thingName->c_str());
-    if (!connection->SetReconnectTimeout(15, 240))
+    // The connection doubles the time between automatic reconnects without randomization, so spread the devices of a
+    // fleet over different starting times to keep them from reconnecting in waves after an outage
+    mt19937_64 generator(Retry::seedFrom(*config.thingName));
+    uint64_t minReconnectSeconds = uniform_int_distribution<uint64_t>(10, 20)(generator);
+    if (!mqttConnection->SetReconnectTimeout(minReconnectSeconds, 240))
     {
         LOG_ERROR(TAG, "Device Client is not able to set reconnection settings. Device Client will retry again.");
         return RETRY;
     }
-    if (!connection->Connect(config.thingName->c_str(), false))
+    connectStartedAt = chrono::steady_clock::now();
+    if (!mqttConnection->Connect(config.thingName->c_str(), false))
     {
-        LOGM_ERROR(TAG, "MQTT Connection failed with error: %s", ErrorDebugString(connection->LastError()));
+        LOGM_ERROR(TAG, "MQTT Connection failed with error: %s", ErrorDebugString(mqttConnection->LastError()));
         return RETRY;
     }
 
@@ -472,6 +568,7 @@ int SharedCrtResourceManager::establishConnection(const PlainConfig &config)
     if (SharedCrtResourceManager::SUCCESS == connectionStatus)
     {
         LOG_INFO(TAG, "Shared MQTT connection is ready!");
+        replayPublishJournal();
         return SharedCrtResourceManager::SUCCESS;
     }
     else
@@ -489,10 +586,237 @@ shared_ptr<MqttConnection> SharedCrtResourceManager::getConnection()
         return nullptr;
     }
 
-    return connection;
+    return atomic_load(&connection);
 }
 
-EventLoopGroup *SharedCrtResourceManager::getEventLoopGroup()
+shared_ptr<PublishGateway> SharedCrtResourceManager::getPublishGateway()
+{
+    if (!initialized)
+    {
+        LOG_WARN(TAG, "Tried to get publishGateway but the SharedCrtResourceManager has not yet been initialized!");
+        return nullptr;
+    }
+
+    return publishGateway;
+}
+
+bool SharedCrtResourceManager::publish(
+    const std::string &topic,
+    QOS qos,
+    const aws_byte_cursor &payload,
+    PublishGateway::Priority priority,
+    const OnOperationCompleteHandler &onComplete,
+    bool durable)
+{
+    if (!initialized || !atomic_load(&connection))
+    {
+        LOG_WARN(TAG, "Tried to publish but the shared MQTT connection has not yet been established!");
+        return false;
+    }
+
+    // Owned by the publish until it completes, since the message may be sent long after the caller released its copy
+    auto message = make_shared<string>(reinterpret_cast<const char *>(payload.ptr), payload.len);
+    uint64_t journalSequence = 0;
+    if (durable && publishJournal)
+    {
+        PublishJournal::Record record;
+        record.topic = topic;
+        record.qos = static_cast<int>(qos);
+        record.priority = priority;
+        record.payload = *message;
+        journalSequence = publishJournal->Append(record);
+    }
+    return submitPublish(topic, qos, message, priority, journalSequence, onComplete);
+}
+
+bool SharedCrtResourceManager::submitPublish(
+    const std::string &topic,
+    QOS qos,
+    shared_ptr<string> message,
+    PublishGateway::Priority priority,
+    uint64_t journalSequence,
+    const OnOperationCompleteHandler &onComplete)
+{
+    shared_ptr<MqttConnection> publishConnection = atomic_load(&connection);
+    shared_ptr<PublishJournal> journal = journalSequence != 0 ? publishJournal : nullptr;
+    if (!publishConnection)
+    {
+        // Disconnected since the publish was accepted. A journaled publish is replayed on the next connection.
+        LOG_WARN(TAG, "Tried to publish but the shared MQTT connection has been closed!");
+        if (journal)
+        {
+            journal->Release(journalSequence);
+        }
+        return false;
+    }
+    auto send = [publishConnection, topic, qos, message, journal, journalSequence, onComplete]() {
+        ByteBuf buf = aws_byte_buf_from_array(message->data(), message->size());
+        auto onPublishComplete =
+            [message, journal, journalSequence, onComplete](MqttConnection &conn, uint16_t packetId, int errorCode) {
+                if (journal && errorCode == AWS_OP_SUCCESS)
+                {
+                    journal->Acknowledge(journalSequence);
+                }
+                else if (journal)
+                {
+                    journal->Release(journalSequence);
+                }
+                if (onComplete)
+                {
+                    onComplete(conn, packetId, errorCode);
+                }
+            };
+        if (publishConnection->Publish(topic.c_str(), qos, false, buf, onPublishComplete) == 0)
+        {
+            LOGM_ERROR(
+                TAG,
+                "Failed to publish to topic %s: %s",
+                topic.c_str(),
+                ErrorDebugString(publishConnection->LastError()));
+            if (journal)
+            {
+                journal->Release(journalSequence);
+            }
+        }
+    };
+
+    if (!publishGateway->Submit(priority, message->size(), send))
+    {
+        if (journal)
+        {
+            journal->Release(journalSequence);
+        }
+        return false;
+    }
+    return true;
+}
+
+void SharedCrtResourceManager::replayPublishJournal()
+{
+    if (!publishJournal)
+    {
+        return;
+    }
+
+    publishJournal->Replay([this](uint64_t sequence, const PublishJournal::Record &record) {
+        submitPublish(
+            record.topic,
+            static_cast<QOS>(record.qos),
+            make_shared<string>(record.payload),
+            record.priority,
+            sequence,
+            nullptr);
+    });
+}
+
+bool SharedCrtResourceManager::buildPublishJournal(const PlainConfig &config)
+{
+    if (!config.publishJournal.enabled)
+    {
+        return true;
+    }
+
+    string directory;
+    if (config.publishJournal.directory.has_value())
+    {
+        directory = config.publishJournal.directory.value();
+    }
+    else
+    {
+        directory = FileUtils::ExtractExpandedPath(DeviceClient::Config::DEFAULT_PUBLISH_JOURNAL_DIR);
+        if (!FileUtils::CreateDirectoryWithPermissions(directory.c_str(), S_IRWXU))
+        {
+            LOGM_ERROR(TAG, "Failed to create publish journal directory %s", Sanitize(directory).c_str());
+            return false;
+        }
+    }
+
+    publishJournal = make_shared<PublishJournal>(directory, static_cast<size_t>(config.publishJournal.maxSize));
+    if (!publishJournal->Open())
+    {
+        publishJournal.reset();
+        return false;
+    }
+    LOGM_INFO(TAG, "Journaling durable publishes in %s", Sanitize(directory).c_str());
+    return true;
+}
+
+unique_ptr<EventLoopGroup> SharedCrtResourceManager::buildEventLoopGroup(
+    const char *role,
+    const PlainConfig::EventLoops::LoopGroup &settings)
+{
+    auto group = unique_ptr<EventLoopGroup>(new EventLoopGroup(static_cast<uint16_t>(settings.threads)));
+    if (!*group)
+    {
+        LOGM_ERROR(
+            TAG, "%s Event Loop Group Creation failed with error: %s", role, ErrorDebugString(group->LastError()));
+        return nullptr;
+    }
+
+    if (!settings.cpuAffinity.empty() || settings.nice.has_value())
+    {
+        aws_event_loop_group *handle = group->GetUnderlyingHandle();
+        for (size_t i = 0; i < aws_event_loop_group_get_loop_count(handle); i++)
+        {
+            // Freed by ApplyEventLoopThreadSettings, which also runs if the loop is destroyed first
+            auto *threadSettings = new EventLoopThreadSettings();
+            threadSettings->role = role;
+            threadSettings->index = i;
+            threadSettings->cpuAffinity = settings.cpuAffinity;
+            threadSettings->nice = settings.nice;
+            aws_task_init(
+                &threadSettings->task, ApplyEventLoopThreadSettings, threadSettings, "EventLoopThreadSettings");
+            aws_event_loop_schedule_task_now(aws_event_loop_group_get_loop_at(handle, i), &threadSettings->task);
+        }
+    }
+
+    LOGM_INFO(TAG, "Created %d %s event loop(s)", settings.threads, role);
+    return group;
+}
+
+void SharedCrtResourceManager::ApplyEventLoopThreadSettings(aws_task *, void *arg, aws_task_status status)
+{
+    unique_ptr<EventLoopThreadSettings> settings(static_cast<EventLoopThreadSettings *>(arg));
+    if (status != AWS_TASK_STATUS_RUN_READY)
+    {
+        return;
+    }
+
+    if (!settings->cpuAffinity.empty())
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu : settings->cpuAffinity)
+        {
+            CPU_SET(cpu, &cpus);
+        }
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (error)
+        {
+            LOGM_WARN(
+                TAG,
+                "Failed to set CPU affinity of %s event loop %zu: %s",
+                settings->role,
+                settings->index,
+                strerror(error));
+        }
+    }
+
+    // On Linux the nice level is an attribute of each thread rather than of the whole process
+    if (settings->nice.has_value() &&
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), settings->nice.value()) != 0)
+    {
+        LOGM_WARN(
+            TAG,
+            "Failed to set nice level of %s event loop %zu to %d: %s",
+            settings->role,
+            settings->index,
+            settings->nice.value(),
+            strerror(errno));
+    }
+}
+
+EventLoopGroup *SharedCrtResourceManager::getEventLoopGroup(EventLoopRole role)
 {
     if (!initialized)
     {
@@ -500,10 +824,14 @@ EventLoopGroup *SharedCrtResourceManager::getEventLoopGroup()
         return nullptr;
     }
 
+    if (role == EventLoopRole::DATA_PLANE && dataPlaneEventLoopGroup)
+    {
+        return dataPlaneEventLoopGroup.get();
+    }
     return eventLoopGroup.get();
 }
 
-aws_event_loop *SharedCrtResourceManager::getNextEventLoop()
+aws_event_loop *SharedCrtResourceManager::getNextEventLoop(EventLoopRole role)
 {
     if (!initialized)
     {
@@ -511,7 +839,7 @@ aws_event_loop *SharedCrtResourceManager::getNextEventLoop()
         return nullptr;
     }
 
-    return aws_event_loop_group_get_next_loop(eventLoopGroup->GetUnderlyingHandle());
+    return aws_event_loop_group_get_next_loop(getEventLoopGroup(role)->GetUnderlyingHandle());
 }
 
 aws_allocator *SharedCrtResourceManager::getAllocator()
@@ -525,7 +853,7 @@ aws_allocator *SharedCrtResourceManager::getAllocator()
     return allocator;
 }
 
-Aws::Crt::Io::ClientBootstrap *SharedCrtResourceManager::getClientBootstrap()
+Aws::Crt::Io::ClientBootstrap *SharedCrtResourceManager::getClientBootstrap(EventLoopRole role)
 {
     if (!initialized)
     {
@@ -533,18 +861,34 @@ Aws::Crt::Io::ClientBootstrap *SharedCrtResourceManager::getClientBootstrap()
         return nullptr;
     }
 
+    if (role == EventLoopRole::DATA_PLANE && dataPlaneClientBootstrap)
+    {
+        return dataPlaneClientBootstrap.get();
+    }
     return clientBootstrap.get();
 }
 
+Aws::Crt::Io::HostResolver *SharedCrtResourceManager::getHostResolver()
+{
+    if (!initialized)
+    {
+        LOG_WARN(TAG, "Tried to get hostResolver but the SharedCrtResourceManager has not yet been initialized!");
+        return nullptr;
+    }
+
+    return defaultHostResolver.get();
+}
+
 void SharedCrtResourceManager::disconnect()
 {
     LOG_DEBUG(TAG, "Attempting to disconnect MQTT connection");
-    if (connection == NULL)
+    shared_ptr<MqttConnection> closingConnection = atomic_load(&connection);
+    if (closingConnection == NULL)
     {
         return;
     }
 
-    if (connection->Disconnect())
+    if (closingConnection->Disconnect())
     {
         if (connectionClosedPromise.get_future().wait_for(std::chrono::seconds(DEFAULT_WAIT_TIME_SECONDS)) ==
             future_status::timeout)
@@ -556,6 +900,9 @@ void SharedCrtResourceManager::disconnect()
     {
         LOG_ERROR(TAG, "MQTT Connection failed to disconnect");
     }
+    // The next connection may use different credentials, such as after fleet provisioning or a config reload.
+    // Publishes already handed to the gateway hold the connection until they are sent.
+    atomic_store(&connection, shared_ptr<MqttConnection>());
 }
 
 void SharedCrtResourceManager::startDeviceClientFeatures() const
@@ -570,4 +917,18 @@ void SharedCrtResourceManager::dumpMemTrace()
     {
         aws_mem_tracer_dump(allocator);
     }
+    if (poolAllocator)
+    {
+        PoolAllocator::Stats stats = poolAllocator->GetStats();
+        LOGM_INFO(
+            TAG,
+            "Pool allocator holds %zu live allocations, %zu of them large, using %zu of %zu reserved bytes in %zu "
+            "slabs (%.1f%% fragmented)",
+            stats.liveAllocations,
+            stats.largeAllocations,
+            stats.requestedBytes,
+            stats.reservedBytes,
+            stats.slabs,
+            poolAllocator->GetFragmentation() * 100);
+    }
 }
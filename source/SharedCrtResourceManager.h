@@ -7,11 +7,18 @@
 #include "Feature.h"
 #include "FeatureRegistry.h"
 #include "config/Config.h"
+#include "util/PoolAllocator.h"
+#include "util/PublishGateway.h"
+#include "util/PublishJournal.h"
 
 #include <atomic>
+#include <aws/common/task_scheduler.h>
 #include <aws/crt/Api.h>
 #include <aws/iot/MqttClient.h>
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 namespace Aws
 {
@@ -19,6 +26,17 @@ namespace Aws
     {
         namespace DeviceClient
         {
+            /**
+             * \brief Role of the event loops a feature runs its I/O on
+             */
+            enum class EventLoopRole
+            {
+                /** MQTT connection, DNS resolution and periodic reporting **/
+                CONTROL_PLANE,
+                /** Bulk data such as sensor sockets and secure tunnels **/
+                DATA_PLANE
+            };
+
             /**
              * \brief Utility class for managing the CRT SDK Resources
              *
@@ -28,19 +46,47 @@ namespace Aws
             class SharedCrtResourceManager
             {
               private:
-                const char *TAG = "SharedCrtResourceManager.cpp";
+                static constexpr char TAG[] = "SharedCrtResourceManager.cpp";
                 const char *BINARY_NAME = "IoTDeviceClient";
 
                 static constexpr int DEFAULT_WAIT_TIME_SECONDS = 10;
                 bool initialized = false;
                 std::atomic<bool> initializedAWSHttpLib{false};
                 std::promise<void> connectionClosedPromise;
+                /**
+                 * \brief Pools the allocations of the CRT when selected with AWS_CRT_ALLOCATOR=pool. Declared before
+                 * the CRT objects so that it outlives them.
+                 */
+                std::unique_ptr<Util::PoolAllocator> poolAllocator;
                 std::unique_ptr<Aws::Crt::ApiHandle> apiHandle;
                 std::unique_ptr<Aws::Crt::Io::EventLoopGroup> eventLoopGroup;
+                /**
+                 * \brief Event loops of the data plane, or null if the data plane shares the control plane loops
+                 */
+                std::unique_ptr<Aws::Crt::Io::EventLoopGroup> dataPlaneEventLoopGroup;
                 std::unique_ptr<Aws::Crt::Io::DefaultHostResolver> defaultHostResolver;
                 std::unique_ptr<Aws::Crt::Io::ClientBootstrap> clientBootstrap;
+                std::unique_ptr<Aws::Crt::Io::ClientBootstrap> dataPlaneClientBootstrap;
                 std::unique_ptr<Aws::Iot::MqttClient> mqttClient;
+                /**
+                 * \brief Only accessed with std::atomic_load and std::atomic_store, since disconnect() resets it
+                 * during a reload while features publish and the publish journal is replayed on other threads
+                 */
                 std::shared_ptr<Crt::Mqtt::MqttConnection> connection;
+                /**
+                 * \brief When the connection was last interrupted, used to log how long it took to resume. Only
+                 * accessed from the event loop running the connection.
+                 */
+                std::chrono::steady_clock::time_point connectionInterruptedAt;
+                /**
+                 * \brief Rate limits publishes on the connection. Declared after the connection so that messages still
+                 * queued on shutdown are discarded before the connection is released.
+                 */
+                std::shared_ptr<Util::PublishGateway> publishGateway;
+                /**
+                 * \brief Durable journal of the publishes of features that opted in, or null if it is disabled
+                 */
+                std::shared_ptr<Util::PublishJournal> publishJournal;
                 aws_allocator *allocator{nullptr};
                 aws_mem_trace_level memTraceLevel{AWS_MEMTRACE_NONE};
                 std::shared_ptr<Util::FeatureRegistry> features;
@@ -49,6 +95,66 @@ namespace Aws
 
                 int buildClient(const PlainConfig &config);
 
+                /**
+                 * \brief Create the MQTT connection along with its TLS context
+                 *
+                 * Loading the PKCS#11 library, logging into the secure element and parsing the certificates are only
+                 * done once, the connection and its TLS context are reused by later connection attempts.
+                 *
+                 * @return SUCCESS, or ABORT if the connection cannot be created with the given configuration
+                 */
+                int buildConnection(const PlainConfig &config);
+
+                /**
+                 * \brief CPU affinity and nice level to apply to the thread of an event loop, from that thread
+                 */
+                struct EventLoopThreadSettings
+                {
+                    aws_task task;
+                    const char *role;
+                    size_t index;
+                    std::vector<int> cpuAffinity;
+                    Aws::Crt::Optional<int> nice;
+                };
+
+                /**
+                 * \brief Create an event loop group and schedule a task on each of its loops that applies the
+                 * configured CPU affinity and nice level to the thread running the loop
+                 *
+                 * @param role name of the role of the group, used for logging
+                 * @param settings the configuration of the group
+                 * @return the event loop group, or null if it could not be created
+                 */
+                std::unique_ptr<Aws::Crt::Io::EventLoopGroup> buildEventLoopGroup(
+                    const char *role,
+                    const PlainConfig::EventLoops::LoopGroup &settings);
+
+                static void ApplyEventLoopThreadSettings(aws_task *task, void *arg, aws_task_status status);
+
+                /**
+                 * \brief Open the publish journal if it is enabled
+                 *
+                 * @return false if the journal is enabled but cannot be used
+                 */
+                bool buildPublishJournal(const PlainConfig &config);
+
+                /**
+                 * \brief Hand a publish to the publish gateway, acknowledging it in the journal once it completes if
+                 * it has a journal sequence number
+                 */
+                bool submitPublish(
+                    const std::string &topic,
+                    Crt::Mqtt::QOS qos,
+                    std::shared_ptr<std::string> message,
+                    Util::PublishGateway::Priority priority,
+                    uint64_t journalSequence,
+                    const Crt::Mqtt::OnOperationCompleteHandler &onComplete);
+
+                /**
+                 * \brief Publish again the journaled publishes that have not been acknowledged
+                 */
+                void replayPublishJournal();
+
                 void loadMemTraceLevelFromEnvironment();
 
               protected:
@@ -90,13 +196,51 @@ namespace Aws
 
                 virtual std::shared_ptr<Crt::Mqtt::MqttConnection> getConnection();
 
-                Aws::Crt::Io::EventLoopGroup *getEventLoopGroup();
+                /**
+                 * \brief The gateway every publish on the shared connection should go through, or null if the
+                 * SharedCrtResourceManager has not been initialized
+                 */
+                std::shared_ptr<Util::PublishGateway> getPublishGateway();
 
-                virtual aws_event_loop *getNextEventLoop();
+                /**
+                 * \brief Publish a message on the shared connection through the publish gateway
+                 *
+                 * @param topic the topic to publish to
+                 * @param qos the QoS of the publish
+                 * @param payload the payload, which is copied so it can be released as soon as this returns
+                 * @param priority the priority class of the message
+                 * @param onComplete called once the publish completes, if it was handed to the connection
+                 * @param durable whether to journal the publish so that it is published again after a reconnect or a
+                 * restart until the broker acknowledges it. Blocks until the publish is flushed to disk, so it must not
+                 * be set from an event loop thread. Ignored if the publish journal is disabled.
+                 * @return false if the message was dropped
+                 */
+                virtual bool publish(
+                    const std::string &topic,
+                    Crt::Mqtt::QOS qos,
+                    const aws_byte_cursor &payload,
+                    Util::PublishGateway::Priority priority,
+                    const Crt::Mqtt::OnOperationCompleteHandler &onComplete,
+                    bool durable = false);
+
+                /**
+                 * \brief The event loop group features of the given role should run on
+                 */
+                Aws::Crt::Io::EventLoopGroup *getEventLoopGroup(EventLoopRole role);
+
+                /**
+                 * \brief The next event loop of the group features of the given role should run on
+                 */
+                virtual aws_event_loop *getNextEventLoop(EventLoopRole role);
 
                 virtual aws_allocator *getAllocator();
 
-                virtual Aws::Crt::Io::ClientBootstrap *getClientBootstrap();
+                /**
+                 * \brief A client bootstrap whose connections run on the event loops of the given role
+                 */
+                virtual Aws::Crt::Io::ClientBootstrap *getClientBootstrap(EventLoopRole role);
+
+                virtual Aws::Crt::Io::HostResolver *getHostResolver();
 
                 void disconnect();
 
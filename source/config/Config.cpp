@@ -22,6 +22,7 @@
 #include "../util/MqttUtils.h"
 #include "../util/ProxyUtils.h"
 #include "../util/StringUtils.h"
+#include "ConfigSnapshot.h"
 #include "Version.h"
 
 #include <algorithm>
@@ -31,6 +32,8 @@
 #include <iostream>
 #include <map>
 #include <regex>
+#include <set>
+#include <sched.h>
 #include <stdexcept>
 #include <string>
 #include <sys/stat.h>
@@ -65,6 +68,10 @@ constexpr char PlainConfig::JSON_KEY_PUB_SUB[];
 constexpr char PlainConfig::JSON_KEY_SAMPLE_SHADOW[];
 constexpr char PlainConfig::JSON_KEY_CONFIG_SHADOW[];
 constexpr char PlainConfig::JSON_KEY_SECURE_ELEMENT[];
+constexpr char PlainConfig::JSON_KEY_EVENT_LOOPS[];
+constexpr char PlainConfig::JSON_KEY_PUBLISH_LIMITS[];
+constexpr char PlainConfig::JSON_KEY_PUBLISH_JOURNAL[];
+constexpr char PlainConfig::JSON_KEY_STARTUP[];
 constexpr char PlainConfig::JSON_KEY_SENSOR_PUBLISH[];
 constexpr char PlainConfig::DEFAULT_LOCK_FILE_PATH[];
 
@@ -240,6 +247,38 @@ bool PlainConfig::LoadFromJson(const Crt::JsonView &json)
         sensorPublish = temp;
     }
 
+    jsonKey = JSON_KEY_EVENT_LOOPS;
+    if (json.ValueExists(jsonKey))
+    {
+        EventLoops temp;
+        temp.LoadFromJson(json.GetJsonObject(jsonKey));
+        eventLoops = temp;
+    }
+
+    jsonKey = JSON_KEY_PUBLISH_LIMITS;
+    if (json.ValueExists(jsonKey))
+    {
+        PublishLimits temp;
+        temp.LoadFromJson(json.GetJsonObject(jsonKey));
+        publishLimits = temp;
+    }
+
+    jsonKey = JSON_KEY_PUBLISH_JOURNAL;
+    if (json.ValueExists(jsonKey))
+    {
+        PublishJournalConfig temp;
+        temp.LoadFromJson(json.GetJsonObject(jsonKey));
+        publishJournal = temp;
+    }
+
+    jsonKey = JSON_KEY_STARTUP;
+    if (json.ValueExists(jsonKey))
+    {
+        Startup temp;
+        temp.LoadFromJson(json.GetJsonObject(jsonKey));
+        startup = temp;
+    }
+
     return true;
 }
 
@@ -319,6 +358,22 @@ bool PlainConfig::Validate() const
     {
         return false;
     }
+    if (!eventLoops.Validate())
+    {
+        return false;
+    }
+    if (!publishLimits.Validate())
+    {
+        return false;
+    }
+    if (!publishJournal.Validate())
+    {
+        return false;
+    }
+    if (!startup.Validate())
+    {
+        return false;
+    }
     if (rootCa.has_value() && !rootCa->empty() && FileUtils::FileExists(rootCa->c_str()))
     {
         string parentDir = FileUtils::ExtractParentDirectory(rootCa->c_str());
@@ -490,6 +545,106 @@ void PlainConfig::SerializeToObject(Crt::JsonObject &object) const
     }
 }
 
+namespace
+{
+    template <typename T> bool sameOptional(const Aws::Crt::Optional<T> &first, const Aws::Crt::Optional<T> &second)
+    {
+        return first.has_value() == second.has_value() && (!first.has_value() || *first == *second);
+    }
+
+    bool sameJsonValue(const Crt::JsonView &first, const Crt::JsonView &second, const char *key)
+    {
+        if (first.ValueExists(key) != second.ValueExists(key))
+        {
+            return false;
+        }
+        return !first.ValueExists(key) ||
+               first.GetJsonObject(key).WriteCompact() == second.GetJsonObject(key).WriteCompact();
+    }
+
+    bool sameLoopGroup(
+        const PlainConfig::EventLoops::LoopGroup &first,
+        const PlainConfig::EventLoops::LoopGroup &second)
+    {
+        return first.threads == second.threads && first.cpuAffinity == second.cpuAffinity &&
+               sameOptional(first.nice, second.nice);
+    }
+} // namespace
+
+bool PlainConfig::HasSameConnectionSettings(const PlainConfig &other) const
+{
+    Crt::JsonObject secureElementObject;
+    secureElement.SerializeToObject(secureElementObject);
+    Crt::JsonObject otherSecureElementObject;
+    other.secureElement.SerializeToObject(otherSecureElementObject);
+
+    return sameOptional(endpoint, other.endpoint) && sameOptional(cert, other.cert) && sameOptional(key, other.key) &&
+           sameOptional(rootCa, other.rootCa) && sameOptional(thingName, other.thingName) &&
+           secureElementObject.View().WriteCompact() == otherSecureElementObject.View().WriteCompact() &&
+           httpProxyConfig.httpProxyEnabled == other.httpProxyConfig.httpProxyEnabled &&
+           httpProxyConfig.httpProxyAuthEnabled == other.httpProxyConfig.httpProxyAuthEnabled &&
+           sameOptional(httpProxyConfig.proxyHost, other.httpProxyConfig.proxyHost) &&
+           sameOptional(httpProxyConfig.proxyPort, other.httpProxyConfig.proxyPort) &&
+           sameOptional(httpProxyConfig.proxyAuthMethod, other.httpProxyConfig.proxyAuthMethod) &&
+           sameOptional(httpProxyConfig.proxyUsername, other.httpProxyConfig.proxyUsername) &&
+           sameOptional(httpProxyConfig.proxyPassword, other.httpProxyConfig.proxyPassword);
+}
+
+vector<string> PlainConfig::ChangedSections(const PlainConfig &other) const
+{
+    vector<string> changed;
+
+    Crt::JsonObject object;
+    SerializeToObject(object);
+    Crt::JsonObject otherObject;
+    other.SerializeToObject(otherObject);
+    for (const char *section :
+         {JSON_KEY_LOGGING,
+          JSON_KEY_JOBS,
+          JSON_KEY_TUNNELING,
+          JSON_KEY_DEVICE_DEFENDER,
+          JSON_KEY_FLEET_PROVISIONING,
+          JSON_KEY_RUNTIME_CONFIG,
+          JSON_KEY_CONFIG_SHADOW,
+          JSON_KEY_SAMPLE_SHADOW,
+          JSON_KEY_SENSOR_PUBLISH})
+    {
+        if (!sameJsonValue(object.View(), otherObject.View(), section))
+        {
+            changed.push_back(section);
+        }
+    }
+    if (!sameJsonValue(
+            object.View().GetJsonObject(JSON_KEY_SAMPLES),
+            otherObject.View().GetJsonObject(JSON_KEY_SAMPLES),
+            JSON_KEY_PUB_SUB))
+    {
+        changed.push_back(JSON_KEY_PUB_SUB);
+    }
+
+    // The sections below are not serialized
+    if (!sameLoopGroup(eventLoops.controlPlane, other.eventLoops.controlPlane) ||
+        eventLoops.dataPlane.has_value() != other.eventLoops.dataPlane.has_value() ||
+        (eventLoops.dataPlane.has_value() && !sameLoopGroup(*eventLoops.dataPlane, *other.eventLoops.dataPlane)))
+    {
+        changed.push_back(JSON_KEY_EVENT_LOOPS);
+    }
+    if (publishLimits.messagesPerSecond != other.publishLimits.messagesPerSecond ||
+        publishLimits.bytesPerSecond != other.publishLimits.bytesPerSecond ||
+        publishLimits.maxQueueDepth != other.publishLimits.maxQueueDepth)
+    {
+        changed.push_back(JSON_KEY_PUBLISH_LIMITS);
+    }
+    if (publishJournal.enabled != other.publishJournal.enabled ||
+        !sameOptional(publishJournal.directory, other.publishJournal.directory) ||
+        publishJournal.maxSize != other.publishJournal.maxSize)
+    {
+        changed.push_back(JSON_KEY_PUBLISH_JOURNAL);
+    }
+
+    return changed;
+}
+
 constexpr char PlainConfig::LogConfig::LOG_TYPE_FILE[];
 constexpr char PlainConfig::LogConfig::LOG_TYPE_STDOUT[];
 
@@ -799,6 +954,19 @@ constexpr char PlainConfig::Jobs::CLI_ENABLE_JOBS[];
 constexpr char PlainConfig::Jobs::CLI_HANDLER_DIR[];
 constexpr char PlainConfig::Jobs::JSON_KEY_ENABLED[];
 constexpr char PlainConfig::Jobs::JSON_KEY_HANDLER_DIR[];
+constexpr char PlainConfig::Jobs::JSON_KEY_DOWNLOAD_DIR[];
+constexpr char PlainConfig::Jobs::JSON_KEY_PROGRESS_INTERVAL[];
+constexpr char PlainConfig::Jobs::JSON_KEY_RESUME_JOBS[];
+constexpr char PlainConfig::Jobs::JSON_KEY_RESIDENT_HANDLERS[];
+constexpr char PlainConfig::Jobs::JSON_KEY_DEVICE_ATTRIBUTES[];
+constexpr char PlainConfig::Jobs::JSON_KEY_CGROUP_ISOLATION[];
+constexpr char PlainConfig::Jobs::JSON_KEY_CGROUP_PARENT[];
+constexpr char PlainConfig::Jobs::JSON_KEY_CGROUP_CPU_MAX[];
+constexpr char PlainConfig::Jobs::JSON_KEY_CGROUP_MEMORY_MAX[];
+constexpr char PlainConfig::Jobs::JSON_KEY_CGROUP_IO_WEIGHT[];
+constexpr int PlainConfig::Jobs::DEFAULT_PROGRESS_INTERVAL_SECONDS;
+constexpr int PlainConfig::Jobs::MIN_CGROUP_IO_WEIGHT;
+constexpr int PlainConfig::Jobs::MAX_CGROUP_IO_WEIGHT;
 
 bool PlainConfig::Jobs::LoadFromJson(const Crt::JsonView &json)
 {
@@ -814,6 +982,77 @@ bool PlainConfig::Jobs::LoadFromJson(const Crt::JsonView &json)
         handlerDir = FileUtils::ExtractExpandedPath(json.GetString(jsonKey).c_str());
     }
 
+    jsonKey = JSON_KEY_DOWNLOAD_DIR;
+    if (json.ValueExists(jsonKey) && !json.GetString(jsonKey).empty())
+    {
+        downloadDir = FileUtils::ExtractExpandedPath(json.GetString(jsonKey).c_str());
+    }
+
+    jsonKey = JSON_KEY_PROGRESS_INTERVAL;
+    if (json.ValueExists(jsonKey))
+    {
+        progressInterval = json.GetInteger(jsonKey);
+    }
+
+    jsonKey = JSON_KEY_RESUME_JOBS;
+    if (json.ValueExists(jsonKey))
+    {
+        resumeJobs = json.GetBool(jsonKey);
+    }
+
+    jsonKey = JSON_KEY_RESIDENT_HANDLERS;
+    if (json.ValueExists(jsonKey) && json.GetJsonObject(jsonKey).IsListType())
+    {
+        residentHandlers.clear();
+        for (const auto &handler : json.GetArray(jsonKey))
+        {
+            // Anything but a handler name is rejected by Validate
+            residentHandlers.push_back(handler.IsString() ? handler.AsString().c_str() : "");
+        }
+    }
+
+    jsonKey = JSON_KEY_DEVICE_ATTRIBUTES;
+    if (json.ValueExists(jsonKey) && json.GetJsonObject(jsonKey).IsObject())
+    {
+        deviceAttributes.clear();
+        for (const auto &attribute : json.GetJsonObject(jsonKey).GetAllObjects())
+        {
+            // Anything but a string value is rejected by Validate
+            deviceAttributes[attribute.first.c_str()] =
+                attribute.second.IsString() ? attribute.second.AsString().c_str() : "";
+        }
+    }
+
+    jsonKey = JSON_KEY_CGROUP_ISOLATION;
+    if (json.ValueExists(jsonKey))
+    {
+        cgroupIsolation = json.GetBool(jsonKey);
+    }
+
+    jsonKey = JSON_KEY_CGROUP_PARENT;
+    if (json.ValueExists(jsonKey) && !json.GetString(jsonKey).empty())
+    {
+        cgroupParent = json.GetString(jsonKey).c_str();
+    }
+
+    jsonKey = JSON_KEY_CGROUP_CPU_MAX;
+    if (json.ValueExists(jsonKey) && !json.GetString(jsonKey).empty())
+    {
+        cgroupCpuMax = json.GetString(jsonKey).c_str();
+    }
+
+    jsonKey = JSON_KEY_CGROUP_MEMORY_MAX;
+    if (json.ValueExists(jsonKey) && !json.GetString(jsonKey).empty())
+    {
+        cgroupMemoryMax = json.GetString(jsonKey).c_str();
+    }
+
+    jsonKey = JSON_KEY_CGROUP_IO_WEIGHT;
+    if (json.ValueExists(jsonKey))
+    {
+        cgroupIoWeight = json.GetInteger(jsonKey);
+    }
+
     return true;
 }
 
@@ -834,6 +1073,97 @@ bool PlainConfig::Jobs::LoadFromCliArgs(const CliArgs &cliArgs)
 
 bool PlainConfig::Jobs::Validate() const
 {
+    if (progressInterval < 0)
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: %s must not be negative ***",
+            DeviceClient::DC_FATAL_ERROR,
+            JSON_KEY_PROGRESS_INTERVAL);
+        return false;
+    }
+
+    if (!downloadDir.empty() && downloadDir.front() != '/')
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: %s must be an absolute path ***",
+            DeviceClient::DC_FATAL_ERROR,
+            JSON_KEY_DOWNLOAD_DIR);
+        return false;
+    }
+
+    for (const auto &handler : residentHandlers)
+    {
+        if (handler.empty() || handler == "." || handler == ".." ||
+            handler.find(Config::PATH_DIRECTORY_SEPARATOR) != string::npos)
+        {
+            LOGM_ERROR(
+                Config::TAG,
+                "*** %s: %s must only contain names of handlers in the handler directory ***",
+                DeviceClient::DC_FATAL_ERROR,
+                JSON_KEY_RESIDENT_HANDLERS);
+            return false;
+        }
+    }
+
+    for (const auto &attribute : deviceAttributes)
+    {
+        if (attribute.first.empty() || attribute.second.empty())
+        {
+            LOGM_ERROR(
+                Config::TAG,
+                "*** %s: %s must map names of attributes to non-empty strings ***",
+                DeviceClient::DC_FATAL_ERROR,
+                JSON_KEY_DEVICE_ATTRIBUTES);
+            return false;
+        }
+    }
+
+    if (cgroupParent.has_value() && cgroupParent->front() != '/')
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: %s must be an absolute path ***",
+            DeviceClient::DC_FATAL_ERROR,
+            JSON_KEY_CGROUP_PARENT);
+        return false;
+    }
+
+    // In the formats the kernel accepts: a quota and an optional period in microseconds, and a number of bytes
+    if (cgroupCpuMax.has_value() && !regex_match(*cgroupCpuMax, regex("(max|[0-9]+)( [0-9]+)?")))
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: %s must be \"max\" or a quota, optionally followed by a period, in microseconds ***",
+            DeviceClient::DC_FATAL_ERROR,
+            JSON_KEY_CGROUP_CPU_MAX);
+        return false;
+    }
+
+    if (cgroupMemoryMax.has_value() && !regex_match(*cgroupMemoryMax, regex("max|[0-9]+[KMG]?")))
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: %s must be \"max\" or a number of bytes, optionally followed by K, M or G ***",
+            DeviceClient::DC_FATAL_ERROR,
+            JSON_KEY_CGROUP_MEMORY_MAX);
+        return false;
+    }
+
+    if (cgroupIoWeight.has_value() &&
+        (cgroupIoWeight.value() < MIN_CGROUP_IO_WEIGHT || cgroupIoWeight.value() > MAX_CGROUP_IO_WEIGHT))
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: %s must be between %d and %d ***",
+            DeviceClient::DC_FATAL_ERROR,
+            JSON_KEY_CGROUP_IO_WEIGHT,
+            MIN_CGROUP_IO_WEIGHT,
+            MAX_CGROUP_IO_WEIGHT);
+        return false;
+    }
+
     return true;
 }
 
@@ -846,6 +1176,59 @@ void PlainConfig::Jobs::SerializeToObject(Crt::JsonObject &object) const
     {
         object.WithString(JSON_KEY_HANDLER_DIR, handlerDir.c_str());
     }
+
+    if (!downloadDir.empty())
+    {
+        object.WithString(JSON_KEY_DOWNLOAD_DIR, downloadDir.c_str());
+    }
+
+    object.WithInteger(JSON_KEY_PROGRESS_INTERVAL, progressInterval);
+
+    object.WithBool(JSON_KEY_RESUME_JOBS, resumeJobs);
+
+    if (!residentHandlers.empty())
+    {
+        Crt::Vector<Crt::JsonObject> handlers;
+        for (const auto &handler : residentHandlers)
+        {
+            Crt::JsonObject name;
+            name.AsString(handler.c_str());
+            handlers.push_back(name);
+        }
+        object.WithArray(JSON_KEY_RESIDENT_HANDLERS, handlers);
+    }
+
+    if (!deviceAttributes.empty())
+    {
+        Crt::JsonObject attributes;
+        for (const auto &attribute : deviceAttributes)
+        {
+            attributes.WithString(attribute.first.c_str(), attribute.second.c_str());
+        }
+        object.WithObject(JSON_KEY_DEVICE_ATTRIBUTES, attributes);
+    }
+
+    object.WithBool(JSON_KEY_CGROUP_ISOLATION, cgroupIsolation);
+
+    if (cgroupParent.has_value())
+    {
+        object.WithString(JSON_KEY_CGROUP_PARENT, cgroupParent->c_str());
+    }
+
+    if (cgroupCpuMax.has_value())
+    {
+        object.WithString(JSON_KEY_CGROUP_CPU_MAX, cgroupCpuMax->c_str());
+    }
+
+    if (cgroupMemoryMax.has_value())
+    {
+        object.WithString(JSON_KEY_CGROUP_MEMORY_MAX, cgroupMemoryMax->c_str());
+    }
+
+    if (cgroupIoWeight.has_value())
+    {
+        object.WithInteger(JSON_KEY_CGROUP_IO_WEIGHT, cgroupIoWeight.value());
+    }
 }
 
 constexpr char PlainConfig::Tunneling::CLI_ENABLE_TUNNELING[];
@@ -854,6 +1237,7 @@ constexpr char PlainConfig::Tunneling::CLI_TUNNELING_REGION[];
 constexpr char PlainConfig::Tunneling::CLI_TUNNELING_SERVICE[];
 constexpr char PlainConfig::Tunneling::JSON_KEY_ENABLED[];
 constexpr char PlainConfig::Tunneling::JSON_KEY_ENDPOINT[];
+constexpr char PlainConfig::Tunneling::JSON_KEY_PREWARM[];
 
 bool PlainConfig::Tunneling::LoadFromJson(const Crt::JsonView &json)
 {
@@ -869,6 +1253,12 @@ bool PlainConfig::Tunneling::LoadFromJson(const Crt::JsonView &json)
         endpoint = json.GetString(jsonKey).c_str();
     }
 
+    jsonKey = JSON_KEY_PREWARM;
+    if (json.ValueExists(jsonKey))
+    {
+        prewarm = json.GetBool(jsonKey);
+    }
+
     return true;
 }
 
@@ -948,6 +1338,8 @@ bool PlainConfig::Tunneling::Validate() const
 void PlainConfig::Tunneling::SerializeToObject(Crt::JsonObject &object) const
 {
     object.WithBool(JSON_KEY_ENABLED, enabled);
+
+    object.WithBool(JSON_KEY_PREWARM, prewarm);
 }
 
 constexpr char PlainConfig::DeviceDefender::CLI_ENABLE_DEVICE_DEFENDER[];
@@ -955,6 +1347,15 @@ constexpr char PlainConfig::DeviceDefender::CLI_DEVICE_DEFENDER_INTERVAL[];
 
 constexpr char PlainConfig::DeviceDefender::JSON_KEY_ENABLED[];
 constexpr char PlainConfig::DeviceDefender::JSON_KEY_INTERVAL[];
+constexpr char PlainConfig::DeviceDefender::JSON_KEY_COLLECTOR[];
+constexpr char PlainConfig::DeviceDefender::JSON_KEY_CUSTOM_METRICS[];
+constexpr char PlainConfig::DeviceDefender::COLLECTOR_SDK[];
+constexpr char PlainConfig::DeviceDefender::COLLECTOR_NATIVE[];
+constexpr char PlainConfig::DeviceDefender::CUSTOM_METRIC_CPU_USAGE[];
+constexpr char PlainConfig::DeviceDefender::CUSTOM_METRIC_MEMORY_USAGE[];
+constexpr char PlainConfig::DeviceDefender::CUSTOM_METRIC_DISK_USAGE[];
+constexpr char PlainConfig::DeviceDefender::CUSTOM_METRIC_TEMPERATURE[];
+constexpr char PlainConfig::DeviceDefender::CUSTOM_METRIC_THREAD_COUNT[];
 
 bool PlainConfig::DeviceDefender::LoadFromJson(const Crt::JsonView &json)
 {
@@ -970,6 +1371,23 @@ bool PlainConfig::DeviceDefender::LoadFromJson(const Crt::JsonView &json)
         interval = json.GetInteger(jsonKey);
     }
 
+    jsonKey = JSON_KEY_COLLECTOR;
+    if (json.ValueExists(jsonKey))
+    {
+        collector = json.GetString(jsonKey).c_str();
+    }
+
+    jsonKey = JSON_KEY_CUSTOM_METRICS;
+    if (json.ValueExists(jsonKey) && json.GetJsonObject(jsonKey).IsListType())
+    {
+        customMetrics.clear();
+        for (const auto &metric : json.GetArray(jsonKey))
+        {
+            // Anything but the name of a supported metric is rejected by Validate
+            customMetrics.push_back(metric.IsString() ? metric.AsString().c_str() : "");
+        }
+    }
+
     return true;
 }
 
@@ -1010,6 +1428,47 @@ bool PlainConfig::DeviceDefender::Validate() const
         LOGM_ERROR(Config::TAG, "*** %s: Interval value <= 0 ***", DeviceClient::DC_FATAL_ERROR);
         return false;
     }
+    if (collector != COLLECTOR_SDK && collector != COLLECTOR_NATIVE)
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: %s must be either %s or %s ***",
+            DeviceClient::DC_FATAL_ERROR,
+            JSON_KEY_COLLECTOR,
+            COLLECTOR_SDK,
+            COLLECTOR_NATIVE);
+        return false;
+    }
+    if (!customMetrics.empty() && collector != COLLECTOR_NATIVE)
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: %s are only supported by the %s collector ***",
+            DeviceClient::DC_FATAL_ERROR,
+            JSON_KEY_CUSTOM_METRICS,
+            COLLECTOR_NATIVE);
+        return false;
+    }
+
+    const vector<string> supportedMetrics = {
+        CUSTOM_METRIC_CPU_USAGE,
+        CUSTOM_METRIC_MEMORY_USAGE,
+        CUSTOM_METRIC_DISK_USAGE,
+        CUSTOM_METRIC_TEMPERATURE,
+        CUSTOM_METRIC_THREAD_COUNT};
+    for (const auto &metric : customMetrics)
+    {
+        if (find(supportedMetrics.begin(), supportedMetrics.end(), metric) == supportedMetrics.end())
+        {
+            LOGM_ERROR(
+                Config::TAG,
+                "*** %s: Unsupported metric {%s} in %s ***",
+                DeviceClient::DC_FATAL_ERROR,
+                Sanitize(metric).c_str(),
+                JSON_KEY_CUSTOM_METRICS);
+            return false;
+        }
+    }
 
     return true;
 }
@@ -1018,6 +1477,19 @@ void PlainConfig::DeviceDefender::SerializeToObject(Crt::JsonObject &object) con
 {
     object.WithBool(JSON_KEY_ENABLED, enabled);
     object.WithInteger(JSON_KEY_INTERVAL, interval);
+    object.WithString(JSON_KEY_COLLECTOR, collector.c_str());
+
+    if (!customMetrics.empty())
+    {
+        Crt::Vector<Crt::JsonObject> metrics;
+        for (const auto &metric : customMetrics)
+        {
+            Crt::JsonObject name;
+            name.AsString(metric.c_str());
+            metrics.push_back(name);
+        }
+        object.WithArray(JSON_KEY_CUSTOM_METRICS, metrics);
+    }
 }
 
 constexpr char PlainConfig::FleetProvisioning::CLI_ENABLE_FLEET_PROVISIONING[];
@@ -1481,6 +1953,281 @@ bool PlainConfig::HttpProxyConfig::Validate() const
     return true;
 }
 
+constexpr char PlainConfig::EventLoops::JSON_KEY_CONTROL_PLANE[];
+constexpr char PlainConfig::EventLoops::JSON_KEY_DATA_PLANE[];
+constexpr char PlainConfig::EventLoops::JSON_KEY_THREADS[];
+constexpr char PlainConfig::EventLoops::JSON_KEY_CPU_AFFINITY[];
+constexpr char PlainConfig::EventLoops::JSON_KEY_NICE[];
+constexpr int PlainConfig::EventLoops::MAX_THREADS;
+
+bool PlainConfig::EventLoops::LoadFromJson(const Crt::JsonView &json)
+{
+    const char *jsonKey = JSON_KEY_CONTROL_PLANE;
+    if (json.ValueExists(jsonKey))
+    {
+        LoadLoopGroup(json.GetJsonObject(jsonKey), controlPlane);
+    }
+
+    jsonKey = JSON_KEY_DATA_PLANE;
+    if (json.ValueExists(jsonKey))
+    {
+        LoopGroup temp;
+        LoadLoopGroup(json.GetJsonObject(jsonKey), temp);
+        dataPlane = temp;
+    }
+
+    return true;
+}
+
+bool PlainConfig::EventLoops::LoadLoopGroup(const Crt::JsonView &json, LoopGroup &group)
+{
+    const char *jsonKey = JSON_KEY_THREADS;
+    if (json.ValueExists(jsonKey))
+    {
+        group.threads = json.GetInteger(jsonKey);
+    }
+
+    jsonKey = JSON_KEY_CPU_AFFINITY;
+    if (json.ValueExists(jsonKey) && json.GetJsonObject(jsonKey).IsListType())
+    {
+        for (const auto &cpu : json.GetArray(jsonKey))
+        {
+            // Anything but a CPU number is rejected by Validate
+            group.cpuAffinity.push_back(cpu.IsIntegerType() ? cpu.AsInteger() : -1);
+        }
+    }
+
+    jsonKey = JSON_KEY_NICE;
+    if (json.ValueExists(jsonKey))
+    {
+        group.nice = json.GetInteger(jsonKey);
+    }
+
+    return true;
+}
+
+bool PlainConfig::EventLoops::Validate() const
+{
+    return ValidateLoopGroup(JSON_KEY_CONTROL_PLANE, controlPlane) &&
+           (!dataPlane.has_value() || ValidateLoopGroup(JSON_KEY_DATA_PLANE, dataPlane.value()));
+}
+
+bool PlainConfig::EventLoops::ValidateLoopGroup(const char *role, const LoopGroup &group)
+{
+    if (group.threads < 1 || group.threads > MAX_THREADS)
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: %s %s must be between 1 and %d ***",
+            DeviceClient::DC_FATAL_ERROR,
+            role,
+            JSON_KEY_THREADS,
+            MAX_THREADS);
+        return false;
+    }
+
+    for (int cpu : group.cpuAffinity)
+    {
+        if (cpu < 0 || cpu >= CPU_SETSIZE)
+        {
+            LOGM_ERROR(
+                Config::TAG,
+                "*** %s: %s %s must only contain CPU numbers between 0 and %d ***",
+                DeviceClient::DC_FATAL_ERROR,
+                role,
+                JSON_KEY_CPU_AFFINITY,
+                CPU_SETSIZE - 1);
+            return false;
+        }
+    }
+
+    if (group.nice.has_value() && (group.nice.value() < -20 || group.nice.value() > 19))
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: %s %s must be between -20 and 19 ***",
+            DeviceClient::DC_FATAL_ERROR,
+            role,
+            JSON_KEY_NICE);
+        return false;
+    }
+
+    return true;
+}
+
+constexpr char PlainConfig::PublishLimits::JSON_KEY_MESSAGES_PER_SECOND[];
+constexpr char PlainConfig::PublishLimits::JSON_KEY_BYTES_PER_SECOND[];
+constexpr char PlainConfig::PublishLimits::JSON_KEY_MAX_QUEUE_DEPTH[];
+constexpr int PlainConfig::PublishLimits::DEFAULT_MESSAGES_PER_SECOND;
+constexpr int PlainConfig::PublishLimits::DEFAULT_BYTES_PER_SECOND;
+constexpr int PlainConfig::PublishLimits::DEFAULT_MAX_QUEUE_DEPTH;
+
+bool PlainConfig::PublishLimits::LoadFromJson(const Crt::JsonView &json)
+{
+    const char *jsonKey = JSON_KEY_MESSAGES_PER_SECOND;
+    if (json.ValueExists(jsonKey))
+    {
+        messagesPerSecond = json.GetInteger(jsonKey);
+    }
+
+    jsonKey = JSON_KEY_BYTES_PER_SECOND;
+    if (json.ValueExists(jsonKey))
+    {
+        bytesPerSecond = json.GetInteger(jsonKey);
+    }
+
+    jsonKey = JSON_KEY_MAX_QUEUE_DEPTH;
+    if (json.ValueExists(jsonKey))
+    {
+        maxQueueDepth = json.GetInteger(jsonKey);
+    }
+
+    return true;
+}
+
+bool PlainConfig::PublishLimits::Validate() const
+{
+    if (messagesPerSecond < 0 || bytesPerSecond < 0)
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: %s and %s must not be negative ***",
+            DeviceClient::DC_FATAL_ERROR,
+            JSON_KEY_MESSAGES_PER_SECOND,
+            JSON_KEY_BYTES_PER_SECOND);
+        return false;
+    }
+
+    if (maxQueueDepth < 1)
+    {
+        LOGM_ERROR(
+            Config::TAG, "*** %s: %s must be at least 1 ***", DeviceClient::DC_FATAL_ERROR, JSON_KEY_MAX_QUEUE_DEPTH);
+        return false;
+    }
+
+    return true;
+}
+
+constexpr char PlainConfig::PublishJournalConfig::JSON_KEY_ENABLED[];
+constexpr char PlainConfig::PublishJournalConfig::JSON_KEY_DIRECTORY[];
+constexpr char PlainConfig::PublishJournalConfig::JSON_KEY_MAX_SIZE[];
+constexpr int PlainConfig::PublishJournalConfig::DEFAULT_MAX_SIZE;
+constexpr int PlainConfig::PublishJournalConfig::MIN_MAX_SIZE;
+
+bool PlainConfig::PublishJournalConfig::LoadFromJson(const Crt::JsonView &json)
+{
+    const char *jsonKey = JSON_KEY_ENABLED;
+    if (json.ValueExists(jsonKey))
+    {
+        enabled = json.GetBool(jsonKey);
+    }
+
+    jsonKey = JSON_KEY_DIRECTORY;
+    if (json.ValueExists(jsonKey))
+    {
+        if (!json.GetString(jsonKey).empty())
+        {
+            directory = FileUtils::ExtractExpandedPath(json.GetString(jsonKey).c_str());
+        }
+    }
+
+    jsonKey = JSON_KEY_MAX_SIZE;
+    if (json.ValueExists(jsonKey))
+    {
+        maxSize = json.GetInteger(jsonKey);
+    }
+
+    return true;
+}
+
+bool PlainConfig::PublishJournalConfig::Validate() const
+{
+    if (!enabled)
+    {
+        return true;
+    }
+
+    if (maxSize < MIN_MAX_SIZE)
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: %s must be at least %d bytes ***",
+            DeviceClient::DC_FATAL_ERROR,
+            JSON_KEY_MAX_SIZE,
+            MIN_MAX_SIZE);
+        return false;
+    }
+
+    if (directory.has_value())
+    {
+        if (!FileUtils::DirectoryExists(directory->c_str()))
+        {
+            LOGM_ERROR(
+                Config::TAG,
+                "*** %s: Publish journal directory %s does not exist ***",
+                DeviceClient::DC_FATAL_ERROR,
+                Sanitize(directory->c_str()).c_str());
+            return false;
+        }
+        if (!FileUtils::ValidateFilePermissions(directory->c_str(), Permissions::PUBLISH_JOURNAL_DIR))
+        {
+            LOGM_ERROR(
+                Config::TAG,
+                "*** %s: Incorrect permissions on publish journal directory %s ***",
+                DeviceClient::DC_FATAL_ERROR,
+                Sanitize(directory->c_str()).c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+constexpr char PlainConfig::Startup::JSON_KEY_TRACE_FILE[];
+constexpr char PlainConfig::Startup::JSON_KEY_FAST_START[];
+constexpr char PlainConfig::Startup::JSON_KEY_CONFIG_SNAPSHOT[];
+
+bool PlainConfig::Startup::LoadFromJson(const Crt::JsonView &json)
+{
+    const char *jsonKey = JSON_KEY_TRACE_FILE;
+    if (json.ValueExists(jsonKey))
+    {
+        if (!json.GetString(jsonKey).empty())
+        {
+            traceFile = FileUtils::ExtractExpandedPath(json.GetString(jsonKey).c_str());
+        }
+    }
+
+    jsonKey = JSON_KEY_FAST_START;
+    if (json.ValueExists(jsonKey))
+    {
+        fastStart = json.GetBool(jsonKey);
+    }
+
+    jsonKey = JSON_KEY_CONFIG_SNAPSHOT;
+    if (json.ValueExists(jsonKey))
+    {
+        configSnapshot = json.GetBool(jsonKey);
+    }
+
+    return true;
+}
+
+bool PlainConfig::Startup::Validate() const
+{
+    if (traceFile.has_value() && !FileUtils::DirectoryExists(FileUtils::ExtractParentDirectory(traceFile->c_str())))
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: Directory of the startup trace file %s does not exist ***",
+            DeviceClient::DC_FATAL_ERROR,
+            Sanitize(traceFile->c_str()).c_str());
+        return false;
+    }
+
+    return true;
+}
+
 constexpr char PlainConfig::PubSub::CLI_ENABLE_PUB_SUB[];
 constexpr char PlainConfig::PubSub::CLI_PUB_SUB_PUBLISH_TOPIC[];
 constexpr char PlainConfig::PubSub::CLI_PUB_SUB_PUBLISH_FILE[];
@@ -1656,6 +2403,9 @@ constexpr char PlainConfig::SampleShadow::JSON_ENABLE_SAMPLE_SHADOW[];
 constexpr char PlainConfig::SampleShadow::JSON_SAMPLE_SHADOW_NAME[];
 constexpr char PlainConfig::SampleShadow::JSON_SAMPLE_SHADOW_INPUT_FILE[];
 constexpr char PlainConfig::SampleShadow::JSON_SAMPLE_SHADOW_OUTPUT_FILE[];
+constexpr char PlainConfig::SampleShadow::JSON_SAMPLE_SHADOW_LOCAL_SOCKET[];
+constexpr char PlainConfig::SampleShadow::JSON_SAMPLE_SHADOW_INPUT_DIRECTORY[];
+constexpr char PlainConfig::SampleShadow::JSON_SAMPLE_SHADOW_OUTPUT_DIRECTORY[];
 
 bool PlainConfig::SampleShadow::createShadowOutputFile()
 {
@@ -1717,7 +2467,7 @@ bool PlainConfig::SampleShadow::LoadFromJson(const Crt::JsonView &json)
         {
             shadowName = json.GetString(jsonKey).c_str();
         }
-        else
+        else if (!json.ValueExists(JSON_SAMPLE_SHADOW_INPUT_DIRECTORY))
         {
             LOGM_WARN(
                 Config::TAG,
@@ -1746,6 +2496,24 @@ bool PlainConfig::SampleShadow::LoadFromJson(const Crt::JsonView &json)
         {
             shadowOutputFile = FileUtils::ExtractExpandedPath(json.GetString(jsonKey).c_str());
         }
+
+        jsonKey = JSON_SAMPLE_SHADOW_LOCAL_SOCKET;
+        if (json.ValueExists(jsonKey) && !json.GetString(jsonKey).empty())
+        {
+            shadowLocalSocket = FileUtils::ExtractExpandedPath(json.GetString(jsonKey).c_str());
+        }
+
+        jsonKey = JSON_SAMPLE_SHADOW_INPUT_DIRECTORY;
+        if (json.ValueExists(jsonKey) && !json.GetString(jsonKey).empty())
+        {
+            shadowInputDirectory = FileUtils::ExtractExpandedPath(json.GetString(jsonKey).c_str());
+        }
+
+        jsonKey = JSON_SAMPLE_SHADOW_OUTPUT_DIRECTORY;
+        if (json.ValueExists(jsonKey) && !json.GetString(jsonKey).empty())
+        {
+            shadowOutputDirectory = FileUtils::ExtractExpandedPath(json.GetString(jsonKey).c_str());
+        }
     }
 
     return true;
@@ -1789,7 +2557,8 @@ bool PlainConfig::SampleShadow::Validate() const
         return true;
     }
 
-    if (!shadowName.has_value() || shadowName->empty())
+    bool hasInputDirectory = shadowInputDirectory.has_value() && !shadowInputDirectory->empty();
+    if (!hasInputDirectory && (!shadowName.has_value() || shadowName->empty()))
     {
         LOGM_ERROR(
             Config::TAG,
@@ -1798,6 +2567,57 @@ bool PlainConfig::SampleShadow::Validate() const
         return false;
     }
 
+    if (hasInputDirectory)
+    {
+        if (!FileUtils::DirectoryExists(shadowInputDirectory.value()))
+        {
+            LOGM_ERROR(
+                Config::TAG,
+                "*** %s: Directory {%s} passed for argument %s does not exist ***",
+                DeviceClient::DC_FATAL_ERROR,
+                Sanitize(shadowInputDirectory.value()).c_str(),
+                JSON_SAMPLE_SHADOW_INPUT_DIRECTORY);
+            return false;
+        }
+        if (!FileUtils::ValidateFilePermissions(shadowInputDirectory.value(), Permissions::SAMPLE_SHADOW_DIR))
+        {
+            return false;
+        }
+    }
+
+    if (shadowOutputDirectory.has_value() && !shadowOutputDirectory->empty())
+    {
+        if (!FileUtils::DirectoryExists(shadowOutputDirectory.value()))
+        {
+            LOGM_ERROR(
+                Config::TAG,
+                "*** %s: Directory {%s} passed for argument %s does not exist ***",
+                DeviceClient::DC_FATAL_ERROR,
+                Sanitize(shadowOutputDirectory.value()).c_str(),
+                JSON_SAMPLE_SHADOW_OUTPUT_DIRECTORY);
+            return false;
+        }
+        if (!FileUtils::ValidateFilePermissions(shadowOutputDirectory.value(), Permissions::SAMPLE_SHADOW_DIR))
+        {
+            return false;
+        }
+    }
+
+    auto withTrailingSlash = [](const string &directory) {
+        return directory.back() == '/' ? directory : directory + "/";
+    };
+    if (hasInputDirectory && shadowOutputDirectory.has_value() && !shadowOutputDirectory->empty() &&
+        withTrailingSlash(shadowInputDirectory.value()) == withTrailingSlash(shadowOutputDirectory.value()))
+    {
+        LOGM_ERROR(
+            Config::TAG,
+            "*** %s: %s and %s must be different directories ***",
+            DeviceClient::DC_FATAL_ERROR,
+            JSON_SAMPLE_SHADOW_INPUT_DIRECTORY,
+            JSON_SAMPLE_SHADOW_OUTPUT_DIRECTORY);
+        return false;
+    }
+
     if (shadowInputFile.has_value() && !shadowInputFile->empty())
     {
         if (FileUtils::IsValidFilePath(shadowInputFile->c_str()))
@@ -1852,6 +2672,28 @@ bool PlainConfig::SampleShadow::Validate() const
         }
     }
 
+    if (shadowLocalSocket.has_value() && !shadowLocalSocket->empty())
+    {
+        auto socketParentDir = FileUtils::ExtractParentDirectory(shadowLocalSocket.value());
+        if (!FileUtils::ValidateFilePermissions(socketParentDir, Permissions::SAMPLE_SHADOW_SOCKET_DIR))
+        {
+            return false;
+        }
+
+        // Include extra character for terminating null byte.
+        if (shadowLocalSocket->length() + 1 > AWS_ADDRESS_MAX_LEN)
+        {
+            LOGM_ERROR(
+                Config::TAG,
+                "*** %s: Config %s length (%ld) exceeds maximum (%ld)",
+                DeviceClient::DC_FATAL_ERROR,
+                JSON_SAMPLE_SHADOW_LOCAL_SOCKET,
+                shadowLocalSocket->length() + 1,
+                AWS_ADDRESS_MAX_LEN);
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -1874,6 +2716,21 @@ void PlainConfig::SampleShadow::SerializeToObject(Crt::JsonObject &object) const
     {
         object.WithString(JSON_SAMPLE_SHADOW_OUTPUT_FILE, shadowOutputFile->c_str());
     }
+
+    if (shadowLocalSocket.has_value())
+    {
+        object.WithString(JSON_SAMPLE_SHADOW_LOCAL_SOCKET, shadowLocalSocket->c_str());
+    }
+
+    if (shadowInputDirectory.has_value())
+    {
+        object.WithString(JSON_SAMPLE_SHADOW_INPUT_DIRECTORY, shadowInputDirectory->c_str());
+    }
+
+    if (shadowOutputDirectory.has_value())
+    {
+        object.WithString(JSON_SAMPLE_SHADOW_OUTPUT_DIRECTORY, shadowOutputDirectory->c_str());
+    }
 }
 
 constexpr char PlainConfig::ConfigShadow::JSON_ENABLE_CONFIG_SHADOW[];
@@ -2493,6 +3350,10 @@ constexpr char Config::CLI_CONFIG_FILE[];
 constexpr char Config::DEFAULT_FLEET_PROVISIONING_RUNTIME_CONFIG_FILE[];
 constexpr char Config::DEFAULT_SAMPLE_SHADOW_OUTPUT_DIR[];
 constexpr char Config::DEFAULT_SAMPLE_SHADOW_DOCUMENT_FILE[];
+constexpr char Config::DEFAULT_PUBLISH_JOURNAL_DIR[];
+constexpr char Config::DEFAULT_LAST_KNOWN_GOOD_CONFIG_FILE[];
+constexpr char Config::DEFAULT_CONFIG_SNAPSHOT_FILE[];
+constexpr char Config::DEFAULT_JOB_JOURNAL_FILE[];
 constexpr char Config::DEFAULT_HTTP_PROXY_CONFIG_FILE[];
 
 bool Config::CheckTerminalArgs(int argc, char **argv)
@@ -2717,6 +3578,10 @@ bool Config::init(const CliArgs &cliArgs)
             return true;
         }
 
+        if (config.startup.configSnapshot)
+        {
+            return ValidateWithSnapshot(cliArgs, bReadConfigFile ? filename : "");
+        }
         return config.Validate();
     }
     catch (const std::exception &e)
@@ -2759,6 +3624,44 @@ bool Config::ValidateAndStoreHttpProxyConfig() const
     return true;
 }
 
+bool Config::ValidateWithSnapshot(const CliArgs &cliArgs, const string &configFile) const
+{
+    ConfigSnapshot snapshot(Config::DEFAULT_CONFIG_SNAPSHOT_FILE);
+    snapshot.AddInput("version", DEVICE_CLIENT_VERSION_FULL);
+    if (!configFile.empty())
+    {
+        snapshot.AddFileInput(configFile);
+    }
+    snapshot.AddFileInput(Config::DEFAULT_FLEET_PROVISIONING_RUNTIME_CONFIG_FILE);
+    snapshot.AddFileInput(config.httpProxyConfig.proxyConfigPath->c_str());
+    for (const auto &arg : cliArgs)
+    {
+        snapshot.AddInput(arg.first, arg.second);
+    }
+    for (const char *name : {"HOME", "LOCK_FILE_PATH", "AWSIOT_TUNNEL_ACCESS_TOKEN"})
+    {
+        const char *value = std::getenv(name);
+        snapshot.AddInput(name, value == nullptr ? "" : value);
+    }
+
+    if (snapshot.Matches())
+    {
+        LOG_INFO(TAG, "Configuration matches the config snapshot, skipping validation");
+        // Validating Sensor Publish disables invalid sensors, so it cannot be skipped
+        return config.sensorPublish.Validate();
+    }
+
+    FileUtils::StartRecordingCheckedPaths();
+    bool valid = config.Validate();
+    set<string> checkedPaths = FileUtils::StopRecordingCheckedPaths();
+    if (valid && FileUtils::DirectoryExists(FileUtils::ExtractParentDirectory(
+                     FileUtils::ExtractExpandedPath(Config::DEFAULT_CONFIG_SNAPSHOT_FILE))))
+    {
+        snapshot.Store(checkedPaths);
+    }
+    return valid;
+}
+
 bool Config::ParseConfigFile(const string &file, ConfigFileType configFileType)
 {
     string expandedPath = FileUtils::ExtractExpandedPath(file.c_str());
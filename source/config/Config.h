@@ -47,6 +47,9 @@ namespace Aws
                 static constexpr int PUBSUB_DIR = 745;
                 static constexpr int PKCS11_LIB_DIR = 700;
                 static constexpr int SENSOR_PUBLISH_ADDR_DIR = 700;
+                static constexpr int SAMPLE_SHADOW_SOCKET_DIR = 700;
+                static constexpr int SAMPLE_SHADOW_DIR = 700;
+                static constexpr int PUBLISH_JOURNAL_DIR = 700;
 
                 /** Files **/
                 static constexpr int PRIVATE_KEY = 600;
@@ -62,6 +65,8 @@ namespace Aws
                 static constexpr int SENSOR_PUBLISH_ADDR_FILE = 660;
                 static constexpr int PKCS11_LIB_FILE = 640;
                 static constexpr int HTTP_PROXY_CONFIG_FILE = 600;
+                static constexpr int CONFIG_SNAPSHOT_FILE = 600;
+                static constexpr int JOB_JOURNAL_FILE = 600;
             };
 
             struct PlainConfig : public LoadableFromJsonAndCliAndEnvironment
@@ -72,6 +77,10 @@ namespace Aws
                 bool Validate() const override;
                 /** Serialize configurations To Json Object **/
                 void SerializeToObject(Crt::JsonObject &object) const;
+                /** Whether the MQTT connection built from both configurations would be the same **/
+                bool HasSameConnectionSettings(const PlainConfig &other) const;
+                /** JSON keys of the sections, besides the connection settings, that differ from another config **/
+                std::vector<std::string> ChangedSections(const PlainConfig &other) const;
 
                 static constexpr char CLI_ENDPOINT[] = "--endpoint";
                 static constexpr char CLI_CERT[] = "--cert";
@@ -102,6 +111,14 @@ namespace Aws
 
                 static constexpr char JSON_KEY_SECURE_ELEMENT[] = "secure-element";
 
+                static constexpr char JSON_KEY_EVENT_LOOPS[] = "event-loops";
+
+                static constexpr char JSON_KEY_PUBLISH_LIMITS[] = "publish-limits";
+
+                static constexpr char JSON_KEY_PUBLISH_JOURNAL[] = "publish-journal";
+
+                static constexpr char JSON_KEY_STARTUP[] = "startup";
+
                 Aws::Crt::Optional<std::string> endpoint;
                 Aws::Crt::Optional<std::string> cert;
                 Aws::Crt::Optional<std::string> key;
@@ -165,9 +182,64 @@ namespace Aws
                     static constexpr char CLI_HANDLER_DIR[] = "--jobs-handler-dir";
                     static constexpr char JSON_KEY_ENABLED[] = "enabled";
                     static constexpr char JSON_KEY_HANDLER_DIR[] = "handler-directory";
+                    static constexpr char JSON_KEY_DOWNLOAD_DIR[] = "download-directory";
+                    static constexpr char JSON_KEY_PROGRESS_INTERVAL[] = "progress-interval";
+                    static constexpr char JSON_KEY_RESUME_JOBS[] = "resume-jobs";
+                    static constexpr char JSON_KEY_RESIDENT_HANDLERS[] = "resident-handlers";
+                    static constexpr char JSON_KEY_DEVICE_ATTRIBUTES[] = "device-attributes";
+                    static constexpr char JSON_KEY_CGROUP_ISOLATION[] = "cgroup-isolation";
+                    static constexpr char JSON_KEY_CGROUP_PARENT[] = "cgroup-parent";
+                    static constexpr char JSON_KEY_CGROUP_CPU_MAX[] = "cgroup-cpu-max";
+                    static constexpr char JSON_KEY_CGROUP_MEMORY_MAX[] = "cgroup-memory-max";
+                    static constexpr char JSON_KEY_CGROUP_IO_WEIGHT[] = "cgroup-io-weight";
+
+                    static constexpr int DEFAULT_PROGRESS_INTERVAL_SECONDS = 30;
+                    static constexpr int MIN_CGROUP_IO_WEIGHT = 1;
+                    static constexpr int MAX_CGROUP_IO_WEIGHT = 10000;
 
                     bool enabled{true};
                     std::string handlerDir;
+                    /**
+                     * The directory the files of "download" actions are written under, or empty for the default
+                     */
+                    std::string downloadDir;
+                    /**
+                     * Seconds between the progress updates of a running job, or zero to only report the job once
+                     * it completes
+                     */
+                    int progressInterval{DEFAULT_PROGRESS_INTERVAL_SECONDS};
+                    /**
+                     * Whether a job interrupted by a restart of the Device Client resumes at its first step that had
+                     * not completed, instead of running all of its steps again
+                     */
+                    bool resumeJobs{true};
+                    /**
+                     * Names of handlers in the handler directory that are kept running between steps and receive
+                     * each step as a request, instead of being executed for every step
+                     */
+                    std::vector<std::string> residentHandlers;
+                    /**
+                     * Attributes of the device, such as its operating system, that the conditions of job documents are
+                     * evaluated against. A job with a condition on one of them that the device does not meet is
+                     * rejected.
+                     */
+                    std::map<std::string, std::string> deviceAttributes;
+
+                    /**
+                     * Whether each step that runs a handler or a command is placed in a cgroup v2 group of its own,
+                     * limited by the cgroup settings below
+                     */
+                    bool cgroupIsolation{false};
+                    /**
+                     * The cgroup the groups of steps are created in, or the cgroup of the Device Client if not set
+                     */
+                    Aws::Crt::Optional<std::string> cgroupParent;
+                    /** Written to cpu.max of each step, e.g. "50000 100000" for half a CPU **/
+                    Aws::Crt::Optional<std::string> cgroupCpuMax;
+                    /** Written to memory.max of each step, e.g. "256M" **/
+                    Aws::Crt::Optional<std::string> cgroupMemoryMax;
+                    /** Written to io.weight of each step, from 1 to 10000 **/
+                    Aws::Crt::Optional<int> cgroupIoWeight;
                 };
                 Jobs jobs;
 
@@ -186,9 +258,14 @@ namespace Aws
                     static constexpr char CLI_TUNNELING_SERVICE[] = "--tunneling-service";
                     static constexpr char JSON_KEY_ENABLED[] = "enabled";
                     static constexpr char JSON_KEY_ENDPOINT[] = "endpoint";
+                    static constexpr char JSON_KEY_PREWARM[] = "prewarm";
 
                     bool enabled{true};
                     bool subscribeNotification{true};
+
+                    // When enabled, the Secure Tunneling feature resolves the data plane endpoint for the device's
+                    // region at start and keeps it resolved so that a new tunnel does not wait on DNS.
+                    bool prewarm{false};
                     Aws::Crt::Optional<std::string> destinationAccessToken;
                     Aws::Crt::Optional<std::string> region;
                     Aws::Crt::Optional<int> port;
@@ -213,9 +290,28 @@ namespace Aws
 
                     static constexpr char JSON_KEY_ENABLED[] = "enabled";
                     static constexpr char JSON_KEY_INTERVAL[] = "interval";
+                    static constexpr char JSON_KEY_COLLECTOR[] = "collector";
+                    static constexpr char JSON_KEY_CUSTOM_METRICS[] = "custom-metrics";
+
+                    /** The metrics are collected and reported by the Device Defender library of the SDK **/
+                    static constexpr char COLLECTOR_SDK[] = "sdk";
+                    /** The metrics are collected and reported by the Device Client itself **/
+                    static constexpr char COLLECTOR_NATIVE[] = "native";
+
+                    static constexpr char CUSTOM_METRIC_CPU_USAGE[] = "cpu-usage";
+                    static constexpr char CUSTOM_METRIC_MEMORY_USAGE[] = "memory-usage";
+                    static constexpr char CUSTOM_METRIC_DISK_USAGE[] = "disk-usage";
+                    static constexpr char CUSTOM_METRIC_TEMPERATURE[] = "temperature";
+                    static constexpr char CUSTOM_METRIC_THREAD_COUNT[] = "thread-count";
 
                     bool enabled{false};
                     int interval{300};
+                    std::string collector{COLLECTOR_SDK};
+                    /**
+                     * The custom metrics reported along with the standard ones, which only the native collector
+                     * supports
+                     */
+                    std::vector<std::string> customMetrics;
                 };
                 DeviceDefender deviceDefender;
 
@@ -301,6 +397,105 @@ namespace Aws
                 };
                 HttpProxyConfig httpProxyConfig;
 
+                struct EventLoops : public LoadableFromJsonAndCliAndEnvironment
+                {
+                    bool LoadFromJson(const Crt::JsonView &json) override;
+                    bool LoadFromCliArgs(const CliArgs &cliArgs) override { return true; }
+                    bool LoadFromEnvironment() override { return true; }
+                    bool Validate() const override;
+
+                    static constexpr char JSON_KEY_CONTROL_PLANE[] = "control-plane";
+                    static constexpr char JSON_KEY_DATA_PLANE[] = "data-plane";
+                    static constexpr char JSON_KEY_THREADS[] = "threads";
+                    static constexpr char JSON_KEY_CPU_AFFINITY[] = "cpu-affinity";
+                    static constexpr char JSON_KEY_NICE[] = "nice";
+
+                    static constexpr int MAX_THREADS = 16;
+
+                    struct LoopGroup
+                    {
+                        int threads{1};
+                        /** CPUs the threads of the group may run on. Empty to let the scheduler decide. **/
+                        std::vector<int> cpuAffinity;
+                        Aws::Crt::Optional<int> nice;
+                    };
+
+                    /** Loops running the MQTT connection, DNS resolution and the Device Defender report task **/
+                    LoopGroup controlPlane;
+                    /** Loops running sensor sockets and secure tunnels. Unset to share the control plane loops. **/
+                    Aws::Crt::Optional<LoopGroup> dataPlane;
+
+                  private:
+                    static bool LoadLoopGroup(const Crt::JsonView &json, LoopGroup &group);
+                    static bool ValidateLoopGroup(const char *role, const LoopGroup &group);
+                };
+                EventLoops eventLoops;
+
+                struct PublishLimits : public LoadableFromJsonAndCliAndEnvironment
+                {
+                    bool LoadFromJson(const Crt::JsonView &json) override;
+                    bool LoadFromCliArgs(const CliArgs &cliArgs) override { return true; }
+                    bool LoadFromEnvironment() override { return true; }
+                    bool Validate() const override;
+
+                    static constexpr char JSON_KEY_MESSAGES_PER_SECOND[] = "messages-per-second";
+                    static constexpr char JSON_KEY_BYTES_PER_SECOND[] = "bytes-per-second";
+                    static constexpr char JSON_KEY_MAX_QUEUE_DEPTH[] = "max-queue-depth";
+
+                    /** AWS IoT Core limits on publish requests and throughput per connection **/
+                    static constexpr int DEFAULT_MESSAGES_PER_SECOND = 100;
+                    static constexpr int DEFAULT_BYTES_PER_SECOND = 512 * 1024;
+                    static constexpr int DEFAULT_MAX_QUEUE_DEPTH = 1000;
+
+                    /** 0 disables the corresponding limit **/
+                    int messagesPerSecond{DEFAULT_MESSAGES_PER_SECOND};
+                    int bytesPerSecond{DEFAULT_BYTES_PER_SECOND};
+                    /** Messages each priority can queue before new ones are dropped **/
+                    int maxQueueDepth{DEFAULT_MAX_QUEUE_DEPTH};
+                };
+                PublishLimits publishLimits;
+
+                struct PublishJournalConfig : public LoadableFromJsonAndCliAndEnvironment
+                {
+                    bool LoadFromJson(const Crt::JsonView &json) override;
+                    bool LoadFromCliArgs(const CliArgs &cliArgs) override { return true; }
+                    bool LoadFromEnvironment() override { return true; }
+                    bool Validate() const override;
+
+                    static constexpr char JSON_KEY_ENABLED[] = "enabled";
+                    static constexpr char JSON_KEY_DIRECTORY[] = "directory";
+                    static constexpr char JSON_KEY_MAX_SIZE[] = "max-size-bytes";
+
+                    static constexpr int DEFAULT_MAX_SIZE = 16 * 1024 * 1024;
+                    static constexpr int MIN_MAX_SIZE = 64 * 1024;
+
+                    bool enabled{false};
+                    /** Directory of the journal segments. Unset to use the default directory. **/
+                    Aws::Crt::Optional<std::string> directory;
+                    int maxSize{DEFAULT_MAX_SIZE};
+                };
+                PublishJournalConfig publishJournal;
+
+                struct Startup : public LoadableFromJsonAndCliAndEnvironment
+                {
+                    bool LoadFromJson(const Crt::JsonView &json) override;
+                    bool LoadFromCliArgs(const CliArgs &cliArgs) override { return true; }
+                    bool LoadFromEnvironment() override { return true; }
+                    bool Validate() const override;
+
+                    static constexpr char JSON_KEY_TRACE_FILE[] = "trace-file";
+                    static constexpr char JSON_KEY_FAST_START[] = "fast-start";
+                    static constexpr char JSON_KEY_CONFIG_SNAPSHOT[] = "config-snapshot";
+
+                    /** File the startup trace is written to in the Chrome trace event format, if set **/
+                    Aws::Crt::Optional<std::string> traceFile;
+                    /** Start features from the last known good config shadow while it is reconciled **/
+                    bool fastStart{false};
+                    /** Skip validating the configuration when it matches the last one that was validated **/
+                    bool configSnapshot{false};
+                };
+                Startup startup;
+
                 struct PubSub : public LoadableFromJsonAndCliAndEnvironment
                 {
                     bool LoadFromJson(const Crt::JsonView &json) override;
@@ -351,6 +546,9 @@ namespace Aws
                     static constexpr char JSON_SAMPLE_SHADOW_NAME[] = "shadow-name";
                     static constexpr char JSON_SAMPLE_SHADOW_INPUT_FILE[] = "shadow-input-file";
                     static constexpr char JSON_SAMPLE_SHADOW_OUTPUT_FILE[] = "shadow-output-file";
+                    static constexpr char JSON_SAMPLE_SHADOW_LOCAL_SOCKET[] = "shadow-local-socket";
+                    static constexpr char JSON_SAMPLE_SHADOW_INPUT_DIRECTORY[] = "shadow-input-directory";
+                    static constexpr char JSON_SAMPLE_SHADOW_OUTPUT_DIRECTORY[] = "shadow-output-directory";
 
                     static constexpr int MAXIMUM_SHADOW_INPUT_FILE_SIZE = 8 * 1024;
 
@@ -358,6 +556,13 @@ namespace Aws
                     Aws::Crt::Optional<std::string> shadowName;
                     Aws::Crt::Optional<std::string> shadowInputFile;
                     Aws::Crt::Optional<std::string> shadowOutputFile;
+                    /** Unix domain socket the shadow is served on to local applications **/
+                    Aws::Crt::Optional<std::string> shadowLocalSocket;
+                    /** Directory of <shadow-name>.json documents, each published to the named shadow of the same name
+                     * **/
+                    Aws::Crt::Optional<std::string> shadowInputDirectory;
+                    /** Directory the latest document of each shadow of the input directory is written to **/
+                    Aws::Crt::Optional<std::string> shadowOutputDirectory;
                 };
                 SampleShadow sampleShadow;
 
@@ -491,6 +696,11 @@ namespace Aws
                 static constexpr char DEFAULT_HTTP_PROXY_CONFIG_FILE[] = "~/.aws-iot-device-client/http-proxy.conf";
                 static constexpr char DEFAULT_SAMPLE_SHADOW_OUTPUT_DIR[] = "~/.aws-iot-device-client/sample-shadow/";
                 static constexpr char DEFAULT_SAMPLE_SHADOW_DOCUMENT_FILE[] = "default-sample-shadow-document";
+                static constexpr char DEFAULT_PUBLISH_JOURNAL_DIR[] = "~/.aws-iot-device-client/publish-journal/";
+                static constexpr char DEFAULT_LAST_KNOWN_GOOD_CONFIG_FILE[] =
+                    "~/.aws-iot-device-client/config-shadow-last-known-good.json";
+                static constexpr char DEFAULT_CONFIG_SNAPSHOT_FILE[] = "~/.aws-iot-device-client/config-snapshot";
+                static constexpr char DEFAULT_JOB_JOURNAL_FILE[] = "~/.aws-iot-device-client/job-journal";
 
                 static constexpr char CLI_HELP[] = "--help";
                 static constexpr char CLI_VERSION[] = "--version";
@@ -511,6 +721,11 @@ namespace Aws
                 static bool ParseCliArgs(int argc, char *argv[], CliArgs &cliArgs);
                 bool ValidateAndStoreRuntimeConfig();
                 bool ValidateAndStoreHttpProxyConfig() const;
+                /**
+                 * \brief Validate the configuration, skipping validation when the config snapshot shows the same
+                 * configuration was already validated and nothing it was validated against has changed
+                 */
+                bool ValidateWithSnapshot(const CliArgs &cliArgs, const std::string &configFile) const;
                 bool ParseConfigFile(const std::string &file, ConfigFileType configFileType);
                 bool init(const CliArgs &cliArgs);
 
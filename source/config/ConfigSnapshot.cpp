@@ -0,0 +1,150 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ConfigSnapshot.h"
+#include "../logging/LoggerFactory.h"
+#include "../util/FileUtils.h"
+#include "../util/HashUtils.h"
+#include "../util/StringUtils.h"
+#include "Config.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient;
+using namespace Aws::Iot::DeviceClient::Util;
+using namespace Aws::Iot::DeviceClient::Logging;
+
+constexpr char ConfigSnapshot::TAG[];
+constexpr char ConfigSnapshot::HEADER[];
+
+ConfigSnapshot::ConfigSnapshot(const string &file)
+    : file(FileUtils::ExtractExpandedPath(file)), key(FNV1A_OFFSET_BASIS)
+{
+}
+
+void ConfigSnapshot::hash(const string &value)
+{
+    // Prefix each value with its length so that different splits of the same bytes hash differently
+    key = Fnv1a(to_string(value.size()) + ":" + value, key);
+}
+
+void ConfigSnapshot::AddInput(const string &name, const string &value)
+{
+    hash(name);
+    hash(value);
+}
+
+void ConfigSnapshot::AddFileInput(const string &path)
+{
+    string expandedPath = FileUtils::ExtractExpandedPath(path);
+    ifstream input(expandedPath, ios::binary);
+    if (!input.is_open())
+    {
+        AddInput(expandedPath, "");
+        hash("missing");
+        return;
+    }
+    stringstream contents;
+    contents << input.rdbuf();
+    AddInput(expandedPath, contents.str());
+}
+
+string ConfigSnapshot::fingerprint(const string &path)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+    {
+        return "missing";
+    }
+    ostringstream fingerprint;
+    fingerprint << info.st_dev << ':' << info.st_ino << ':' << info.st_mode << ':' << info.st_uid << ':'
+                << info.st_gid << ':' << info.st_ctim.tv_sec << ':' << info.st_ctim.tv_nsec;
+    return fingerprint.str();
+}
+
+bool ConfigSnapshot::Matches() const
+{
+    if (!FileUtils::FileExists(file))
+    {
+        LOG_DEBUG(TAG, "No config snapshot has been stored yet");
+        return false;
+    }
+    if (!FileUtils::ValidateFileOwnershipPermissions(file) ||
+        !FileUtils::ValidateFilePermissions(file, Permissions::CONFIG_SNAPSHOT_FILE, false))
+    {
+        return false;
+    }
+
+    ifstream snapshot(file);
+    string line;
+    if (!getline(snapshot, line) || line != HEADER)
+    {
+        LOG_WARN(TAG, "Ignoring config snapshot in an unknown format");
+        return false;
+    }
+    if (!getline(snapshot, line) || line != to_string(key))
+    {
+        LOG_INFO(TAG, "Configuration inputs have changed since the config snapshot was stored");
+        return false;
+    }
+    while (getline(snapshot, line))
+    {
+        size_t separator = line.find('\t');
+        if (separator == string::npos)
+        {
+            LOG_WARN(TAG, "Ignoring malformed config snapshot");
+            return false;
+        }
+        string path = line.substr(separator + 1);
+        if (line.substr(0, separator) != fingerprint(path))
+        {
+            LOGM_INFO(TAG, "%s has changed since the config snapshot was stored", Sanitize(path).c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ConfigSnapshot::Store(const set<string> &checkedPaths) const
+{
+    ostringstream snapshot;
+    snapshot << HEADER << '\n' << key << '\n';
+    for (const auto &path : checkedPaths)
+    {
+        if (path.find('\n') != string::npos)
+        {
+            LOGM_WARN(TAG, "Not storing a config snapshot since %s contains a newline", Sanitize(path).c_str());
+            return false;
+        }
+        snapshot << fingerprint(path) << '\t' << path << '\n';
+    }
+
+    // Write to a temporary file first so that a crash never leaves a partial snapshot behind
+    string temporaryFile = file + ".tmp";
+    {
+        ofstream output(temporaryFile, ios::trunc);
+        if (!output.is_open())
+        {
+            LOGM_WARN(TAG, "Unable to open file: '%s'", Sanitize(temporaryFile).c_str());
+            return false;
+        }
+        chmod(temporaryFile.c_str(), S_IRUSR | S_IWUSR);
+        output << snapshot.str();
+        if (!output)
+        {
+            LOGM_WARN(TAG, "Unable to write file: '%s'", Sanitize(temporaryFile).c_str());
+            return false;
+        }
+    }
+    if (rename(temporaryFile.c_str(), file.c_str()) != 0)
+    {
+        LOGM_WARN(TAG, "Unable to store config snapshot to: '%s'", Sanitize(file).c_str());
+        return false;
+    }
+    LOGM_DEBUG(TAG, "Stored config snapshot of %zu paths to %s", checkedPaths.size(), Sanitize(file).c_str());
+    return true;
+}
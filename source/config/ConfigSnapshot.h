@@ -0,0 +1,75 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_CONFIGSNAPSHOT_H
+#define AWS_IOT_DEVICE_CLIENT_CONFIGSNAPSHOT_H
+
+#include <cstdint>
+#include <set>
+#include <string>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            /**
+             * \brief Remembers that a configuration was validated, so that the next start with the same inputs can
+             * skip validating it again.
+             *
+             * The snapshot is keyed by a hash of every input the configuration was loaded from, such as the contents
+             * of the configuration files, the command line arguments and the environment. It also holds a fingerprint
+             * of each file and directory examined during validation, made of its inode, owner, permissions and change
+             * time, so that creating, deleting, replacing or changing the permissions of any of them invalidates the
+             * snapshot.
+             */
+            class ConfigSnapshot
+            {
+              public:
+                /**
+                 * @param file path of the snapshot file
+                 */
+                explicit ConfigSnapshot(const std::string &file);
+
+                /**
+                 * \brief Add a named value to the inputs the snapshot is keyed by
+                 */
+                void AddInput(const std::string &name, const std::string &value);
+
+                /**
+                 * \brief Add the contents of a file to the inputs the snapshot is keyed by. A missing file is an input
+                 * too.
+                 */
+                void AddFileInput(const std::string &path);
+
+                /**
+                 * \brief Whether the stored snapshot was taken with the same inputs and none of the paths examined
+                 * during its validation have changed since
+                 */
+                bool Matches() const;
+
+                /**
+                 * \brief Store a snapshot of the inputs added so far
+                 *
+                 * @param checkedPaths the paths examined while validating the configuration
+                 * @return false if the snapshot could not be written
+                 */
+                bool Store(const std::set<std::string> &checkedPaths) const;
+
+              private:
+                static constexpr char TAG[] = "ConfigSnapshot.cpp";
+                static constexpr char HEADER[] = "aws-iot-device-client-config-snapshot 1";
+
+                std::string file;
+                /** FNV-1a hash of the inputs **/
+                uint64_t key;
+
+                void hash(const std::string &value);
+                static std::string fingerprint(const std::string &path);
+            };
+        } // namespace DeviceClient
+    }     // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_CONFIGSNAPSHOT_H
@@ -3,6 +3,8 @@
 
 #include "DeviceDefenderFeature.h"
 #include "../logging/LoggerFactory.h"
+#include "MetricsCollector.h"
+#include "NativeReportTask.h"
 #include "ReportTaskWrapper.h"
 
 #include <aws/iotdevicedefender/DeviceDefender.h>
@@ -63,6 +65,8 @@ int DeviceDefenderFeature::init(
     resourceManager = manager;
     baseNotifier = notifier;
     interval = config.deviceDefender.interval;
+    collector = config.deviceDefender.collector;
+    customMetrics = config.deviceDefender.customMetrics;
     thingName = *config.thingName;
     return 0;
 }
@@ -82,6 +86,27 @@ int DeviceDefenderFeature::stop()
 }
 std::shared_ptr<AbstractReportTask> DeviceDefender::DeviceDefenderFeature::createReportTask()
 {
+    if (collector == PlainConfig::DeviceDefender::COLLECTOR_NATIVE)
+    {
+        LOGM_INFO(
+            TAG,
+            "%s native collector interval: %i, custom metrics: %zu",
+            getName().c_str(),
+            interval,
+            customMetrics.size());
+        const string topic = FormatMessage(TOPIC_FORMAT, TOPIC_PRE, thingName.c_str(), TOPIC_POST, "");
+        shared_ptr<SharedCrtResourceManager> manager = resourceManager;
+        auto publish = [manager, topic](const string &payload) {
+            return manager->publish(
+                topic,
+                AWS_MQTT_QOS_AT_LEAST_ONCE,
+                aws_byte_cursor_from_array(payload.data(), payload.size()),
+                PublishGateway::Priority::TELEMETRY,
+                nullptr);
+        };
+        return std::make_shared<NativeReportTask>(
+            interval, unique_ptr<MetricsCollector>(new MetricsCollector(customMetrics)), publish);
+    }
 
     auto onCancelled = [this](void *userData) -> void {
         LOGM_DEBUG(TAG, "task called onCancelled for thing: %s", thingName.c_str());
@@ -91,7 +116,7 @@ std::shared_ptr<AbstractReportTask> DeviceDefender::DeviceDefenderFeature::creat
     Iotdevicedefenderv1::ReportTaskBuilder taskBuilder(
         resourceManager->getAllocator(),
         resourceManager->getConnection(),
-        *resourceManager->getEventLoopGroup(),
+        *resourceManager->getEventLoopGroup(EventLoopRole::CONTROL_PLANE),
         String(thingName.c_str()));
     taskBuilder.WithTaskPeriodSeconds((uint32_t)interval);
     taskBuilder.WithNetworkConnectionSamplePeriodSeconds((uint32_t)interval);
@@ -13,6 +13,9 @@
 #include "../SharedCrtResourceManager.h"
 #include "ReportTaskWrapper.h"
 
+#include <string>
+#include <vector>
+
 namespace Aws
 {
     namespace Iot
@@ -63,6 +66,14 @@ namespace Aws
                      * \brief the ThingName to use
                      */
                     std::string thingName;
+                    /**
+                     * \brief Which collector gathers and reports the metrics, the SDK's or the Device Client's
+                     */
+                    std::string collector{PlainConfig::DeviceDefender::COLLECTOR_SDK};
+                    /**
+                     * \brief The custom metrics the native collector reports
+                     */
+                    std::vector<std::string> customMetrics;
 
                   private:
                     /**
@@ -109,7 +120,8 @@ namespace Aws
                     static constexpr char TOPIC_FORMAT[] = "%s%s%s%s";
 
                     /**
-                     * \brief Factory method for ReportTask to facilitate mocking
+                     * \brief Factory method for ReportTask to facilitate mocking. Builds the task of the SDK, or the
+                     * native one if the native collector is configured.
                      */
                     virtual std::shared_ptr<AbstractReportTask> createReportTask();
 
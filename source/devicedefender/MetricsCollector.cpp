@@ -0,0 +1,432 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "MetricsCollector.h"
+#include "../config/Config.h"
+#include "../logging/LoggerFactory.h"
+#include "../util/StringUtils.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient;
+using namespace Aws::Iot::DeviceClient::DeviceDefender;
+using namespace Aws::Iot::DeviceClient::Logging;
+using namespace Aws::Iot::DeviceClient::Util;
+
+constexpr char MetricsCollector::TAG[];
+constexpr size_t MetricsCollector::INITIAL_BUFFER_SIZE;
+
+namespace
+{
+    /** States of sockets in /proc/net/tcp and the like, as in include/net/tcp_states.h of the kernel **/
+    constexpr unsigned TCP_STATE_ESTABLISHED = 0x01;
+    constexpr unsigned TCP_STATE_LISTEN = 0x0A;
+    /** An unconnected UDP socket is reported as closed, which is how one bound to receive datagrams appears **/
+    constexpr unsigned UDP_STATE_UNCONNECTED = 0x07;
+
+    /**
+     * \brief Calls fn with each line of a buffer, which it terminates in place, so that the lines can be parsed with
+     * sscanf without it measuring the rest of the buffer each time
+     */
+    template <typename LineFn> void forEachLine(char *contents, size_t length, LineFn fn)
+    {
+        char *line = contents;
+        char *end = contents + length;
+        while (line < end)
+        {
+            char *newline = static_cast<char *>(memchr(line, '\n', end - line));
+            char *lineEnd = newline != nullptr ? newline : end;
+            *lineEnd = '\0';
+            fn(line);
+            line = lineEnd + 1;
+        }
+    }
+
+    long threadCpuMicros()
+    {
+        timespec now{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        return static_cast<long>(now.tv_sec) * 1000 * 1000 + now.tv_nsec / 1000;
+    }
+
+    uint64_t delta(uint64_t current, uint64_t last)
+    {
+        // Counters start over when an interface is recreated
+        return current >= last ? current - last : 0;
+    }
+
+    /**
+     * \brief Formats an address from /proc/net/tcp and the like, where it is printed as the hexadecimal value of each
+     * 32 bit word of the address in host byte order
+     */
+    string formatAddress(const char *hex, bool ipv6, unsigned port)
+    {
+        char address[INET6_ADDRSTRLEN] = {};
+        if (ipv6)
+        {
+            in6_addr ipv6Address{};
+            for (size_t i = 0; i < 4; i++)
+            {
+                char word[9] = {};
+                memcpy(word, hex + i * 8, 8);
+                uint32_t value = static_cast<uint32_t>(strtoul(word, nullptr, 16));
+                memcpy(ipv6Address.s6_addr + i * 4, &value, sizeof(value));
+            }
+            inet_ntop(AF_INET6, &ipv6Address, address, sizeof(address));
+            return FormatMessage("[%s]:%u", address, port);
+        }
+        in_addr ipv4Address{};
+        ipv4Address.s_addr = static_cast<uint32_t>(strtoul(hex, nullptr, 16));
+        inet_ntop(AF_INET, &ipv4Address, address, sizeof(address));
+        return FormatMessage("%s:%u", address, port);
+    }
+} // namespace
+
+MetricsCollector::MetricsCollector(const vector<string> &customMetrics, const string &root)
+    : customMetrics(customMetrics)
+{
+    open(tcp, root + "/proc/net/tcp");
+    open(tcp6, root + "/proc/net/tcp6");
+    open(udp, root + "/proc/net/udp");
+    open(udp6, root + "/proc/net/udp6");
+    open(netDev, root + "/proc/net/dev");
+
+    // Only the files the configured custom metrics are read from are kept open
+    auto configured = [&customMetrics](const char *name) {
+        return find(customMetrics.begin(), customMetrics.end(), name) != customMetrics.end();
+    };
+    if (configured(PlainConfig::DeviceDefender::CUSTOM_METRIC_CPU_USAGE))
+    {
+        open(stat, root + "/proc/stat");
+    }
+    if (configured(PlainConfig::DeviceDefender::CUSTOM_METRIC_MEMORY_USAGE))
+    {
+        open(meminfo, root + "/proc/meminfo");
+    }
+    if (configured(PlainConfig::DeviceDefender::CUSTOM_METRIC_THREAD_COUNT))
+    {
+        open(loadavg, root + "/proc/loadavg");
+    }
+    if (configured(PlainConfig::DeviceDefender::CUSTOM_METRIC_TEMPERATURE))
+    {
+        open(temperature, root + "/sys/class/thermal/thermal_zone0/temp");
+    }
+    if (configured(PlainConfig::DeviceDefender::CUSTOM_METRIC_DISK_USAGE))
+    {
+        const string rootDir = root.empty() ? "/" : root;
+        rootFd = ::open(rootDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (rootFd < 0)
+        {
+            LOGM_WARN(
+                TAG, "Unable to open %s to report its disk usage: %s", Sanitize(rootDir).c_str(), strerror(errno));
+        }
+    }
+
+    // The counters of the first sample are the difference since the collector was created
+    if (read(netDev))
+    {
+        parseNetworkCounters(netDev, lastNetworkCounters);
+    }
+    if (read(stat))
+    {
+        parseCpuTimes(stat, lastCpuTimes);
+    }
+}
+
+MetricsCollector::~MetricsCollector()
+{
+    for (SourceFile *file : {&tcp, &tcp6, &udp, &udp6, &netDev, &stat, &meminfo, &loadavg, &temperature})
+    {
+        if (file->fd >= 0)
+        {
+            close(file->fd);
+        }
+    }
+    if (rootFd >= 0)
+    {
+        close(rootFd);
+    }
+}
+
+MetricsCollector::Sample MetricsCollector::sample()
+{
+    const long startMicros = threadCpuMicros();
+    Sample sample;
+
+    if (read(tcp))
+    {
+        parseSockets(tcp, false, TCP_STATE_LISTEN, sample.listeningTcpPorts, &sample.establishedConnections);
+    }
+    if (read(tcp6))
+    {
+        parseSockets(tcp6, true, TCP_STATE_LISTEN, sample.listeningTcpPorts, &sample.establishedConnections);
+    }
+    if (read(udp))
+    {
+        parseSockets(udp, false, UDP_STATE_UNCONNECTED, sample.listeningUdpPorts, nullptr);
+    }
+    if (read(udp6))
+    {
+        parseSockets(udp6, true, UDP_STATE_UNCONNECTED, sample.listeningUdpPorts, nullptr);
+    }
+    // A port listened on over both IPv4 and IPv6 is reported once
+    for (auto *ports : {&sample.listeningTcpPorts, &sample.listeningUdpPorts})
+    {
+        sort(ports->begin(), ports->end());
+        ports->erase(unique(ports->begin(), ports->end()), ports->end());
+    }
+
+    NetworkCounters networkCounters;
+    if (read(netDev) && parseNetworkCounters(netDev, networkCounters))
+    {
+        sample.bytesIn = delta(networkCounters.bytesIn, lastNetworkCounters.bytesIn);
+        sample.bytesOut = delta(networkCounters.bytesOut, lastNetworkCounters.bytesOut);
+        sample.packetsIn = delta(networkCounters.packetsIn, lastNetworkCounters.packetsIn);
+        sample.packetsOut = delta(networkCounters.packetsOut, lastNetworkCounters.packetsOut);
+        lastNetworkCounters = networkCounters;
+    }
+
+    CpuTimes cpuTimes;
+    const bool cpuTimesRead = read(stat) && parseCpuTimes(stat, cpuTimes);
+    for (const auto &name : customMetrics)
+    {
+        sampleCustomMetric(name, cpuTimesRead ? &cpuTimes : nullptr, sample);
+    }
+    if (cpuTimesRead)
+    {
+        lastCpuTimes = cpuTimes;
+    }
+
+    sample.cpuMicros = threadCpuMicros() - startMicros;
+    LOGM_DEBUG(TAG, "Sampled Device Defender metrics in %ld microseconds of CPU time", sample.cpuMicros);
+    return sample;
+}
+
+void MetricsCollector::open(SourceFile &file, const string &path)
+{
+    file.path = path;
+    file.fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file.fd < 0)
+    {
+        LOGM_WARN(TAG, "Unable to open %s, its metrics are not reported: %s", Sanitize(path).c_str(), strerror(errno));
+        return;
+    }
+    file.buffer.resize(INITIAL_BUFFER_SIZE);
+}
+
+bool MetricsCollector::read(SourceFile &file)
+{
+    if (file.fd < 0)
+    {
+        return false;
+    }
+    file.length = 0;
+    while (true)
+    {
+        // One byte is kept free to terminate the contents
+        if (file.length + 1 >= file.buffer.size())
+        {
+            file.buffer.resize(file.buffer.size() * 2);
+        }
+        ssize_t bytesRead = pread(
+            file.fd,
+            file.buffer.data() + file.length,
+            file.buffer.size() - file.length - 1,
+            static_cast<off_t>(file.length));
+        if (bytesRead < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytesRead < 0)
+        {
+            LOGM_WARN(TAG, "Unable to read %s: %s", Sanitize(file.path).c_str(), strerror(errno));
+            return false;
+        }
+        if (bytesRead == 0)
+        {
+            break;
+        }
+        file.length += static_cast<size_t>(bytesRead);
+    }
+    file.buffer[file.length] = '\0';
+    return true;
+}
+
+void MetricsCollector::parseSockets(
+    SourceFile &file,
+    bool ipv6,
+    unsigned listeningState,
+    vector<uint16_t> &ports,
+    vector<Connection> *connections)
+{
+    forEachLine(file.buffer.data(), file.length, [&](const char *line) {
+        char localAddress[33] = {};
+        char remoteAddress[33] = {};
+        unsigned localPort = 0;
+        unsigned remotePort = 0;
+        unsigned state = 0;
+        // The heading, and any line that does not look like a socket, is skipped
+        if (sscanf(
+                line,
+                " %*s %32[0-9A-Fa-f]:%x %32[0-9A-Fa-f]:%x %x",
+                localAddress,
+                &localPort,
+                remoteAddress,
+                &remotePort,
+                &state) != 5 ||
+            strlen(remoteAddress) != (ipv6 ? 32 : 8))
+        {
+            return;
+        }
+        if (state == listeningState)
+        {
+            ports.push_back(static_cast<uint16_t>(localPort));
+        }
+        else if (connections != nullptr && state == TCP_STATE_ESTABLISHED)
+        {
+            connections->push_back({static_cast<uint16_t>(localPort), formatAddress(remoteAddress, ipv6, remotePort)});
+        }
+    });
+}
+
+bool MetricsCollector::parseNetworkCounters(SourceFile &file, NetworkCounters &counters)
+{
+    bool parsed = false;
+    counters = NetworkCounters();
+    forEachLine(file.buffer.data(), file.length, [&](char *line) {
+        char *colon = strchr(line, ':');
+        if (colon == nullptr)
+        {
+            return;
+        }
+        *colon = '\0';
+        char name[32] = {};
+        if (sscanf(line, " %31s", name) != 1 || strcmp(name, "lo") == 0)
+        {
+            return;
+        }
+        uint64_t bytesIn = 0;
+        uint64_t packetsIn = 0;
+        uint64_t bytesOut = 0;
+        uint64_t packetsOut = 0;
+        if (sscanf(
+                colon + 1,
+                " %" SCNu64 " %" SCNu64 " %*u %*u %*u %*u %*u %*u %" SCNu64 " %" SCNu64,
+                &bytesIn,
+                &packetsIn,
+                &bytesOut,
+                &packetsOut) == 4)
+        {
+            counters.bytesIn += bytesIn;
+            counters.packetsIn += packetsIn;
+            counters.bytesOut += bytesOut;
+            counters.packetsOut += packetsOut;
+            parsed = true;
+        }
+    });
+    return parsed;
+}
+
+bool MetricsCollector::parseCpuTimes(const SourceFile &file, CpuTimes &times)
+{
+    // The first line sums the time of every CPU, in the order user, nice, system, idle, iowait, irq, softirq and
+    // steal. Guest time is already counted as user time.
+    uint64_t fields[8] = {};
+    if (sscanf(
+            file.buffer.data(),
+            "cpu %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64,
+            &fields[0],
+            &fields[1],
+            &fields[2],
+            &fields[3],
+            &fields[4],
+            &fields[5],
+            &fields[6],
+            &fields[7]) < 4)
+    {
+        return false;
+    }
+    times.total = 0;
+    for (uint64_t field : fields)
+    {
+        times.total += field;
+    }
+    times.busy = times.total - fields[3] - fields[4];
+    return true;
+}
+
+void MetricsCollector::sampleCustomMetric(const string &name, const CpuTimes *cpuTimes, Sample &sample)
+{
+    if (name == PlainConfig::DeviceDefender::CUSTOM_METRIC_CPU_USAGE)
+    {
+        if (cpuTimes != nullptr && cpuTimes->total > lastCpuTimes.total)
+        {
+            sample.customMetrics[name] = 100.0 * static_cast<double>(delta(cpuTimes->busy, lastCpuTimes.busy)) /
+                                         static_cast<double>(cpuTimes->total - lastCpuTimes.total);
+        }
+    }
+    else if (name == PlainConfig::DeviceDefender::CUSTOM_METRIC_MEMORY_USAGE)
+    {
+        if (!read(meminfo))
+        {
+            return;
+        }
+        uint64_t totalKb = 0;
+        uint64_t availableKb = 0;
+        forEachLine(meminfo.buffer.data(), meminfo.length, [&](const char *line) {
+            sscanf(line, "MemTotal: %" SCNu64, &totalKb);
+            sscanf(line, "MemAvailable: %" SCNu64, &availableKb);
+        });
+        if (totalKb > 0 && availableKb <= totalKb)
+        {
+            sample.customMetrics[name] =
+                100.0 * static_cast<double>(totalKb - availableKb) / static_cast<double>(totalKb);
+        }
+    }
+    else if (name == PlainConfig::DeviceDefender::CUSTOM_METRIC_DISK_USAGE)
+    {
+        struct statvfs fileSystem
+        {
+        };
+        if (rootFd < 0 || fstatvfs(rootFd, &fileSystem) != 0)
+        {
+            return;
+        }
+        // Used as a share of what is available to unprivileged users, the way df reports it
+        const double used = static_cast<double>(fileSystem.f_blocks - fileSystem.f_bfree);
+        const double available = static_cast<double>(fileSystem.f_bavail);
+        if (used + available > 0)
+        {
+            sample.customMetrics[name] = 100.0 * used / (used + available);
+        }
+    }
+    else if (name == PlainConfig::DeviceDefender::CUSTOM_METRIC_TEMPERATURE)
+    {
+        long milliCelsius = 0;
+        if (read(temperature) && sscanf(temperature.buffer.data(), "%ld", &milliCelsius) == 1)
+        {
+            sample.customMetrics[name] = static_cast<double>(milliCelsius) / 1000.0;
+        }
+    }
+    else if (name == PlainConfig::DeviceDefender::CUSTOM_METRIC_THREAD_COUNT)
+    {
+        // The fourth field of /proc/loadavg counts the runnable and the total scheduling entities, which are threads
+        unsigned long threads = 0;
+        if (read(loadavg) && sscanf(loadavg.buffer.data(), "%*s %*s %*s %*u/%lu", &threads) == 1)
+        {
+            sample.customMetrics[name] = static_cast<double>(threads);
+        }
+    }
+}
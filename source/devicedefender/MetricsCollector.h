@@ -0,0 +1,155 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_METRICSCOLLECTOR_H
+#define AWS_IOT_DEVICE_CLIENT_METRICSCOLLECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace DeviceDefender
+            {
+                /**
+                 * \brief Samples the device-side metrics of Device Defender, and the custom metrics the Device Client
+                 * supports, from /proc and /sys
+                 *
+                 * The files are opened once and read with pread into buffers that are reused between samples, so a
+                 * sample costs a handful of system calls and no allocations once the buffers have grown to fit.
+                 * Counters such as the bytes received are reported as the difference since the previous sample.
+                 */
+                class MetricsCollector
+                {
+                  public:
+                    struct Connection
+                    {
+                        uint16_t localPort;
+                        /** The remote address and port, as in 192.168.0.1:8000 or [2001:db8::1]:8000 **/
+                        std::string remoteAddress;
+                    };
+
+                    struct Sample
+                    {
+                        std::vector<uint16_t> listeningTcpPorts;
+                        std::vector<uint16_t> listeningUdpPorts;
+                        std::vector<Connection> establishedConnections;
+                        /** Traffic on every interface but loopback since the previous sample **/
+                        uint64_t bytesIn{0};
+                        uint64_t bytesOut{0};
+                        uint64_t packetsIn{0};
+                        uint64_t packetsOut{0};
+                        /** The configured custom metrics that could be read, by name **/
+                        std::map<std::string, double> customMetrics;
+                        /** CPU time the collector spent taking the sample, in microseconds **/
+                        long cpuMicros{0};
+                    };
+
+                    /**
+                     * @param customMetrics the names of the custom metrics to sample, from PlainConfig::DeviceDefender
+                     * @param root the directory /proc, /sys and the file system whose disk usage is reported are
+                     * found under, which only tests change
+                     */
+                    explicit MetricsCollector(
+                        const std::vector<std::string> &customMetrics,
+                        const std::string &root = "");
+
+                    ~MetricsCollector();
+
+                    MetricsCollector(const MetricsCollector &) = delete;
+                    MetricsCollector &operator=(const MetricsCollector &) = delete;
+
+                    /**
+                     * \brief Takes a sample of the metrics. Files that cannot be read leave their metrics out of it.
+                     */
+                    Sample sample();
+
+                  private:
+                    static constexpr char TAG[] = "MetricsCollector.cpp";
+                    static constexpr size_t INITIAL_BUFFER_SIZE = 4096;
+
+                    /**
+                     * \brief A file kept open between samples, and the buffer it is read into
+                     */
+                    struct SourceFile
+                    {
+                        std::string path;
+                        int fd{-1};
+                        std::vector<char> buffer;
+                        /** The length of the contents read into the buffer by the last read **/
+                        size_t length{0};
+                    };
+
+                    struct CpuTimes
+                    {
+                        uint64_t busy{0};
+                        uint64_t total{0};
+                    };
+
+                    struct NetworkCounters
+                    {
+                        uint64_t bytesIn{0};
+                        uint64_t bytesOut{0};
+                        uint64_t packetsIn{0};
+                        uint64_t packetsOut{0};
+                    };
+
+                    std::vector<std::string> customMetrics;
+
+                    SourceFile tcp;
+                    SourceFile tcp6;
+                    SourceFile udp;
+                    SourceFile udp6;
+                    SourceFile netDev;
+                    SourceFile stat;
+                    SourceFile meminfo;
+                    SourceFile loadavg;
+                    SourceFile temperature;
+                    /** The root directory, whose file system the disk usage is reported for **/
+                    int rootFd{-1};
+
+                    NetworkCounters lastNetworkCounters;
+                    CpuTimes lastCpuTimes;
+
+                    static void open(SourceFile &file, const std::string &path);
+
+                    /**
+                     * \brief Reads the whole file from its start, growing its buffer as needed
+                     * @return false if the file could not be read
+                     */
+                    static bool read(SourceFile &file);
+
+                    /**
+                     * \brief Parses a table of sockets, /proc/net/tcp or the like, adding the local ports of those in
+                     * the given state to ports and, if connections is not null, the established connections to it.
+                     * Lines are terminated in place, so the file has to be read again before it is parsed again.
+                     */
+                    static void parseSockets(
+                        SourceFile &file,
+                        bool ipv6,
+                        unsigned listeningState,
+                        std::vector<uint16_t> &ports,
+                        std::vector<Connection> *connections);
+
+                    static bool parseNetworkCounters(SourceFile &file, NetworkCounters &counters);
+
+                    static bool parseCpuTimes(const SourceFile &file, CpuTimes &times);
+
+                    /**
+                     * \brief Adds the custom metric of the given name to the sample, if it can be read
+                     */
+                    void sampleCustomMetric(const std::string &name, const CpuTimes *cpuTimes, Sample &sample);
+                };
+            } // namespace DeviceDefender
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_METRICSCOLLECTOR_H
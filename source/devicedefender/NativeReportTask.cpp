@@ -0,0 +1,157 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "NativeReportTask.h"
+#include "../logging/LoggerFactory.h"
+
+#include <aws/crt/JsonObject.h>
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+using namespace Aws;
+using namespace Aws::Crt;
+using namespace Aws::Iot::DeviceClient::DeviceDefender;
+using namespace Aws::Iot::DeviceClient::Logging;
+
+constexpr char NativeReportTask::TAG[];
+constexpr char NativeReportTask::REPORT_VERSION[];
+
+namespace
+{
+    JsonObject portList(const vector<uint16_t> &ports)
+    {
+        Crt::Vector<JsonObject> entries;
+        for (uint16_t port : ports)
+        {
+            JsonObject entry;
+            entry.WithInteger("port", port);
+            entries.push_back(entry);
+        }
+        JsonObject list;
+        list.WithArray("ports", entries);
+        list.WithInteger("total", static_cast<int>(ports.size()));
+        return list;
+    }
+} // namespace
+
+NativeReportTask::NativeReportTask(int intervalSeconds, unique_ptr<MetricsCollector> collector, PublishFn publish)
+    : intervalSeconds(intervalSeconds), collector(std::move(collector)), publish(std::move(publish))
+{
+}
+
+NativeReportTask::~NativeReportTask()
+{
+    StopTask();
+}
+
+int NativeReportTask::StartTask()
+{
+    lock_guard<mutex> guard(lock);
+    if (reporter.joinable())
+    {
+        return 0;
+    }
+    stopped = false;
+    reporter = thread(&NativeReportTask::run, this);
+    return 0;
+}
+
+void NativeReportTask::StopTask()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopped = true;
+    }
+    wakeUp.notify_all();
+    if (reporter.joinable() && reporter.get_id() != this_thread::get_id())
+    {
+        reporter.join();
+    }
+}
+
+void NativeReportTask::run()
+{
+    unique_lock<mutex> guard(lock);
+    while (true)
+    {
+        if (wakeUp.wait_for(guard, chrono::seconds(intervalSeconds), [this] { return stopped; }))
+        {
+            return;
+        }
+        guard.unlock();
+
+        MetricsCollector::Sample sample = collector->sample();
+        // Identified by the time it was taken, like the reports of the SDK, but never reusing an identifier
+        const uint64_t now = static_cast<uint64_t>(
+            chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count());
+        lastReportId = max(now, lastReportId + 1);
+        const string report = buildReport(sample, lastReportId);
+        LOGM_DEBUG(
+            TAG,
+            "Publishing report %llu of %zu bytes, sampled in %ld microseconds of CPU time",
+            static_cast<unsigned long long>(lastReportId),
+            report.size(),
+            sample.cpuMicros);
+        if (!publish(report))
+        {
+            LOGM_WARN(TAG, "Report %llu was dropped", static_cast<unsigned long long>(lastReportId));
+        }
+
+        guard.lock();
+    }
+}
+
+string NativeReportTask::buildReport(const MetricsCollector::Sample &sample, uint64_t reportId)
+{
+    JsonObject header;
+    header.WithInt64("report_id", static_cast<int64_t>(reportId));
+    header.WithString("version", REPORT_VERSION);
+
+    JsonObject networkStats;
+    networkStats.WithInt64("bytes_in", static_cast<int64_t>(sample.bytesIn));
+    networkStats.WithInt64("bytes_out", static_cast<int64_t>(sample.bytesOut));
+    networkStats.WithInt64("packets_in", static_cast<int64_t>(sample.packetsIn));
+    networkStats.WithInt64("packets_out", static_cast<int64_t>(sample.packetsOut));
+
+    Crt::Vector<JsonObject> connections;
+    for (const auto &connection : sample.establishedConnections)
+    {
+        JsonObject entry;
+        entry.WithInteger("local_port", connection.localPort);
+        entry.WithString("remote_addr", connection.remoteAddress.c_str());
+        connections.push_back(entry);
+    }
+    JsonObject establishedConnections;
+    establishedConnections.WithArray("connections", connections);
+    establishedConnections.WithInteger("total", static_cast<int>(sample.establishedConnections.size()));
+    JsonObject tcpConnections;
+    tcpConnections.WithObject("established_connections", establishedConnections);
+
+    JsonObject metrics;
+    metrics.WithObject("listening_tcp_ports", portList(sample.listeningTcpPorts));
+    metrics.WithObject("listening_udp_ports", portList(sample.listeningUdpPorts));
+    metrics.WithObject("network_stats", networkStats);
+    metrics.WithObject("tcp_connections", tcpConnections);
+
+    JsonObject report;
+    report.WithObject("header", header);
+    report.WithObject("metrics", metrics);
+
+    if (!sample.customMetrics.empty())
+    {
+        JsonObject customMetrics;
+        for (const auto &metric : sample.customMetrics)
+        {
+            JsonObject value;
+            value.WithDouble("number", metric.second);
+            Crt::Vector<JsonObject> values;
+            values.push_back(value);
+            customMetrics.WithArray(metric.first.c_str(), values);
+        }
+        report.WithObject("custom_metrics", customMetrics);
+    }
+
+    return report.View().WriteCompact().c_str();
+}
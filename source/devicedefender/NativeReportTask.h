@@ -0,0 +1,81 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_NATIVEREPORTTASK_H
+#define AWS_IOT_DEVICE_CLIENT_NATIVEREPORTTASK_H
+
+#include "MetricsCollector.h"
+#include "ReportTaskWrapper.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace DeviceDefender
+            {
+                /**
+                 * \brief Publishes Device Defender reports built from the samples of a MetricsCollector, in place of
+                 * the report task of the SDK, so that custom metrics are reported along with the standard ones
+                 */
+                class NativeReportTask : public AbstractReportTask
+                {
+                  public:
+                    /**
+                     * \brief Publishes a report, returning false if it was dropped
+                     */
+                    using PublishFn = std::function<bool(const std::string &payload)>;
+
+                    /**
+                     * @param intervalSeconds the time between samples, each of which is published as a report
+                     * @param collector samples the metrics of the reports
+                     * @param publish publishes each report to the Device Defender metrics topic of the thing
+                     */
+                    NativeReportTask(
+                        int intervalSeconds,
+                        std::unique_ptr<MetricsCollector> collector,
+                        PublishFn publish);
+
+                    ~NativeReportTask() override;
+
+                    int StartTask() override;
+                    void StopTask() override;
+
+                    /**
+                     * \brief Builds a report in the JSON format of Device Defender from a sample
+                     * @param reportId the identifier of the report, which must be greater than that of the previous
+                     * report of the thing
+                     */
+                    static std::string buildReport(const MetricsCollector::Sample &sample, uint64_t reportId);
+
+                  private:
+                    static constexpr char TAG[] = "NativeReportTask.cpp";
+                    static constexpr char REPORT_VERSION[] = "1.0";
+
+                    const int intervalSeconds;
+                    std::unique_ptr<MetricsCollector> collector;
+                    PublishFn publish;
+
+                    std::mutex lock;
+                    std::condition_variable wakeUp;
+                    bool stopped{false};
+                    std::thread reporter;
+                    uint64_t lastReportId{0};
+
+                    void run();
+                };
+            } // namespace DeviceDefender
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_NATIVEREPORTTASK_H
@@ -0,0 +1,627 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "FileDownloader.h"
+#include "../logging/LoggerFactory.h"
+#include "../util/FileUtils.h"
+#include "../util/Retry.h"
+#include "../util/StringUtils.h"
+
+#include <aws/crt/crypto/Hash.h>
+#include <aws/crt/http/HttpConnection.h>
+#include <aws/crt/http/HttpRequestResponse.h>
+#include <aws/crt/io/SocketOptions.h>
+#include <aws/crt/io/TlsOptions.h>
+#include <aws/crt/io/Uri.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace Aws::Crt;
+using namespace Aws::Iot::DeviceClient::Jobs;
+using namespace Aws::Iot::DeviceClient::Logging;
+using namespace Aws::Iot::DeviceClient::Util;
+
+constexpr char FileDownloader::PART_FILE_SUFFIX[];
+constexpr char FileDownloader::PART_INFO_SUFFIX[];
+constexpr size_t FileDownloader::WINDOW_SIZE;
+constexpr int FileDownloader::MAX_REDIRECTS;
+constexpr uint32_t FileDownloader::CONNECT_TIMEOUT_MILLIS;
+constexpr uint32_t FileDownloader::STALL_TIMEOUT_MILLIS;
+constexpr long FileDownloader::DEFAULT_MAX_ATTEMPTS;
+constexpr long FileDownloader::DEFAULT_STARTING_BACKOFF_MILLIS;
+
+namespace
+{
+    constexpr char TAG[] = "FileDownloader.cpp";
+    constexpr long MAX_BACKOFF_MILLIS = 30 * 1000;
+    /** Smallest window when the rate is limited, so that a low limit still gets reasonably sized reads **/
+    constexpr size_t MIN_WINDOW_SIZE = 16 * 1024;
+
+    /**
+     * State shared with the callbacks of a connection and its stream
+     */
+    struct Transfer
+    {
+        mutex lock;
+        condition_variable changed;
+
+        bool connectionSetUp{false};
+        shared_ptr<Http::HttpClientConnection> connection;
+        int connectionError{AWS_ERROR_SUCCESS};
+
+        bool headersDone{false};
+        int statusCode{0};
+        /** Response headers keyed by their lower case names **/
+        map<string, string> headers;
+
+        deque<vector<uint8_t>> chunks;
+
+        bool complete{false};
+        int streamError{AWS_ERROR_SUCCESS};
+    };
+
+    class FileDescriptor
+    {
+      public:
+        explicit FileDescriptor(int fd) : fd(fd) {}
+        ~FileDescriptor() { close(); }
+        FileDescriptor(const FileDescriptor &) = delete;
+        FileDescriptor &operator=(const FileDescriptor &) = delete;
+
+        int get() const { return fd; }
+
+        int close()
+        {
+            int result = fd < 0 ? 0 : ::close(fd);
+            fd = -1;
+            return result;
+        }
+
+      private:
+        int fd;
+    };
+
+    string toString(const ByteCursor &cursor) { return string(reinterpret_cast<const char *>(cursor.ptr), cursor.len); }
+
+    string toLowerCase(string value)
+    {
+        transform(value.begin(), value.end(), value.begin(), ::tolower);
+        return value;
+    }
+
+    string toHex(const uint8_t *bytes, size_t length)
+    {
+        static constexpr char DIGITS[] = "0123456789abcdef";
+        string hex;
+        hex.reserve(length * 2);
+        for (size_t i = 0; i < length; i++)
+        {
+            hex.push_back(DIGITS[bytes[i] >> 4]);
+            hex.push_back(DIGITS[bytes[i] & 0xf]);
+        }
+        return hex;
+    }
+
+    void addHeader(Http::HttpRequest &request, const char *name, const string &value)
+    {
+        Http::HttpHeader header{};
+        header.name = ByteCursorFromCString(name);
+        header.value = ByteCursorFromCString(value.c_str());
+        request.AddHeader(header);
+    }
+
+    /**
+     * Resolves the location the server redirected to against the URL that was requested
+     *
+     * @return an empty string if the location is neither absolute nor relative to the root of the server
+     */
+    string resolveLocation(const string &url, const string &location)
+    {
+        if (location.find("://") != string::npos)
+        {
+            return location;
+        }
+        if (!location.empty() && location.front() == '/')
+        {
+            return url.substr(0, url.find('/', url.find("://") + 3)) + location;
+        }
+        return "";
+    }
+
+    bool readPartInfo(const string &infoFile, string &url, string &validator)
+    {
+        ifstream info(infoFile);
+        return static_cast<bool>(getline(info, url)) && static_cast<bool>(getline(info, validator));
+    }
+
+    bool writePartInfo(const string &infoFile, const string &url, const string &validator)
+    {
+        ofstream info(infoFile, ios::trunc);
+        info << url << '\n' << validator << '\n';
+        info.close();
+        return !info.fail();
+    }
+
+    bool writeFully(int fd, const vector<uint8_t> &data, uint64_t offset)
+    {
+        size_t written = 0;
+        while (written < data.size())
+        {
+            ssize_t count = pwrite(fd, data.data() + written, data.size() - written, offset + written);
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                return false;
+            }
+            written += static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    /**
+     * Feeds the bytes already in the part file to the digest before the transfer appends to it
+     */
+    bool hashPrefix(int fd, uint64_t length, Crypto::Hash &hash)
+    {
+        vector<uint8_t> buffer(64 * 1024);
+        uint64_t position = 0;
+        while (position < length)
+        {
+            size_t wanted = static_cast<size_t>(min<uint64_t>(buffer.size(), length - position));
+            ssize_t count = pread(fd, buffer.data(), wanted, position);
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0 || !hash.Update(ByteCursorFromArray(buffer.data(), static_cast<size_t>(count))))
+            {
+                return false;
+            }
+            position += static_cast<uint64_t>(count);
+        }
+        return true;
+    }
+
+    /**
+     * Closes the connection and waits for the stream to complete, after which its callbacks no longer run
+     */
+    void abandon(const shared_ptr<Http::HttpClientConnection> &connection, const shared_ptr<Transfer> &transfer)
+    {
+        connection->Close();
+        unique_lock<mutex> lock(transfer->lock);
+        transfer->changed.wait(lock, [&transfer] { return transfer->complete; });
+    }
+} // namespace
+
+FileDownloader::FileDownloader(
+    Crt::Io::ClientBootstrap *bootstrap,
+    Crt::Allocator *allocator,
+    long maxAttempts,
+    long startingBackoffMillis)
+    : bootstrap(bootstrap), allocator(allocator), maxAttempts(maxAttempts), startingBackoffMillis(startingBackoffMillis)
+{
+}
+
+bool FileDownloader::download(const Request &request)
+{
+    error.clear();
+    sha256.clear();
+    LOGM_INFO(TAG, "Downloading %s to %s", Sanitize(request.url).c_str(), Sanitize(request.destination).c_str());
+
+    bool succeeded = false;
+    auto downloadOnce = [this, &request, &succeeded]() -> bool {
+        string url = request.url;
+        for (int redirects = 0; redirects <= MAX_REDIRECTS; redirects++)
+        {
+            switch (attempt(request, url))
+            {
+                case Outcome::SUCCEEDED:
+                    succeeded = true;
+                    return true;
+                case Outcome::FAILED:
+                    return true;
+                case Outcome::RETRY:
+                    LOGM_WARN(TAG, "Download attempt failed and will be resumed: %s", Sanitize(error).c_str());
+                    return false;
+                case Outcome::REDIRECT:
+                    LOGM_DEBUG(TAG, "Following redirect to %s", Sanitize(url).c_str());
+                    break;
+            }
+        }
+        error = FormatMessage("Gave up after %d redirects", MAX_REDIRECTS);
+        return true;
+    };
+
+    Retry::ExponentialRetryConfig retryConfig = {
+        startingBackoffMillis, MAX_BACKOFF_MILLIS, maxAttempts, nullptr, Retry::Jitter::FULL, 0};
+    Retry::exponentialBackoff(retryConfig, downloadOnce);
+
+    if (succeeded)
+    {
+        LOGM_INFO(TAG, "Downloaded %s with SHA-256 digest %s", Sanitize(request.destination).c_str(), sha256.c_str());
+    }
+    else
+    {
+        LOGM_ERROR(TAG, "Failed to download %s: %s", Sanitize(request.url).c_str(), Sanitize(error).c_str());
+        // Keep a part file with data in it for the next download of the same URL to resume
+        string partFile = request.destination + PART_FILE_SUFFIX;
+        if (FileUtils::FileExists(partFile) && FileUtils::GetFileSize(partFile) == 0)
+        {
+            remove(partFile.c_str());
+            remove((request.destination + PART_INFO_SUFFIX).c_str());
+        }
+    }
+    return succeeded;
+}
+
+FileDownloader::Outcome FileDownloader::attempt(const Request &request, string &url)
+{
+    Io::Uri uri(ByteCursorFromCString(url.c_str()), allocator);
+    if (!uri)
+    {
+        error = FormatMessage("Invalid URL %s: %s", url.c_str(), ErrorDebugString(uri.LastError()));
+        return Outcome::FAILED;
+    }
+    string scheme = toLowerCase(toString(uri.GetScheme()));
+    if (scheme != "http" && scheme != "https")
+    {
+        error = FormatMessage("Unsupported URL scheme %s", scheme.c_str());
+        return Outcome::FAILED;
+    }
+    bool secure = scheme == "https";
+    string host = toString(uri.GetHostName());
+    uint16_t port = uri.GetPort();
+    string hostHeader = port == 0 ? host : host + ":" + to_string(port);
+    if (port == 0)
+    {
+        port = secure ? 443 : 80;
+    }
+    string path = toString(uri.GetPathAndQuery());
+    if (path.empty())
+    {
+        path = "/";
+    }
+
+    string partFile = request.destination + PART_FILE_SUFFIX;
+    string infoFile = request.destination + PART_INFO_SUFFIX;
+    // A symbolic link left in place of the part file must not redirect the download elsewhere
+    FileDescriptor fd(open(
+        partFile.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH));
+    struct stat partStat;
+    if (fd.get() < 0 || fstat(fd.get(), &partStat) != 0)
+    {
+        error = FormatMessage("Unable to open %s: %s", partFile.c_str(), strerror(errno));
+        return Outcome::FAILED;
+    }
+
+    // Only resume a part file downloaded from the same URL, since the file it was downloaded to may have been reused
+    uint64_t offset = 0;
+    string partUrl;
+    string validator;
+    if (partStat.st_size > 0 && readPartInfo(infoFile, partUrl, validator) && partUrl == request.url)
+    {
+        offset = static_cast<uint64_t>(partStat.st_size);
+    }
+
+    auto transfer = make_shared<Transfer>();
+    Http::HttpClientConnectionOptions connectionOptions;
+    connectionOptions.Bootstrap = bootstrap;
+    connectionOptions.HostName = host.c_str();
+    connectionOptions.Port = port;
+    connectionOptions.SocketOptions.SetConnectTimeoutMs(CONNECT_TIMEOUT_MILLIS);
+    // The window is only opened once data is written to the part file, which also limits the rate of the download
+    connectionOptions.ManualWindowManagement = true;
+    connectionOptions.InitialWindowSize =
+        request.maxBytesPerSecond == 0 ? WINDOW_SIZE
+                                       : max(MIN_WINDOW_SIZE, min(WINDOW_SIZE, request.maxBytesPerSecond / 4));
+    if (secure)
+    {
+        Io::TlsContextOptions tlsContextOptions = Io::TlsContextOptions::InitDefaultClient(allocator);
+        Io::TlsContext tlsContext(tlsContextOptions, Io::TlsMode::CLIENT, allocator);
+        if (!tlsContext)
+        {
+            error = FormatMessage(
+                "Unable to create TLS context: %s", ErrorDebugString(tlsContext.GetInitializationError()));
+            return Outcome::FAILED;
+        }
+        Io::TlsConnectionOptions tlsConnectionOptions = tlsContext.NewConnectionOptions();
+        ByteCursor serverName = ByteCursorFromCString(host.c_str());
+        tlsConnectionOptions.SetServerName(serverName);
+        connectionOptions.TlsOptions = tlsConnectionOptions;
+    }
+    connectionOptions.OnConnectionSetupCallback =
+        [transfer](const shared_ptr<Http::HttpClientConnection> &connection, int errorCode) {
+            lock_guard<mutex> guard(transfer->lock);
+            transfer->connection = connection;
+            transfer->connectionError = errorCode;
+            transfer->connectionSetUp = true;
+            transfer->changed.notify_all();
+        };
+    // A stream in flight when the connection shuts down completes with an error of its own
+    connectionOptions.OnConnectionShutdownCallback = [](Http::HttpClientConnection &, int) {};
+
+    if (!Http::HttpClientConnection::CreateConnection(connectionOptions, allocator))
+    {
+        error = FormatMessage("Unable to connect to %s: %s", host.c_str(), ErrorDebugString(LastError()));
+        return Outcome::RETRY;
+    }
+    shared_ptr<Http::HttpClientConnection> connection;
+    {
+        unique_lock<mutex> lock(transfer->lock);
+        transfer->changed.wait(lock, [&transfer] { return transfer->connectionSetUp; });
+        // Hold the connection here rather than in the state its own callbacks keep alive
+        connection = move(transfer->connection);
+        if (connection == nullptr)
+        {
+            error = FormatMessage(
+                "Unable to connect to %s: %s", host.c_str(), ErrorDebugString(transfer->connectionError));
+            return Outcome::RETRY;
+        }
+    }
+
+    Http::HttpRequest httpRequest(allocator);
+    httpRequest.SetMethod(ByteCursorFromCString("GET"));
+    httpRequest.SetPath(ByteCursorFromCString(path.c_str()));
+    addHeader(httpRequest, "Host", hostHeader);
+    addHeader(httpRequest, "User-Agent", "aws-iot-device-client");
+    if (offset > 0)
+    {
+        addHeader(httpRequest, "Range", "bytes=" + to_string(offset) + "-");
+        if (!validator.empty())
+        {
+            // Sends the whole file instead if it changed since the part file was downloaded
+            addHeader(httpRequest, "If-Range", validator);
+        }
+    }
+
+    Http::HttpRequestOptions requestOptions;
+    requestOptions.request = &httpRequest;
+    requestOptions.onIncomingHeaders = [transfer](
+                                           Http::HttpStream &,
+                                           enum aws_http_header_block block,
+                                           const Http::HttpHeader *headers,
+                                           size_t count) {
+        if (block != AWS_HTTP_HEADER_BLOCK_MAIN)
+        {
+            return;
+        }
+        lock_guard<mutex> guard(transfer->lock);
+        for (size_t i = 0; i < count; i++)
+        {
+            transfer->headers[toLowerCase(toString(headers[i].name))] = toString(headers[i].value);
+        }
+    };
+    requestOptions.onIncomingHeadersBlockDone = [transfer](Http::HttpStream &stream, enum aws_http_header_block block) {
+        if (block != AWS_HTTP_HEADER_BLOCK_MAIN)
+        {
+            return;
+        }
+        int statusCode = static_cast<Http::HttpClientStream &>(stream).GetResponseStatusCode();
+        lock_guard<mutex> guard(transfer->lock);
+        transfer->statusCode = statusCode;
+        transfer->headersDone = true;
+        transfer->changed.notify_all();
+    };
+    requestOptions.onIncomingBody = [transfer](Http::HttpStream &, const ByteCursor &data) {
+        lock_guard<mutex> guard(transfer->lock);
+        transfer->chunks.emplace_back(data.ptr, data.ptr + data.len);
+        transfer->changed.notify_all();
+    };
+    requestOptions.onStreamComplete = [transfer](Http::HttpStream &, int errorCode) {
+        lock_guard<mutex> guard(transfer->lock);
+        transfer->complete = true;
+        transfer->streamError = errorCode;
+        transfer->changed.notify_all();
+    };
+
+    auto stream = connection->NewClientStream(requestOptions);
+    if (stream == nullptr || !stream->Activate())
+    {
+        error = FormatMessage("Unable to send the request to %s: %s", host.c_str(), ErrorDebugString(LastError()));
+        connection->Close();
+        return Outcome::RETRY;
+    }
+
+    const auto stallTimeout = chrono::milliseconds(STALL_TIMEOUT_MILLIS);
+    int statusCode;
+    map<string, string> headers;
+    {
+        unique_lock<mutex> lock(transfer->lock);
+        if (!transfer->changed.wait_for(
+                lock, stallTimeout, [&transfer] { return transfer->headersDone || transfer->complete; }) ||
+            !transfer->headersDone)
+        {
+            lock.unlock();
+            error = FormatMessage("No response from %s", host.c_str());
+            abandon(connection, transfer);
+            return Outcome::RETRY;
+        }
+        statusCode = transfer->statusCode;
+        headers = transfer->headers;
+    }
+
+    if (statusCode == 301 || statusCode == 302 || statusCode == 303 || statusCode == 307 || statusCode == 308)
+    {
+        abandon(connection, transfer);
+        string location = resolveLocation(url, headers["location"]);
+        if (location.empty())
+        {
+            error = FormatMessage("Unable to follow redirect to %s", headers["location"].c_str());
+            return Outcome::FAILED;
+        }
+        // The file could be replaced in transit once the download leaves TLS, and its digest is optional
+        if (secure && toLowerCase(location).rfind("https://", 0) != 0)
+        {
+            error = FormatMessage("Refusing to follow redirect from https to %s", Sanitize(location).c_str());
+            return Outcome::FAILED;
+        }
+        url = location;
+        return Outcome::REDIRECT;
+    }
+
+    uint64_t expectedSize = 0;
+    if (statusCode == 206 && offset > 0)
+    {
+        uint64_t start = 0;
+        uint64_t end = 0;
+        uint64_t total = 0;
+        int fields = sscanf(
+            headers["content-range"].c_str(), "bytes %" SCNu64 "-%" SCNu64 "/%" SCNu64, &start, &end, &total);
+        if (fields < 2 || start != offset)
+        {
+            abandon(connection, transfer);
+            error = FormatMessage("Server resumed from an unexpected range %s", headers["content-range"].c_str());
+            // Download the whole file on the next attempt
+            remove(infoFile.c_str());
+            return Outcome::RETRY;
+        }
+        expectedSize = fields == 3 ? total : end + 1;
+        LOGM_INFO(TAG, "Resuming download of %s at byte %" PRIu64, Sanitize(request.destination).c_str(), offset);
+    }
+    else if (statusCode == 200)
+    {
+        if (offset > 0)
+        {
+            LOG_INFO(TAG, "Server sent the whole file instead of resuming the download, restarting the download");
+        }
+        offset = 0;
+        string newValidator = headers.count("etag") > 0 ? headers["etag"] : headers["last-modified"];
+        if (ftruncate(fd.get(), 0) != 0 || !writePartInfo(infoFile, request.url, newValidator))
+        {
+            abandon(connection, transfer);
+            error = FormatMessage("Unable to write %s: %s", partFile.c_str(), strerror(errno));
+            return Outcome::FAILED;
+        }
+        if (headers.count("content-length") > 0)
+        {
+            expectedSize = strtoull(headers["content-length"].c_str(), nullptr, 10);
+        }
+    }
+    else
+    {
+        abandon(connection, transfer);
+        if (statusCode == 416 && offset > 0)
+        {
+            // The part file does not fit the file on the server anymore, so download the whole file on the next attempt
+            remove(infoFile.c_str());
+            error = "Server rejected the range of the part file";
+            return Outcome::RETRY;
+        }
+        error = FormatMessage("Server responded with status %d", statusCode);
+        return statusCode >= 500 ? Outcome::RETRY : Outcome::FAILED;
+    }
+
+    // Reserve the space of the whole file up front, without changing the size the download is resumed from
+    off_t reserved = static_cast<off_t>(expectedSize - offset);
+    if (expectedSize > offset && fallocate(fd.get(), FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset), reserved) != 0 &&
+        errno == ENOSPC)
+    {
+        abandon(connection, transfer);
+        error = FormatMessage("Not enough space to download %" PRIu64 " bytes to %s", expectedSize, partFile.c_str());
+        return Outcome::FAILED;
+    }
+
+    Crypto::Hash hash = Crypto::Hash::CreateSHA256(allocator);
+    if (!hash || !hashPrefix(fd.get(), offset, hash))
+    {
+        abandon(connection, transfer);
+        error = FormatMessage("Unable to compute the digest of %s", partFile.c_str());
+        return Outcome::FAILED;
+    }
+
+    auto started = chrono::steady_clock::now();
+    uint64_t received = 0;
+    while (true)
+    {
+        vector<uint8_t> chunk;
+        {
+            unique_lock<mutex> lock(transfer->lock);
+            if (!transfer->changed.wait_for(
+                    lock, stallTimeout, [&transfer] { return !transfer->chunks.empty() || transfer->complete; }))
+            {
+                lock.unlock();
+                error = FormatMessage("Download stalled after %" PRIu64 " bytes", offset);
+                abandon(connection, transfer);
+                return Outcome::RETRY;
+            }
+            if (transfer->chunks.empty())
+            {
+                break;
+            }
+            chunk = move(transfer->chunks.front());
+            transfer->chunks.pop_front();
+        }
+
+        if (!writeFully(fd.get(), chunk, offset) ||
+            !hash.Update(ByteCursorFromArray(chunk.data(), chunk.size())))
+        {
+            error = FormatMessage("Unable to write %s: %s", partFile.c_str(), strerror(errno));
+            abandon(connection, transfer);
+            return Outcome::FAILED;
+        }
+        offset += chunk.size();
+        received += chunk.size();
+
+        if (request.maxBytesPerSecond > 0)
+        {
+            this_thread::sleep_until(started + chrono::microseconds(received * 1000000 / request.maxBytesPerSecond));
+        }
+        stream->UpdateWindow(chunk.size());
+    }
+    connection->Close();
+
+    if (transfer->streamError != AWS_ERROR_SUCCESS || (expectedSize > 0 && offset != expectedSize))
+    {
+        error = FormatMessage(
+            "Download interrupted after %" PRIu64 " bytes: %s", offset, ErrorDebugString(transfer->streamError));
+        return Outcome::RETRY;
+    }
+
+    uint8_t digest[Crypto::SHA256_DIGEST_SIZE];
+    ByteBuf digestBuffer = aws_byte_buf_from_empty_array(digest, sizeof(digest));
+    if (!hash.Digest(digestBuffer))
+    {
+        error = FormatMessage("Unable to compute the digest of %s", partFile.c_str());
+        return Outcome::FAILED;
+    }
+    string actualSha256 = toHex(digestBuffer.buffer, digestBuffer.len);
+    if (!request.sha256.empty() && toLowerCase(request.sha256) != actualSha256)
+    {
+        fd.close();
+        remove(partFile.c_str());
+        remove(infoFile.c_str());
+        error = FormatMessage(
+            "SHA-256 digest %s of the downloaded file does not match the expected digest %s",
+            actualSha256.c_str(),
+            Sanitize(request.sha256).c_str());
+        return Outcome::FAILED;
+    }
+
+    if (fsync(fd.get()) != 0 || fd.close() != 0 || rename(partFile.c_str(), request.destination.c_str()) != 0)
+    {
+        error = FormatMessage("Unable to move the download to %s: %s", request.destination.c_str(), strerror(errno));
+        return Outcome::FAILED;
+    }
+    remove(infoFile.c_str());
+    sha256 = actualSha256;
+    return Outcome::SUCCEEDED;
+}
@@ -0,0 +1,127 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_FILEDOWNLOADER_H
+#define AWS_IOT_DEVICE_CLIENT_FILEDOWNLOADER_H
+
+#include <aws/crt/Api.h>
+#include <aws/crt/io/Bootstrap.h>
+
+#include <cstdint>
+#include <string>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Jobs
+            {
+                /**
+                 * \brief Downloads a file over HTTP or HTTPS for the download action of a job
+                 *
+                 * The response body is written to a part file next to the destination while its SHA-256 digest is
+                 * computed, so the file is only read again when a download is resumed. Once the download completes
+                 * and the digest matches, the part file is renamed over the destination. If the transfer is
+                 * interrupted, the download is resumed from the end of the part file with a Range request, both when
+                 * retrying after a dropped connection and when the same URL is downloaded again after a restart.
+                 */
+                class FileDownloader
+                {
+                  public:
+                    static constexpr char PART_FILE_SUFFIX[] = ".part";
+                    /**
+                     * \brief Suffix of the file recording the URL and validator of a part file, so that a part file is
+                     * only resumed for the same URL and only if the file on the server has not changed
+                     */
+                    static constexpr char PART_INFO_SUFFIX[] = ".part.info";
+                    /**
+                     * \brief Bytes the server may send ahead of the bytes written to the part file
+                     */
+                    static constexpr size_t WINDOW_SIZE = 256 * 1024;
+                    static constexpr int MAX_REDIRECTS = 5;
+                    static constexpr uint32_t CONNECT_TIMEOUT_MILLIS = 10 * 1000;
+                    /**
+                     * \brief Time without any data from the server after which the transfer is resumed on a new
+                     * connection
+                     */
+                    static constexpr uint32_t STALL_TIMEOUT_MILLIS = 60 * 1000;
+                    static constexpr long DEFAULT_MAX_ATTEMPTS = 5;
+                    static constexpr long DEFAULT_STARTING_BACKOFF_MILLIS = 1000;
+
+                    struct Request
+                    {
+                        std::string url;
+                        /** Absolute path of the file to write **/
+                        std::string destination;
+                        /** Expected SHA-256 digest of the file in hexadecimal, not checked if empty **/
+                        std::string sha256;
+                        /** Maximum average rate of the download, unlimited if zero **/
+                        size_t maxBytesPerSecond{0};
+                    };
+
+                    /**
+                     * @param bootstrap the client bootstrap to connect to the server with
+                     * @param allocator the allocator of the connections and the digest
+                     * @param maxAttempts the number of times the file is requested before giving up, resuming the
+                     * transfer every time
+                     * @param startingBackoffMillis the time between the first and the second attempt, doubled after
+                     * every attempt
+                     */
+                    FileDownloader(
+                        Crt::Io::ClientBootstrap *bootstrap,
+                        Crt::Allocator *allocator = Crt::ApiAllocator(),
+                        long maxAttempts = DEFAULT_MAX_ATTEMPTS,
+                        long startingBackoffMillis = DEFAULT_STARTING_BACKOFF_MILLIS);
+
+                    /**
+                     * \brief Downloads a file, blocking until the file is downloaded or the download fails
+                     *
+                     * @return true if the file was written to the destination
+                     */
+                    bool download(const Request &request);
+
+                    /**
+                     * \brief Why the last download failed
+                     */
+                    const std::string &getError() const { return error; }
+
+                    /**
+                     * \brief The SHA-256 digest of the last file downloaded, in hexadecimal
+                     */
+                    const std::string &getSha256() const { return sha256; }
+
+                  private:
+                    enum class Outcome
+                    {
+                        SUCCEEDED,
+                        /** The transfer may succeed or make progress if the file is requested again **/
+                        RETRY,
+                        /** The server redirected the request to the URL that was passed in **/
+                        REDIRECT,
+                        FAILED
+                    };
+
+                    /**
+                     * \brief Requests the file once, resuming the part file if it was downloaded from the same URL
+                     *
+                     * @param request the file to download
+                     * @param url the URL to request, which is replaced by the location the server redirects to
+                     */
+                    Outcome attempt(const Request &request, std::string &url);
+
+                    Crt::Io::ClientBootstrap *bootstrap;
+                    Crt::Allocator *allocator;
+                    long maxAttempts;
+                    long startingBackoffMillis;
+
+                    std::string error;
+                    std::string sha256;
+                };
+            } // namespace Jobs
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_FILEDOWNLOADER_H
@@ -4,6 +4,7 @@
 #include "JobDocument.h"
 #include "../logging/LoggerFactory.h"
 #include "../util/StringUtils.h"
+#include <algorithm>
 #include <aws/crt/JsonObject.h>
 #include <regex>
 #include <set>
@@ -19,6 +20,7 @@ constexpr char LoadableFromJobDocument::TAG[];
 
 constexpr char PlainJobDocument::ACTION_TYPE_RUN_HANDLER[];
 constexpr char PlainJobDocument::ACTION_TYPE_RUN_COMMAND[];
+constexpr char PlainJobDocument::ACTION_TYPE_DOWNLOAD[];
 
 constexpr char PlainJobDocument::JSON_KEY_VERSION[];
 constexpr char PlainJobDocument::JSON_KEY_INCLUDESTDOUT[];
@@ -26,6 +28,7 @@ constexpr char PlainJobDocument::JSON_KEY_CONDITIONS[];
 constexpr char PlainJobDocument::JSON_KEY_STEPS[];
 constexpr char PlainJobDocument::JSON_KEY_ACTION[];
 constexpr char PlainJobDocument::JSON_KEY_FINALSTEP[];
+constexpr char PlainJobDocument::JSON_KEY_TIMEOUT_SECONDS[];
 // Old Schema fields
 constexpr char PlainJobDocument::JSON_KEY_OPERATION[];
 constexpr char PlainJobDocument::JSON_KEY_ARGS[];
@@ -48,6 +51,12 @@ void PlainJobDocument::LoadFromJobDocument(const JsonView &json)
         includeStdOut = json.GetString(jsonKey) == "true";
     }
 
+    jsonKey = JSON_KEY_TIMEOUT_SECONDS;
+    if (json.ValueExists(jsonKey) && json.GetJsonObject(jsonKey).IsIntegerType())
+    {
+        timeoutSeconds = json.GetInteger(jsonKey);
+    }
+
     if (version.empty())
     {
         //  Converting Old Job Document schema to new Job Document schema
@@ -142,6 +151,13 @@ bool PlainJobDocument::Validate() const
         return false;
     }
 
+    if (timeoutSeconds.has_value() && timeoutSeconds.value() <= 0)
+    {
+        LOGM_ERROR(
+            TAG, "*** %s: Field timeoutSeconds must be greater than zero ***", DeviceClient::Jobs::DC_INVALID_JOB_DOC);
+        return false;
+    }
+
     if (conditions.has_value())
     {
         for (const auto &condition : *conditions)
@@ -225,9 +241,11 @@ constexpr char PlainJobDocument::JobAction::JSON_KEY_INPUT[];
 constexpr char PlainJobDocument::JobAction::JSON_KEY_RUNASUSER[];
 constexpr char PlainJobDocument::JobAction::JSON_KEY_ALLOWSTDERR[];
 constexpr char PlainJobDocument::JobAction::JSON_KEY_IGNORESTEPFAILURE[];
+constexpr char PlainJobDocument::JobAction::JSON_KEY_TIMEOUT_SECONDS[];
 const static std::set<std::string> SUPPORTED_ACTION_TYPES{
     Aws::Iot::DeviceClient::Jobs::PlainJobDocument::ACTION_TYPE_RUN_HANDLER,
-    Aws::Iot::DeviceClient::Jobs::PlainJobDocument::ACTION_TYPE_RUN_COMMAND};
+    Aws::Iot::DeviceClient::Jobs::PlainJobDocument::ACTION_TYPE_RUN_COMMAND,
+    Aws::Iot::DeviceClient::Jobs::PlainJobDocument::ACTION_TYPE_DOWNLOAD};
 
 void PlainJobDocument::JobAction::LoadFromJobDocument(const JsonView &json)
 {
@@ -258,6 +276,12 @@ void PlainJobDocument::JobAction::LoadFromJobDocument(const JsonView &json)
             temp.LoadFromJobDocument(json.GetJsonObject(jsonKey));
             commandInput = temp;
         }
+        else if (type == PlainJobDocument::ACTION_TYPE_DOWNLOAD)
+        {
+            ActionDownloadInput temp;
+            temp.LoadFromJobDocument(json.GetJsonObject(jsonKey));
+            downloadInput = temp;
+        }
     }
 
     jsonKey = JSON_KEY_RUNASUSER;
@@ -277,6 +301,12 @@ void PlainJobDocument::JobAction::LoadFromJobDocument(const JsonView &json)
     {
         ignoreStepFailure = json.GetString(jsonKey) == "true";
     }
+
+    jsonKey = JSON_KEY_TIMEOUT_SECONDS;
+    if (json.ValueExists(jsonKey) && json.GetJsonObject(jsonKey).IsIntegerType())
+    {
+        timeoutSeconds = json.GetInteger(jsonKey);
+    }
 }
 
 bool PlainJobDocument::JobAction::Validate() const
@@ -317,6 +347,29 @@ bool PlainJobDocument::JobAction::Validate() const
             return false;
         }
     }
+    else if (type == PlainJobDocument::ACTION_TYPE_DOWNLOAD)
+    {
+        if (!downloadInput.has_value())
+        {
+            LOGM_ERROR(
+                TAG, "*** %s: Required field ActionInput is missing ***", DeviceClient::Jobs::DC_INVALID_JOB_DOC);
+            return false;
+        }
+        if (!downloadInput->Validate())
+        {
+            return false;
+        }
+    }
+
+    if (timeoutSeconds.has_value() && timeoutSeconds.value() <= 0)
+    {
+        LOGM_ERROR(
+            TAG,
+            "*** %s: Field timeoutSeconds of action %s must be greater than zero ***",
+            DeviceClient::Jobs::DC_INVALID_JOB_DOC,
+            Util::Sanitize(name).c_str());
+        return false;
+    }
 
     return true;
 }
@@ -402,4 +455,105 @@ bool PlainJobDocument::JobAction::ActionCommandInput::Validate() const
     }
 
     return true;
-}
\ No newline at end of file
+}
+constexpr char PlainJobDocument::JobAction::ActionDownloadInput::JSON_KEY_URL[];
+constexpr char PlainJobDocument::JobAction::ActionDownloadInput::JSON_KEY_PATH[];
+constexpr char PlainJobDocument::JobAction::ActionDownloadInput::JSON_KEY_SHA256[];
+constexpr char PlainJobDocument::JobAction::ActionDownloadInput::JSON_KEY_MAX_BYTES_PER_SECOND[];
+
+void PlainJobDocument::JobAction::ActionDownloadInput::LoadFromJobDocument(const JsonView &json)
+{
+    const char *jsonKey = JSON_KEY_URL;
+    if (json.ValueExists(jsonKey) && json.GetJsonObject(jsonKey).IsString())
+    {
+        url = json.GetString(jsonKey).c_str();
+    }
+
+    jsonKey = JSON_KEY_PATH;
+    if (json.ValueExists(jsonKey) && json.GetJsonObject(jsonKey).IsString())
+    {
+        path = json.GetString(jsonKey).c_str();
+    }
+
+    jsonKey = JSON_KEY_SHA256;
+    if (json.ValueExists(jsonKey) && json.GetJsonObject(jsonKey).IsString())
+    {
+        sha256 = json.GetString(jsonKey).c_str();
+    }
+
+    jsonKey = JSON_KEY_MAX_BYTES_PER_SECOND;
+    if (json.ValueExists(jsonKey) && json.GetJsonObject(jsonKey).IsIntegerType())
+    {
+        maxBytesPerSecond = json.GetInteger(jsonKey);
+    }
+}
+
+bool PlainJobDocument::JobAction::ActionDownloadInput::Validate() const
+{
+    string lowerCaseUrl = url;
+    transform(lowerCaseUrl.begin(), lowerCaseUrl.end(), lowerCaseUrl.begin(), ::tolower);
+    if (lowerCaseUrl.rfind("http://", 0) != 0 && lowerCaseUrl.rfind("https://", 0) != 0)
+    {
+        LOGM_ERROR(
+            TAG,
+            "*** %s: Required field ActionInput url must be an http or https URL: %s ***",
+            DeviceClient::Jobs::DC_INVALID_JOB_DOC,
+            Util::Sanitize(url).c_str());
+        return false;
+    }
+
+    if (path.empty() || path.back() == '/')
+    {
+        LOGM_ERROR(
+            TAG,
+            "*** %s: Required field ActionInput path must name a file: %s ***",
+            DeviceClient::Jobs::DC_INVALID_JOB_DOC,
+            Util::Sanitize(path).c_str());
+        return false;
+    }
+
+    // The path is confined to the download directory of the Device Client, which parent components would escape
+    size_t componentStart = 0;
+    while (componentStart <= path.size())
+    {
+        size_t componentEnd = path.find('/', componentStart);
+        if (componentEnd == string::npos)
+        {
+            componentEnd = path.size();
+        }
+        if (path.compare(componentStart, componentEnd - componentStart, "..") == 0)
+        {
+            LOGM_ERROR(
+                TAG,
+                "*** %s: ActionInput path must not contain .. components: %s ***",
+                DeviceClient::Jobs::DC_INVALID_JOB_DOC,
+                Util::Sanitize(path).c_str());
+            return false;
+        }
+        componentStart = componentEnd + 1;
+    }
+
+    auto isHexDigit = [](const char &c) { return isxdigit(static_cast<unsigned char>(c)); };
+    if (sha256.has_value() &&
+        (sha256->size() != 64 || find_if_not(sha256->cbegin(), sha256->cend(), isHexDigit) != sha256->cend()))
+    {
+        LOGM_ERROR(
+            TAG,
+            "*** %s: ActionInput sha256 must be 64 hexadecimal digits: %s ***",
+            DeviceClient::Jobs::DC_INVALID_JOB_DOC,
+            Util::Sanitize(sha256.value()).c_str());
+        return false;
+    }
+
+    if (maxBytesPerSecond.has_value() && maxBytesPerSecond.value() <= 0)
+    {
+        LOGM_ERROR(
+            TAG,
+            "*** %s: ActionInput maxBytesPerSecond must be positive: %d ***",
+            DeviceClient::Jobs::DC_INVALID_JOB_DOC,
+            maxBytesPerSecond.value());
+        return false;
+    }
+
+    return true;
+}
@@ -38,6 +38,7 @@ namespace Aws
 
                     static constexpr char ACTION_TYPE_RUN_HANDLER[] = "runHandler";
                     static constexpr char ACTION_TYPE_RUN_COMMAND[] = "runCommand";
+                    static constexpr char ACTION_TYPE_DOWNLOAD[] = "download";
 
                     static constexpr char JSON_KEY_VERSION[] = "version";
                     static constexpr char JSON_KEY_INCLUDESTDOUT[] = "includeStdOut";
@@ -45,6 +46,7 @@ namespace Aws
                     static constexpr char JSON_KEY_STEPS[] = "steps";
                     static constexpr char JSON_KEY_ACTION[] = "action";
                     static constexpr char JSON_KEY_FINALSTEP[] = "finalStep";
+                    static constexpr char JSON_KEY_TIMEOUT_SECONDS[] = "timeoutSeconds";
 
                     // Old Schema Fields
                     static constexpr char JSON_KEY_OPERATION[] = "operation";
@@ -56,6 +58,8 @@ namespace Aws
 
                     std::string version;
                     Crt::Optional<bool> includeStdOut{false};
+                    /** Time the steps of the job may take in total before the running step is killed **/
+                    Crt::Optional<int> timeoutSeconds;
 
                     struct JobCondition : public LoadableFromJobDocument
                     {
@@ -83,6 +87,7 @@ namespace Aws
                         static constexpr char JSON_KEY_RUNASUSER[] = "runAsUser";
                         static constexpr char JSON_KEY_ALLOWSTDERR[] = "allowStdErr";
                         static constexpr char JSON_KEY_IGNORESTEPFAILURE[] = "ignoreStepFailure";
+                        static constexpr char JSON_KEY_TIMEOUT_SECONDS[] = "timeoutSeconds";
 
                         std::string name;
                         std::string type;
@@ -118,9 +123,31 @@ namespace Aws
                             std::vector<std::string> command;
                         };
                         Optional<ActionCommandInput> commandInput;
+
+                        /**
+                         * ActionDownloadInput - Downloads a file over HTTP or HTTPS within the Device Client.
+                         */
+                        struct ActionDownloadInput : public LoadableFromJobDocument
+                        {
+                            void LoadFromJobDocument(const JsonView &json) override;
+                            bool Validate() const override;
+
+                            static constexpr char JSON_KEY_URL[] = "url";
+                            static constexpr char JSON_KEY_PATH[] = "path";
+                            static constexpr char JSON_KEY_SHA256[] = "sha256";
+                            static constexpr char JSON_KEY_MAX_BYTES_PER_SECOND[] = "maxBytesPerSecond";
+
+                            std::string url;
+                            std::string path;
+                            Optional<std::string> sha256;
+                            Optional<int> maxBytesPerSecond;
+                        };
+                        Optional<ActionDownloadInput> downloadInput;
                         Optional<std::string> runAsUser{""};
                         Optional<int> allowStdErr;
                         Optional<bool> ignoreStepFailure{false};
+                        /** Time the step may take before it is killed and fails **/
+                        Optional<int> timeoutSeconds;
                     };
                     std::vector<JobAction> steps;
 
@@ -4,49 +4,145 @@
 #include "JobEngine.h"
 #include "../config/Config.h"
 #include "../logging/LoggerFactory.h"
+#include "../util/FileUtils.h"
 
+#include <algorithm>
 #include <array>
+#include <cstdlib>
 #include <cstring>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <thread>
+#include <utility>
 
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 constexpr int PIPE_READ = 0;
 constexpr int PIPE_WRITE = 1;
 constexpr int CMD_FAILURE = 1;
+/** Longest line of output processed at once, as with the buffer output was read into before **/
+constexpr size_t MAX_OUTPUT_LINE_LENGTH = 1023;
 
 using namespace Aws::Iot::DeviceClient;
 using namespace Aws::Iot::DeviceClient::Jobs;
 using namespace Aws::Iot::DeviceClient::Logging;
 using namespace std;
 
-void JobEngine::processCmdOutput(int fd, bool isStdErr, int childPID)
+constexpr int JobEngine::KILL_GRACE_PERIOD_SECONDS;
+constexpr int JobEngine::CHILD_POLL_INTERVAL_MILLIS;
+
+JobEngine::JobEngine(
+    Crt::Io::ClientBootstrap *downloadBootstrap,
+    shared_ptr<StepCgroups> cgroups,
+    shared_ptr<ResidentHandlers> residentHandlers,
+    string downloadDir)
+    : downloadBootstrap(downloadBootstrap), downloadDir(std::move(downloadDir)), cgroups(std::move(cgroups)),
+      residentHandlers(std::move(residentHandlers))
 {
-    array<char, 1024> buffer;
-    unique_ptr<FILE, decltype(&fclose)> pipe(fdopen(fd, "r"), &fclose);
-    if (nullptr == pipe.get())
+    if (pipe2(cancelPipe, O_CLOEXEC | O_NONBLOCK) < 0)
     {
-        LOGM_ERROR(
-            TAG, "Failed to open pipe to %s for job, errno: %s", isStdErr ? "STDERR" : "STDOUT", strerror(errno));
-        return;
+        LOGM_WARN(
+            TAG,
+            "Failed to create pipe for job cancellation, errno {%d}, a canceled job will stop after its running step",
+            errno);
+        cancelPipe[PIPE_READ] = -1;
+        cancelPipe[PIPE_WRITE] = -1;
+    }
+}
+
+JobEngine::~JobEngine()
+{
+    if (cancelPipe[PIPE_READ] >= 0)
+    {
+        close(cancelPipe[PIPE_READ]);
+        close(cancelPipe[PIPE_WRITE]);
     }
+}
 
+void JobEngine::cancel()
+{
+    if (!canceled.exchange(true) && cancelPipe[PIPE_WRITE] >= 0)
+    {
+        const char wakeUp = 0;
+        if (write(cancelPipe[PIPE_WRITE], &wakeUp, 1) < 0)
+        {
+            LOGM_WARN(TAG, "Failed to wake up job for cancellation, errno {%d}", errno);
+        }
+    }
+}
+
+bool JobEngine::isJobStopped()
+{
+    if (canceled)
+    {
+        terminationReason = "Job was canceled";
+        jobStopped = true;
+    }
+    else if (chrono::steady_clock::now() >= jobDeadline.at)
+    {
+        terminationReason = jobDeadline.reason;
+        jobStopped = true;
+    }
+    return jobStopped;
+}
+
+void JobEngine::processCmdOutput(const string &line, bool isStdErr, int childPID)
+{
     string pidString = std::to_string(childPID);
     char const *logTag = pidString.c_str();
 
-    size_t lineCount = 0;
-    while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr)
+    string childOutput = Util::Sanitize(line);
+    if (childOutput.empty())
+    {
+        return;
+    }
+    if (isStdErr)
+    {
+        stderrstream.addString(childOutput);
+        if ('\n' == childOutput[childOutput.size() - 1])
+        {
+            childOutput.pop_back();
+        }
+        LOG_ERROR(logTag, childOutput.c_str());
+        this->errors.fetch_add(1);
+    }
+    else
+    {
+        stdoutstream.addString(childOutput);
+        if ('\n' == childOutput[childOutput.size() - 1])
+        {
+            childOutput.pop_back();
+        }
+        LOG_DEBUG(logTag, childOutput.c_str());
+    }
+}
+
+int JobEngine::waitForChild(int pid, int stdoutFd, int stderrFd)
+{
+    struct Output
     {
-        if (lineCount > MAX_LOG_LINES)
+        int fd;
+        bool isStdErr;
+        string pending;
+        size_t lineCount;
+    };
+    array<Output, 2> outputs{{{stdoutFd, false, "", 0}, {stderrFd, true, "", 0}}};
+
+    auto processLine = [this, pid](Output &output, const string &line) {
+        if (output.lineCount == MAX_LOG_LINES + 1)
         {
             string limitMessage = Util::FormatMessage(
                 "*** The specified job has exceeded the maximum output limit for %s, no further output will be written "
                 "from this file descriptor for this job ***",
-                isStdErr ? "STDERR" : "STDOUT");
-            if (isStdErr)
+                output.isStdErr ? "STDERR" : "STDOUT");
+            if (output.isStdErr)
             {
                 LOG_ERROR(TAG, limitMessage.c_str());
             }
@@ -54,155 +150,230 @@ void JobEngine::processCmdOutput(int fd, bool isStdErr, int childPID)
             {
                 LOG_DEBUG(TAG, limitMessage.c_str());
             }
+        }
+        // Output past the limit is still read, so that the child process is not blocked writing to a full pipe
+        if (output.lineCount++ <= MAX_LOG_LINES)
+        {
+            processCmdOutput(line, output.isStdErr, pid);
+        }
+    };
+    auto readOutput = [&processLine](Output &output) {
+        array<char, 4096> buffer;
+        ssize_t count = read(output.fd, buffer.data(), buffer.size());
+        if (count < 0 && (errno == EINTR || errno == EAGAIN))
+        {
             return;
         }
-        string childOutput;
-        childOutput += buffer.data();
-        childOutput = Util::Sanitize(childOutput);
-        if (isStdErr)
+        if (count > 0)
+        {
+            output.pending.append(buffer.data(), static_cast<size_t>(count));
+        }
+        size_t lineEnd;
+        while ((lineEnd = output.pending.find('\n')) != string::npos || output.pending.size() >= MAX_OUTPUT_LINE_LENGTH)
         {
-            stderrstream.addString(childOutput);
-            if ('\n' == childOutput[childOutput.size() - 1])
+            size_t length = lineEnd == string::npos ? MAX_OUTPUT_LINE_LENGTH : min(lineEnd + 1, MAX_OUTPUT_LINE_LENGTH);
+            processLine(output, output.pending.substr(0, length));
+            output.pending.erase(0, length);
+        }
+        if (count <= 0)
+        {
+            // The child process and any processes it started have closed their end of the pipe
+            if (!output.pending.empty())
             {
-                childOutput.pop_back();
+                processLine(output, output.pending);
             }
-            LOG_ERROR(logTag, childOutput.c_str());
-            this->errors.fetch_add(1);
+            close(output.fd);
+            output.fd = -1;
         }
-        else
+    };
+
+    // A pidfd becomes readable once the child process exits, so that waiting for it does not take a thread
+    int pidFd = -1;
+#ifdef SYS_pidfd_open
+    pidFd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#endif
+
+    enum class Termination
+    {
+        NONE,
+        TERMINATED,
+        KILLED
+    };
+    Termination termination = Termination::NONE;
+    chrono::steady_clock::time_point escalateAt = chrono::steady_clock::time_point::max();
+    bool exited = false;
+    int status = 0;
+    while (true)
+    {
+        if (!exited)
         {
-            stdoutstream.addString(childOutput);
-            if ('\n' == childOutput[childOutput.size() - 1])
+            int waitReturn = waitpid(pid, &status, WNOHANG);
+            if (waitReturn == pid || (waitReturn < 0 && errno != EINTR))
             {
-                childOutput.pop_back();
+                if (waitReturn < 0)
+                {
+                    LOGM_WARN(TAG, "Failed to wait for child process: %d", pid);
+                }
+                exited = true;
+                if (pidFd >= 0)
+                {
+                    close(pidFd);
+                    pidFd = -1;
+                }
             }
-            LOG_DEBUG(logTag, childOutput.c_str());
         }
-        lineCount++;
-    }
-}
+        bool outputOpen = outputs[0].fd >= 0 || outputs[1].fd >= 0;
+        if (exited && !outputOpen)
+        {
+            break;
+        }
 
-string JobEngine::buildCommand(Crt::Optional<string> path, const std::string &handler, const std::string &jobHandlerDir)
-    const
-{
-    ostringstream commandStream;
-    bool operationOwnedByDeviceClient = false;
-    if (path.has_value() && DEFAULT_PATH_KEYWORD == path.value())
-    {
-        LOGM_DEBUG(
-            TAG, "Using DC default command path {%s} for command execution", Util::Sanitize(jobHandlerDir).c_str());
-        operationOwnedByDeviceClient = true;
-        commandStream << jobHandlerDir;
-        if (jobHandlerDir.back() != Config::PATH_DIRECTORY_SEPARATOR)
+        auto now = chrono::steady_clock::now();
+        if (termination == Termination::NONE)
         {
-            commandStream << Config::PATH_DIRECTORY_SEPARATOR;
+            if (isJobStopped() || now >= stepDeadline.at)
+            {
+                if (!jobStopped)
+                {
+                    terminationReason = stepDeadline.reason;
+                }
+                LOGM_WARN(TAG, "%s, terminating process group %d", Util::Sanitize(terminationReason).c_str(), pid);
+                kill(-pid, SIGTERM);
+                termination = Termination::TERMINATED;
+                escalateAt = now + chrono::seconds(KILL_GRACE_PERIOD_SECONDS);
+            }
         }
-    }
-    else if (path.has_value() && !path.value().empty())
-    {
-        LOGM_DEBUG(
-            TAG,
-            "Using path {%s} supplied by job document for command execution",
-            Util::Sanitize(path.value()).c_str());
-        commandStream << path.value();
-        if (path.value().back() != Config::PATH_DIRECTORY_SEPARATOR)
+        else if (now >= escalateAt)
         {
-            commandStream << Config::PATH_DIRECTORY_SEPARATOR;
+            if (termination == Termination::TERMINATED)
+            {
+                LOGM_WARN(TAG, "Process group %d did not exit after SIGTERM, sending SIGKILL", pid);
+                kill(-pid, SIGKILL);
+                if (!stepCgroup.path.empty())
+                {
+                    cgroups->kill(stepCgroup);
+                }
+                termination = Termination::KILLED;
+                escalateAt = now + chrono::seconds(KILL_GRACE_PERIOD_SECONDS);
+            }
+            else if (exited)
+            {
+                // Only processes that left the process group can still hold the pipes open
+                LOGM_WARN(TAG, "Abandoning output of processes started by child process %d", pid);
+                for (auto &output : outputs)
+                {
+                    if (output.fd >= 0)
+                    {
+                        close(output.fd);
+                        output.fd = -1;
+                    }
+                }
+                break;
+            }
         }
-    }
-    else
-    {
-        LOG_DEBUG(TAG, "Assuming executable is in PATH");
-    }
-
-    commandStream << handler;
 
-    if (operationOwnedByDeviceClient)
-    {
-        const int actualPermissions = Util::FileUtils::GetFilePermissions(commandStream.str());
-        if (Permissions::JOB_HANDLER != actualPermissions)
+        chrono::steady_clock::time_point wakeAt = termination == Termination::NONE
+                                                      ? min(jobDeadline.at, stepDeadline.at)
+                                                      : escalateAt;
+        int timeoutMillis = -1;
+        if (wakeAt != chrono::steady_clock::time_point::max())
         {
-            string message = Util::FormatMessage(
-                "Unacceptable permissions found for job handler %s, permissions should be %d but found %d",
-                Util::Sanitize(commandStream.str()).c_str(),
-                Permissions::JOB_HANDLER,
-                actualPermissions);
-            LOG_ERROR(TAG, message.c_str());
-            throw std::runtime_error(message);
+            auto remaining = chrono::duration_cast<chrono::milliseconds>(wakeAt - now).count() + 1;
+            timeoutMillis = static_cast<int>(min<long long>(max<long long>(remaining, 0), numeric_limits<int>::max()));
+        }
+        if (!exited && pidFd < 0)
+        {
+            timeoutMillis =
+                timeoutMillis < 0 ? CHILD_POLL_INTERVAL_MILLIS : min(timeoutMillis, CHILD_POLL_INTERVAL_MILLIS);
         }
-    }
-    return commandStream.str();
-}
 
-void JobEngine::exec_action(PlainJobDocument::JobAction action, const std::string &jobHandlerDir, int &executionStatus)
-{
-    string command;
-    if (action.type == PlainJobDocument::ACTION_TYPE_RUN_HANDLER)
-    {
-        // build command for runHandler type
-        try
+        vector<pollfd> pollFds;
+        for (const auto &output : outputs)
+        {
+            if (output.fd >= 0)
+            {
+                pollFds.push_back({output.fd, POLLIN, 0});
+            }
+        }
+        if (!exited && pidFd >= 0)
+        {
+            pollFds.push_back({pidFd, POLLIN, 0});
+        }
+        if (termination == Termination::NONE && cancelPipe[PIPE_READ] >= 0)
         {
-            command = buildCommand(action.handlerInput->path, action.handlerInput->handler, jobHandlerDir);
+            // Left unread, since a canceled job stays canceled
+            pollFds.push_back({cancelPipe[PIPE_READ], POLLIN, 0});
         }
-        catch (exception &e)
+        if (poll(pollFds.data(), pollFds.size(), timeoutMillis) < 0 && errno != EINTR)
         {
-            if (!action.ignoreStepFailure.value())
+            LOGM_WARN(TAG, "Failed to poll child process %d, errno {%d}", pid, errno);
+            this_thread::sleep_for(chrono::milliseconds(CHILD_POLL_INTERVAL_MILLIS));
+            continue;
+        }
+        for (const auto &pollFd : pollFds)
+        {
+            if (pollFd.revents == 0)
             {
-                executionStatus = 1;
+                continue;
+            }
+            for (auto &output : outputs)
+            {
+                if (output.fd == pollFd.fd)
+                {
+                    readOutput(output);
+                }
             }
-            return;
         }
     }
-    else if (action.type == PlainJobDocument::ACTION_TYPE_RUN_COMMAND)
-    {
-        // build commands for runCommand type
-        command = action.commandInput->command.front();
-    }
-    else
+
+    if (WIFSIGNALED(status))
     {
-        LOG_ERROR(TAG, "Job Document received with invalid action type.");
-        executionStatus = 1;
-        return;
+        LOGM_DEBUG(TAG, "Child process %d was killed by signal %d", pid, WTERMSIG(status));
+        return 128 + WTERMSIG(status);
     }
+    int returnCode = WEXITSTATUS(status);
+    LOGM_DEBUG(TAG, "JobEngine finished waiting for child process, returning %d", returnCode);
+    return returnCode;
+}
 
-    ostringstream argsStringForLogging;
-    if (action.type == RUN_HANDLER_TYPE && action.handlerInput->args.has_value())
+void JobEngine::exec_action(const JobPlan::Step &step, int &executionStatus)
+{
+    const auto &action = step.action;
+    if (!step.error.empty())
     {
-        // build logstream for runHandler to print out on console
-        for (const auto &eachArgument : action.handlerInput->args.value())
+        LOGM_ERROR(
+            TAG,
+            "Unable to execute step %s: %s",
+            Util::Sanitize(action.name).c_str(),
+            Util::Sanitize(step.error).c_str());
+        // A step of an unknown type fails the job even if its failure is ignored
+        if (action.type != PlainJobDocument::ACTION_TYPE_RUN_HANDLER || !action.ignoreStepFailure.value())
         {
-            argsStringForLogging << eachArgument << " ";
+            executionStatus = 1;
         }
+        return;
     }
-    else if (action.type == RUN_COMMAND_TYPE)
+    if (action.type == PlainJobDocument::ACTION_TYPE_DOWNLOAD)
     {
-        // build logstream for runCommand to print out on console
-        for (size_t i = 1; i < action.commandInput->command.size(); i++)
+        // downloads run within the Device Client, so there is no command or output to check
+        int actionExecutionStatus = exec_download(action);
+        if (!action.ignoreStepFailure.value())
         {
-            argsStringForLogging << action.commandInput->command.at(i) << " ";
+            executionStatus = actionExecutionStatus;
         }
-    }
-    else
-    {
-        LOG_INFO(
-            TAG, "Did not find any arguments in the incoming job document. Value should be a JSON array of arguments");
+        return;
     }
 
-    LOGM_INFO(
-        TAG,
-        "About to execute: %s %s %s",
-        Util::Sanitize(command).c_str(),
-        Util::Sanitize(action.runAsUser->c_str()).c_str(),
-        Util::Sanitize(argsStringForLogging.str()).c_str());
+    LOGM_INFO(TAG, "About to execute: %s", step.description.c_str());
 
     int actionExecutionStatus = 0;
-    if (action.type == RUN_HANDLER_TYPE)
+    if (action.type == PlainJobDocument::ACTION_TYPE_RUN_HANDLER)
     {
-        actionExecutionStatus = exec_handlerScript(command, action);
+        actionExecutionStatus = exec_handlerScript(step);
     }
-    else if (action.type == RUN_COMMAND_TYPE)
+    else
     {
-        actionExecutionStatus = exec_shellCommand(action);
+        actionExecutionStatus = exec_shellCommand(step);
     }
 
     if (!action.ignoreStepFailure.value())
@@ -223,34 +394,154 @@ void JobEngine::exec_action(PlainJobDocument::JobAction action, const std::strin
     }
 }
 
-int JobEngine::exec_steps(PlainJobDocument jobDocument, const std::string &jobHandlerDir)
+void JobEngine::startStep(size_t step, const PlainJobDocument::JobAction &action)
+{
+    {
+        lock_guard<mutex> guard(stepLock);
+        currentStep = step;
+        currentStepName = action.name;
+    }
+    stepDeadline = Deadline();
+    terminationReason.clear();
+    if (action.timeoutSeconds.has_value())
+    {
+        stepDeadline.at = chrono::steady_clock::now() + chrono::seconds(action.timeoutSeconds.value());
+        stepDeadline.reason = Util::FormatMessage(
+            "Step %s timed out after %d seconds", action.name.c_str(), action.timeoutSeconds.value());
+    }
+}
+
+void JobEngine::addResourceUsage(const StepCgroups::Usage &usage)
+{
+    if (!resourceUsage.has_value())
+    {
+        resourceUsage = StepCgroups::Usage();
+    }
+    resourceUsage->cpuTimeMicros += usage.cpuTimeMicros;
+    if (usage.peakMemoryBytes.has_value() &&
+        (!resourceUsage->peakMemoryBytes.has_value() || *usage.peakMemoryBytes > *resourceUsage->peakMemoryBytes))
+    {
+        resourceUsage->peakMemoryBytes = usage.peakMemoryBytes;
+    }
+}
+
+JobEngine::StepProgress JobEngine::getStepProgress()
 {
+    lock_guard<mutex> guard(stepLock);
+    StepProgress progress;
+    progress.step = currentStep;
+    progress.totalSteps = totalSteps;
+    progress.name = currentStepName;
+    return progress;
+}
+
+void JobEngine::useJournal(std::shared_ptr<JobJournal> journal, const JobJournal::Entry &entry)
+{
+    this->journal = std::move(journal);
+    journalEntry = entry;
+    if (entry.completedSteps > 0)
+    {
+        stdoutstream.addString(entry.stdOut);
+        stderrstream.addString(entry.stdErr);
+        errors = entry.errors;
+    }
+}
+
+void JobEngine::recordStep(size_t step, int executionStatus)
+{
+    if (!journal)
+    {
+        return;
+    }
+    journalEntry.completedSteps = step;
+    journalEntry.executionStatus = executionStatus;
+    journalEntry.stdOut = stdoutstream.toString();
+    journalEntry.stdErr = stderrstream.toString();
+    journalEntry.errors = errors;
+    if (!journal->store(journalEntry))
+    {
+        LOG_WARN(TAG, "Failed to journal the completed step, the job will run from the start if it is interrupted");
+    }
+}
+
+int JobEngine::exec_steps(const PlainJobDocument &jobDocument, const std::string &jobHandlerDir)
+{
+    return exec_steps(make_shared<JobPlan>(jobDocument, jobHandlerDir));
+}
+
+int JobEngine::exec_steps(shared_ptr<const JobPlan> plan)
+{
+    {
+        lock_guard<mutex> guard(stepLock);
+        totalSteps = plan->getTotalSteps();
+    }
+    // Steps that completed before the Device Client restarted are not run again
+    size_t completedSteps = journal ? journalEntry.completedSteps : 0;
+    if (completedSteps > 0)
+    {
+        if (journalEntry.executionStatus != 0)
+        {
+            LOGM_INFO(TAG, "Step %zu had already failed the job before the restart", completedSteps);
+            return journalEntry.executionStatus;
+        }
+        LOGM_INFO(TAG, "Resuming the job after the %zu steps that completed before the restart", completedSteps);
+    }
+    if (plan->getTimeoutSeconds().has_value())
+    {
+        jobDeadline.at = chrono::steady_clock::now() + chrono::seconds(plan->getTimeoutSeconds().value());
+        jobDeadline.reason = Util::FormatMessage("Job timed out after %d seconds", plan->getTimeoutSeconds().value());
+    }
     int executionStatus = 0;
-    for (const auto &action : jobDocument.steps)
+    size_t step = 0;
+    for (const auto &planStep : plan->getSteps())
     {
+        const auto &action = planStep.action;
+        if (++step <= completedSteps)
+        {
+            continue;
+        }
+        if (isJobStopped())
+        {
+            LOGM_WARN(TAG, "%s, skipping the remaining steps", Util::Sanitize(terminationReason).c_str());
+            return CMD_FAILURE;
+        }
         LOGM_INFO(TAG, "About to execute step with name: %s", Util::Sanitize(action.name).c_str());
-        exec_action(action, jobHandlerDir, executionStatus);
+        startStep(step, action);
+        exec_action(planStep, executionStatus);
         if (this->hasErrors())
         {
             LOGM_WARN(
                 TAG, "While executing action %s, JobEngine reported receiving errors from STDERR", action.name.c_str());
         }
+        recordStep(step, executionStatus);
         if (executionStatus != 0)
         {
             return executionStatus;
         }
     }
 
-    if (jobDocument.finalStep.has_value())
+    const JobPlan::Step *finalStep = plan->getFinalStep();
+    if (finalStep != nullptr && ++step > completedSteps)
     {
-        exec_action(jobDocument.finalStep.value(), jobHandlerDir, executionStatus);
-        LOGM_INFO(
-            TAG, "About to execute step with name: %s", Util::Sanitize(jobDocument.finalStep->name.c_str()).c_str());
+        if (isJobStopped())
+        {
+            LOGM_WARN(TAG, "%s, skipping the final step", Util::Sanitize(terminationReason).c_str());
+            return CMD_FAILURE;
+        }
+        startStep(step, finalStep->action);
+        exec_action(*finalStep, executionStatus);
+        LOGM_INFO(TAG, "About to execute step with name: %s", Util::Sanitize(finalStep->action.name).c_str());
+        recordStep(step, executionStatus);
+    }
+    if (executionStatus == 0 && jobStopped)
+    {
+        // The step that was stopped did not fail the job because ignoreStepFailure is set
+        return CMD_FAILURE;
     }
     return executionStatus;
 }
 
-int JobEngine::exec_cmd(std::unique_ptr<const char *[]> &argv)
+int JobEngine::exec_cmd(const char *const argv[])
 {
     // Establish some file descriptors which we'll use to redirect stdout and
     // stderr from the child process back into our logger
@@ -271,12 +562,18 @@ int JobEngine::exec_cmd(std::unique_ptr<const char *[]> &argv)
         return CMD_FAILURE;
     }
 
-    int execResult;
+    // The child process moves itself to the cgroup of the step before it runs anything
+    bool isolated = cgroups && cgroups->createStep(stepCgroup);
+
     int returnCode;
     int pid = vfork();
     if (pid < 0)
     {
         LOGM_ERROR(TAG, "Failed to create child process, fork returned %d", pid);
+        if (isolated)
+        {
+            cgroups->removeStep(stepCgroup);
+        }
         return CMD_FAILURE;
     }
     else if (pid == 0)
@@ -284,6 +581,14 @@ int JobEngine::exec_cmd(std::unique_ptr<const char *[]> &argv)
         // Child process
         LOG_DEBUG(TAG, "Child process now running");
 
+        // Lead a process group of its own, so that the processes it starts can be terminated along with it
+        setpgid(0, 0);
+
+        if (isolated && write(stepCgroup.procsFd, "0", 1) < 0)
+        {
+            LOGM_WARN(TAG, "Failed to move to the cgroup of the step, errno {%d}, it will run without limits", errno);
+        }
+
         // redirect stdout
         if (dup2(stdout[PIPE_WRITE], STDOUT_FILENO) == -1)
         {
@@ -305,7 +610,7 @@ int JobEngine::exec_cmd(std::unique_ptr<const char *[]> &argv)
 
         LOG_DEBUG(TAG, "Child process about to call execvp");
 
-        auto rc = execvp(argv[0], const_cast<char *const *>(argv.get()));
+        auto rc = execvp(argv[0], const_cast<char *const *>(argv));
         if (rc == -1)
         {
             auto err = errno;
@@ -322,31 +627,17 @@ int JobEngine::exec_cmd(std::unique_ptr<const char *[]> &argv)
         close(stdout[PIPE_WRITE]);
         close(stderr[PIPE_WRITE]);
 
-        // Set up some threads to process the output from the child process
-        thread stdOutProcessor(&JobEngine::processCmdOutput, this, stdout[PIPE_READ], false, pid);
-        stdOutProcessor.join();
-        thread stdErrProcessor(&JobEngine::processCmdOutput, this, stderr[PIPE_READ], true, pid);
-        stdErrProcessor.join();
-
-        do
+        returnCode = waitForChild(pid, stdout[PIPE_READ], stderr[PIPE_READ]);
+        if (isolated)
         {
-            // TODO: do not wait for infinite time for child process to complete
-            int waitReturn = waitpid(pid, &execResult, 0);
-            if (waitReturn == -1)
-            {
-                LOGM_WARN(TAG, "Failed to wait for child process: %d", pid);
-            }
-
-            returnCode = WEXITSTATUS(execResult);
-            LOGM_DEBUG(TAG, "JobEngine finished waiting for child process, returning %d", returnCode);
-        } while (!WIFEXITED(execResult) && !WIFSIGNALED(execResult));
+            addResourceUsage(cgroups->removeStep(stepCgroup));
+        }
     }
     return returnCode;
 }
 
-int JobEngine::exec_process(std::unique_ptr<const char *[]> &argv)
+int JobEngine::exec_process(const char *const argv[])
 {
-    int status = 0;
     int execStatus = 0;
     int pid = vfork();
 
@@ -359,8 +650,9 @@ int JobEngine::exec_process(std::unique_ptr<const char *[]> &argv)
     else if (pid == 0)
     {
         LOG_DEBUG(TAG, "Child process now running.");
+        setpgid(0, 0);
 
-        auto rc = execvp(argv[0], const_cast<char *const *>(argv.get()));
+        auto rc = execvp(argv[0], const_cast<char *const *>(argv));
         if (rc == -1)
         {
             auto err = errno;
@@ -372,71 +664,85 @@ int JobEngine::exec_process(std::unique_ptr<const char *[]> &argv)
     else
     {
         LOGM_DEBUG(TAG, "Parent process now running, child PID is %d", pid);
-        do
-        {
-            // TODO: do not wait for infinite time for child process to complete
-            int waitReturn = waitpid(pid, &status, 0);
-            if (waitReturn == -1)
-            {
-                LOGM_WARN(TAG, "Failed to wait for child process: %d", pid);
-            }
-            execStatus = WEXITSTATUS(status);
-            LOGM_DEBUG(TAG, "JobEngine finished waiting for child process, returning %d", execStatus);
-
-        } while (!WIFEXITED(status) && !WIFSIGNALED(status));
+        execStatus = waitForChild(pid, -1, -1);
     }
     return execStatus;
 }
 
-int JobEngine::exec_handlerScript(const std::string &command, PlainJobDocument::JobAction action)
+int JobEngine::exec_handlerScript(const JobPlan::Step &step)
 {
     /**
-     * \brief Create char array argv[] storing arguments to pass to execvp() function.
+     * \brief The argv of the step is passed to execvp() as it was compiled:
      * argv[0] executable path
      * argv[1] Linux user name
      * argv[2:] arguments required for executing the executable file..
      */
-    int actionExecutionStatus;
-    size_t argSize = 0;
-    if (action.handlerInput->args.has_value())
+    if (residentHandlers && residentHandlers->handles(step.command))
     {
-        argSize = action.handlerInput->args->size();
+        return exec_residentHandler(step);
     }
+    return exec_cmd(step.argv.data());
+}
 
-    // cppcheck-suppress leakReturnValNotUsed
-    std::unique_ptr<const char *[]> argv(new const char *[argSize + 3]);
-    argv[0] = command.c_str();
-    argv[1] = action.runAsUser->c_str();
-    argv[argSize + 2] = nullptr;
-    for (size_t i = 0; i < argSize; i++)
+int JobEngine::exec_residentHandler(const JobPlan::Step &step)
+{
+    // The same arguments the handler would be executed with, without its path
+    vector<string> args(next(step.arguments.begin()), step.arguments.end());
+
+    ResidentHandlers::Response response;
+    ResidentHandlers::Outcome outcome = residentHandlers->invoke(
+        step.command, args, min(jobDeadline.at, stepDeadline.at), cancelPipe[PIPE_READ], response);
+    if (response.usage.has_value())
     {
-        argv[i + 2] = action.handlerInput->args->at(i).c_str();
+        addResourceUsage(response.usage.value());
     }
-    actionExecutionStatus = exec_cmd(argv);
-    return actionExecutionStatus;
+    if (outcome == ResidentHandlers::Outcome::STOPPED)
+    {
+        if (!isJobStopped())
+        {
+            terminationReason = stepDeadline.reason;
+        }
+        LOGM_WARN(
+            TAG,
+            "%s, stopped resident handler %s",
+            Util::Sanitize(terminationReason).c_str(),
+            Util::Sanitize(step.command).c_str());
+        return 128 + SIGTERM;
+    }
+    if (outcome == ResidentHandlers::Outcome::FAILED)
+    {
+        return CMD_FAILURE;
+    }
+
+    const pair<const string &, bool> outputs[] = {{response.stdOut, false}, {response.stdErr, true}};
+    for (const auto &output : outputs)
+    {
+        size_t lineCount = 0;
+        size_t start = 0;
+        while (start < output.first.size() && lineCount++ < MAX_LOG_LINES)
+        {
+            size_t lineEnd = output.first.find('\n', start);
+            size_t length = min(
+                lineEnd == string::npos ? output.first.size() - start : lineEnd - start + 1, MAX_OUTPUT_LINE_LENGTH);
+            processCmdOutput(output.first.substr(start, length), output.second, response.pid);
+            start += length;
+        }
+    }
+    LOGM_DEBUG(TAG, "Resident handler %d responded with status %d", response.pid, response.status);
+    return response.status;
 }
 
-bool JobEngine::verifySudoAndUser(PlainJobDocument::JobAction action)
+bool JobEngine::verifySudoAndUser(const string &runAsUser)
 {
     int execStatus1;
     // first to run command id $user and /bin/bash -c "command -v sudo" to verify user and sudo
-
-    // cppcheck-suppress leakReturnValNotUsed
-    std::unique_ptr<const char *[]> argv1(new const char *[3]);
-    argv1[0] = "id";
-    argv1[1] = action.runAsUser->c_str();
-    argv1[2] = nullptr;
+    const char *const argv1[] = {"id", runAsUser.c_str(), nullptr};
 
     execStatus1 = exec_process(argv1);
 
     if (execStatus1 == 0)
     {
-        // cppcheck-suppress leakReturnValNotUsed
-        std::unique_ptr<const char *[]> argv2(new const char *[4]);
-        argv2[0] = "/bin/bash";
-        argv2[1] = "-c";
-        argv2[2] = "command -v sudo";
-        argv2[3] = nullptr;
+        const char *const argv2[] = {"/bin/bash", "-c", "command -v sudo", nullptr};
 
         int execStatus2 = exec_process(argv2);
         if (execStatus2 != 0)
@@ -451,63 +757,127 @@ bool JobEngine::verifySudoAndUser(PlainJobDocument::JobAction action)
     return true;
 }
 
-int JobEngine::exec_shellCommand(PlainJobDocument::JobAction action)
+int JobEngine::exec_shellCommand(const JobPlan::Step &step)
 {
-    int returnCode;
-    bool verification;
-
-    verification = verifySudoAndUser(action);
+    bool verification = verifySudoAndUser(step.action.runAsUser.has_value() ? step.action.runAsUser.value() : "");
 
+    // if one of two verification fails, execute command without "sudo" and "$user", otherwise build command using
+    // sudo -u $user -n $@ and execute
     if (!verification)
     {
-        // if one of two verification fails, execute command without "sudo" and "$user"
         LOG_WARN(TAG, "username or sudo command not found");
+    }
+    const auto &argv = verification ? step.sudoArgv : step.argv;
+    // print out argv for debug
+    for (size_t i = 0; argv[i] != nullptr; ++i)
+    {
+        LOGM_DEBUG(TAG, "argv[%lu]: %s", i, argv[i]);
+    }
+    return exec_cmd(argv.data());
+}
 
-        size_t argSize = action.commandInput->command.size();
+bool JobEngine::resolveDownloadPath(const string &path, const string &downloadDir, string &resolved, string &error)
+{
+    if (downloadDir.empty())
+    {
+        error = "No download directory is configured";
+        return false;
+    }
+    if (!Util::FileUtils::DirectoryExists(downloadDir) &&
+        !Util::FileUtils::CreateDirectoryWithPermissions(downloadDir.c_str(), S_IRWXU))
+    {
+        error = "Unable to create the download directory " + downloadDir;
+        return false;
+    }
+    unique_ptr<char, void (*)(void *)> realDownloadDir(realpath(downloadDir.c_str(), nullptr), free);
+    if (!realDownloadDir)
+    {
+        error = Util::FormatMessage(
+            "Unable to resolve the download directory %s, errno {%d}", downloadDir.c_str(), errno);
+        return false;
+    }
 
-        // cppcheck-suppress leakReturnValNotUsed
-        std::unique_ptr<const char *[]> argv(new const char *[argSize + 1]);
-        argv[argSize] = nullptr;
-        for (size_t i = 0; i < argSize; i++)
-        {
-            argv[i] = action.commandInput->command.at(i).c_str();
-        }
-        // print out argv for debug
-        for (size_t i = 0; i < argSize; ++i)
-        {
-            LOGM_DEBUG(TAG, "argv[%lu]: %s", i, (argv.get())[i]);
-        }
-        returnCode = exec_cmd(argv);
+    const string joined = !path.empty() && path.front() == '/' ? path : downloadDir + "/" + path;
+    const size_t nameStart = joined.rfind('/') + 1;
+    const string name = joined.substr(nameStart);
+    if (name.empty() || name == "." || name == "..")
+    {
+        error = "The path does not name a file: " + path;
+        return false;
     }
-    else
+    // Symbolic links in the directories of the path are resolved, so none can lead out of the download directory
+    unique_ptr<char, void (*)(void *)> parent(realpath(joined.substr(0, nameStart).c_str(), nullptr), free);
+    if (!parent)
     {
-        // if two verifications succeeds, build command using sudo -u $user -n $@ and execute
-        size_t argSize = action.commandInput->command.size();
+        error = Util::FormatMessage("Unable to resolve the directory of %s, errno {%d}", path.c_str(), errno);
+        return false;
+    }
 
-        // cppcheck-suppress leakReturnValNotUsed
-        std::unique_ptr<const char *[]> argv(new const char *[argSize + 5]);
-        argv[0] = "sudo";
-        argv[1] = "-u";
-        argv[2] = action.runAsUser->c_str();
-        argv[3] = "-n";
-        argv[argSize + 4] = nullptr;
-        for (size_t i = 0; i < argSize; i++)
-        {
-            argv[i + 4] = action.commandInput->command.at(i).c_str();
-        }
-        // print out argv to debug
-        for (size_t i = 0; i < argSize + 4; ++i)
-        {
-            LOGM_DEBUG(TAG, "argv[%lu]: %s", i, (argv.get())[i]);
-        }
+    const string base = realDownloadDir.get();
+    const string directory = parent.get();
+    const bool inDownloadDir = directory == base || (directory.size() > base.size() &&
+                                                     directory.compare(0, base.size(), base) == 0 &&
+                                                     (base.back() == '/' || directory[base.size()] == '/'));
+    if (!inDownloadDir)
+    {
+        error = "The path is outside of the download directory " + base + ": " + path;
+        return false;
+    }
+    resolved = directory.back() == '/' ? directory + name : directory + "/" + name;
+    return true;
+}
 
-        returnCode = exec_cmd(argv);
+int JobEngine::exec_download(const PlainJobDocument::JobAction &action)
+{
+    const auto &input = action.downloadInput.value();
+    LOGM_INFO(TAG, "About to download %s to %s", Util::Sanitize(input.url).c_str(), Util::Sanitize(input.path).c_str());
+    if (downloadBootstrap == nullptr)
+    {
+        LOG_ERROR(TAG, "Unable to download files since no client bootstrap was provided to the JobEngine");
+        stderrstream.addString("Download actions are not supported by this job engine\n");
+        return CMD_FAILURE;
     }
-    return returnCode;
+
+    string destination;
+    string error;
+    if (!resolveDownloadPath(input.path, downloadDir, destination, error))
+    {
+        LOGM_ERROR(TAG, "Refusing to download to %s: %s", Util::Sanitize(input.path).c_str(), error.c_str());
+        stderrstream.addString(Util::Sanitize(error) + "\n");
+        return CMD_FAILURE;
+    }
+
+    FileDownloader::Request request;
+    request.url = input.url;
+    request.destination = destination;
+    if (input.sha256.has_value())
+    {
+        request.sha256 = input.sha256.value();
+    }
+    if (input.maxBytesPerSecond.has_value())
+    {
+        request.maxBytesPerSecond = static_cast<size_t>(input.maxBytesPerSecond.value());
+    }
+
+    FileDownloader downloader(downloadBootstrap);
+    if (!downloader.download(request))
+    {
+        stderrstream.addString(Util::Sanitize(downloader.getError()) + "\n");
+        return CMD_FAILURE;
+    }
+    stdoutstream.addString(Util::FormatMessage(
+        "Downloaded %s with SHA-256 digest %s\n",
+        Util::Sanitize(input.path).c_str(),
+        downloader.getSha256().c_str()));
+    return 0;
 }
 
 string JobEngine::getReason(int statusCode)
 {
+    if (statusCode != 0 && !terminationReason.empty())
+    {
+        return terminationReason;
+    }
     ostringstream reason;
     if (WIFEXITED(statusCode))
     {
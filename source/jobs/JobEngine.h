@@ -5,15 +5,22 @@
 #define DEVICE_CLIENT_JOBENGINE_H
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include "../util/FileUtils.h"
+#include "FileDownloader.h"
 #include "JobDocument.h"
+#include "JobJournal.h"
+#include "JobPlan.h"
 #include "LimitedStreamBuffer.h"
+#include "ResidentHandlers.h"
+#include "StepCgroups.h"
 
 namespace Aws
 {
@@ -43,14 +50,49 @@ namespace Aws
                     static constexpr size_t MAX_LOG_LINES = 1000;
 
                     /**
-                     * \brief A keyword that can be specified as the "path" in a job doc to tell the Jobs feature to
-                     * use the configured handler directory when looking for an executable matching the specified
-                     * operation
+                     * \brief Time the processes of a step have to exit after SIGTERM before they are sent SIGKILL
                      */
-                    const char *DEFAULT_PATH_KEYWORD = "default";
+                    static constexpr int KILL_GRACE_PERIOD_SECONDS = 10;
 
-                    const char *RUN_HANDLER_TYPE = "runHandler";
-                    const char *RUN_COMMAND_TYPE = "runCommand";
+                    /**
+                     * \brief How often a child process is checked for having exited when the kernel cannot report it
+                     * through a file descriptor
+                     */
+                    static constexpr int CHILD_POLL_INTERVAL_MILLIS = 100;
+
+                    /**
+                     * \brief The client bootstrap "download" actions connect with, which fail if it is null
+                     */
+                    Crt::Io::ClientBootstrap *downloadBootstrap;
+                    /**
+                     * \brief The directory "download" actions write their files under, which they cannot leave
+                     */
+                    std::string downloadDir;
+
+                    /**
+                     * \brief Creates the cgroups steps that run a handler or a command are placed in, or null to run
+                     * them in the cgroup of the Device Client
+                     */
+                    std::shared_ptr<StepCgroups> cgroups;
+                    /**
+                     * \brief The cgroup of the step being executed, with an empty path if it has none
+                     */
+                    StepCgroups::Step stepCgroup;
+                    /**
+                     * \brief The resources used by the steps executed in cgroups so far
+                     */
+                    Crt::Optional<StepCgroups::Usage> resourceUsage;
+
+                    /**
+                     * \brief Adds the resources used by a step to those of the job
+                     */
+                    void addResourceUsage(const StepCgroups::Usage &usage);
+
+                    /**
+                     * \brief The handlers that are kept running between steps, or null if every step starts its
+                     * handler
+                     */
+                    std::shared_ptr<ResidentHandlers> residentHandlers;
 
                     /**
                      * \brief The number of lines received on STDERR from the child process
@@ -73,89 +115,225 @@ namespace Aws
                     Aws::Iot::DeviceClient::Jobs::LimitedStreamBuffer stderrstream;
 
                     /**
-                     * \brief Builds the command that will be executed
-                     * @param path the provided path to the executable
-                     * @param handler the name of the handler script or executable file
-                     * @return the full executable path.
+                     * \brief Used to read the step being executed from the thread reporting the progress of the job
+                     */
+                    std::mutex stepLock;
+                    size_t currentStep{0};
+                    size_t totalSteps{0};
+                    std::string currentStepName;
+
+                    /**
+                     * \brief Records the step about to be executed and when it times out
+                     */
+                    void startStep(size_t step, const PlainJobDocument::JobAction &action);
+
+                    /**
+                     * \brief A point in time at which the running step is terminated, and why
+                     */
+                    struct Deadline
+                    {
+                        std::chrono::steady_clock::time_point at{std::chrono::steady_clock::time_point::max()};
+                        std::string reason;
+                    };
+                    Deadline jobDeadline;
+                    Deadline stepDeadline;
+
+                    /**
+                     * \brief Why the job was stopped before its steps completed, empty unless it timed out or was
+                     * canceled
+                     */
+                    std::string terminationReason;
+
+                    /**
+                     * \brief Where the progress of the job is recorded after each step, if it is journaled at all
+                     */
+                    std::shared_ptr<JobJournal> journal;
+                    JobJournal::Entry journalEntry;
+
+                    /**
+                     * \brief Records in the journal that a step completed, along with the output of the job so far
+                     * @param step the number of steps that have completed
+                     * @param executionStatus the status the step left the job in
+                     */
+                    void recordStep(size_t step, int executionStatus);
+
+                    std::atomic<bool> canceled{false};
+                    /**
+                     * \brief Whether a step was stopped because the job was canceled or timed out
+                     */
+                    bool jobStopped{false};
+                    /**
+                     * \brief Written to by cancel() to wake up the wait for the running child process
+                     */
+                    int cancelPipe[2]{-1, -1};
+
+                    /**
+                     * \brief Whether the job was canceled or ran out of time, in which case no further steps are run
+                     */
+                    bool isJobStopped();
+
+                    /**
+                     * \brief Waits for a child process to exit while processing its output, without any other thread
                      *
-                     * If this command is unable to find a given job handler and/or the permissions
-                     * for the given job handler are inappropriate, this function will thrown an exception.
+                     * If the step or the job times out or the job is canceled while the child runs, its process group
+                     * is sent SIGTERM, and SIGKILL if it has not exited KILL_GRACE_PERIOD_SECONDS later. The SIGKILL
+                     * also goes to every process in the cgroup of the step, if it has one.
+                     * @param pid the process ID of the child process, which leads its own process group
+                     * @param stdoutFd the read end of the pipe of STDOUT of the child process, or -1
+                     * @param stderrFd the read end of the pipe of STDERR of the child process, or -1
+                     * @return the exit code of the child process, or 128 plus the signal number if it was killed
                      */
-                    std::string buildCommand(
-                        Crt::Optional<std::string> path,
-                        const std::string &handler,
-                        const std::string &jobHandlerDir) const;
+                    int waitForChild(int pid, int stdoutFd, int stderrFd);
 
                     /**
                      * \brief Executes the argv, consists of command and arguments, using execvp().
                      * This function also opens two pipes to process outputs from child processes.
-                     * @param argv the arguments to pass to execvp() to execute
+                     * @param argv the null terminated arguments to pass to execvp() to execute
                      * @return an integer representing the return code of the executed process
                      */
-                    int exec_cmd(std::unique_ptr<const char *[]> &argv);
+                    int exec_cmd(const char *const argv[]);
 
                     /**
                      * \brief Executes the argv, consists of command and arguments, using execvp()
                      * This function only returns the exit code of child processes
-                     * @param argv the arguments to pass to execvp() to execute
+                     * @param argv the null terminated arguments to pass to execvp() to execute
                      * @return an integer representing the return code of the executed process
                      */
-                    int exec_process(std::unique_ptr<const char *[]> &argv);
+                    int exec_process(const char *const argv[]);
 
                     /**
                      * \brief Verifies if "sudo" and "$user" exists
-                     * @param action the action provided in job document to execute
+                     * @param runAsUser the user the step runs as
                      * @return an boolean indicating verification succeeds or fails
                      */
-                    bool verifySudoAndUser(PlainJobDocument::JobAction action);
+                    bool verifySudoAndUser(const std::string &runAsUser);
 
                     /**
-                     * \brief Builds argv for "runHandler" type of jobs and makes calls to exec_cmd()
-                     * to execute
-                     * @param command the command built from handler and path and used by execvp() to execute
-                     * @param action the action provided in job document to execute
+                     * \brief Executes a "runHandler" step with the argv of its plan using exec_cmd()
+                     * @param step the compiled step to execute
                      * @return an integer representing the return code of the executed process
                      */
-                    int exec_handlerScript(const std::string &command, PlainJobDocument::JobAction action);
+                    int exec_handlerScript(const JobPlan::Step &step);
 
                     /**
-                     * \brief Builds argv for "runCommand" type of jobs and makes calls to exec_cmd()
-                     * to execute
-                     * @param action the action provided in job document to execute
-                     * @return an boolean indicating verification succeeds or fails
+                     * \brief Sends a "runHandler" step to its resident handler instead of starting the handler,
+                     * stopping the handler if the step times out or the job is canceled
+                     * @param step the compiled step to execute
+                     * @return the exit status the handler responded with, or an error code
                      */
-                    int exec_shellCommand(PlainJobDocument::JobAction action);
+                    int exec_residentHandler(const JobPlan::Step &step);
 
                     /**
-                     * \brief Executes the given set of steps (actions) in sequence as provided in the job document
+                     * \brief Executes a "runCommand" step using exec_cmd(), as its user through sudo if the user and
+                     * sudo exist
+                     * @param step the compiled step to execute
+                     * @return an integer representing the return code of the executed process
+                     */
+                    int exec_shellCommand(const JobPlan::Step &step);
+
+                    /**
+                     * \brief Downloads the file of a "download" action within the Device Client
                      * @param action the action provided in job document to execute
-                     * @param jobHandlerDir the default job handler directory path
+                     * @return zero if the file was downloaded, or an error code
+                     */
+                    int exec_download(const PlainJobDocument::JobAction &action);
+
+                    /**
+                     * \brief Executes a step of a plan
+                     * @param step the compiled step to execute
                      * @param executionStatus job execution status
-                     * @return an integer representing the return code of the executed action
                      */
-                    void exec_action(
-                        PlainJobDocument::JobAction action,
-                        const std::string &jobHandlerDir,
-                        int &executionStatus);
+                    void exec_action(const JobPlan::Step &step, int &executionStatus);
 
                   public:
-                    virtual ~JobEngine() = default;
                     /**
-                     * \brief Used by output processing threads to assess output from the child process
+                     * \brief The step a job engine is executing, counting from 1, with zero before the first step
+                     */
+                    struct StepProgress
+                    {
+                        size_t step{0};
+                        size_t totalSteps{0};
+                        std::string name;
+                    };
+
+                    /**
+                     * @param downloadBootstrap the client bootstrap "download" actions connect with
+                     * @param cgroups creates the cgroups steps that run a handler or a command are placed in, or null
+                     * @param residentHandlers the handlers that are kept running between steps, or null
+                     * @param downloadDir the directory "download" actions write their files under
+                     */
+                    explicit JobEngine(
+                        Crt::Io::ClientBootstrap *downloadBootstrap = nullptr,
+                        std::shared_ptr<StepCgroups> cgroups = nullptr,
+                        std::shared_ptr<ResidentHandlers> residentHandlers = nullptr,
+                        std::string downloadDir = "");
+                    virtual ~JobEngine();
+
+                    /**
+                     * \brief Resolves the path of a "download" action to the file it writes
+                     *
+                     * Relative paths are resolved against the download directory, which is created if it does not
+                     * exist. The directory the file is written to must already exist and, once symbolic links are
+                     * resolved, be the download directory or one below it.
+                     * @param path the path of the action
+                     * @param downloadDir the download directory
+                     * @param resolved set to the path of the file the action writes
+                     * @param error set to the reason the path was refused
+                     * @return false if the action may not write to the path
+                     */
+                    static bool resolveDownloadPath(
+                        const std::string &path,
+                        const std::string &downloadDir,
+                        std::string &resolved,
+                        std::string &error);
+
+                    // Non-copyable.
+                    JobEngine(const JobEngine &) = delete;
+                    JobEngine &operator=(const JobEngine &) = delete;
+
+                    /**
+                     * \brief Used to assess output from the child process
                      *
-                     * @param fd the file descriptor of the output to process
+                     * @param line a line of output, ending with a newline unless it was cut short
                      * @param isStdErr whether the output being processed is from STDERR
                      * @param childPID the process ID of the child process
                      */
-                    virtual void processCmdOutput(int fd, bool isStdErr, int childPID);
+                    virtual void processCmdOutput(const std::string &line, bool isStdErr, int childPID);
+
+                    /**
+                     * \brief Stops the job, terminating the process group of the running step and skipping the steps
+                     * that remain. May be called from any thread.
+                     */
+                    virtual void cancel();
+
+                    /**
+                     * \brief Whether cancel() was called
+                     */
+                    virtual bool isCanceled() { return canceled; }
+
+                    /**
+                     * \brief Executes the steps of a compiled job document in sequence
+                     * @param plan the plan of the job, which is only read and may be shared with other threads
+                     * @return an integer representing the return code of the executed action
+                     */
+                    virtual int exec_steps(std::shared_ptr<const JobPlan> plan);
 
                     /**
-                     * \brief Executes the given set of steps (actions) in sequence as provided in the job document
+                     * \brief Compiles a job document into a plan, without evaluating its conditions, and executes its
+                     * steps in sequence
                      * @param jobDocument the job document to execute
                      * @param jobHandlerDir the default job handler directory path
                      * @return an integer representing the return code of the executed action
                      */
-                    virtual int exec_steps(PlainJobDocument jobDocument, const std::string &jobHandlerDir);
+                    int exec_steps(const PlainJobDocument &jobDocument, const std::string &jobHandlerDir);
+
+                    /**
+                     * \brief Journals the steps exec_steps completes, and resumes the job after the steps the entry
+                     * records as completed, restoring the output they reported
+                     * @param journal the journal to record the progress of the job in
+                     * @param entry the entry of the job, which records no completed steps unless the job is resumed
+                     */
+                    virtual void useJournal(std::shared_ptr<JobJournal> journal, const JobJournal::Entry &entry);
                     /**
                      * \brief Begin the execution of a command with the specified arguments
                      *
@@ -171,7 +349,8 @@ namespace Aws
                     virtual int hasErrors() { return errors; }
 
                     /**
-                     * \brief Evaluates the return code of the JobEngine's command execution
+                     * \brief Evaluates the return code of the JobEngine's command execution, or explains why the job
+                     * was stopped if it timed out or was canceled
                      * @param statusCode the status code returned by the job execution
                      * @return the output of the status code evaluation
                      */
@@ -190,6 +369,18 @@ namespace Aws
                      * @return a LimitedStreamBuffer taken from the JobEngine
                      */
                     virtual std::string getStdErr() { return stderrstream.toString(); };
+
+                    /**
+                     * \brief The step being executed, which may be called while exec_steps runs on another thread
+                     */
+                    virtual StepProgress getStepProgress();
+
+                    /**
+                     * \brief The CPU time and peak memory of the steps executed in cgroups, which is not set if no
+                     * step was. The CPU time is the sum over the steps and the peak memory is that of the step that
+                     * used the most.
+                     */
+                    virtual Crt::Optional<StepCgroups::Usage> getResourceUsage() { return resourceUsage; }
                 };
             } // namespace Jobs
         }     // namespace DeviceClient
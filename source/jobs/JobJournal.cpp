@@ -0,0 +1,179 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "JobJournal.h"
+#include "../config/Config.h"
+#include "../logging/LoggerFactory.h"
+#include "../util/FileUtils.h"
+#include "../util/StringUtils.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient;
+using namespace Aws::Iot::DeviceClient::Jobs;
+using namespace Aws::Iot::DeviceClient::Logging;
+using namespace Aws::Iot::DeviceClient::Util;
+
+constexpr char JobJournal::HEADER[];
+constexpr char JobJournal::TAG[];
+
+namespace
+{
+    /**
+     * Reads a value written as its length on a line of its own followed by its bytes, since the output of a step
+     * may contain newlines
+     */
+    bool readBlock(istream &input, string &value)
+    {
+        string line;
+        if (!getline(input, line) || line.empty() || line.find_first_not_of("0123456789") != string::npos)
+        {
+            return false;
+        }
+        value.resize(stoul(line));
+        return input.read(&value[0], static_cast<streamsize>(value.size())) && input.get() == '\n';
+    }
+
+    template <typename T> bool readNumber(istream &input, T &value)
+    {
+        string line;
+        if (!getline(input, line))
+        {
+            return false;
+        }
+        istringstream number(line);
+        return (number >> value) && number.eof();
+    }
+} // namespace
+
+bool JobJournal::Entry::isSameExecution(const Entry &other) const
+{
+    return jobId == other.jobId && executionNumber == other.executionNumber && documentHash == other.documentHash;
+}
+
+JobJournal::JobJournal(const string &file) : file(FileUtils::ExtractExpandedPath(file)) {}
+
+bool JobJournal::load(Entry &entry) const
+{
+    if (!FileUtils::FileExists(file))
+    {
+        return false;
+    }
+    if (!FileUtils::ValidateFileOwnershipPermissions(file) ||
+        !FileUtils::ValidateFilePermissions(file, Permissions::JOB_JOURNAL_FILE, false))
+    {
+        return false;
+    }
+
+    ifstream input(file, ios::binary);
+    string line;
+    Entry loaded;
+    if (!getline(input, line) || line != HEADER)
+    {
+        LOG_WARN(TAG, "Ignoring job journal in an unknown format");
+        return false;
+    }
+    if (!getline(input, loaded.jobId) || !readNumber(input, loaded.executionNumber) ||
+        !getline(input, loaded.documentHash) || !readNumber(input, loaded.completedSteps) ||
+        !readNumber(input, loaded.executionStatus) || !readNumber(input, loaded.errors) ||
+        !readBlock(input, loaded.stdOut) || !readBlock(input, loaded.stdErr))
+    {
+        LOG_WARN(TAG, "Ignoring malformed job journal");
+        return false;
+    }
+    entry = loaded;
+    return true;
+}
+
+bool JobJournal::store(const Entry &entry) const
+{
+    if (entry.jobId.find('\n') != string::npos)
+    {
+        LOGM_WARN(TAG, "Not journaling job %s since its ID contains a newline", Sanitize(entry.jobId).c_str());
+        return false;
+    }
+    ostringstream contents;
+    contents << HEADER << '\n'
+             << entry.jobId << '\n'
+             << entry.executionNumber << '\n'
+             << entry.documentHash << '\n'
+             << entry.completedSteps << '\n'
+             << entry.executionStatus << '\n'
+             << entry.errors << '\n'
+             << entry.stdOut.size() << '\n'
+             << entry.stdOut << '\n'
+             << entry.stdErr.size() << '\n'
+             << entry.stdErr << '\n';
+    const string journal = contents.str();
+
+    // Sync a temporary file before it replaces the journal, so that a crash never leaves a partial entry behind
+    string temporaryFile = file + ".tmp";
+    int fd = open(temporaryFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd == -1)
+    {
+        LOGM_WARN(TAG, "Unable to open file: '%s': %s", Sanitize(temporaryFile).c_str(), strerror(errno));
+        return false;
+    }
+    size_t written = 0;
+    while (written < journal.size())
+    {
+        ssize_t count = write(fd, journal.data() + written, journal.size() - written);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count < 0)
+        {
+            break;
+        }
+        written += static_cast<size_t>(count);
+    }
+    bool synced = written == journal.size() && fsync(fd) == 0;
+    close(fd);
+    if (!synced)
+    {
+        LOGM_WARN(TAG, "Unable to write file: '%s': %s", Sanitize(temporaryFile).c_str(), strerror(errno));
+        remove(temporaryFile.c_str());
+        return false;
+    }
+    if (rename(temporaryFile.c_str(), file.c_str()) != 0)
+    {
+        LOGM_WARN(TAG, "Unable to store job journal to: '%s': %s", Sanitize(file).c_str(), strerror(errno));
+        remove(temporaryFile.c_str());
+        return false;
+    }
+
+    // Make the rename itself durable
+    size_t separator = file.find_last_of('/');
+    string directory = separator == string::npos ? "." : file.substr(0, separator == 0 ? 1 : separator);
+    int dirFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd != -1)
+    {
+        fsync(dirFd);
+        close(dirFd);
+    }
+    return true;
+}
+
+void JobJournal::clear() const
+{
+    if (remove(file.c_str()) != 0 && errno != ENOENT)
+    {
+        LOGM_WARN(TAG, "Unable to remove job journal: '%s': %s", Sanitize(file).c_str(), strerror(errno));
+    }
+}
+
+string JobJournal::formatDigest(uint64_t documentDigest)
+{
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(documentDigest));
+    return hex;
+}
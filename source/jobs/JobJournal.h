@@ -0,0 +1,86 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_JOBJOURNAL_H
+#define AWS_IOT_DEVICE_CLIENT_JOBJOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Jobs
+            {
+                /**
+                 * \brief Records how far the steps of the running job got, so that a job interrupted by a restart of
+                 * the Device Client resumes at its first step that had not completed
+                 *
+                 * The journal holds a single entry, which is replaced after every step. Each entry is written to a
+                 * temporary file that is synced and renamed over the journal, so that a crash at any point leaves
+                 * either the previous entry or the new one behind.
+                 */
+                class JobJournal
+                {
+                  public:
+                    static constexpr char HEADER[] = "aws-iot-device-client job journal v1";
+
+                    struct Entry
+                    {
+                        std::string jobId;
+                        int64_t executionNumber{0};
+                        /** Hash of the job document, since a job is only resumed if its steps have not changed **/
+                        std::string documentHash;
+                        /** Number of steps that have completed, counting the final step after all other steps **/
+                        size_t completedSteps{0};
+                        /** The status of the job once a step failed, which ends the job **/
+                        int executionStatus{0};
+                        /** Output of the completed steps that is reported with the status of the job **/
+                        std::string stdOut;
+                        std::string stdErr;
+                        int errors{0};
+
+                        /**
+                         * \brief Whether the entry was recorded for the same execution of the same job document
+                         */
+                        bool isSameExecution(const Entry &other) const;
+                    };
+
+                    explicit JobJournal(const std::string &file);
+
+                    /**
+                     * \brief Reads the entry of the journal
+                     *
+                     * @return false if there is no entry, or the journal is unreadable or has unsafe permissions
+                     */
+                    bool load(Entry &entry) const;
+
+                    /**
+                     * \brief Durably replaces the entry of the journal
+                     */
+                    bool store(const Entry &entry) const;
+
+                    /**
+                     * \brief Removes the entry of the journal once the job it records has been reported as complete
+                     */
+                    void clear() const;
+
+                    /**
+                     * \brief The digest of a job document from SeenJobExecutions::digest, as 16 hexadecimal digits
+                     */
+                    static std::string formatDigest(uint64_t documentDigest);
+
+                  private:
+                    static constexpr char TAG[] = "JobJournal.cpp";
+                    std::string file;
+                };
+            } // namespace Jobs
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_JOBJOURNAL_H
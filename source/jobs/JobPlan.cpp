@@ -0,0 +1,218 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "JobPlan.h"
+#include "../config/Config.h"
+#include "../logging/LoggerFactory.h"
+#include "../util/FileUtils.h"
+#include "../util/StringUtils.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient;
+using namespace Aws::Iot::DeviceClient::Jobs;
+using namespace Aws::Iot::DeviceClient::Logging;
+using namespace Aws::Iot::DeviceClient::Util;
+
+constexpr char JobPlan::CONDITION_TYPE_STRING_EQUAL[];
+constexpr char JobPlan::TAG[];
+constexpr char JobPlan::DEFAULT_PATH_KEYWORD[];
+
+namespace
+{
+    /** Arguments that run a command as the user of its step, which precede the command itself **/
+    constexpr size_t SUDO_PREFIX_LENGTH = 4;
+} // namespace
+
+JobPlan::JobPlan(
+    const PlainJobDocument &jobDocument,
+    const string &jobHandlerDir,
+    const map<string, string> &deviceAttributes)
+    : stdOutIncluded(jobDocument.includeStdOut.has_value() && jobDocument.includeStdOut.value()),
+      timeoutSeconds(jobDocument.timeoutSeconds),
+      unmetCondition(evaluateConditions(jobDocument, deviceAttributes))
+{
+    steps.reserve(jobDocument.steps.size());
+    for (const auto &action : jobDocument.steps)
+    {
+        steps.push_back(compileStep(action, jobHandlerDir));
+    }
+    if (jobDocument.finalStep.has_value())
+    {
+        finalStep.push_back(compileStep(jobDocument.finalStep.value(), jobHandlerDir));
+    }
+
+    // The steps stay where they are from here on, so their argv can point into them
+    for (auto &step : steps)
+    {
+        linkArgv(step);
+    }
+    for (auto &step : finalStep)
+    {
+        linkArgv(step);
+    }
+}
+
+JobPlan::Step JobPlan::compileStep(const PlainJobDocument::JobAction &action, const string &jobHandlerDir)
+{
+    Step step;
+    step.action = action;
+    const string runAsUser = action.runAsUser.has_value() ? action.runAsUser.value() : "";
+    ostringstream argsStringForLogging;
+    if (action.type == PlainJobDocument::ACTION_TYPE_RUN_HANDLER)
+    {
+        try
+        {
+            step.command = buildCommand(action.handlerInput->path, action.handlerInput->handler, jobHandlerDir);
+        }
+        catch (exception &e)
+        {
+            step.error = e.what();
+            return step;
+        }
+        step.arguments.push_back(step.command);
+        step.arguments.push_back(runAsUser);
+        if (action.handlerInput->args.has_value())
+        {
+            for (const auto &eachArgument : action.handlerInput->args.value())
+            {
+                step.arguments.push_back(eachArgument);
+                argsStringForLogging << eachArgument << " ";
+            }
+        }
+        else
+        {
+            LOGM_INFO(
+                TAG,
+                "Did not find any arguments for step %s in the incoming job document. Value should be a JSON array of "
+                "arguments",
+                Sanitize(action.name).c_str());
+        }
+    }
+    else if (action.type == PlainJobDocument::ACTION_TYPE_RUN_COMMAND)
+    {
+        const auto &command = action.commandInput->command;
+        step.command = command.front();
+        step.arguments = {"sudo", "-u", runAsUser, "-n"};
+        step.arguments.insert(step.arguments.end(), command.begin(), command.end());
+        for (size_t i = 1; i < command.size(); i++)
+        {
+            argsStringForLogging << command.at(i) << " ";
+        }
+    }
+    else if (action.type != PlainJobDocument::ACTION_TYPE_DOWNLOAD)
+    {
+        step.error = "Job Document received with invalid action type.";
+        return step;
+    }
+
+    step.description =
+        Sanitize(step.command) + " " + Sanitize(runAsUser) + " " + Sanitize(argsStringForLogging.str());
+    return step;
+}
+
+void JobPlan::linkArgv(Step &step)
+{
+    if (step.arguments.empty())
+    {
+        return;
+    }
+    for (const auto &argument : step.arguments)
+    {
+        step.argv.push_back(argument.c_str());
+    }
+    step.argv.push_back(nullptr);
+    if (step.action.type == PlainJobDocument::ACTION_TYPE_RUN_COMMAND)
+    {
+        step.sudoArgv = step.argv;
+        step.argv.erase(step.argv.begin(), step.argv.begin() + SUDO_PREFIX_LENGTH);
+    }
+}
+
+string JobPlan::buildCommand(const Crt::Optional<string> &path, const string &handler, const string &jobHandlerDir)
+{
+    ostringstream commandStream;
+    bool operationOwnedByDeviceClient = false;
+    if (path.has_value() && DEFAULT_PATH_KEYWORD == path.value())
+    {
+        LOGM_DEBUG(TAG, "Using DC default command path {%s} for command execution", Sanitize(jobHandlerDir).c_str());
+        operationOwnedByDeviceClient = true;
+        commandStream << jobHandlerDir;
+        if (jobHandlerDir.back() != Config::PATH_DIRECTORY_SEPARATOR)
+        {
+            commandStream << Config::PATH_DIRECTORY_SEPARATOR;
+        }
+    }
+    else if (path.has_value() && !path.value().empty())
+    {
+        LOGM_DEBUG(
+            TAG, "Using path {%s} supplied by job document for command execution", Sanitize(path.value()).c_str());
+        commandStream << path.value();
+        if (path.value().back() != Config::PATH_DIRECTORY_SEPARATOR)
+        {
+            commandStream << Config::PATH_DIRECTORY_SEPARATOR;
+        }
+    }
+    else
+    {
+        LOG_DEBUG(TAG, "Assuming executable is in PATH");
+    }
+
+    commandStream << handler;
+
+    if (operationOwnedByDeviceClient)
+    {
+        const int actualPermissions = FileUtils::GetFilePermissions(commandStream.str());
+        if (Permissions::JOB_HANDLER != actualPermissions)
+        {
+            string message = FormatMessage(
+                "Unacceptable permissions found for job handler %s, permissions should be %d but found %d",
+                Sanitize(commandStream.str()).c_str(),
+                Permissions::JOB_HANDLER,
+                actualPermissions);
+            LOG_ERROR(TAG, message.c_str());
+            throw std::runtime_error(message);
+        }
+    }
+    return commandStream.str();
+}
+
+string JobPlan::evaluateConditions(const PlainJobDocument &jobDocument, const map<string, string> &deviceAttributes)
+{
+    if (!jobDocument.conditions.has_value())
+    {
+        return "";
+    }
+    for (const auto &condition : jobDocument.conditions.value())
+    {
+        auto attribute = deviceAttributes.find(condition.conditionKey);
+        if (attribute == deviceAttributes.end())
+        {
+            LOGM_INFO(
+                TAG,
+                "Not evaluating the condition on %s, since the device has no such attribute",
+                Sanitize(condition.conditionKey).c_str());
+            continue;
+        }
+        const string type = condition.type.has_value() ? condition.type.value() : CONDITION_TYPE_STRING_EQUAL;
+        if (type != CONDITION_TYPE_STRING_EQUAL)
+        {
+            return FormatMessage(
+                "Condition on %s has unsupported type %s",
+                Sanitize(condition.conditionKey).c_str(),
+                Sanitize(type).c_str());
+        }
+        const auto &values = condition.conditionValue;
+        if (find(values.begin(), values.end(), attribute->second) == values.end())
+        {
+            return FormatMessage(
+                "Attribute %s of the device is %s, which the condition does not allow",
+                Sanitize(condition.conditionKey).c_str(),
+                Sanitize(attribute->second).c_str());
+        }
+    }
+    return "";
+}
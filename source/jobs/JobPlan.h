@@ -0,0 +1,149 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_JOBPLAN_H
+#define AWS_IOT_DEVICE_CLIENT_JOBPLAN_H
+
+#include "JobDocument.h"
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Jobs
+            {
+                /**
+                 * \brief A validated job document compiled into what its steps execute
+                 *
+                 * The handler paths of the steps are resolved, the permissions of the handlers of the Device Client
+                 * are checked, the argv of every step is built and the conditions of the document are evaluated once,
+                 * when the plan is created. A plan is immutable afterwards, so it can be shared between the thread
+                 * executing the job and the one reporting its progress.
+                 */
+                class JobPlan
+                {
+                  public:
+                    static constexpr char CONDITION_TYPE_STRING_EQUAL[] = "stringEqual";
+
+                    struct Step
+                    {
+                        PlainJobDocument::JobAction action;
+                        /** The executable the step runs, empty for a download **/
+                        std::string command;
+                        /** Why the step fails without running, such as its handler being unusable, empty if it runs **/
+                        std::string error;
+                        /**
+                         * For a "runHandler" step the command, the user to run as and the arguments of the handler.
+                         * For a "runCommand" step the prefix that runs the command as the user through sudo, followed
+                         * by the command and its arguments.
+                         */
+                        std::vector<std::string> arguments;
+                        /** The null terminated argv the step is executed with, pointing into arguments **/
+                        std::vector<const char *> argv;
+                        /** The argv of a "runCommand" step that runs it as the user through sudo **/
+                        std::vector<const char *> sudoArgv;
+                        /** The command, user and arguments of the step as they are logged, already sanitized **/
+                        std::string description;
+                    };
+
+                    /**
+                     * @param jobDocument a job document that passed validation
+                     * @param jobHandlerDir the directory of the handlers of the Device Client
+                     * @param deviceAttributes the attributes of the device the conditions of the document are
+                     * evaluated against
+                     */
+                    JobPlan(
+                        const PlainJobDocument &jobDocument,
+                        const std::string &jobHandlerDir,
+                        const std::map<std::string, std::string> &deviceAttributes =
+                            std::map<std::string, std::string>());
+
+                    // The argv of the steps point into the plan, so it is neither copied nor moved
+                    JobPlan(const JobPlan &) = delete;
+                    JobPlan &operator=(const JobPlan &) = delete;
+
+                    bool includeStdOut() const { return stdOutIncluded; }
+
+                    const Crt::Optional<int> &getTimeoutSeconds() const { return timeoutSeconds; }
+
+                    const std::vector<Step> &getSteps() const { return steps; }
+
+                    /**
+                     * \brief The step run after the others have succeeded, or null if the document has none
+                     */
+                    const Step *getFinalStep() const { return finalStep.empty() ? nullptr : &finalStep.front(); }
+
+                    size_t getTotalSteps() const { return steps.size() + finalStep.size(); }
+
+                    /**
+                     * \brief Whether the device meets every condition of the document on an attribute it has
+                     *
+                     * Conditions on attributes the device was not configured with are not evaluated.
+                     */
+                    bool areConditionsMet() const { return unmetCondition.empty(); }
+
+                    /**
+                     * \brief Describes the first condition the device does not meet, empty if it meets them all
+                     */
+                    const std::string &getUnmetCondition() const { return unmetCondition; }
+
+                  private:
+                    static constexpr char TAG[] = "JobPlan.cpp";
+
+                    /**
+                     * \brief A keyword that can be specified as the "path" in a job doc to tell the Jobs feature to
+                     * use the configured handler directory when looking for an executable matching the specified
+                     * operation
+                     */
+                    static constexpr char DEFAULT_PATH_KEYWORD[] = "default";
+
+                    bool stdOutIncluded{false};
+                    Crt::Optional<int> timeoutSeconds;
+                    std::vector<Step> steps;
+                    /** Holds the final step, if any, so that it is never copied once its argv points into it **/
+                    std::vector<Step> finalStep;
+                    std::string unmetCondition;
+
+                    static Step compileStep(
+                        const PlainJobDocument::JobAction &action,
+                        const std::string &jobHandlerDir);
+
+                    /**
+                     * \brief Points the argv of a step into its arguments, once the step is in its final place
+                     */
+                    static void linkArgv(Step &step);
+
+                    /**
+                     * \brief Builds the command that will be executed
+                     * @param path the provided path to the executable
+                     * @param handler the name of the handler script or executable file
+                     * @return the full executable path.
+                     *
+                     * If this command is unable to find a given job handler and/or the permissions
+                     * for the given job handler are inappropriate, this function will thrown an exception.
+                     */
+                    static std::string buildCommand(
+                        const Crt::Optional<std::string> &path,
+                        const std::string &handler,
+                        const std::string &jobHandlerDir);
+
+                    /**
+                     * \brief Describes the first condition the device does not meet, or returns an empty string
+                     */
+                    static std::string evaluateConditions(
+                        const PlainJobDocument &jobDocument,
+                        const std::map<std::string, std::string> &deviceAttributes);
+                };
+            } // namespace Jobs
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_JOBPLAN_H
@@ -9,6 +9,7 @@
 #include "EphemeralPromise.h"
 #include "JobDocument.h"
 #include "JobEngine.h"
+#include "JobPlan.h"
 
 #include <aws/iotjobs/NextJobExecutionChangedEvent.h>
 #include <aws/iotjobs/NextJobExecutionChangedSubscriptionRequest.h>
@@ -22,6 +23,8 @@
 #include <aws/iotjobs/UpdateJobExecutionSubscriptionRequest.h>
 #include <wordexp.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <thread>
 #include <utility>
 
@@ -34,7 +37,9 @@ using namespace Aws::Iot::DeviceClient::Jobs;
 using namespace Aws::Iotjobs;
 
 constexpr char JobsFeature::NAME[];
+constexpr int JobsFeature::STOP_JOB_TIMEOUT_SECONDS;
 const std::string JobsFeature::DEFAULT_JOBS_HANDLER_DIR = "~/.aws-iot-device-client/jobs/";
+const std::string JobsFeature::DEFAULT_DOWNLOAD_DIR = "~/.aws-iot-device-client/downloads/";
 
 string JobsFeature::getName()
 {
@@ -239,11 +244,12 @@ void JobsFeature::startNextPendingJobReceivedHandler(StartNextJobExecutionRespon
         }
         else
         {
-            if (!isDuplicateNotification(response->Execution.value()))
+            SeenJobExecutions::Key execution = SeenJobExecutions::keyOf(response->Execution.value());
+            if (!isDuplicateNotification(execution))
             {
                 handlingJob.store(true);
 
-                copyJobsNotification(response->Execution.value());
+                copyJobsNotification(execution);
                 initJob(response->Execution.value());
             }
         }
@@ -276,6 +282,17 @@ void JobsFeature::nextJobChangedHandler(NextJobExecutionChangedEvent *event, int
         return;
     }
 
+    {
+        // A job in progress stays the next job of this thing until it reaches a terminal state, which it cannot
+        // have reached through this device while it is still running, so it was canceled or timed out in the service
+        lock_guard<mutex> guard(runningJobLock);
+        if (runningJobEngine && (!event->Execution.has_value() || runningJobId != event->Execution->JobId->c_str()))
+        {
+            LOGM_INFO(TAG, "Job %s is no longer the next job of this thing, canceling it", runningJobId.c_str());
+            runningJobEngine->cancel();
+        }
+    }
+
     if (event->Execution.has_value())
     {
         if (needStop.load())
@@ -290,11 +307,12 @@ void JobsFeature::nextJobChangedHandler(NextJobExecutionChangedEvent *event, int
         else
         {
             // Check to see if this is a duplicate notification
-            if (!isDuplicateNotification(event->Execution.value()))
+            SeenJobExecutions::Key execution = SeenJobExecutions::keyOf(event->Execution.value());
+            if (!isDuplicateNotification(execution))
             {
                 handlingJob.store(true);
 
-                copyJobsNotification(event->Execution.value());
+                copyJobsNotification(execution);
                 initJob(event->Execution.value());
             }
         }
@@ -324,10 +342,18 @@ void JobsFeature::updateJobExecutionStatusAcceptedHandler(Iotjobs::UpdateJobExec
     auto keyValuePair = updateJobExecutionPromises.find(clientToken);
     if (keyValuePair == updateJobExecutionPromises.end())
     {
-        LOGM_ERROR(TAG, "Could not find matching promise for ClientToken: %s", clientToken.c_str());
+        readLock.unlock();
+        if (!statusUpdates.respond(clientToken.c_str(), StatusUpdateDispatcher::Response::ACCEPTED))
+        {
+            LOGM_ERROR(TAG, "Could not find matching promise for ClientToken: %s", clientToken.c_str());
+        }
         return;
     }
 
+    if (response->ExecutionState.has_value() && response->ExecutionState->VersionNumber.has_value())
+    {
+        updateJobExecutionVersions[clientToken] = response->ExecutionState->VersionNumber.value();
+    }
     LOGM_DEBUG(TAG, "Removing ClientToken %s from the updateJobExecution promises map", clientToken.c_str());
     keyValuePair->second.set_value(ACCEPTED);
 }
@@ -353,14 +379,32 @@ void JobsFeature::updateJobExecutionStatusRejectedHandler(Iotjobs::RejectedError
     {
         responseCode = RETRYABLE_ERROR;
     }
+    else if (rejectedErrorCode == Iotjobs::RejectedErrorCode::VersionMismatch)
+    {
+        responseCode = VERSION_MISMATCH;
+    }
 
     Aws::Crt::String clientToken = rejectedError->ClientToken.value();
     unique_lock<mutex> readLock(updateJobExecutionPromisesLock);
     if (updateJobExecutionPromises.find(clientToken) == updateJobExecutionPromises.end())
     {
-        LOGM_ERROR(TAG, "Could not find matching promise for ClientToken: %s", clientToken.c_str());
+        readLock.unlock();
+        // A final status update is given up on after a version mismatch, just like after any non-retryable error
+        const auto dispatcherResponse = responseCode == RETRYABLE_ERROR
+                                            ? StatusUpdateDispatcher::Response::RETRYABLE_ERROR
+                                            : StatusUpdateDispatcher::Response::NON_RETRYABLE_ERROR;
+        if (!statusUpdates.respond(clientToken.c_str(), dispatcherResponse))
+        {
+            // The request timed out before this response arrived
+            LOGM_ERROR(TAG, "Could not find matching promise for ClientToken: %s", clientToken.c_str());
+        }
+        return;
     }
 
+    if (rejectedError->ExecutionState.has_value() && rejectedError->ExecutionState->VersionNumber.has_value())
+    {
+        updateJobExecutionVersions[clientToken] = rejectedError->ExecutionState->VersionNumber.value();
+    }
     updateJobExecutionPromises.at(clientToken).set_value(responseCode);
 }
 
@@ -402,6 +446,15 @@ void JobsFeature::publishUpdateJobExecutionStatus(
         statusDetails["stderr"] = statusInfo.stderror.substr(startPos, statusInfo.stderror.size()).c_str();
     }
 
+    if (statusInfo.resourceUsage.has_value())
+    {
+        statusDetails["cpuTimeMillis"] = to_string(statusInfo.resourceUsage->cpuTimeMicros / 1000).c_str();
+        if (statusInfo.resourceUsage->peakMemoryBytes.has_value())
+        {
+            statusDetails["peakMemoryBytes"] = to_string(*statusInfo.resourceUsage->peakMemoryBytes).c_str();
+        }
+    }
+
     // NOTE(marcoaz): statusDetails is captured by value
     publishUpdateJobExecutionStatusWithRetry(data, statusInfo, statusDetails, onCompleteCallback);
 }
@@ -416,7 +469,8 @@ void JobsFeature::publishUpdateJobExecutionStatusWithRetry(
      * backoff in case our request gets throttled. Otherwise, if we never properly
      * update the job execution status, we'll never receive the next job
      */
-    Retry::ExponentialRetryConfig retryConfig = {10 * 1000, 640 * 1000, -1, &needStop};
+    Retry::ExponentialRetryConfig retryConfig = {
+        10 * 1000, 640 * 1000, -1, &needStop, Retry::Jitter::DECORRELATED, Retry::seedFrom(thingName)};
     if (needStop.load())
     {
         // If we need to stop the Jobs feature, then we're making a best-effort attempt here
@@ -425,135 +479,182 @@ void JobsFeature::publishUpdateJobExecutionStatusWithRetry(
         retryConfig.needStopFlag = nullptr;
     }
 
-    auto publishLambda = [this, data, statusInfo, statusDetails]() -> bool {
-        // We first need to make sure that we haven't previously leaked any promises into our map
-        unique_lock<mutex> leakLock(updateJobExecutionPromisesLock);
-        for (auto keyPromise = updateJobExecutionPromises.cbegin(); keyPromise != updateJobExecutionPromises.cend();
-             /** no increment here **/)
-        {
-            if (keyPromise->second.isExpired())
-            {
-                LOGM_DEBUG(
-                    TAG,
-                    "Removing expired promise for ClientToken %s from the updateJobExecution promise map",
-                    keyPromise->first.c_str());
-                keyPromise = updateJobExecutionPromises.erase(keyPromise);
-            }
-            else
-            {
-                ++keyPromise;
-            }
-        }
-        leakLock.unlock();
-
-        UpdateJobExecutionRequest request;
-        request.JobId = data.JobId->c_str();
-        request.ThingName = this->thingName.c_str();
-        request.Status = statusInfo.status;
-        request.StatusDetails = statusDetails;
-
-        // Create a unique client token each time we attempt the request since the promise has to be fresh
-        string clientToken = UniqueString::GetRandomToken(10);
-        request.ClientToken = Aws::Crt::Optional<Aws::Crt::String>(clientToken.c_str());
-        unique_lock<mutex> writeLock(updateJobExecutionPromisesLock);
-        this->updateJobExecutionPromises.insert(
-            std::pair<Aws::Crt::String, EphemeralPromise<UpdateJobExecutionResponseType>>(
-                clientToken.c_str(),
-                EphemeralPromise<UpdateJobExecutionResponseType>(std::chrono::milliseconds(15 * 1000))));
-        writeLock.unlock();
-        LOGM_DEBUG(
-            TAG,
-            "Created EphemeralPromise for ClientToken %s in the updateJobExecution promises map",
-            clientToken.c_str());
-
-        this->jobsClient->PublishUpdateJobExecution(
-            request,
-            AWS_MQTT_QOS_AT_LEAST_ONCE,
-            std::bind(&JobsFeature::ackUpdateJobExecutionStatus, this, std::placeholders::_1));
-        unique_lock<mutex> futureLock(updateJobExecutionPromisesLock);
-        future<UpdateJobExecutionResponseType> updateFuture =
-            this->updateJobExecutionPromises.at(clientToken.c_str()).get_future();
-        futureLock.unlock();
-        bool finished = false;
-        // Although this entire block will be retried based on the retryConfig, we're only waiting for a maximum of 10
-        // seconds for each individual response
-        if (std::future_status::timeout == updateFuture.wait_for(std::chrono::seconds(10)))
+    UpdateJobExecutionRequest request;
+    request.JobId = data.JobId->c_str();
+    request.ThingName = thingName.c_str();
+    request.Status = statusInfo.status;
+    request.StatusDetails = statusDetails;
+
+    StatusUpdateDispatcher::Update update;
+    update.jobId = data.JobId->c_str();
+    update.onComplete = onCompleteCallback;
+    update.retryConfig = retryConfig;
+    // The dispatcher picks a fresh client token for each attempt, which its response is passed back with
+    update.publish = [this, request](const string &clientToken) {
+        UpdateJobExecutionRequest attempt = request;
+        attempt.ClientToken = Aws::Crt::Optional<Aws::Crt::String>(clientToken.c_str());
+        auto publish = [this, attempt]() {
+            jobsClient->PublishUpdateJobExecution(
+                attempt,
+                AWS_MQTT_QOS_AT_LEAST_ONCE,
+                std::bind(&JobsFeature::ackUpdateJobExecutionStatus, this, std::placeholders::_1));
+        };
+        if (!publishGateway)
         {
-            LOGM_WARN(TAG, "Timeout waiting for ack from PublishUpdateJobExecution for job %s", data.JobId->c_str());
+            publish();
+            return;
         }
-        else
+        Aws::Crt::JsonObject payload;
+        attempt.SerializeToObject(payload);
+        if (!publishGateway->Submit(
+                PublishGateway::Priority::CONTROL, payload.View().WriteCompact().size(), std::move(publish)))
         {
-            int responseCode = updateFuture.get();
-            if (responseCode != ACCEPTED)
-            {
-                if (responseCode == NON_RETRYABLE_ERROR)
-                {
-                    LOGM_ERROR(
-                        TAG,
-                        "Received a non-retryable error response after publishing an UpdateJobExecution request for "
-                        "job %s",
-                        data.JobId->c_str());
-                    finished = true;
-                }
-                else
-                {
-                    LOGM_WARN(
-                        TAG,
-                        "Received a retryable error response after publishing an UpdateJobExecution request for job %s",
-                        data.JobId->c_str());
-                }
-            }
-            else
-            {
-                LOGM_DEBUG(TAG, "Success response after UpdateJobExecution for job %s", data.JobId->c_str());
-                finished = true;
-            }
+            // Left to the response timeout of the dispatcher, after which the update is retried
+            LOGM_WARN(TAG, "Update of job %s was dropped by the publish gateway", attempt.JobId->c_str());
         }
-        unique_lock<mutex> eraseLock(updateJobExecutionPromisesLock);
-        this->updateJobExecutionPromises.erase(clientToken.c_str());
-        return finished;
     };
-    std::thread updateJobExecutionThread([retryConfig, publishLambda, onCompleteCallback] {
-        Retry::exponentialBackoff(retryConfig, publishLambda, onCompleteCallback);
-    });
-    updateJobExecutionThread.detach();
-}
 
-void JobsFeature::copyJobsNotification(Iotjobs::JobExecutionData job)
-{
-    unique_lock<mutex> copyNotificationLock(latestJobsNotificationLock);
-    latestJobsNotification.JobId = job.JobId.value();
-    latestJobsNotification.JobDocument = job.JobDocument.value();
-    latestJobsNotification.ExecutionNumber = job.ExecutionNumber.value();
+    if (!statusUpdates.submit(std::move(update)))
+    {
+        // Not waiting on an update that will never be sent, so that the feature moves on to the next job
+        LOGM_ERROR(TAG, "Dropped the status update of job %s", data.JobId->c_str());
+        if (onCompleteCallback)
+        {
+            onCompleteCallback();
+        }
+    }
 }
 
-bool JobsFeature::isDuplicateNotification(JobExecutionData job)
+JobsFeature::UpdateJobExecutionResponseType JobsFeature::publishJobProgress(
+    const Aws::Iotjobs::JobExecutionData &data,
+    const Aws::Crt::Map<Aws::Crt::String, Aws::Crt::String> &statusDetails,
+    Aws::Crt::Optional<int32_t> &expectedVersion)
 {
-    unique_lock<mutex> readLatestNotificationLock(latestJobsNotificationLock);
-    if (!latestJobsNotification.JobId.has_value())
+    UpdateJobExecutionRequest request;
+    request.JobId = data.JobId->c_str();
+    request.ThingName = thingName.c_str();
+    request.Status = JobStatus::IN_PROGRESS;
+    request.StatusDetails = statusDetails;
+    request.ExpectedVersion = expectedVersion;
+    // Asks for the version of the job execution in the response, which the next progress update expects
+    request.IncludeJobExecutionState = true;
+
+    string clientToken = UniqueString::GetRandomToken(10);
+    request.ClientToken = Aws::Crt::Optional<Aws::Crt::String>(clientToken.c_str());
+    unique_lock<mutex> writeLock(updateJobExecutionPromisesLock);
+    updateJobExecutionPromises.insert(std::pair<Aws::Crt::String, EphemeralPromise<UpdateJobExecutionResponseType>>(
+        clientToken.c_str(),
+        EphemeralPromise<UpdateJobExecutionResponseType>(std::chrono::milliseconds(15 * 1000))));
+    future<UpdateJobExecutionResponseType> updateFuture =
+        updateJobExecutionPromises.at(clientToken.c_str()).get_future();
+    writeLock.unlock();
+
+    auto publish = [this, request]() {
+        jobsClient->PublishUpdateJobExecution(
+            request,
+            AWS_MQTT_QOS_AT_LEAST_ONCE,
+            std::bind(&JobsFeature::ackUpdateJobExecutionStatus, this, std::placeholders::_1));
+    };
+    if (!publishGateway)
     {
-        // We have not seen a job yet
-        LOG_DEBUG(TAG, "We have not seen a job yet, this is not a duplicate job notification");
-        return false;
+        publish();
+    }
+    else
+    {
+        Aws::Crt::JsonObject payload;
+        request.SerializeToObject(payload);
+        // Progress is informational, so it yields to the final status updates of jobs
+        if (!publishGateway->Submit(
+                PublishGateway::Priority::TELEMETRY, payload.View().WriteCompact().size(), std::move(publish)))
+        {
+            LOGM_DEBUG(TAG, "Progress update of job %s was dropped by the publish gateway", data.JobId->c_str());
+        }
     }
 
-    if (strcmp(job.JobId.value().c_str(), latestJobsNotification.JobId.value().c_str()) != 0)
+    UpdateJobExecutionResponseType responseCode = RETRYABLE_ERROR;
+    if (std::future_status::timeout == updateFuture.wait_for(std::chrono::seconds(10)))
     {
-        LOG_DEBUG(TAG, "Job ids differ");
-        return false;
+        LOGM_DEBUG(TAG, "Timeout waiting for the response to a progress update of job %s", data.JobId->c_str());
+    }
+    else
+    {
+        responseCode = updateFuture.get();
     }
 
-    if (strcmp(
-            job.JobDocument.value().View().WriteCompact().c_str(),
-            latestJobsNotification.JobDocument.value().View().WriteCompact().c_str()) != 0)
+    unique_lock<mutex> eraseLock(updateJobExecutionPromisesLock);
+    updateJobExecutionPromises.erase(clientToken.c_str());
+    auto version = updateJobExecutionVersions.find(clientToken.c_str());
+    if (version != updateJobExecutionVersions.end())
     {
-        LOG_DEBUG(TAG, "Job document differs");
-        return false;
+        expectedVersion = version->second;
+        updateJobExecutionVersions.erase(version);
+    }
+    else if (responseCode == VERSION_MISMATCH)
+    {
+        // Without the current version, the next update is sent unconditionally to learn it
+        expectedVersion.reset();
     }
+    return responseCode;
+}
+
+void JobsFeature::reportJobProgress(
+    const Iotjobs::JobExecutionData &job,
+    const JobPlan &plan,
+    JobEngine &engine,
+    const std::function<bool(std::chrono::seconds)> &waitForSteps)
+{
+    auto start = chrono::steady_clock::now();
+    Aws::Crt::Optional<int32_t> expectedVersion;
+    // Each update waits for its response before the next interval starts, so at most one is in flight and a slow
+    // response delays the next update rather than queueing several behind it
+    while (!waitForSteps(chrono::seconds(progressIntervalSeconds)))
+    {
+        JobEngine::StepProgress progress = engine.getStepProgress();
+        Aws::Crt::Map<Aws::Crt::String, Aws::Crt::String> statusDetails;
+        statusDetails["step"] = FormatMessage("%zu/%zu", progress.step, progress.totalSteps).c_str();
+        if (!progress.name.empty())
+        {
+            statusDetails["stepName"] = progress.name.substr(0, MAX_STATUS_DETAIL_LENGTH).c_str();
+        }
+        statusDetails["elapsedSeconds"] =
+            to_string(chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now() - start).count()).c_str();
+
+        string standardOut = plan.includeStdOut() ? engine.getStdOut() : "";
+        if (!standardOut.empty())
+        {
+            size_t startPos =
+                standardOut.size() > PROGRESS_OUTPUT_LENGTH ? standardOut.size() - PROGRESS_OUTPUT_LENGTH : 0;
+            statusDetails["stdout"] = standardOut.substr(startPos).c_str();
+        }
+        string standardError = engine.getStdErr();
+        if (!standardError.empty())
+        {
+            size_t startPos =
+                standardError.size() > PROGRESS_OUTPUT_LENGTH ? standardError.size() - PROGRESS_OUTPUT_LENGTH : 0;
+            statusDetails["stderr"] = standardError.substr(startPos).c_str();
+        }
 
-    if (job.ExecutionNumber.value() != latestJobsNotification.ExecutionNumber.value())
+        if (publishJobProgress(job, statusDetails, expectedVersion) == NON_RETRYABLE_ERROR)
+        {
+            // Most likely the job was canceled or otherwise left IN_PROGRESS in the service
+            LOGM_WARN(TAG, "Progress update of job %s was rejected, no longer reporting progress", job.JobId->c_str());
+            return;
+        }
+    }
+}
+
+void JobsFeature::copyJobsNotification(const SeenJobExecutions::Key &job)
+{
+    unique_lock<mutex> copyNotificationLock(seenJobExecutionsLock);
+    seenJobExecutions.insert(job);
+}
+
+bool JobsFeature::isDuplicateNotification(const SeenJobExecutions::Key &job)
+{
+    unique_lock<mutex> readSeenExecutionsLock(seenJobExecutionsLock);
+    if (!seenJobExecutions.contains(job))
     {
-        LOG_DEBUG(TAG, "Execution number differs");
+        LOG_DEBUG(TAG, "The job execution was not notified recently, this is not a duplicate job notification");
         return false;
     }
 
@@ -586,11 +687,21 @@ void JobsFeature::initJob(const JobExecutionData &job)
             shutdownHandler);
         return;
     }
+    // The document is compiled once here, and the thread that runs the job shares the immutable plan
+    shared_ptr<const JobPlan> plan = make_shared<JobPlan>(jobDocument, jobHandlerDir, deviceAttributes);
+    if (!plan->areConditionsMet())
+    {
+        string reason = "Unable to execute job, the device does not meet its conditions: " + plan->getUnmetCondition();
+        LOGM_ERROR(TAG, "%s", reason.c_str());
+        publishUpdateJobExecutionStatus(
+            job, JobExecutionStatusInfo(Iotjobs::JobStatus::REJECTED, reason, "", ""), shutdownHandler);
+        return;
+    }
     publishUpdateJobExecutionStatus(job, JobExecutionStatusInfo(Iotjobs::JobStatus::IN_PROGRESS));
-    executeJob(job, jobDocument);
+    executeJob(job, plan);
 }
 
-void JobsFeature::executeJob(const Iotjobs::JobExecutionData &job, const PlainJobDocument &jobDocument)
+void JobsFeature::executeJob(const Iotjobs::JobExecutionData &job, shared_ptr<const JobPlan> plan)
 {
     LOGM_INFO(TAG, "Executing job: %s", job.JobId->c_str());
 
@@ -602,11 +713,100 @@ void JobsFeature::executeJob(const Iotjobs::JobExecutionData &job, const PlainJo
             baseNotifier->onEvent(static_cast<Feature *>(this), ClientBaseEventNotification::FEATURE_STOPPED);
         }
     };
-    // TODO: Add support for checking condition
-    auto runJob = [this, job, jobDocument, shutdownHandler]() {
+    auto endJobThread = [this]() {
+        {
+            lock_guard<mutex> guard(runningJobLock);
+            runningJobThread = false;
+        }
+        runningJobEnded.notify_all();
+    };
+    auto runJob = [this, job, plan, shutdownHandler, endJobThread]() {
         auto engine = createJobEngine();
+        {
+            lock_guard<mutex> guard(runningJobLock);
+            runningJobId = job.JobId->c_str();
+            runningJobEngine = engine;
+            if (needStop.load())
+            {
+                // stop() was called before the engine could be canceled by it
+                engine->cancel();
+            }
+        }
+        if (jobJournal)
+        {
+            JobJournal::Entry entry;
+            entry.jobId = job.JobId->c_str();
+            entry.executionNumber = job.ExecutionNumber.value();
+            entry.documentHash = JobJournal::formatDigest(SeenJobExecutions::digest(job.JobDocument->View()));
+            JobJournal::Entry journaled;
+            if (jobJournal->load(journaled) && journaled.isSameExecution(entry))
+            {
+                LOGM_INFO(
+                    TAG,
+                    "Resuming job %s after %zu steps that completed before the Device Client restarted",
+                    job.JobId->c_str(),
+                    journaled.completedSteps);
+                entry = journaled;
+            }
+            engine->useJournal(jobJournal, entry);
+        }
+
+        // Reports the progress of the job on another thread while its steps run
+        mutex progressLock;
+        condition_variable progressCondition;
+        bool stepsDone = false;
+        thread progressReporter;
+        if (progressIntervalSeconds > 0)
+        {
+            auto waitForSteps = [&progressLock, &progressCondition, &stepsDone](chrono::seconds interval) -> bool {
+                unique_lock<mutex> lock(progressLock);
+                return progressCondition.wait_for(lock, interval, [&stepsDone]() { return stepsDone; });
+            };
+            progressReporter = thread([this, &job, &plan, &engine, waitForSteps]() {
+                reportJobProgress(job, *plan, *engine, waitForSteps);
+            });
+        }
+
         // execute all action steps in sequence as provided in job document
-        int executionStatus = engine->exec_steps(jobDocument, jobHandlerDir);
+        int executionStatus = engine->exec_steps(plan);
+        if (progressReporter.joinable())
+        {
+            {
+                lock_guard<mutex> guard(progressLock);
+                stepsDone = true;
+            }
+            progressCondition.notify_all();
+            // The final update is sent after any progress update in flight, so that it is not overwritten
+            progressReporter.join();
+        }
+        {
+            lock_guard<mutex> guard(runningJobLock);
+            if (runningJobEngine == engine)
+            {
+                runningJobEngine.reset();
+            }
+        }
+        if (engine->isCanceled())
+        {
+            if (needStop.load())
+            {
+                // The job is still in progress in the service, and resumes from its journal once jobs start again
+                LOGM_INFO(TAG, "Interrupted job %s since %s is stopping", job.JobId->c_str(), getName().c_str());
+                // stop() reports the feature as stopped once this thread has ended
+                handlingJob.store(false);
+                endJobThread();
+                return;
+            }
+            // The job execution has already reached a terminal state in the service
+            LOGM_INFO(TAG, "Stopped job %s after it was canceled", job.JobId->c_str());
+            if (jobJournal)
+            {
+                jobJournal->clear();
+            }
+            shutdownHandler();
+            endJobThread();
+            return;
+        }
         string reason = engine->getReason(executionStatus);
 
         LOG_INFO(TAG, Sanitize(reason).c_str());
@@ -617,7 +817,7 @@ void JobsFeature::executeJob(const Iotjobs::JobExecutionData &job, const PlainJo
         }
 
         string standardOut;
-        if (jobDocument.includeStdOut)
+        if (plan->includeStdOut())
         {
             standardOut = engine->getStdOut();
         }
@@ -636,9 +836,24 @@ void JobsFeature::executeJob(const Iotjobs::JobExecutionData &job, const PlainJo
             LOG_WARN(TAG, "Job execution failed!");
             status = JobStatus::FAILED;
         }
-        publishUpdateJobExecutionStatus(
-            job, JobExecutionStatusInfo(status, reason, standardOut, engine->getStdErr()), shutdownHandler);
+        JobExecutionStatusInfo statusInfo(status, reason, standardOut, engine->getStdErr());
+        statusInfo.resourceUsage = engine->getResourceUsage();
+        // The journal is kept until the final status has been published, so that a restart before then resumes the
+        // job at its end and reports it again
+        auto journal = jobJournal;
+        publishUpdateJobExecutionStatus(job, statusInfo, [journal, shutdownHandler]() {
+            if (journal)
+            {
+                journal->clear();
+            }
+            shutdownHandler();
+        });
+        endJobThread();
     };
+    {
+        lock_guard<mutex> guard(runningJobLock);
+        runningJobThread = true;
+    }
     thread jobEngineThread(runJob);
     jobEngineThread.detach();
 }
@@ -663,11 +878,40 @@ void JobsFeature::runJobs()
 int JobsFeature::init(
     shared_ptr<Crt::Mqtt::MqttConnection> connection,
     shared_ptr<ClientBaseNotifier> notifier,
-    const PlainConfig &config)
+    const PlainConfig &config,
+    shared_ptr<Util::PublishGateway> publishGateway,
+    Crt::Io::ClientBootstrap *downloadBootstrap)
 {
     mqttConnection = connection;
+    this->publishGateway = publishGateway;
+    this->downloadBootstrap = downloadBootstrap;
     baseNotifier = notifier;
     thingName = config.thingName->c_str();
+    progressIntervalSeconds = config.jobs.progressInterval;
+
+    jobJournal.reset();
+    if (config.jobs.resumeJobs)
+    {
+        jobJournal = make_shared<JobJournal>(Config::DEFAULT_JOB_JOURNAL_FILE);
+    }
+
+    stepCgroups.reset();
+    if (config.jobs.cgroupIsolation)
+    {
+        StepCgroups::Limits limits;
+        limits.cpuMax = config.jobs.cgroupCpuMax;
+        limits.memoryMax = config.jobs.cgroupMemoryMax;
+        limits.ioWeight = config.jobs.cgroupIoWeight;
+        auto cgroups = make_shared<StepCgroups>(limits, config.jobs.cgroupParent);
+        if (cgroups->init())
+        {
+            stepCgroups = cgroups;
+        }
+        else
+        {
+            LOGM_ERROR(TAG, "Failed to set up cgroups for job steps, they will run without resource limits");
+        }
+    }
 
     wordexp_t word;
     if (!config.jobs.handlerDir.empty())
@@ -682,6 +926,18 @@ int JobsFeature::init(
     }
     wordfree(&word);
 
+    wordexp(config.jobs.downloadDir.empty() ? DEFAULT_DOWNLOAD_DIR.c_str() : config.jobs.downloadDir.c_str(), &word, 0);
+    downloadDir = word.we_wordv[0];
+    wordfree(&word);
+
+    deviceAttributes = config.jobs.deviceAttributes;
+
+    residentHandlers.reset();
+    if (!config.jobs.residentHandlers.empty())
+    {
+        residentHandlers = make_shared<ResidentHandlers>(jobHandlerDir, config.jobs.residentHandlers, stepCgroups);
+    }
+
     return 0;
 }
 
@@ -697,6 +953,21 @@ int JobsFeature::start()
 int JobsFeature::stop()
 {
     needStop.store(true);
+    {
+        // A running job is interrupted rather than left running, since a restarted Jobs feature would otherwise
+        // execute it again alongside this one
+        unique_lock<mutex> guard(runningJobLock);
+        if (runningJobEngine)
+        {
+            LOGM_INFO(TAG, "Canceling job %s since %s is stopping", runningJobId.c_str(), getName().c_str());
+            runningJobEngine->cancel();
+        }
+        if (!runningJobEnded.wait_for(
+                guard, chrono::seconds(STOP_JOB_TIMEOUT_SECONDS), [this]() { return !runningJobThread; }))
+        {
+            LOGM_ERROR(TAG, "Job %s did not stop within %d seconds", runningJobId.c_str(), STOP_JOB_TIMEOUT_SECONDS);
+        }
+    }
     if (!handlingJob.load())
     {
         baseNotifier->onEvent(static_cast<Feature *>(this), ClientBaseEventNotification::FEATURE_STOPPED);
@@ -712,5 +983,5 @@ std::shared_ptr<AbstractIotJobsClient> JobsFeature::createJobsClient()
 
 std::shared_ptr<JobEngine> JobsFeature::createJobEngine()
 {
-    return std::make_shared<JobEngine>();
+    return std::make_shared<JobEngine>(downloadBootstrap, stepCgroups, residentHandlers, downloadDir);
 }
@@ -15,6 +15,13 @@
 #include "IotJobsClientWrapper.h"
 #include "JobDocument.h"
 #include "JobEngine.h"
+#include "JobPlan.h"
+#include "SeenJobExecutions.h"
+#include "StatusUpdateDispatcher.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 
 namespace Aws
 {
@@ -45,6 +52,8 @@ namespace Aws
                         std::string reason;
                         std::string stdoutput;
                         std::string stderror;
+                        /** The resources used by the steps of the job, if they ran in cgroups **/
+                        Crt::Optional<StepCgroups::Usage> resourceUsage;
 
                         explicit JobExecutionStatusInfo(Aws::Iotjobs::JobStatus status) : status(status) {}
                         JobExecutionStatusInfo(
@@ -65,12 +74,18 @@ namespace Aws
                      * @param notifier an ClientBaseNotifier used for notifying the client base of events or errors
                      * @param config configuration information passed in by the user via either the command line or
                      * configuration file
+                     * @param publishGateway gateway job status updates are published through, or null to publish
+                     * directly on the connection
+                     * @param downloadBootstrap client bootstrap the "download" actions of jobs connect with, or null
+                     * to fail them
                      * @return a non-zero return code indicates a problem. The logs can be checked for more info
                      */
                     virtual int init(
                         std::shared_ptr<Crt::Mqtt::MqttConnection> connection,
                         std::shared_ptr<ClientBaseNotifier> notifier,
-                        const PlainConfig &config);
+                        const PlainConfig &config,
+                        std::shared_ptr<Util::PublishGateway> publishGateway = nullptr,
+                        Crt::Io::ClientBootstrap *downloadBootstrap = nullptr);
 
                     // Interface methods defined in Feature.h
                     virtual int start() override;
@@ -88,7 +103,9 @@ namespace Aws
                     {
                         ACCEPTED,
                         RETRYABLE_ERROR,
-                        NON_RETRYABLE_ERROR
+                        NON_RETRYABLE_ERROR,
+                        /** The update named an expected version that no longer matches the job execution **/
+                        VERSION_MISMATCH
                     };
 
                   private:
@@ -103,12 +120,29 @@ namespace Aws
                      */
                     static const std::string DEFAULT_JOBS_HANDLER_DIR;
 
+                    /**
+                     * \brief The default directory that "download" actions write their files under
+                     */
+                    static const std::string DEFAULT_DOWNLOAD_DIR;
+
                     /**
                      * \brief A limit enforced by the AWS IoT Jobs API on the maximum number of characters allowed
                      * to be provided in a StatusDetail entry when calling the UpdateJobExecution API
                      */
                     const size_t MAX_STATUS_DETAIL_LENGTH = 1024;
 
+                    /**
+                     * \brief How long stop() waits for a canceled job to end, which leaves time for the processes of
+                     * its step to exit after SIGTERM and still stops within the deadline of the feature registry
+                     */
+                    static constexpr int STOP_JOB_TIMEOUT_SECONDS = 20;
+
+                    /**
+                     * \brief The number of characters at the end of STDOUT and STDERR included in a progress update,
+                     * which is sent far more often than the final update and so carries less of the output
+                     */
+                    const size_t PROGRESS_OUTPUT_LENGTH = 256;
+
                     /**
                      * \brief Whether the DeviceClient base has requested this feature to stop
                      */
@@ -131,13 +165,56 @@ namespace Aws
                         Aws::Iot::DeviceClient::Jobs::EphemeralPromise<UpdateJobExecutionResponseType>>
                         updateJobExecutionPromises;
 
-                    std::mutex latestJobsNotificationLock;
-                    Aws::Iotjobs::JobExecutionData latestJobsNotification;
+                    /**
+                     * \brief The version of the job execution reported in the response to an UpdateJobExecution
+                     * request, by ClientToken. Guarded by updateJobExecutionPromisesLock.
+                     */
+                    Aws::Crt::Map<Aws::Crt::String, int32_t> updateJobExecutionVersions;
+
+                    /**
+                     * \brief The job being executed and the engine executing it, so that the job can be canceled
+                     */
+                    std::mutex runningJobLock;
+                    std::string runningJobId;
+                    std::shared_ptr<JobEngine> runningJobEngine;
+                    /**
+                     * \brief Whether the thread executing a job has not ended yet, guarded by runningJobLock and
+                     * signaled through runningJobEnded, so that stop() can wait for it
+                     */
+                    bool runningJobThread{false};
+                    std::condition_variable runningJobEnded;
+
+                    /**
+                     * \brief The job executions notified most recently, guarded by seenJobExecutionsLock
+                     */
+                    std::mutex seenJobExecutionsLock;
+                    SeenJobExecutions seenJobExecutions;
 
                     /**
                      * \brief Mqtt Connection for IotJobsClient
                      */
                     std::shared_ptr<Crt::Mqtt::MqttConnection> mqttConnection;
+                    /**
+                     * \brief Rate limits job status updates against the other publishes on the connection
+                     */
+                    std::shared_ptr<Util::PublishGateway> publishGateway;
+                    /**
+                     * \brief Client bootstrap the job engines download files with
+                     */
+                    Crt::Io::ClientBootstrap *downloadBootstrap{nullptr};
+                    /**
+                     * \brief Creates the cgroups the steps of jobs run in, or null if steps are not isolated
+                     */
+                    std::shared_ptr<StepCgroups> stepCgroups;
+                    /**
+                     * \brief Records the completed steps of the running job so that it resumes after a restart, or
+                     * null if interrupted jobs run from the start
+                     */
+                    std::shared_ptr<JobJournal> jobJournal;
+                    /**
+                     * \brief The handlers kept running between steps, or null if none are configured
+                     */
+                    std::shared_ptr<ResidentHandlers> residentHandlers;
                     /**
                      * \brief An interface used to notify the Client base if there is an event that requires its
                      * attention
@@ -158,6 +235,23 @@ namespace Aws
                      * the Json configuration file
                      */
                     std::string jobHandlerDir = DEFAULT_JOBS_HANDLER_DIR;
+                    /**
+                     * \brief The directory "download" actions write their files under
+                     */
+                    std::string downloadDir;
+                    /**
+                     * \brief The attributes of the device the conditions of job documents are evaluated against
+                     */
+                    std::map<std::string, std::string> deviceAttributes;
+                    /**
+                     * \brief Seconds between the progress updates of a running job, or zero to disable them
+                     */
+                    int progressIntervalSeconds{PlainConfig::Jobs::DEFAULT_PROGRESS_INTERVAL_SECONDS};
+                    /**
+                     * \brief Publishes and retries the final status updates of jobs. Declared last, so that its thread
+                     * is stopped before the members its callbacks use are destroyed.
+                     */
+                    StatusUpdateDispatcher statusUpdates;
 
                     // Ack handlers
                     /**
@@ -224,6 +318,39 @@ namespace Aws
                         const JobExecutionStatusInfo &statusInfo,
                         const Aws::Crt::Map<Aws::Crt::String, Aws::Crt::String> &statusDetails,
                         const std::function<void(void)> &onCompleteCallback);
+                    /**
+                     * \brief Reports the progress of a running job, waiting for the response without retrying
+                     *
+                     * Progress updates are best effort, so one that fails is superseded by the next one rather than
+                     * retried. The update only applies if the job execution is still at the expected version, if one
+                     * is known, so that it cannot overwrite a change made by the service in the meantime, such as the
+                     * job being canceled.
+                     * @param data JobExecutionData containing information about the job
+                     * @param statusDetails the progress to report
+                     * @param expectedVersion the version of the job execution the update applies to, which is replaced
+                     * by the version reported in the response
+                     * @return how the Jobs service responded, or RETRYABLE_ERROR if there was no response in time
+                     */
+                    virtual UpdateJobExecutionResponseType publishJobProgress(
+                        const Aws::Iotjobs::JobExecutionData &data,
+                        const Aws::Crt::Map<Aws::Crt::String, Aws::Crt::String> &statusDetails,
+                        Aws::Crt::Optional<int32_t> &expectedVersion);
+
+                    /**
+                     * \brief Publishes the progress of a job every progressIntervalSeconds until its steps are done
+                     *
+                     * @param job the job being executed
+                     * @param plan the plan of the job
+                     * @param engine the engine executing the steps of the job
+                     * @param waitForSteps waits up to the given time for the steps to finish, returning true once
+                     * they have
+                     */
+                    void reportJobProgress(
+                        const Aws::Iotjobs::JobExecutionData &job,
+                        const JobPlan &plan,
+                        JobEngine &engine,
+                        const std::function<bool(std::chrono::seconds)> &waitForSteps);
+
                     /**
                      * \brief Creates a subscription to the startNextPendingJobExecution topic
                      */
@@ -296,8 +423,11 @@ namespace Aws
                      * \brief Called to begin the execution of a job on the device
                      *
                      * @param job the job to execute
+                     * @param plan the compiled document of the job, which the job thread shares
                      */
-                    virtual void executeJob(const Iotjobs::JobExecutionData &job, const PlainJobDocument &jobDocument);
+                    virtual void executeJob(
+                        const Iotjobs::JobExecutionData &job,
+                        std::shared_ptr<const JobPlan> plan);
 
                     void initJob(const Iotjobs::JobExecutionData &job);
 
@@ -308,17 +438,17 @@ namespace Aws
                      * or loss where the jobs feature may receive multiple instances of the same message.
                      * This allows us to eliminate duplicates that would otherwise cause the Jobs feature
                      * to run the same job more than once.
-                     * @param job
-                     * @return true if it's a duplicate, false otherwise
+                     * @param job the execution of the job notification, from SeenJobExecutions::keyOf
+                     * @return true if the execution was among those notified most recently, false otherwise
                      */
-                    bool isDuplicateNotification(Iotjobs::JobExecutionData job);
+                    bool isDuplicateNotification(const SeenJobExecutions::Key &job);
 
                     /**
-                     * \brief Stores information about a job notification
+                     * \brief Records the execution of a job notification as the most recently notified one
                      *
-                     * @param job
+                     * @param job the execution of the job notification, from SeenJobExecutions::keyOf
                      */
-                    void copyJobsNotification(Iotjobs::JobExecutionData job);
+                    void copyJobsNotification(const SeenJobExecutions::Key &job);
 
                     /**
                      * \brief virtual functions to facilitate injecting mocks for testing
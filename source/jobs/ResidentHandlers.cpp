@@ -0,0 +1,381 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ResidentHandlers.h"
+#include "../config/Config.h"
+#include "../logging/LoggerFactory.h"
+#include "../util/StringUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <limits>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+using namespace Aws;
+using namespace Aws::Iot::DeviceClient;
+using namespace Aws::Iot::DeviceClient::Jobs;
+using namespace Aws::Iot::DeviceClient::Logging;
+using namespace Aws::Iot::DeviceClient::Util;
+
+constexpr char ResidentHandlers::RESIDENT_ARGUMENT[];
+constexpr size_t ResidentHandlers::MAX_OUTPUT_BYTES;
+constexpr int ResidentHandlers::STOP_GRACE_PERIOD_MILLIS;
+constexpr char ResidentHandlers::TAG[];
+
+namespace
+{
+    constexpr size_t MAX_HEADER_LENGTH = 64;
+    constexpr int EXIT_POLL_INTERVAL_MILLIS = 10;
+
+    bool sendAll(int fd, const string &data)
+    {
+        size_t sent = 0;
+        while (sent < data.size())
+        {
+            // MSG_NOSIGNAL, since a handler that exited must not take the Device Client down with SIGPIPE
+            ssize_t count = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                return false;
+            }
+            sent += static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    /**
+     * Parses "<exit status> <length of stdout> <length of stderr>"
+     */
+    bool parseHeader(const string &header, int &status, size_t &stdOutLength, size_t &stdErrLength)
+    {
+        istringstream fields(header);
+        long long outLength = -1;
+        long long errLength = -1;
+        if (!(fields >> status >> outLength >> errLength) || !(fields >> ws).eof())
+        {
+            return false;
+        }
+        const long long maxLength = static_cast<long long>(ResidentHandlers::MAX_OUTPUT_BYTES);
+        if (outLength < 0 || errLength < 0 || outLength > maxLength || errLength > maxLength)
+        {
+            return false;
+        }
+        stdOutLength = static_cast<size_t>(outLength);
+        stdErrLength = static_cast<size_t>(errLength);
+        return true;
+    }
+} // namespace
+
+ResidentHandlers::ResidentHandlers(
+    const string &handlerDir,
+    const vector<string> &names,
+    shared_ptr<StepCgroups> cgroups)
+    : cgroups(std::move(cgroups))
+{
+    string directory = handlerDir;
+    if (!directory.empty() && directory.back() != Config::PATH_DIRECTORY_SEPARATOR)
+    {
+        directory += Config::PATH_DIRECTORY_SEPARATOR;
+    }
+    for (const auto &name : names)
+    {
+        commands.insert(directory + name);
+    }
+}
+
+ResidentHandlers::~ResidentHandlers()
+{
+    lock_guard<mutex> guard(workersLock);
+    for (auto &worker : workers)
+    {
+        stop(worker.second, 0);
+    }
+}
+
+bool ResidentHandlers::handles(const string &command) const
+{
+    return commands.count(command) > 0;
+}
+
+ResidentHandlers::Outcome ResidentHandlers::invoke(
+    const string &command,
+    const vector<string> &args,
+    chrono::steady_clock::time_point deadline,
+    int wakeUpFd,
+    Response &response)
+{
+    lock_guard<mutex> guard(workersLock);
+    Worker &worker = workers[command];
+    if (worker.pid < 0 && !start(command, worker))
+    {
+        return Outcome::FAILED;
+    }
+
+    Outcome outcome = serve(command, worker, args, deadline, wakeUpFd, response);
+    response.usage = takeUsage(worker);
+    return outcome;
+}
+
+ResidentHandlers::Outcome ResidentHandlers::serve(
+    const string &command,
+    Worker &worker,
+    const vector<string> &args,
+    chrono::steady_clock::time_point deadline,
+    int wakeUpFd,
+    Response &response)
+{
+    ostringstream request;
+    request << args.size() << '\n';
+    for (const auto &arg : args)
+    {
+        request << arg.size() << '\n' << arg << '\n';
+    }
+    if (!sendAll(worker.fd, request.str()))
+    {
+        LOGM_ERROR(
+            TAG,
+            "Failed to send step to resident handler %s (%d): %s",
+            Sanitize(command).c_str(),
+            worker.pid,
+            strerror(errno));
+        stop(worker, SIGTERM);
+        return Outcome::FAILED;
+    }
+
+    size_t headerEnd;
+    while ((headerEnd = worker.received.find('\n')) == string::npos)
+    {
+        if (worker.received.size() > MAX_HEADER_LENGTH)
+        {
+            break;
+        }
+        Read read = readMore(worker, deadline, wakeUpFd);
+        if (read != Read::RECEIVED)
+        {
+            if (read == Read::CLOSED)
+            {
+                LOGM_ERROR(
+                    TAG,
+                    "Resident handler %s (%d) exited without responding to the step",
+                    Sanitize(command).c_str(),
+                    worker.pid);
+            }
+            stop(worker, read == Read::STOPPED ? SIGTERM : 0);
+            return read == Read::STOPPED ? Outcome::STOPPED : Outcome::FAILED;
+        }
+    }
+    int status = 0;
+    size_t stdOutLength = 0;
+    size_t stdErrLength = 0;
+    if (headerEnd == string::npos ||
+        !parseHeader(worker.received.substr(0, headerEnd), status, stdOutLength, stdErrLength))
+    {
+        LOGM_ERROR(TAG, "Resident handler %s (%d) sent a malformed response", Sanitize(command).c_str(), worker.pid);
+        stop(worker, SIGTERM);
+        return Outcome::FAILED;
+    }
+    worker.received.erase(0, headerEnd + 1);
+
+    while (worker.received.size() < stdOutLength + stdErrLength)
+    {
+        Read read = readMore(worker, deadline, wakeUpFd);
+        if (read != Read::RECEIVED)
+        {
+            if (read == Read::CLOSED)
+            {
+                LOGM_ERROR(
+                    TAG,
+                    "Resident handler %s (%d) exited part way through its response",
+                    Sanitize(command).c_str(),
+                    worker.pid);
+            }
+            stop(worker, read == Read::STOPPED ? SIGTERM : 0);
+            return read == Read::STOPPED ? Outcome::STOPPED : Outcome::FAILED;
+        }
+    }
+
+    response.pid = worker.pid;
+    response.status = status;
+    response.stdOut = worker.received.substr(0, stdOutLength);
+    response.stdErr = worker.received.substr(stdOutLength, stdErrLength);
+    worker.received.erase(0, stdOutLength + stdErrLength);
+    return Outcome::COMPLETED;
+}
+
+bool ResidentHandlers::start(const string &command, Worker &worker)
+{
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) < 0)
+    {
+        LOGM_ERROR(
+            TAG, "Failed to create socket for resident handler %s: %s", Sanitize(command).c_str(), strerror(errno));
+        return false;
+    }
+
+    // The handler moves itself to its group before it runs anything, like the child process of a step
+    worker.isolated = cgroups && cgroups->createStep(worker.group, StepCgroups::HANDLER_GROUP_PREFIX);
+    worker.attributedCpuMicros = 0;
+
+    pid_t pid = vfork();
+    if (pid < 0)
+    {
+        LOGM_ERROR(TAG, "Failed to start resident handler %s: %s", Sanitize(command).c_str(), strerror(errno));
+        close(sockets[0]);
+        close(sockets[1]);
+        if (worker.isolated)
+        {
+            cgroups->removeStep(worker.group);
+            worker.isolated = false;
+        }
+        return false;
+    }
+    if (pid == 0)
+    {
+        // Lead a process group of its own, so that the processes it starts can be stopped along with it
+        setpgid(0, 0);
+        if (worker.isolated && write(worker.group.procsFd, "0", 1) < 0)
+        {
+            LOGM_WARN(
+                TAG, "Failed to move to the cgroup of the handler, errno {%d}, it will run without limits", errno);
+        }
+        // dup2 clears close-on-exec for the copies
+        if (dup2(sockets[1], STDIN_FILENO) == -1 || dup2(sockets[1], STDOUT_FILENO) == -1)
+        {
+            _exit(1);
+        }
+        execl(command.c_str(), command.c_str(), RESIDENT_ARGUMENT, static_cast<char *>(nullptr));
+        _exit(127);
+    }
+
+    close(sockets[1]);
+    worker.pid = pid;
+    worker.fd = sockets[0];
+    worker.received.clear();
+    LOGM_INFO(TAG, "Started resident handler %s (%d)", Sanitize(command).c_str(), pid);
+    return true;
+}
+
+void ResidentHandlers::stop(Worker &worker, int signal)
+{
+    if (worker.pid < 0)
+    {
+        return;
+    }
+    close(worker.fd);
+    worker.fd = -1;
+    worker.received.clear();
+    if (signal != 0)
+    {
+        kill(-worker.pid, signal);
+    }
+
+    auto giveUpAt = chrono::steady_clock::now() + chrono::milliseconds(STOP_GRACE_PERIOD_MILLIS);
+    while (true)
+    {
+        pid_t waitReturn = waitpid(worker.pid, nullptr, WNOHANG);
+        if (waitReturn == worker.pid || (waitReturn < 0 && errno != EINTR))
+        {
+            break;
+        }
+        if (chrono::steady_clock::now() >= giveUpAt)
+        {
+            LOGM_WARN(TAG, "Resident handler %d did not exit, sending SIGKILL", worker.pid);
+            kill(-worker.pid, SIGKILL);
+            waitpid(worker.pid, nullptr, 0);
+            break;
+        }
+        this_thread::sleep_for(chrono::milliseconds(EXIT_POLL_INTERVAL_MILLIS));
+    }
+    worker.pid = -1;
+
+    if (!worker.group.path.empty())
+    {
+        // Also kills any process the handler left running
+        uint64_t cpuMicros = cgroups->removeStep(worker.group).cpuTimeMicros;
+        worker.pendingCpuMicros += cpuMicros - min(cpuMicros, worker.attributedCpuMicros);
+        worker.attributedCpuMicros = 0;
+    }
+}
+
+Crt::Optional<StepCgroups::Usage> ResidentHandlers::takeUsage(Worker &worker)
+{
+    if (!worker.isolated)
+    {
+        return Crt::Optional<StepCgroups::Usage>();
+    }
+    if (!worker.group.path.empty())
+    {
+        uint64_t cpuMicros = StepCgroups::readUsage(worker.group.path).cpuTimeMicros;
+        worker.pendingCpuMicros += cpuMicros - min(cpuMicros, worker.attributedCpuMicros);
+        worker.attributedCpuMicros = cpuMicros;
+    }
+    StepCgroups::Usage usage;
+    usage.cpuTimeMicros = worker.pendingCpuMicros;
+    worker.pendingCpuMicros = 0;
+    return usage;
+}
+
+ResidentHandlers::Read ResidentHandlers::readMore(
+    Worker &worker,
+    chrono::steady_clock::time_point deadline,
+    int wakeUpFd)
+{
+    while (true)
+    {
+        int timeoutMillis = -1;
+        if (deadline != chrono::steady_clock::time_point::max())
+        {
+            auto remaining =
+                chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count() + 1;
+            if (remaining <= 0)
+            {
+                return Read::STOPPED;
+            }
+            timeoutMillis = static_cast<int>(min<long long>(remaining, numeric_limits<int>::max()));
+        }
+        array<pollfd, 2> pollFds{{{worker.fd, POLLIN, 0}, {wakeUpFd, POLLIN, 0}}};
+        int ready = poll(pollFds.data(), wakeUpFd >= 0 ? 2 : 1, timeoutMillis);
+        if (ready < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (ready < 0)
+        {
+            return Read::CLOSED;
+        }
+        if (wakeUpFd >= 0 && pollFds[1].revents != 0)
+        {
+            return Read::STOPPED;
+        }
+        if (pollFds[0].revents == 0)
+        {
+            continue;
+        }
+
+        array<char, 4096> buffer;
+        ssize_t count = recv(worker.fd, buffer.data(), buffer.size(), 0);
+        if (count < 0 && (errno == EINTR || errno == EAGAIN))
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return Read::CLOSED;
+        }
+        worker.received.append(buffer.data(), static_cast<size_t>(count));
+        return Read::RECEIVED;
+    }
+}
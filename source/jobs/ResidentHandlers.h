@@ -0,0 +1,188 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_RESIDENTHANDLERS_H
+#define AWS_IOT_DEVICE_CLIENT_RESIDENTHANDLERS_H
+
+#include "StepCgroups.h"
+
+#include <aws/crt/Optional.h>
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Jobs
+            {
+                /**
+                 * \brief Keeps job handlers that are invoked often running between steps, so that a step does not
+                 * pay for starting a process and its interpreter
+                 *
+                 * A resident handler is started once with the single argument RESIDENT_ARGUMENT, with its STDIN and
+                 * STDOUT connected to a socket. Each step is sent to it as a request holding the arguments the
+                 * handler would otherwise be executed with, the first being the user to run as:
+                 *
+                 *     <argument count>\n
+                 *     <length of argument>\n<argument>\n    (for each argument)
+                 *
+                 * and the handler writes back the exit status of the step along with its output:
+                 *
+                 *     <exit status> <length of stdout> <length of stderr>\n<stdout><stderr>
+                 *
+                 * Lengths are in bytes. A handler that exits or breaks the protocol fails the step it was running and
+                 * is started again for the next one. The STDERR of the handler itself is that of the Device Client.
+                 *
+                 * When steps run in cgroups, each handler runs in a group of its own with the limits of a step, and
+                 * the CPU time the group uses between responses is attributed to the step being served.
+                 */
+                class ResidentHandlers
+                {
+                  public:
+                    static constexpr char RESIDENT_ARGUMENT[] = "--resident";
+                    /** Largest stdout or stderr of a response, beyond which the handler is considered broken **/
+                    static constexpr size_t MAX_OUTPUT_BYTES = 1024 * 1024;
+                    /** Time a handler has to exit after its socket is closed or it is sent SIGTERM **/
+                    static constexpr int STOP_GRACE_PERIOD_MILLIS = 2000;
+
+                    struct Response
+                    {
+                        /** The process ID of the handler, for logging **/
+                        pid_t pid{-1};
+                        int status{0};
+                        std::string stdOut;
+                        std::string stdErr;
+                        /**
+                         * The CPU time the handler used for the step, including its start for the first step it
+                         * serves, if it runs in a cgroup. Its peak memory is not known, since the handler outlives
+                         * the step.
+                         */
+                        Crt::Optional<StepCgroups::Usage> usage;
+                    };
+
+                    enum class Outcome
+                    {
+                        COMPLETED,
+                        /** The deadline passed or the step was woken up, so the handler was stopped **/
+                        STOPPED,
+                        FAILED
+                    };
+
+                    /**
+                     * @param handlerDir the directory of the handlers
+                     * @param names the names of the handlers in the directory that are kept running
+                     * @param cgroups creates the groups the handlers run in, or null if they run in the cgroup of the
+                     * Device Client
+                     */
+                    ResidentHandlers(
+                        const std::string &handlerDir,
+                        const std::vector<std::string> &names,
+                        std::shared_ptr<StepCgroups> cgroups = nullptr);
+
+                    /**
+                     * \brief Closes the sockets of the handlers, which makes them exit
+                     */
+                    ~ResidentHandlers();
+
+                    ResidentHandlers(const ResidentHandlers &) = delete;
+                    ResidentHandlers &operator=(const ResidentHandlers &) = delete;
+
+                    /**
+                     * \brief Whether the handler at the given path is kept running
+                     */
+                    bool handles(const std::string &command) const;
+
+                    /**
+                     * \brief Sends a step to a handler, starting the handler if it is not running, and waits for its
+                     * response
+                     *
+                     * @param command the path of the handler
+                     * @param args the arguments of the step
+                     * @param deadline when to give up on the response and stop the handler
+                     * @param wakeUpFd a file descriptor that becomes readable when the step should be stopped, or -1
+                     * @param response set to the response of the handler if the step completed
+                     */
+                    Outcome invoke(
+                        const std::string &command,
+                        const std::vector<std::string> &args,
+                        std::chrono::steady_clock::time_point deadline,
+                        int wakeUpFd,
+                        Response &response);
+
+                  private:
+                    static constexpr char TAG[] = "ResidentHandlers.cpp";
+
+                    struct Worker
+                    {
+                        pid_t pid{-1};
+                        int fd{-1};
+                        /** Bytes received beyond the last response **/
+                        std::string received;
+                        /** Whether the handler was started in a group of its own **/
+                        bool isolated{false};
+                        StepCgroups::Step group;
+                        /** CPU time of the group that was attributed to steps **/
+                        uint64_t attributedCpuMicros{0};
+                        /** CPU time of groups the handler was stopped in that was not attributed to a step yet **/
+                        uint64_t pendingCpuMicros{0};
+                    };
+
+                    /**
+                     * \brief Result of waiting for more of a response
+                     */
+                    enum class Read
+                    {
+                        RECEIVED,
+                        STOPPED,
+                        CLOSED
+                    };
+
+                    std::set<std::string> commands;
+                    std::shared_ptr<StepCgroups> cgroups;
+                    /** Guards workers, and is held for a whole invocation since a handler serves one step at a time **/
+                    std::mutex workersLock;
+                    std::map<std::string, Worker> workers;
+
+                    bool start(const std::string &command, Worker &worker);
+
+                    /**
+                     * \brief Closes the socket of a handler and reaps it, sending it SIGKILL if it has not exited
+                     * STOP_GRACE_PERIOD_MILLIS after the given signal, if any, then removes its group
+                     */
+                    void stop(Worker &worker, int signal);
+
+                    /**
+                     * \brief Sends a step to a running handler and waits for its response
+                     */
+                    Outcome serve(
+                        const std::string &command,
+                        Worker &worker,
+                        const std::vector<std::string> &args,
+                        std::chrono::steady_clock::time_point deadline,
+                        int wakeUpFd,
+                        Response &response);
+
+                    /**
+                     * \brief The CPU time the handler used since the last step it served, if it runs in a group
+                     */
+                    static Crt::Optional<StepCgroups::Usage> takeUsage(Worker &worker);
+
+                    static Read readMore(Worker &worker, std::chrono::steady_clock::time_point deadline, int wakeUpFd);
+                };
+            } // namespace Jobs
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_RESIDENTHANDLERS_H
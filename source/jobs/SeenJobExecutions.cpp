@@ -0,0 +1,134 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "SeenJobExecutions.h"
+#include "../util/HashUtils.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace Aws::Crt;
+using namespace Aws::Iot::DeviceClient::Jobs;
+using namespace Aws::Iot::DeviceClient::Util;
+
+constexpr size_t SeenJobExecutions::DEFAULT_CAPACITY;
+
+namespace
+{
+    void hashBytes(uint64_t &hash, const void *data, size_t size)
+    {
+        hash = Fnv1aBytes(data, size, hash);
+    }
+
+    /**
+     * Each value is prefixed with its type, and strings with their length, so that different documents never hash the
+     * same sequence of bytes
+     */
+    void hashString(uint64_t &hash, char type, const String &value)
+    {
+        uint64_t size = value.size();
+        hashBytes(hash, &type, 1);
+        hashBytes(hash, &size, sizeof(size));
+        hashBytes(hash, value.data(), value.size());
+    }
+
+    void hashValue(uint64_t &hash, const JsonView &value)
+    {
+        if (value.IsObject())
+        {
+            // Keys are visited in sorted order, since the map is ordered
+            Map<String, JsonView> members = value.GetAllObjects();
+            uint64_t size = members.size();
+            hashBytes(hash, "{", 1);
+            hashBytes(hash, &size, sizeof(size));
+            for (const auto &member : members)
+            {
+                hashString(hash, 'k', member.first);
+                hashValue(hash, member.second);
+            }
+        }
+        else if (value.IsListType())
+        {
+            Vector<JsonView> elements = value.AsArray();
+            uint64_t size = elements.size();
+            hashBytes(hash, "[", 1);
+            hashBytes(hash, &size, sizeof(size));
+            for (const auto &element : elements)
+            {
+                hashValue(hash, element);
+            }
+        }
+        else if (value.IsString())
+        {
+            hashString(hash, 's', value.AsString());
+        }
+        else if (value.IsNumber())
+        {
+            double number = value.AsDouble();
+            uint64_t bits;
+            memcpy(&bits, &number, sizeof(bits));
+            hashBytes(hash, "n", 1);
+            hashBytes(hash, &bits, sizeof(bits));
+        }
+        else if (value.IsBool())
+        {
+            hashBytes(hash, value.AsBool() ? "t" : "f", 1);
+        }
+        else
+        {
+            hashBytes(hash, "z", 1);
+        }
+    }
+} // namespace
+
+SeenJobExecutions::Key SeenJobExecutions::keyOf(const Iotjobs::JobExecutionData &job)
+{
+    Key key;
+    if (job.JobId.has_value())
+    {
+        key.jobId = job.JobId->c_str();
+    }
+    if (job.ExecutionNumber.has_value())
+    {
+        key.executionNumber = job.ExecutionNumber.value();
+    }
+    if (job.JobDocument.has_value())
+    {
+        key.documentDigest = digest(job.JobDocument->View());
+    }
+    return key;
+}
+
+uint64_t SeenJobExecutions::digest(const JsonView &document)
+{
+    uint64_t hash = FNV1A_OFFSET_BASIS;
+    hashValue(hash, document);
+    return hash;
+}
+
+SeenJobExecutions::SeenJobExecutions(size_t capacity) : capacity(max<size_t>(capacity, 1)) {}
+
+bool SeenJobExecutions::contains(const Key &key)
+{
+    auto seen = find(recent.begin(), recent.end(), key);
+    if (seen == recent.end())
+    {
+        return false;
+    }
+    recent.splice(recent.begin(), recent, seen);
+    return true;
+}
+
+void SeenJobExecutions::insert(const Key &key)
+{
+    if (contains(key))
+    {
+        return;
+    }
+    recent.push_front(key);
+    if (recent.size() > capacity)
+    {
+        recent.pop_back();
+    }
+}
@@ -0,0 +1,83 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_SEENJOBEXECUTIONS_H
+#define AWS_IOT_DEVICE_CLIENT_SEENJOBEXECUTIONS_H
+
+#include <aws/crt/JsonObject.h>
+#include <aws/iotjobs/JobExecutionData.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Jobs
+            {
+                /**
+                 * \brief The job executions the Jobs feature was most recently notified of, used to tell duplicate
+                 * notifications apart from new jobs
+                 *
+                 * Executions are compared by job ID, execution number and a digest of the job document, which is
+                 * computed once per notification instead of serializing both documents for every comparison. The
+                 * least recently seen execution is forgotten once more than the capacity have been seen. Not thread
+                 * safe.
+                 */
+                class SeenJobExecutions
+                {
+                  public:
+                    static constexpr size_t DEFAULT_CAPACITY = 16;
+
+                    struct Key
+                    {
+                        std::string jobId;
+                        int64_t executionNumber{0};
+                        uint64_t documentDigest{0};
+
+                        bool operator==(const Key &other) const
+                        {
+                            return executionNumber == other.executionNumber &&
+                                   documentDigest == other.documentDigest && jobId == other.jobId;
+                        }
+                    };
+
+                    /**
+                     * \brief Identifies the execution of a job notification
+                     */
+                    static Key keyOf(const Iotjobs::JobExecutionData &job);
+
+                    /**
+                     * \brief 64-bit FNV-1a digest of a JSON document that does not depend on the order of the keys of
+                     * its objects or on how it is formatted
+                     */
+                    static uint64_t digest(const Crt::JsonView &document);
+
+                    explicit SeenJobExecutions(size_t capacity = DEFAULT_CAPACITY);
+
+                    /**
+                     * \brief Whether the execution was seen recently, which makes it the most recently seen one
+                     */
+                    bool contains(const Key &key);
+
+                    /**
+                     * \brief Records the execution as the most recently seen one
+                     */
+                    void insert(const Key &key);
+
+                  private:
+                    size_t capacity;
+                    /** Most recently seen first **/
+                    std::list<Key> recent;
+                };
+            } // namespace Jobs
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_SEENJOBEXECUTIONS_H
@@ -0,0 +1,271 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "StatusUpdateDispatcher.h"
+#include "../logging/LoggerFactory.h"
+#include "../util/StringUtils.h"
+#include "../util/UniqueString.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Jobs;
+using namespace Aws::Iot::DeviceClient::Logging;
+using namespace Aws::Iot::DeviceClient::Util;
+
+constexpr size_t StatusUpdateDispatcher::DEFAULT_CAPACITY;
+constexpr int StatusUpdateDispatcher::DEFAULT_RESPONSE_TIMEOUT_MILLIS;
+constexpr char StatusUpdateDispatcher::TAG[];
+
+namespace
+{
+    constexpr size_t CLIENT_TOKEN_LENGTH = 10;
+} // namespace
+
+StatusUpdateDispatcher::StatusUpdateDispatcher(size_t capacity, chrono::milliseconds responseTimeout)
+    : capacity(max<size_t>(capacity, 1)), responseTimeout(responseTimeout)
+{
+}
+
+StatusUpdateDispatcher::~StatusUpdateDispatcher()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        running = false;
+    }
+    wakeUp.notify_all();
+    if (dispatcher.joinable())
+    {
+        dispatcher.join();
+    }
+}
+
+bool StatusUpdateDispatcher::submit(Update update)
+{
+    lock_guard<mutex> guard(lock);
+    const string jobId = update.jobId;
+    auto existing = pending.find(jobId);
+    if (existing != pending.end())
+    {
+        Pending &current = *existing->second;
+        LOGM_DEBUG(TAG, "Superseding the pending status update of job %s", Sanitize(jobId).c_str());
+        if (current.update.onComplete)
+        {
+            current.supersededCallbacks.push_back(std::move(current.update.onComplete));
+        }
+        current.update = std::move(update);
+        current.backoff = Retry::BackoffSchedule(current.update.retryConfig);
+        current.attempts = 0;
+        if (!current.inFlightToken.empty())
+        {
+            // Sent once the request in flight is answered or times out, so that the service never receives the
+            // updates of a job out of order
+            current.superseded = true;
+            return true;
+        }
+        schedule(jobId, current, Clock::now());
+    }
+    else
+    {
+        if (pending.size() >= capacity)
+        {
+            LOGM_ERROR(
+                TAG,
+                "Unable to queue the status update of job %s, updates of %zu other jobs are pending",
+                Sanitize(jobId).c_str(),
+                pending.size());
+            return false;
+        }
+        unique_ptr<Pending> &added = pending[jobId];
+        added.reset(new Pending(std::move(update)));
+        schedule(jobId, *added, Clock::now());
+    }
+
+    if (!dispatcher.joinable())
+    {
+        dispatcher = thread(&StatusUpdateDispatcher::run, this);
+    }
+    return true;
+}
+
+bool StatusUpdateDispatcher::respond(const string &clientToken, Response response)
+{
+    lock_guard<mutex> guard(lock);
+    auto request = inFlight.find(clientToken);
+    if (request == inFlight.end())
+    {
+        return false;
+    }
+    const string jobId = request->second;
+    inFlight.erase(request);
+
+    auto update = pending.find(jobId);
+    if (update != pending.end() && update->second->inFlightToken == clientToken)
+    {
+        update->second->responded = true;
+        update->second->response = response;
+        schedule(jobId, *update->second, Clock::now());
+    }
+    return true;
+}
+
+size_t StatusUpdateDispatcher::pendingCount()
+{
+    lock_guard<mutex> guard(lock);
+    return pending.size();
+}
+
+void StatusUpdateDispatcher::schedule(const string &jobId, Pending &update, Clock::time_point at)
+{
+    update.timer = ++lastTimer;
+    const bool earliest = timers.empty() || at < timers.top().at;
+    timers.push({at, update.timer, jobId});
+    if (earliest)
+    {
+        wakeUp.notify_one();
+    }
+}
+
+void StatusUpdateDispatcher::run()
+{
+    unique_lock<mutex> guard(lock);
+    while (running)
+    {
+        if (timers.empty())
+        {
+            wakeUp.wait(guard);
+            continue;
+        }
+        // Copied, since the heap may change while the lock is released
+        const Clock::time_point at = timers.top().at;
+        if (at > Clock::now())
+        {
+            wakeUp.wait_until(guard, at);
+            continue;
+        }
+
+        Timer timer = timers.top();
+        timers.pop();
+        auto update = pending.find(timer.jobId);
+        if (update == pending.end() || update->second->timer != timer.id)
+        {
+            // Superseded by a later timer of the job
+            continue;
+        }
+        vector<function<void()>> actions;
+        advance(timer.jobId, *update->second, actions);
+
+        // Publishing may respond right away, and completion callbacks may submit further updates
+        guard.unlock();
+        for (const auto &action : actions)
+        {
+            action();
+        }
+        guard.lock();
+    }
+}
+
+void StatusUpdateDispatcher::advance(const string &jobId, Pending &update, vector<function<void()>> &actions)
+{
+    if (!update.inFlightToken.empty())
+    {
+        const bool responded = update.responded;
+        if (!responded)
+        {
+            LOGM_WARN(TAG, "Timeout waiting for the response to the status update of job %s", Sanitize(jobId).c_str());
+            inFlight.erase(update.inFlightToken);
+        }
+        update.inFlightToken.clear();
+        update.responded = false;
+
+        if (update.superseded)
+        {
+            // Whatever the response, the update that superseded the one in flight is sent next
+            update.superseded = false;
+        }
+        else if (responded && update.response != Response::RETRYABLE_ERROR)
+        {
+            if (update.response == Response::NON_RETRYABLE_ERROR)
+            {
+                LOGM_ERROR(
+                    TAG,
+                    "Received a non-retryable error response to the status update of job %s",
+                    Sanitize(jobId).c_str());
+            }
+            else
+            {
+                LOGM_DEBUG(TAG, "Status update of job %s was accepted", Sanitize(jobId).c_str());
+            }
+            complete(jobId, actions);
+            return;
+        }
+        else
+        {
+            if (responded)
+            {
+                LOGM_WARN(
+                    TAG, "Received a retryable error response to the status update of job %s", Sanitize(jobId).c_str());
+            }
+            const long maxRetries = update.update.retryConfig.maxRetries;
+            if (isStopRequested(update) || (maxRetries >= 0 && update.attempts >= maxRetries))
+            {
+                LOGM_WARN(TAG, "Giving up on the status update of job %s", Sanitize(jobId).c_str());
+                complete(jobId, actions);
+                return;
+            }
+            long backoffMillis = update.backoff.next();
+            LOGM_DEBUG(
+                TAG,
+                "Sending the status update of job %s again in %ld milliseconds",
+                Sanitize(jobId).c_str(),
+                backoffMillis);
+            schedule(jobId, update, Clock::now() + chrono::milliseconds(backoffMillis));
+            return;
+        }
+    }
+
+    if (isStopRequested(update))
+    {
+        LOGM_DEBUG(TAG, "Stop was requested, not sending the status update of job %s", Sanitize(jobId).c_str());
+        complete(jobId, actions);
+        return;
+    }
+    // A fresh client token for each attempt, so that a late response to an earlier attempt is not mistaken for it
+    string clientToken = UniqueString::GetRandomToken(CLIENT_TOKEN_LENGTH);
+    update.inFlightToken = clientToken;
+    update.attempts++;
+    inFlight[clientToken] = jobId;
+    schedule(jobId, update, Clock::now() + responseTimeout);
+    // Copied, since a later update may replace it while it is called without the lock
+    auto publish = update.update.publish;
+    actions.push_back([publish, clientToken]() { publish(clientToken); });
+}
+
+void StatusUpdateDispatcher::complete(const string &jobId, vector<function<void()>> &actions)
+{
+    auto update = pending.find(jobId);
+    if (update == pending.end())
+    {
+        return;
+    }
+    Pending &completed = *update->second;
+    if (!completed.inFlightToken.empty())
+    {
+        inFlight.erase(completed.inFlightToken);
+    }
+    for (auto &callback : completed.supersededCallbacks)
+    {
+        actions.push_back(std::move(callback));
+    }
+    if (completed.update.onComplete)
+    {
+        actions.push_back(std::move(completed.update.onComplete));
+    }
+    pending.erase(update);
+}
+
+bool StatusUpdateDispatcher::isStopRequested(const Pending &update)
+{
+    const auto *needStopFlag = update.update.retryConfig.needStopFlag;
+    return needStopFlag != nullptr && needStopFlag->load();
+}
@@ -0,0 +1,190 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_STATUSUPDATEDISPATCHER_H
+#define AWS_IOT_DEVICE_CLIENT_STATUSUPDATEDISPATCHER_H
+
+#include "../util/Retry.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Jobs
+            {
+                /**
+                 * \brief Publishes the status updates of job executions from a single thread, retrying them with
+                 * exponential backoff until the service responds
+                 *
+                 * Only the latest status of a job execution matters, so an update submitted while an earlier one for
+                 * the same job is still pending supersedes it: the earlier one is not sent again, and its completion
+                 * callback runs along with that of the update that superseded it. Retries and response timeouts are
+                 * kept in a min-heap of timers, so a throttled update waits without holding a thread, and no more
+                 * than one request per job execution is in flight.
+                 */
+                class StatusUpdateDispatcher
+                {
+                  public:
+                    static constexpr size_t DEFAULT_CAPACITY = 16;
+                    static constexpr int DEFAULT_RESPONSE_TIMEOUT_MILLIS = 10 * 1000;
+
+                    enum class Response
+                    {
+                        ACCEPTED,
+                        /** Such as throttling, after which the update is sent again **/
+                        RETRYABLE_ERROR,
+                        /** The update can never be applied, so it is given up on **/
+                        NON_RETRYABLE_ERROR
+                    };
+
+                    struct Update
+                    {
+                        std::string jobId;
+                        /**
+                         * Sends the update as a request with the given client token, which the response to it is
+                         * passed back to respond() with
+                         */
+                        std::function<void(const std::string &clientToken)> publish;
+                        /** Called once the update is accepted or given up on, or null **/
+                        std::function<void()> onComplete;
+                        /** How often and how long apart the update is sent again, as with Retry::exponentialBackoff **/
+                        Util::Retry::ExponentialRetryConfig retryConfig;
+                    };
+
+                    /**
+                     * @param capacity the most job executions updates may be pending for at once
+                     * @param responseTimeout how long to wait for the response to a request before sending it again
+                     */
+                    explicit StatusUpdateDispatcher(
+                        size_t capacity = DEFAULT_CAPACITY,
+                        std::chrono::milliseconds responseTimeout =
+                            std::chrono::milliseconds(DEFAULT_RESPONSE_TIMEOUT_MILLIS));
+
+                    /**
+                     * \brief Stops the thread of the dispatcher, dropping the updates still pending
+                     */
+                    ~StatusUpdateDispatcher();
+
+                    StatusUpdateDispatcher(const StatusUpdateDispatcher &) = delete;
+                    StatusUpdateDispatcher &operator=(const StatusUpdateDispatcher &) = delete;
+
+                    /**
+                     * \brief Queues an update, superseding any update of the same job execution still pending
+                     * @return false if updates of capacity other job executions are already pending, in which case
+                     * the update is not queued and its completion callback is not called
+                     */
+                    bool submit(Update update);
+
+                    /**
+                     * \brief Passes on the response to the request with the given client token. May be called from
+                     * any thread, including from within the publish function of an update.
+                     * @return false if no request with the client token is waiting for its response
+                     */
+                    bool respond(const std::string &clientToken, Response response);
+
+                    /**
+                     * \brief The number of job executions whose updates are pending
+                     */
+                    size_t pendingCount();
+
+                  private:
+                    static constexpr char TAG[] = "StatusUpdateDispatcher.cpp";
+
+                    using Clock = std::chrono::steady_clock;
+
+                    struct Pending
+                    {
+                        explicit Pending(Update update)
+                            : update(std::move(update)), backoff(this->update.retryConfig)
+                        {
+                        }
+
+                        /** The latest update of the job execution **/
+                        Update update;
+                        /** Completion callbacks of the updates it superseded **/
+                        std::vector<std::function<void()>> supersededCallbacks;
+                        Util::Retry::BackoffSchedule backoff;
+                        long attempts{0};
+                        /** The client token of the request waiting for its response, empty if there is none **/
+                        std::string inFlightToken;
+                        /** Whether the request in flight is of an update that was superseded since **/
+                        bool superseded{false};
+                        /** Whether the response to the request in flight arrived, and what it was **/
+                        bool responded{false};
+                        Response response{Response::RETRYABLE_ERROR};
+                        /** The only timer of the job execution that has not been superseded **/
+                        uint64_t timer{0};
+                    };
+
+                    struct Timer
+                    {
+                        Clock::time_point at;
+                        uint64_t id;
+                        std::string jobId;
+
+                        bool operator>(const Timer &other) const { return at > other.at; }
+                    };
+
+                    const size_t capacity;
+                    const std::chrono::milliseconds responseTimeout;
+
+                    std::mutex lock;
+                    std::condition_variable wakeUp;
+                    bool running{true};
+                    std::thread dispatcher;
+                    std::map<std::string, std::unique_ptr<Pending>> pending;
+                    /** The job execution of each request waiting for its response, by client token **/
+                    std::map<std::string, std::string> inFlight;
+                    /**
+                     * Timers are not removed when they are superseded, but skipped once they expire, since only the
+                     * latest timer of each job execution is kept in Pending::timer
+                     */
+                    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+                    uint64_t lastTimer{0};
+
+                    /**
+                     * \brief Sets the timer of a job execution, superseding the one it had
+                     */
+                    void schedule(const std::string &jobId, Pending &update, Clock::time_point at);
+
+                    void run();
+
+                    /**
+                     * \brief Acts on an expired timer of a job execution: sends its update, retries it, or completes
+                     * it, adding the functions to call once the lock is released to actions
+                     */
+                    void advance(
+                        const std::string &jobId,
+                        Pending &update,
+                        std::vector<std::function<void()>> &actions);
+
+                    /**
+                     * \brief Removes the pending update of a job execution, adding its completion callbacks and those
+                     * of the updates it superseded to actions
+                     */
+                    void complete(const std::string &jobId, std::vector<std::function<void()>> &actions);
+
+                    static bool isStopRequested(const Pending &update);
+                };
+            } // namespace Jobs
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_STATUSUPDATEDISPATCHER_H
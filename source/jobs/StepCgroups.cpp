@@ -0,0 +1,330 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "StepCgroups.h"
+#include "../logging/LoggerFactory.h"
+#include "../util/StringUtils.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Jobs;
+using namespace Aws::Iot::DeviceClient::Logging;
+using namespace Aws::Iot::DeviceClient::Util;
+
+constexpr char StepCgroups::CGROUP_MOUNT_POINT[];
+constexpr char StepCgroups::CLIENT_GROUP[];
+constexpr char StepCgroups::STEP_GROUP_PREFIX[];
+constexpr char StepCgroups::HANDLER_GROUP_PREFIX[];
+constexpr int StepCgroups::DRAIN_TIMEOUT_MILLIS;
+
+namespace
+{
+    constexpr char TAG[] = "StepCgroups.cpp";
+    constexpr int DRAIN_POLL_INTERVAL_MILLIS = 10;
+
+    /**
+     * Writes a value to a cgroup interface file in a single write, as the kernel expects
+     *
+     * @return zero, or the errno of the failure
+     */
+    int writeControl(const string &path, const string &value)
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return errno;
+        }
+        int error = 0;
+        if (write(fd, value.c_str(), value.size()) < 0)
+        {
+            error = errno;
+        }
+        close(fd);
+        return error;
+    }
+
+    string readControl(const string &path)
+    {
+        ifstream file(path);
+        return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    }
+
+    /**
+     * The value of a key in a flat keyed cgroup file such as cpu.stat or cgroup.events
+     */
+    Aws::Crt::Optional<uint64_t> readKeyedValue(const string &path, const string &key)
+    {
+        istringstream contents(readControl(path));
+        string name;
+        uint64_t value;
+        while (contents >> name >> value)
+        {
+            if (name == key)
+            {
+                return value;
+            }
+        }
+        return Aws::Crt::Optional<uint64_t>();
+    }
+
+    /**
+     * The path of the cgroup of this process in the cgroup v2 hierarchy, which is empty if the process is not in one
+     */
+    string ownCgroup()
+    {
+        ifstream file("/proc/self/cgroup");
+        string line;
+        while (getline(file, line))
+        {
+            if (line.compare(0, 3, "0::") == 0)
+            {
+                return line.substr(3);
+            }
+        }
+        return "";
+    }
+} // namespace
+
+StepCgroups::StepCgroups(const Limits &limits, const Crt::Optional<string> &parent)
+    : limits(limits), configuredParent(parent)
+{
+}
+
+bool StepCgroups::init()
+{
+    if (configuredParent.has_value())
+    {
+        parentPath = configuredParent.value();
+    }
+    else
+    {
+        string own = ownCgroup();
+        const string clientSuffix = string("/") + CLIENT_GROUP;
+        if (own.size() > clientSuffix.size() &&
+            own.compare(own.size() - clientSuffix.size(), clientSuffix.size(), clientSuffix) == 0)
+        {
+            // The Device Client moved itself to its leaf group when the Jobs feature started before
+            own.erase(own.size() - clientSuffix.size());
+        }
+        parentPath = CGROUP_MOUNT_POINT + (own == "/" ? "" : own);
+    }
+
+    if (access((parentPath + "/cgroup.controllers").c_str(), F_OK) != 0)
+    {
+        LOGM_ERROR(
+            TAG,
+            "The cgroup %s for job steps is not part of a cgroup v2 hierarchy mounted at %s",
+            Sanitize(parentPath).c_str(),
+            CGROUP_MOUNT_POINT);
+        return false;
+    }
+
+    if (!configuredParent.has_value())
+    {
+        const string clientPath = parentPath + "/" + CLIENT_GROUP;
+        if (mkdir(clientPath.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            LOGM_ERROR(TAG, "Failed to create cgroup %s: %s", Sanitize(clientPath).c_str(), strerror(errno));
+            return false;
+        }
+        // Moves every thread of the Device Client
+        int error = writeControl(clientPath + "/cgroup.procs", to_string(getpid()));
+        if (error != 0)
+        {
+            LOGM_ERROR(
+                TAG,
+                "Failed to move the Device Client to cgroup %s: %s",
+                Sanitize(clientPath).c_str(),
+                strerror(error));
+            return false;
+        }
+    }
+
+    set<string> available;
+    istringstream availableControllers(readControl(parentPath + "/cgroup.controllers"));
+    string name;
+    while (availableControllers >> name)
+    {
+        available.insert(name);
+    }
+    string enable;
+    const pair<string, bool> controllers[] = {
+        {"cpu", limits.cpuMax.has_value()},
+        {"memory", limits.memoryMax.has_value()},
+        {"io", limits.ioWeight.has_value()}};
+    for (const auto &controller : controllers)
+    {
+        // The memory controller is enabled even without a limit, since it tracks the peak memory of a step
+        if (!controller.second && controller.first != "memory")
+        {
+            continue;
+        }
+        if (available.count(controller.first))
+        {
+            enable += (enable.empty() ? "+" : " +") + controller.first;
+        }
+        else if (controller.second)
+        {
+            LOGM_ERROR(
+                TAG,
+                "The %s controller its limit needs is not available in cgroup %s",
+                controller.first.c_str(),
+                Sanitize(parentPath).c_str());
+            return false;
+        }
+    }
+    if (!enable.empty())
+    {
+        int error = writeControl(parentPath + "/cgroup.subtree_control", enable);
+        if (error != 0)
+        {
+            LOGM_ERROR(
+                TAG,
+                "Failed to enable controllers %s for the children of cgroup %s: %s%s",
+                enable.c_str(),
+                Sanitize(parentPath).c_str(),
+                strerror(error),
+                error == EBUSY ? ", as processes other than the Device Client are in it" : "");
+            return false;
+        }
+    }
+
+    LOGM_INFO(TAG, "Job steps will run in groups of their own under cgroup %s", Sanitize(parentPath).c_str());
+    return true;
+}
+
+bool StepCgroups::createStep(Step &step, const char *prefix)
+{
+    step.path = parentPath + "/" + prefix + to_string(getpid()) + "-" + to_string(++stepCount);
+    if (mkdir(step.path.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        LOGM_ERROR(
+            TAG,
+            "Failed to create cgroup %s, the step will run without resource limits: %s",
+            Sanitize(step.path).c_str(),
+            strerror(errno));
+        step.path.clear();
+        return false;
+    }
+
+    const pair<const char *, Crt::Optional<string>> settings[] = {
+        {"cpu.max", limits.cpuMax},
+        {"memory.max", limits.memoryMax},
+        {"io.weight",
+         limits.ioWeight.has_value() ? Crt::Optional<string>(to_string(limits.ioWeight.value()))
+                                     : Crt::Optional<string>()}};
+    for (const auto &setting : settings)
+    {
+        if (!setting.second.has_value())
+        {
+            continue;
+        }
+        int error = writeControl(step.path + "/" + setting.first, setting.second.value());
+        if (error != 0)
+        {
+            LOGM_WARN(
+                TAG,
+                "Failed to set %s of cgroup %s to %s: %s",
+                setting.first,
+                Sanitize(step.path).c_str(),
+                Sanitize(setting.second.value()).c_str(),
+                strerror(error));
+        }
+    }
+
+    step.procsFd = open((step.path + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+    if (step.procsFd < 0)
+    {
+        LOGM_ERROR(
+            TAG,
+            "Failed to open cgroup %s, the step will run without resource limits: %s",
+            Sanitize(step.path).c_str(),
+            strerror(errno));
+        rmdir(step.path.c_str());
+        step.path.clear();
+        return false;
+    }
+    return true;
+}
+
+void StepCgroups::kill(const Step &step)
+{
+    if (step.path.empty() || writeControl(step.path + "/cgroup.kill", "1") == 0)
+    {
+        return;
+    }
+    // cgroup.kill is only available from Linux 5.14
+    istringstream pids(readControl(step.path + "/cgroup.procs"));
+    pid_t pid;
+    while (pids >> pid)
+    {
+        ::kill(pid, SIGKILL);
+    }
+}
+
+StepCgroups::Usage StepCgroups::removeStep(Step &step)
+{
+    Usage usage;
+    if (step.procsFd >= 0)
+    {
+        close(step.procsFd);
+        step.procsFd = -1;
+    }
+    if (step.path.empty())
+    {
+        return usage;
+    }
+
+    if (isPopulated(step.path))
+    {
+        LOGM_INFO(TAG, "Stopping the processes left running by the step in cgroup %s", Sanitize(step.path).c_str());
+        auto giveUpAt = chrono::steady_clock::now() + chrono::milliseconds(DRAIN_TIMEOUT_MILLIS);
+        do
+        {
+            kill(step);
+            this_thread::sleep_for(chrono::milliseconds(DRAIN_POLL_INTERVAL_MILLIS));
+        } while (isPopulated(step.path) && chrono::steady_clock::now() < giveUpAt);
+    }
+
+    usage = readUsage(step.path);
+    if (rmdir(step.path.c_str()) != 0)
+    {
+        LOGM_WARN(TAG, "Failed to remove cgroup %s: %s", Sanitize(step.path).c_str(), strerror(errno));
+    }
+    step.path.clear();
+    return usage;
+}
+
+StepCgroups::Usage StepCgroups::readUsage(const string &path)
+{
+    Usage usage;
+    Crt::Optional<uint64_t> cpuTime = readKeyedValue(path + "/cpu.stat", "usage_usec");
+    if (cpuTime.has_value())
+    {
+        usage.cpuTimeMicros = cpuTime.value();
+    }
+    string peak = readControl(path + "/memory.peak");
+    if (!peak.empty())
+    {
+        usage.peakMemoryBytes = strtoull(peak.c_str(), nullptr, 10);
+    }
+    return usage;
+}
+
+bool StepCgroups::isPopulated(const string &path)
+{
+    Crt::Optional<uint64_t> populated = readKeyedValue(path + "/cgroup.events", "populated");
+    return populated.has_value() && populated.value() != 0;
+}
@@ -0,0 +1,135 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_STEPCGROUPS_H
+#define AWS_IOT_DEVICE_CLIENT_STEPCGROUPS_H
+
+#include <aws/crt/Optional.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Jobs
+            {
+                /**
+                 * \brief Places the processes of job steps in cgroup v2 groups of their own, so that the CPU, memory
+                 * and I/O a step uses can be limited and measured
+                 *
+                 * A group is created for each step under a parent cgroup, which is the cgroup of the Device Client
+                 * unless another one is configured. Since a cgroup v2 group cannot enable controllers for its children
+                 * while it holds processes itself, the Device Client moves itself to a leaf group named CLIENT_GROUP
+                 * when the groups of steps are created in its own cgroup. Under systemd, this requires Delegate=yes in
+                 * the unit of the Device Client.
+                 */
+                class StepCgroups
+                {
+                  public:
+                    static constexpr char CGROUP_MOUNT_POINT[] = "/sys/fs/cgroup";
+                    static constexpr char CLIENT_GROUP[] = "device-client";
+                    static constexpr char STEP_GROUP_PREFIX[] = "job-step-";
+                    static constexpr char HANDLER_GROUP_PREFIX[] = "job-handler-";
+                    /**
+                     * \brief Time the processes a step leaves behind have to exit after they are killed, before the
+                     * group of the step is abandoned
+                     */
+                    static constexpr int DRAIN_TIMEOUT_MILLIS = 2000;
+
+                    struct Limits
+                    {
+                        /** Written to cpu.max, a quota and an optional period in microseconds **/
+                        Crt::Optional<std::string> cpuMax;
+                        /** Written to memory.max **/
+                        Crt::Optional<std::string> memoryMax;
+                        /** Written to io.weight **/
+                        Crt::Optional<int> ioWeight;
+                    };
+
+                    /**
+                     * \brief The resources the processes of a step used
+                     */
+                    struct Usage
+                    {
+                        uint64_t cpuTimeMicros{0};
+                        /** Not known on kernels older than 5.19, which do not track it **/
+                        Crt::Optional<uint64_t> peakMemoryBytes;
+                    };
+
+                    /**
+                     * \brief The group of a step that is running
+                     */
+                    struct Step
+                    {
+                        std::string path;
+                        /**
+                         * The cgroup.procs file of the group, which the child process of the step writes "0" to
+                         * between fork and exec to move itself into the group
+                         */
+                        int procsFd{-1};
+                    };
+
+                    /**
+                     * @param limits the limits of each step
+                     * @param parent the path of the cgroup the groups of steps are created in, or the cgroup of the
+                     * Device Client if not set
+                     */
+                    StepCgroups(const Limits &limits, const Crt::Optional<std::string> &parent);
+
+                    /**
+                     * \brief Enables the controllers the limits need for the groups of steps, moving the Device Client
+                     * to its own leaf group first if needed
+                     *
+                     * @return false if cgroup v2 is not available or the parent cgroup cannot be used
+                     */
+                    bool init();
+
+                    /**
+                     * \brief Creates the group of a step and applies the limits to it
+                     *
+                     * @param step set to the group that was created
+                     * @param prefix the prefix of the name of the group, HANDLER_GROUP_PREFIX for the group a resident
+                     * handler serves its steps from
+                     * @return false if the group could not be created, in which case the step runs without it
+                     */
+                    bool createStep(Step &step, const char *prefix = STEP_GROUP_PREFIX);
+
+                    /**
+                     * \brief Kills all processes in the group of a step, including those that left its process group
+                     */
+                    void kill(const Step &step);
+
+                    /**
+                     * \brief Kills any processes the step left running, then removes its group
+                     *
+                     * @return the resources used by the processes of the step
+                     */
+                    Usage removeStep(Step &step);
+
+                    /**
+                     * \brief The resources used so far by the processes of the group at the given path
+                     */
+                    static Usage readUsage(const std::string &path);
+
+                  private:
+                    Limits limits;
+                    Crt::Optional<std::string> configuredParent;
+                    std::string parentPath;
+                    std::atomic<unsigned> stepCount{0};
+
+                    /**
+                     * \brief Whether any process is left in the group at the given path
+                     */
+                    static bool isPopulated(const std::string &path);
+                };
+            } // namespace Jobs
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_STEPCGROUPS_H
@@ -10,6 +10,7 @@
 #include "util/EnvUtils.h"
 #include "util/LockFile.h"
 #include "util/Retry.h"
+#include "util/StartupTrace.h"
 
 #if !defined(EXCLUDE_DD)
 
@@ -60,9 +61,12 @@
 
 #endif
 
+#include <algorithm>
 #include <csignal>
+#include <map>
 #include <memory>
 #include <thread>
+#include <unistd.h>
 #include <vector>
 
 using namespace std;
@@ -100,6 +104,24 @@ shared_ptr<SharedCrtResourceManager> resourceManager;
 unique_ptr<LockFile> lockFile;
 bool attemptingShutdown{false};
 Config config;
+StartupTrace startupTrace;
+#if !defined(EXCLUDE_SHADOW) && !defined(EXCLUDE_CONFIG_SHADOW) && !defined(DISABLE_MQTT)
+/**
+ * Kept for the lifetime of the process, since a fast start reconciles it in the background with the connection open
+ */
+shared_ptr<ConfigShadow> configShadow;
+#endif
+
+/**
+ * Writes the startup trace to the configured trace file, if any
+ */
+void writeStartupTrace()
+{
+    if (config.config.startup.traceFile.has_value())
+    {
+        startupTrace.WriteChromeTrace(config.config.startup.traceFile.value());
+    }
+}
 
 /**
  * TODO: For future expandability of main
@@ -182,7 +204,9 @@ void attemptConnection()
 {
     try
     {
-        Retry::ExponentialRetryConfig retryConfig = {10 * 1000, 900 * 1000, -1, nullptr};
+        // Jitter the retries so that a fleet of devices losing its connection at once does not reconnect in waves
+        Retry::ExponentialRetryConfig retryConfig = {
+            10 * 1000, 900 * 1000, -1, nullptr, Retry::Jitter::DECORRELATED, Retry::seedFrom(*config.config.thingName)};
         auto publishLambda = []() -> bool {
             int connectionStatus = resourceManager.get()->establishConnection(config.config);
             if (SharedCrtResourceManager::ABORT == connectionStatus)
@@ -291,8 +315,205 @@ namespace Aws
     }     // namespace Iot
 } // namespace Aws
 
+/**
+ * Creates and initializes a feature from the running configuration
+ *
+ * @param name the name of the feature as defined by the Feature's getName() method
+ * @return nullptr if the feature is disabled or not compiled into the binary
+ */
+shared_ptr<Feature> createFeature(const string &name, const shared_ptr<ClientBaseNotifier> &listener)
+{
+#if !defined(EXCLUDE_JOBS) && !defined(DISABLE_MQTT)
+    if (name == JobsFeature::NAME && config.config.jobs.enabled)
+    {
+        auto jobs = make_shared<JobsFeature>();
+        jobs->init(
+            resourceManager->getConnection(),
+            listener,
+            config.config,
+            resourceManager->getPublishGateway(),
+            resourceManager->getClientBootstrap(EventLoopRole::DATA_PLANE));
+        return jobs;
+    }
+#endif
+#if !defined(EXCLUDE_ST)
+    if (name == SecureTunnelingFeature::NAME && config.config.tunneling.enabled)
+    {
+        auto tunneling = make_shared<SecureTunnelingFeature>();
+        tunneling->init(resourceManager, listener, config.config);
+        return tunneling;
+    }
+#endif
+#if !defined(EXCLUDE_DD) && !defined(DISABLE_MQTT)
+    if (name == DeviceDefenderFeature::NAME && config.config.deviceDefender.enabled)
+    {
+        auto deviceDefender = make_shared<DeviceDefenderFeature>();
+        deviceDefender->init(resourceManager, listener, config.config);
+        return deviceDefender;
+    }
+#endif
+#if !defined(EXCLUDE_SHADOW) && !defined(EXCLUDE_SAMPLE_SHADOW) && !defined(DISABLE_MQTT)
+    if (name == SampleShadowFeature::NAME && config.config.sampleShadow.enabled)
+    {
+        auto sampleShadow = make_shared<SampleShadowFeature>();
+        sampleShadow->init(resourceManager, listener, config.config);
+        return sampleShadow;
+    }
+#endif
+#if !defined(EXCLUDE_SAMPLES) && !defined(EXCLUDE_PUBSUB) && !defined(DISABLE_MQTT)
+    if (name == PubSubFeature::NAME && config.config.pubSub.enabled)
+    {
+        auto pubSub = make_shared<PubSubFeature>();
+        pubSub->init(resourceManager, listener, config.config);
+        return pubSub;
+    }
+#endif
+#if !defined(EXCLUDE_SENSOR_PUBLISH) && !defined(DISABLE_MQTT)
+    if (name == SensorPublishFeature::NAME && config.config.sensorPublish.enabled)
+    {
+        auto sensorPublish = make_shared<SensorPublishFeature>();
+        sensorPublish->init(resourceManager, listener, config.config);
+        return sensorPublish;
+    }
+#endif
+    return nullptr;
+}
+
+/**
+ * Maps the sections of the configuration that can be applied while running to the features they configure
+ */
+map<string, string> reloadableFeatures()
+{
+    map<string, string> sections;
+#if !defined(EXCLUDE_JOBS) && !defined(DISABLE_MQTT)
+    sections[PlainConfig::JSON_KEY_JOBS] = JobsFeature::NAME;
+#endif
+#if !defined(EXCLUDE_ST)
+    sections[PlainConfig::JSON_KEY_TUNNELING] = SecureTunnelingFeature::NAME;
+#endif
+#if !defined(EXCLUDE_DD) && !defined(DISABLE_MQTT)
+    sections[PlainConfig::JSON_KEY_DEVICE_DEFENDER] = DeviceDefenderFeature::NAME;
+#endif
+#if !defined(EXCLUDE_SHADOW) && !defined(EXCLUDE_SAMPLE_SHADOW) && !defined(DISABLE_MQTT)
+    sections[PlainConfig::JSON_KEY_SAMPLE_SHADOW] = SampleShadowFeature::NAME;
+#endif
+#if !defined(EXCLUDE_SAMPLES) && !defined(EXCLUDE_PUBSUB) && !defined(DISABLE_MQTT)
+    sections[PlainConfig::JSON_KEY_PUB_SUB] = PubSubFeature::NAME;
+#endif
+#if !defined(EXCLUDE_SENSOR_PUBLISH) && !defined(DISABLE_MQTT)
+    sections[PlainConfig::JSON_KEY_SENSOR_PUBLISH] = SensorPublishFeature::NAME;
+#endif
+    return sections;
+}
+
+/**
+ * Subscribes to changes of the config shadow made while running, which are applied by reloading the configuration
+ */
+void subscribeToConfigShadowDeltas()
+{
+#if !defined(EXCLUDE_SHADOW) && !defined(EXCLUDE_CONFIG_SHADOW) && !defined(DISABLE_MQTT)
+    if (configShadow != nullptr)
+    {
+        // Reloads run on the main thread, which waits for SIGHUP
+        configShadow->subscribeToConfigDeltas(
+            resourceManager, *config.config.thingName, []() { kill(getpid(), SIGHUP); });
+    }
+#endif
+}
+
+/**
+ * Re-reads the configuration and applies the changes to the running Device Client. Only the features whose
+ * configuration changed are restarted, and the MQTT connection is kept unless the connection settings changed.
+ */
+void reloadConfig(const CliArgs &cliArgs, const shared_ptr<ClientBaseNotifier> &listener)
+{
+    LOG_INFO(TAG, "Reloading configuration");
+    Config reloaded;
+    if (!reloaded.init(cliArgs))
+    {
+        LOG_ERROR(TAG, "The reloaded configuration is invalid, keeping the running configuration");
+        return;
+    }
+
+    PlainConfig running = config.config;
+    map<string, string> reloadable = reloadableFeatures();
+    vector<string> restart;
+    bool reconnect = !running.HasSameConnectionSettings(reloaded.config);
+#if !defined(DISABLE_MQTT)
+    if (reconnect)
+    {
+        LOG_INFO(TAG, "Connection settings have changed, reconnecting and restarting all features");
+        features->stopAll();
+        resourceManager->disconnect();
+        config.config = reloaded.config;
+        attemptConnection();
+        for (const auto &section : reloadable)
+        {
+            restart.push_back(section.second);
+        }
+    }
+#endif
+
+#if !defined(EXCLUDE_SHADOW) && !defined(EXCLUDE_CONFIG_SHADOW) && !defined(DISABLE_MQTT)
+    if (reloaded.config.configShadow.enabled)
+    {
+        // The requests of a config shadow can only be made once, so each reload reconciles with a new one
+        ConfigShadow reconciler;
+        reconciler.reconfigureWithConfigShadow(resourceManager, reloaded.config);
+    }
+#endif
+
+    vector<string> changed = running.ChangedSections(reloaded.config);
+    if (!reconnect && changed.empty())
+    {
+        LOG_INFO(TAG, "Configuration is unchanged");
+        return;
+    }
+
+    bool reconfigureLogging = false;
+    for (const auto &section : changed)
+    {
+        auto feature = reloadable.find(section);
+        if (feature != reloadable.end())
+        {
+            if (find(restart.begin(), restart.end(), feature->second) == restart.end())
+            {
+                restart.push_back(feature->second);
+            }
+        }
+        else if (section == PlainConfig::JSON_KEY_LOGGING)
+        {
+            reconfigureLogging = true;
+        }
+        else
+        {
+            LOGM_WARN(
+                TAG,
+                "The %s configuration has changed and will be applied the next time the Device Client starts",
+                section.c_str());
+        }
+    }
+
+    config.config = reloaded.config;
+    if (reconfigureLogging && !LoggerFactory::reconfigure(config.config))
+    {
+        LOG_ERROR(TAG, "Unable to apply the reloaded logging configuration");
+    }
+    for (const auto &name : restart)
+    {
+        LOGM_INFO(TAG, "Applying the reloaded configuration of %s", name.c_str());
+        features->replace(name, createFeature(name, listener));
+    }
+    if (reconnect)
+    {
+        subscribeToConfigShadowDeltas();
+    }
+    LOG_INFO(TAG, "Reloaded configuration");
+}
+
 int main(int argc, char *argv[])
 {
+    startupTrace.Begin("startup");
 
     if (Config::CheckTerminalArgs(argc, argv))
     {
@@ -303,6 +524,7 @@ int main(int argc, char *argv[])
     resourceManager = std::make_shared<SharedCrtResourceManager>();
     resourceManager->initializeAllocator();
 
+    startupTrace.Begin("load-config");
     CliArgs cliArgs;
     if (!Config::ParseCliArgs(argc, argv, cliArgs) || !config.init(cliArgs))
     {
@@ -312,6 +534,7 @@ int main(int argc, char *argv[])
             DC_FATAL_ERROR);
         deviceClientAbort("Invalid configuration", EXIT_FAILURE);
     }
+    startupTrace.End("load-config");
 
     if (!LoggerFactory::reconfigure(config.config) &&
         dynamic_cast<StdOutLogger *>(LoggerFactory::getLoggerInstance().get()) == nullptr)
@@ -354,19 +577,23 @@ int main(int argc, char *argv[])
     sigaddset(&sigset, SIGINT);
     sigaddset(&sigset, SIGHUP);
     sigaddset(&sigset, SIGTERM);
+    sigaddset(&sigset, SIGUSR1);
     sigprocmask(SIG_BLOCK, &sigset, nullptr);
 
     auto listener = std::make_shared<DefaultClientBaseNotifier>();
+    startupTrace.Begin("initialize-crt");
     if (!resourceManager.get()->initialize(config.config, features))
     {
         LOGM_ERROR(TAG, "*** %s: Failed to initialize AWS CRT SDK.", DC_FATAL_ERROR);
         deviceClientAbort("Failed to initialize AWS CRT SDK", EXIT_FAILURE);
     }
+    startupTrace.End("initialize-crt");
 
 #if !defined(EXCLUDE_FP) && !defined(DISABLE_MQTT)
     if (config.config.fleetProvisioning.enabled &&
         !config.config.fleetProvisioningRuntimeConfig.completedFleetProvisioning)
     {
+        startupTrace.Begin("fleet-provisioning");
         /*
          * Establish MQTT connection using claim certificates and private key to provision the device/thing.
          */
@@ -391,6 +618,7 @@ int main(int argc, char *argv[])
             deviceClientAbort("Fleet provisioning failed", EXIT_FAILURE);
         }
         resourceManager->disconnect();
+        startupTrace.End("fleet-provisioning");
     }
 #else
     if (config.config.fleetProvisioning.enabled)
@@ -411,7 +639,9 @@ int main(int argc, char *argv[])
      * Establish MQTT connection using permanent certificate and private key to start and run AWS IoT Device Client
      * features.
      */
+    startupTrace.Begin("connect");
     attemptConnection();
+    startupTrace.End("connect");
 #endif
 
 #if defined(EXCLUDE_SECURE_ELEMENT) && !defined(DISABLE_MQTT)
@@ -444,10 +674,35 @@ int main(int argc, char *argv[])
     if (config.config.configShadow.enabled)
     {
         LOG_INFO(TAG, "Config shadow is enabled");
-        ConfigShadow configShadow;
-        configShadow.reconfigureWithConfigShadow(resourceManager, config.config);
-        resourceManager->disconnect();
-        attemptConnection();
+        startupTrace.Begin("config-shadow");
+        configShadow = make_shared<ConfigShadow>();
+        if (config.config.startup.fastStart && configShadow->loadLastKnownGoodConfig(config.config))
+        {
+            LOG_INFO(
+                TAG,
+                "Starting features from the last known good configuration while the config shadow is reconciled");
+            // Compared against a copy, since a reload replaces config.config on the main thread meanwhile
+            const PlainConfig startedConfig = config.config;
+            PlainConfig reconciledConfig = startedConfig;
+            thread([startedConfig, reconciledConfig]() mutable {
+                configShadow->reconfigureWithConfigShadow(resourceManager, reconciledConfig);
+                startupTrace.End("config-shadow");
+                if (!configShadow->hasSameFeatureConfig(reconciledConfig, startedConfig))
+                {
+                    LOG_INFO(
+                        TAG, "The config shadow changed the configuration of running features, reloading them");
+                    kill(getpid(), SIGHUP);
+                }
+                writeStartupTrace();
+            }).detach();
+        }
+        else
+        {
+            configShadow->reconfigureWithConfigShadow(resourceManager, config.config);
+            resourceManager->disconnect();
+            attemptConnection();
+            startupTrace.End("config-shadow");
+        }
     }
     else
     {
@@ -464,14 +719,12 @@ int main(int argc, char *argv[])
     }
 #endif
 
+    startupTrace.Begin("initialize-features");
 #if !defined(EXCLUDE_JOBS) && !defined(DISABLE_MQTT)
     if (config.config.jobs.enabled)
     {
-        shared_ptr<JobsFeature> jobs;
         LOG_INFO(TAG, "Jobs is enabled");
-        jobs = make_shared<JobsFeature>();
-        jobs->init(resourceManager->getConnection(), listener, config.config);
-        features->add(jobs->getName(), jobs);
+        features->add(JobsFeature::NAME, createFeature(JobsFeature::NAME, listener));
     }
     else
     {
@@ -492,11 +745,8 @@ int main(int argc, char *argv[])
 #if !defined(EXCLUDE_ST)
     if (config.config.tunneling.enabled)
     {
-        shared_ptr<SecureTunnelingFeature> tunneling;
         LOG_INFO(TAG, "Secure Tunneling is enabled");
-        tunneling = make_shared<SecureTunnelingFeature>();
-        tunneling->init(resourceManager, listener, config.config);
-        features->add(tunneling->getName(), tunneling);
+        features->add(SecureTunnelingFeature::NAME, createFeature(SecureTunnelingFeature::NAME, listener));
     }
     else
     {
@@ -520,11 +770,8 @@ int main(int argc, char *argv[])
 #if !defined(EXCLUDE_DD) && !defined(DISABLE_MQTT)
     if (config.config.deviceDefender.enabled)
     {
-        shared_ptr<DeviceDefenderFeature> deviceDefender;
         LOG_INFO(TAG, "Device Defender is enabled");
-        deviceDefender = make_shared<DeviceDefenderFeature>();
-        deviceDefender->init(resourceManager, listener, config.config);
-        features->add(deviceDefender->getName(), deviceDefender);
+        features->add(DeviceDefenderFeature::NAME, createFeature(DeviceDefenderFeature::NAME, listener));
     }
     else
     {
@@ -547,11 +794,8 @@ int main(int argc, char *argv[])
 #if !defined(EXCLUDE_SHADOW) && !defined(EXCLUDE_SAMPLE_SHADOW) && !defined(DISABLE_MQTT)
     if (config.config.sampleShadow.enabled)
     {
-        shared_ptr<SampleShadowFeature> sampleShadow;
         LOG_INFO(TAG, "Sample shadow is enabled");
-        sampleShadow = make_shared<SampleShadowFeature>();
-        sampleShadow->init(resourceManager, listener, config.config);
-        features->add(sampleShadow->getName(), sampleShadow);
+        features->add(SampleShadowFeature::NAME, createFeature(SampleShadowFeature::NAME, listener));
     }
     else
     {
@@ -574,11 +818,8 @@ int main(int argc, char *argv[])
 #if !defined(EXCLUDE_SAMPLES) && !defined(EXCLUDE_PUBSUB) && !defined(DISABLE_MQTT)
     if (config.config.pubSub.enabled)
     {
-        shared_ptr<PubSubFeature> pubSub;
         LOG_INFO(TAG, "PubSub is enabled");
-        pubSub = make_shared<PubSubFeature>();
-        pubSub->init(resourceManager, listener, config.config);
-        features->add(pubSub->getName(), pubSub);
+        features->add(PubSubFeature::NAME, createFeature(PubSubFeature::NAME, listener));
     }
     else
     {
@@ -601,11 +842,8 @@ int main(int argc, char *argv[])
 #if !defined(EXCLUDE_SENSOR_PUBLISH) && !defined(DISABLE_MQTT)
     if (config.config.sensorPublish.enabled)
     {
-        shared_ptr<SensorPublishFeature> sensorPublish;
         LOG_INFO(TAG, "Sensor Publish is enabled");
-        sensorPublish = make_shared<SensorPublishFeature>();
-        sensorPublish->init(resourceManager, listener, config.config);
-        features->add(sensorPublish->getName(), sensorPublish);
+        features->add(SensorPublishFeature::NAME, createFeature(SensorPublishFeature::NAME, listener));
     }
     else
     {
@@ -625,7 +863,15 @@ int main(int argc, char *argv[])
     }
 #endif
 
+    startupTrace.End("initialize-features");
+
+    startupTrace.Begin("start-features");
     resourceManager->startDeviceClientFeatures();
+    subscribeToConfigShadowDeltas();
+    startupTrace.End("start-features");
+    startupTrace.End("startup");
+    startupTrace.LogSummary();
+    writeStartupTrace();
 
     // Now allow this thread to sleep until it's interrupted by a signal
     while (true)
@@ -641,6 +887,9 @@ int main(int argc, char *argv[])
                 shutdown();
                 break;
             case SIGHUP:
+                reloadConfig(cliArgs, listener);
+                break;
+            case SIGUSR1:
                 resourceManager->dumpMemTrace();
                 break;
             default:
@@ -4,6 +4,7 @@
 #include "PubSubFeature.h"
 #include "../../logging/LoggerFactory.h"
 #include "../../util/FileUtils.h"
+#include "../../util/FileWatcher.h"
 
 #include <aws/common/byte_buf.h>
 #include <aws/crt/Api.h>
@@ -14,8 +15,6 @@
 #include <unistd.h>
 #include <utility>
 
-#include <sys/inotify.h>
-
 using namespace std;
 using namespace Aws;
 using namespace Aws::Iot;
@@ -32,12 +31,6 @@ constexpr char PubSubFeature::DEFAULT_PUBLISH_FILE[];
 constexpr char PubSubFeature::DEFAULT_SUBSCRIBE_FILE[];
 
 constexpr size_t MAX_IOT_CORE_MQTT_MESSAGE_SIZE_BYTES = 128000;
-// Definitions for inode notify
-constexpr size_t MAX_EVENTS = 1000; /* Maximum number of events to process */
-constexpr size_t LEN_NAME = 16;     /* Assuming that the length of the filename won't exceed 16 bytes */
-constexpr size_t EVENT_SIZE = (sizeof(struct inotify_event)); /* size of one event */
-constexpr size_t EVENT_BUFSIZE =
-    (MAX_EVENTS * (EVENT_SIZE + LEN_NAME)); /* size of buffer used to store the data of events */
 
 const std::string PubSubFeature::DEFAULT_PUBLISH_PAYLOAD = R"({"Hello": "World!"})";
 const std::string PubSubFeature::PUBLISH_TRIGGER_PAYLOAD = "DC-Publish";
@@ -148,73 +141,6 @@ int PubSubFeature::init(
     return AWS_OP_SUCCESS;
 }
 
-void PubSubFeature::runFileMonitor()
-{
-    int len = 0;
-    int fd = 0;
-    int dir_wd = 0;
-    int file_wd = 0;
-    char buf[EVENT_BUFSIZE];
-    fd = inotify_init();
-
-    string fileDir = FileUtils::ExtractParentDirectory(pubFile.c_str());
-    string fileName = pubFile.substr(fileDir.length());
-
-    if (fd == -1)
-    {
-        LOGM_ERROR(TAG, "Encountered error %d while initializing the inode notify system return s%", fd);
-        return;
-    }
-
-    dir_wd = inotify_add_watch(fd, fileDir.c_str(), IN_CREATE);
-    if (dir_wd == -1)
-    {
-        LOGM_ERROR(TAG, "Encountered error %d while adding the watch for input file's parent directory", fd);
-        goto exit;
-    }
-
-    file_wd = inotify_add_watch(fd, pubFile.c_str(), IN_CLOSE_WRITE);
-    if (file_wd == -1)
-    {
-        LOGM_ERROR(TAG, "Encountered error %d while adding the watch for target file", fd);
-        goto exit;
-    }
-
-    while (!needStop.load())
-    {
-        len = read(fd, buf, EVENT_BUFSIZE);
-        if (len <= 0)
-        {
-            LOG_WARN(TAG, "Couldn't monitor any more target file modify events as it reaches max read buffer size");
-            break;
-        }
-
-        for (int i = 0; i < len;)
-        {
-            struct inotify_event *e = (struct inotify_event *)&buf[i];
-
-            if (e->mask & IN_CREATE && strcmp(e->name, fileName.c_str()) == 0 && !(e->mask & IN_ISDIR))
-            {
-                LOG_DEBUG(TAG, "New file is created with the same name of the target file.");
-                publishFileData();
-                file_wd = inotify_add_watch(fd, pubFile.c_str(), IN_CLOSE_WRITE);
-            }
-            else if (e->mask & IN_CLOSE_WRITE)
-            {
-                LOG_DEBUG(TAG, "The target file is modified, start updating the shadow");
-                publishFileData();
-            }
-
-            i += EVENT_SIZE + e->len;
-        }
-        this_thread::sleep_for(std::chrono::milliseconds(500));
-    }
-exit:
-    inotify_rm_watch(fd, file_wd);
-    inotify_rm_watch(fd, dir_wd);
-    close(fd);
-}
-
 int PubSubFeature::getPublishFileData(aws_byte_buf *buf) const
 {
     size_t publishFileSize = FileUtils::GetFileSize(pubFile);
@@ -249,12 +175,32 @@ void PubSubFeature::publishFileData()
         aws_byte_buf_clean_up_secure(&payload);
         return;
     }
-    auto onPublishComplete = [payload, this](const Mqtt::MqttConnection &, uint16_t, int errorCode) mutable {
-        LOGM_DEBUG(TAG, "PublishCompAck: PacketId:(%s), ErrorCode:%d", getName().c_str(), errorCode);
-        aws_byte_buf_clean_up_secure(&payload);
+    publishPayload(aws_byte_cursor_from_buf(&payload));
+    aws_byte_buf_clean_up_secure(&payload);
+}
+
+void PubSubFeature::publishFileContent(const std::string &content)
+{
+    if (content.empty())
+    {
+        LOG_ERROR(TAG, "Publish file contains no data... Skipping publish");
+        return;
+    }
+
+    publishPayload(aws_byte_cursor_from_array(content.data(), content.size()));
+}
+
+void PubSubFeature::publishPayload(const aws_byte_cursor &payload)
+{
+    // Captures nothing, the publish can complete after a config reload destroyed this feature
+    auto onPublishComplete = [](const Mqtt::MqttConnection &, uint16_t, int errorCode) {
+        LOGM_DEBUG(TAG, "PublishCompAck: PacketId:(%s), ErrorCode:%d", NAME, errorCode);
     };
-    resourceManager->getConnection()->Publish(
-        pubTopic.c_str(), AWS_MQTT_QOS_AT_LEAST_ONCE, false, payload, onPublishComplete);
+    if (!resourceManager->publish(
+            pubTopic, AWS_MQTT_QOS_AT_LEAST_ONCE, payload, PublishGateway::Priority::TELEMETRY, onPublishComplete))
+    {
+        LOGM_WARN(TAG, "Publish to %s was dropped by the publish gateway", pubTopic.c_str());
+    }
 }
 
 int PubSubFeature::start()
@@ -284,8 +230,15 @@ int PubSubFeature::start()
 
     if (publishOnChange)
     {
-        thread file_monitor_thread(&PubSubFeature::runFileMonitor, this);
-        file_monitor_thread.detach();
+        fileWatchId = FileWatcher::GetInstance().Watch(
+            pubFile,
+            FileWatcher::DEFAULT_DEBOUNCE,
+            MAX_IOT_CORE_MQTT_MESSAGE_SIZE_BYTES,
+            std::bind(&PubSubFeature::publishFileContent, this, std::placeholders::_1));
+        if (fileWatchId == -1)
+        {
+            LOGM_WARN(TAG, "Unable to monitor %s, changes to it won't be published", Sanitize(pubFile).c_str());
+        }
     }
 
     baseNotifier->onEvent(static_cast<Feature *>(this), ClientBaseEventNotification::FEATURE_STARTED);
@@ -294,7 +247,11 @@ int PubSubFeature::start()
 
 int PubSubFeature::stop()
 {
-    needStop.store(true);
+    if (fileWatchId != -1)
+    {
+        FileWatcher::GetInstance().Unwatch(fileWatchId);
+        fileWatchId = -1;
+    }
 
     auto onUnsubscribe = [](const MqttConnection &, uint16_t packetId, int errorCode) -> void {
         LOGM_DEBUG(TAG, "Unsubscribing: PacketId:%u, ErrorCode:%d", packetId, errorCode);
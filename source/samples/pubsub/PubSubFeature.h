@@ -74,10 +74,6 @@ namespace Aws
                      * attention
                      */
                     std::shared_ptr<ClientBaseNotifier> baseNotifier;
-                    /**
-                     * \brief Whether the DeviceClient base has requested this feature to stop.
-                     */
-                    std::atomic<bool> needStop{false};
                     /**
                      * \brief Topic for publishing data to
                      */
@@ -87,9 +83,13 @@ namespace Aws
                      */
                     std::string pubFile = DEFAULT_PUBLISH_FILE;
                     /**
-                     * \brief Whether or not to start the inotify thread to republish changes.
+                     * \brief Whether or not to watch the publish file to republish changes.
                      */
                     bool publishOnChange = false;
+                    /**
+                     * \brief Id of the watch on the publish file, or -1 if the publish file isn't watched
+                     */
+                    int fileWatchId = -1;
                     /**
                      * \brief Topic to subscribe to
                      */
@@ -117,11 +117,16 @@ namespace Aws
                      */
                     int getPublishFileData(aws_byte_buf *buf) const;
                     /**
-                     * \brief A file monitor to detect any changes related to the input file.
-                     * Once any data is modified in the publish-file, the client will publish
-                     * the data to the publish-topic.
+                     * \brief Called by the file watcher once the publish file has changed. Publishes the new content
+                     * of the publish file to the publish-topic.
+                     * @param content Content of the publish file
+                     */
+                    void publishFileContent(const std::string &content);
+                    /**
+                     * \brief Publish a payload to the configured topic through the publish gateway
+                     * @param payload Payload to publish, copied by the gateway
                      */
-                    void runFileMonitor();
+                    void publishPayload(const aws_byte_cursor &payload);
                 };
             } // namespace Samples
         }     // namespace DeviceClient
@@ -37,9 +37,11 @@ Sensor::Sensor(
     aws_allocator *allocator,
     shared_ptr<Crt::Mqtt::MqttConnection> connection,
     aws_event_loop *eventLoop,
-    shared_ptr<Socket> socket)
-    : mSettings(settings), mAllocator(allocator), mConnection(connection), mEventLoop(eventLoop), mSocket(socket),
-      mEomPattern(settings.eomDelimiter.value()), mHeartbeatTask(mState, mSettings, mConnection, mEventLoop)
+    shared_ptr<Socket> socket,
+    shared_ptr<Util::PublishGateway> publishGateway)
+    : mSettings(settings), mAllocator(allocator), mConnection(connection), mPublishGateway(publishGateway),
+      mEventLoop(eventLoop), mSocket(socket), mEomPattern(settings.eomDelimiter.value()),
+      mHeartbeatTask(mState, mSettings, mConnection, mEventLoop)
 {
     // Handle out of memory when allocating read buffer.
     AWS_ZERO_STRUCT(mReadBuf);
@@ -394,6 +396,43 @@ bool Sensor::needPublish(size_t &bufferSize, size_t &numBatches)
 
 void Sensor::publishOneMessage(const aws_byte_cursor *payload)
 {
+    if (mPublishGateway)
+    {
+        // The read buffer is reused as soon as this returns, so the gateway gets a copy of the batch
+        auto message = make_shared<string>(reinterpret_cast<const char *>(payload->ptr), payload->len);
+        shared_ptr<MqttConnection> connection = mConnection;
+        string topic = mSettings.mqttTopic.value();
+        string name = mSettings.name.value();
+        auto send = [connection, topic, name, message]() {
+            auto onPublishComplete = [name, message](MqttConnection &, uint16_t packetId, int errorCode) {
+                if (errorCode)
+                {
+                    LOGM_ERROR(
+                        TAG,
+                        "Error sensor name: %s func: %s msg: %s",
+                        name.c_str(),
+                        __func__,
+                        aws_error_str(errorCode));
+                }
+                else
+                {
+                    LOGM_DEBUG(TAG, "Publish complete sensor name: %s packetId: %d", name.c_str(), packetId);
+                }
+            };
+            connection->Publish(
+                topic.c_str(),
+                AWS_MQTT_QOS_AT_LEAST_ONCE,
+                false,
+                aws_byte_buf_from_array(message->data(), message->size()),
+                onPublishComplete);
+        };
+        if (!mPublishGateway->Submit(Util::PublishGateway::Priority::BULK, payload->len, send))
+        {
+            LOGM_WARN(TAG, "Publish gateway dropped %zu bytes sensor name: %s", payload->len, name.c_str());
+        }
+        return;
+    }
+
     aws_mqtt_client_connection_publish(
         mConnection->GetUnderlyingConnection(),
         &mTopic,
@@ -5,6 +5,7 @@
 #define DEVICE_CLIENT_SENSOR_H
 
 #include "../config/Config.h"
+#include "../util/PublishGateway.h"
 #include "HeartbeatTask.h"
 #include "SensorState.h"
 #include "Socket.h"
@@ -53,6 +54,11 @@ namespace Aws
                      */
                     std::shared_ptr<Crt::Mqtt::MqttConnection> mConnection;
 
+                    /**
+                     * \brief Rate limits the publishes of the sensor, or null to publish directly on the connection
+                     */
+                    std::shared_ptr<Util::PublishGateway> mPublishGateway;
+
                     /**
                      * \brief Reading and publishing are managed through the same event loop
                      *
@@ -166,13 +172,15 @@ namespace Aws
                      * \brief Constructor
                      *
                      * @param settings the settings for this sensor
+                     * @param publishGateway gateway sensor batches are published through, or null to publish directly
                      */
                     Sensor(
                         const PlainConfig::SensorPublish::SensorSettings &settings,
                         aws_allocator *allocator,
                         std::shared_ptr<Crt::Mqtt::MqttConnection> connection,
                         aws_event_loop *eventLoop,
-                        std::shared_ptr<Socket> socket);
+                        std::shared_ptr<Socket> socket,
+                        std::shared_ptr<Util::PublishGateway> publishGateway = nullptr);
 
                     virtual ~Sensor();
 
@@ -34,7 +34,7 @@ int SensorPublishFeature::init(
         {
             try
             {
-                auto *eventLoop = mResourceManager->getNextEventLoop();
+                auto *eventLoop = mResourceManager->getNextEventLoop(EventLoopRole::DATA_PLANE);
                 if (eventLoop)
                 {
                     mSensors.emplace_back(createSensor(
@@ -61,8 +61,13 @@ std::unique_ptr<Sensor> SensorPublishFeature::createSensor(
     std::shared_ptr<Crt::Mqtt::MqttConnection> connection,
     aws_event_loop *eventLoop) const
 {
-    return std::unique_ptr<Sensor>(
-        new Sensor(settings, allocator, connection, eventLoop, std::make_shared<AwsSocket>()));
+    return std::unique_ptr<Sensor>(new Sensor(
+        settings,
+        allocator,
+        connection,
+        eventLoop,
+        std::make_shared<AwsSocket>(),
+        mResourceManager->getPublishGateway()));
 }
 
 std::string SensorPublishFeature::getName()
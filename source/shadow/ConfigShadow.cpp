@@ -3,13 +3,21 @@
 #include "ConfigShadow.h"
 #include "../config/Config.h"
 #include "../logging/LoggerFactory.h"
+#include "../util/FileUtils.h"
+#include "../util/StringUtils.h"
 #include <aws/crt/UUID.h>
 #include <aws/iotshadow/ErrorResponse.h>
 #include <aws/iotshadow/GetNamedShadowRequest.h>
 #include <aws/iotshadow/GetNamedShadowSubscriptionRequest.h>
 #include <aws/iotshadow/GetShadowResponse.h>
+#include <aws/iotshadow/NamedShadowDeltaUpdatedSubscriptionRequest.h>
+#include <aws/iotshadow/ShadowDeltaUpdatedEvent.h>
 #include <aws/iotshadow/UpdateNamedShadowRequest.h>
 #include <aws/iotshadow/UpdateNamedShadowSubscriptionRequest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
 
 using namespace std;
 using namespace Aws;
@@ -131,6 +139,55 @@ void ConfigShadow::ackUpdateNamedShadowStatus(int ioError)
     shadowUpdateCompletedPromise.set_value(ioError == AWS_OP_SUCCESS);
 }
 
+void ConfigShadow::configDeltaHandler(Iotshadow::ShadowDeltaUpdatedEvent *event, int ioError)
+{
+    if (ioError)
+    {
+        LOGM_ERROR(TAG, "Encountered ioError %d within configDeltaHandler", ioError);
+        return;
+    }
+    if (!event->State.has_value())
+    {
+        return;
+    }
+
+    string delta = event->State->View().WriteCompact();
+    {
+        lock_guard<mutex> lock(configDeltaLock);
+        if (delta == lastConfigDelta)
+        {
+            LOG_DEBUG(TAG, "Ignoring config shadow delta that has already been received");
+            return;
+        }
+        lastConfigDelta = delta;
+    }
+    LOG_INFO(TAG, "Received a new delta of the config shadow");
+    onConfigDelta();
+}
+
+void ConfigShadow::subscribeToConfigDeltas(
+    std::shared_ptr<SharedCrtResourceManager> resourceManager,
+    const std::string &thingName,
+    std::function<void()> onDelta)
+{
+    onConfigDelta = std::move(onDelta);
+    deltaShadowClient = std::make_shared<IotShadowClient>(resourceManager->getConnection());
+
+    NamedShadowDeltaUpdatedSubscriptionRequest request;
+    request.ThingName = thingName.c_str();
+    request.ShadowName = DEFAULT_CONFIG_SHADOW_NAME;
+    deltaShadowClient->SubscribeToNamedShadowDeltaUpdatedEvents(
+        request,
+        AWS_MQTT_QOS_AT_LEAST_ONCE,
+        std::bind(&ConfigShadow::configDeltaHandler, this, std::placeholders::_1, std::placeholders::_2),
+        [](int ioError) {
+            if (ioError)
+            {
+                LOGM_ERROR(TAG, "Failed to subscribe to the deltas of the config shadow with code {%d}", ioError);
+            }
+        });
+}
+
 bool ConfigShadow::subscribeGetAndUpdateNamedShadowTopics(Iotshadow::IotShadowClient iotShadowClient)
 {
     GetNamedShadowSubscriptionRequest getNamedShadowSubscriptionRequest;
@@ -470,4 +527,74 @@ void ConfigShadow::reconfigureWithConfigShadow(
         // config shadow doesn't exists, store the device client configuration into config shadow
         updateShadowWithLocalConfig(iotShadowClient, config);
     }
+    storeLastKnownGoodConfig(config);
+}
+
+void ConfigShadow::storeLastKnownGoodConfig(PlainConfig &config) const
+{
+    JsonObject jsonObj;
+    loadFeatureConfigIntoJsonObject(config, jsonObj);
+
+    // Write to a temporary file first so that a crash never leaves a partial configuration behind
+    string expandedPath = FileUtils::ExtractExpandedPath(Config::DEFAULT_LAST_KNOWN_GOOD_CONFIG_FILE);
+    string temporaryPath = expandedPath + ".tmp";
+    {
+        ofstream file(temporaryPath);
+        if (!file.is_open())
+        {
+            LOGM_WARN(TAG, "Unable to open file: '%s'", Sanitize(temporaryPath).c_str());
+            return;
+        }
+        file << jsonObj.View().WriteCompact().c_str();
+        if (!file)
+        {
+            LOGM_WARN(TAG, "Unable to write file: '%s'", Sanitize(temporaryPath).c_str());
+            return;
+        }
+    }
+    chmod(temporaryPath.c_str(), S_IRUSR | S_IWUSR | S_IRGRP);
+    if (rename(temporaryPath.c_str(), expandedPath.c_str()) != 0)
+    {
+        LOGM_WARN(TAG, "Unable to store last known good configuration to: '%s'", Sanitize(expandedPath).c_str());
+        return;
+    }
+    LOGM_DEBUG(TAG, "Stored last known good configuration to: %s", Sanitize(expandedPath).c_str());
+}
+
+bool ConfigShadow::loadLastKnownGoodConfig(PlainConfig &config) const
+{
+    string expandedPath = FileUtils::ExtractExpandedPath(Config::DEFAULT_LAST_KNOWN_GOOD_CONFIG_FILE);
+    if (!FileUtils::FileExists(expandedPath))
+    {
+        LOG_INFO(TAG, "No last known good configuration has been stored yet");
+        return false;
+    }
+    if (!FileUtils::ValidateFilePermissions(expandedPath, Permissions::CONFIG_FILE, false))
+    {
+        return false;
+    }
+
+    ifstream file(expandedPath);
+    stringstream contents;
+    contents << file.rdbuf();
+    JsonObject jsonObj(contents.str().c_str());
+    if (!file || !jsonObj.WasParseSuccessful())
+    {
+        LOGM_ERROR(TAG, "Unable to read last known good configuration from: '%s'", Sanitize(expandedPath).c_str());
+        return false;
+    }
+
+    // Every feature in the stored configuration is reset, as if the whole of it was a delta
+    JsonView jsonView = jsonObj.View();
+    resetClientConfigWithJSON(config, jsonView, jsonView);
+    return true;
+}
+
+bool ConfigShadow::hasSameFeatureConfig(PlainConfig &first, PlainConfig &second) const
+{
+    JsonObject firstObj;
+    loadFeatureConfigIntoJsonObject(first, firstObj);
+    JsonObject secondObj;
+    loadFeatureConfigIntoJsonObject(second, secondObj);
+    return firstObj.View().WriteCompact() == secondObj.View().WriteCompact();
 }
@@ -12,6 +12,8 @@
 #include <aws/crt/JsonObject.h>
 #include <aws/crt/Optional.h>
 #include <aws/iotshadow/IotShadowClient.h>
+#include <functional>
+#include <mutex>
 
 namespace Aws
 {
@@ -45,6 +47,33 @@ namespace Aws
                         Crt::JsonView &deltaView,
                         Crt::JsonView &desiredView) const;
 
+                    /**
+                     * \brief Applies the feature configuration last reconciled with the config shadow, stored by a
+                     * previous run of the Device Client
+                     *
+                     * @param config device client local configuration
+                     * @return false if no configuration was stored or it could not be read
+                     */
+                    bool loadLastKnownGoodConfig(PlainConfig &config) const;
+
+                    /**
+                     * \brief Whether two configurations differ in the features managed by the config shadow
+                     */
+                    bool hasSameFeatureConfig(PlainConfig &first, PlainConfig &second) const;
+
+                    /**
+                     * \brief Subscribes to changes of the desired configuration in the config shadow made while the
+                     * Device Client is running
+                     *
+                     * @param resourceManager provides the MQTT connection to subscribe on
+                     * @param thingName the thing the config shadow belongs to
+                     * @param onDelta called on the CRT event loop for each delta that differs from the previous one
+                     */
+                    void subscribeToConfigDeltas(
+                        std::shared_ptr<SharedCrtResourceManager> resourceManager,
+                        const std::string &thingName,
+                        std::function<void()> onDelta);
+
                   private:
                     static constexpr char TAG[] = "ConfigShadow.cpp";
                     /**
@@ -63,6 +92,20 @@ namespace Aws
                      * \brief Allow us to store the desired information in the config shadow from cloud
                      */
                     Aws::Crt::Optional<Aws::Crt::JsonObject> desiredConfig;
+                    /**
+                     * \brief Client subscribed to the deltas of the config shadow while the Device Client is running
+                     */
+                    std::shared_ptr<Iotshadow::IotShadowClient> deltaShadowClient;
+                    /**
+                     * \brief Called for each new delta of the config shadow
+                     */
+                    std::function<void()> onConfigDelta;
+                    /**
+                     * \brief The last delta received, since the delta is published again whenever the shadow is
+                     * updated while the desired configuration still differs from the reported one
+                     */
+                    std::string lastConfigDelta;
+                    std::mutex configDeltaLock;
                     /**
                      * \brief The default value in seconds for which Device client will wait for promise variables to be
                      * initialized. These promise variables will be initialized in respective callback methods
@@ -108,6 +151,12 @@ namespace Aws
                      * cloud successfully
                      */
                     bool fetchRemoteConfigShadow(Iotshadow::IotShadowClient IotShadowClient);
+
+                    /**
+                     * \brief Stores the feature configuration reconciled with the config shadow so that the next run
+                     * can start from it
+                     */
+                    void storeLastKnownGoodConfig(PlainConfig &config) const;
                     /**
                      * A handler function called by the CRT SDK when our request to
                      * get a named shadow is accepted
@@ -178,6 +227,14 @@ namespace Aws
                      * and check CloudWatch for more insights on errors
                      */
                     void ackUpdateNamedShadowStatus(int ioError);
+                    /**
+                     * \brief Executed when the desired configuration in the config shadow differs from the reported
+                     * one after an update
+                     *
+                     * @param event the difference between the desired and reported configuration
+                     * @param ioError a non-zero error code indicates a problem
+                     */
+                    void configDeltaHandler(Iotshadow::ShadowDeltaUpdatedEvent *event, int ioError);
                     /**
                      * \brief Subscribes to pertinent named shadow GET and UPDATE topics
                      *
@@ -0,0 +1,469 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "LocalShadowServer.h"
+#include "../logging/LoggerFactory.h"
+#include "../util/StringUtils.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace Aws;
+using namespace Aws::Crt;
+using namespace Aws::Iot::DeviceClient::Shadow;
+using namespace Aws::Iot::DeviceClient::Util;
+using namespace Aws::Iot::DeviceClient::Logging;
+
+constexpr char LocalShadowServer::TAG[];
+constexpr std::chrono::milliseconds LocalShadowServer::DEFAULT_BATCH_INTERVAL;
+constexpr size_t LocalShadowServer::MAX_REQUEST_SIZE;
+constexpr int LocalShadowServer::SOCKET_PERMISSIONS;
+constexpr int LocalShadowServer::LISTEN_BACKLOG;
+
+constexpr char OP_GET[] = "get";
+constexpr char OP_WATCH[] = "watch";
+constexpr char OP_UPDATE[] = "update";
+constexpr char OP_CHANGED[] = "changed";
+
+/**
+ * \brief Turn a cached document into a message by adding the operation it answers
+ */
+static string ToMessage(const char *op, const string &document)
+{
+    // The cached document is a serialized object, so the operation can be spliced in after its opening brace
+    return string("{\"op\":\"") + op + "\"," + document.substr(1);
+}
+
+/**
+ * \brief Get a string field of a request, or an empty string if the field is missing or not a string
+ */
+static string GetStringField(const JsonView &view, const char *key)
+{
+    if (!view.ValueExists(key) || !view.GetJsonObject(key).IsString())
+    {
+        return "";
+    }
+    return view.GetString(key).c_str();
+}
+
+LocalShadowServer::LocalShadowServer(
+    std::shared_ptr<ShadowCache> cache,
+    const OnReportedUpdateFn &onReportedUpdate,
+    std::chrono::milliseconds batchInterval)
+    : cache(cache), onReportedUpdate(onReportedUpdate), batchInterval(batchInterval)
+{
+}
+
+LocalShadowServer::~LocalShadowServer()
+{
+    Stop();
+}
+
+bool LocalShadowServer::Start(const std::string &path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    if (path.length() + 1 > sizeof(addr.sun_path))
+    {
+        LOGM_ERROR(TAG, "Local shadow socket path %s is too long", Sanitize(path).c_str());
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listenFd == -1 || epollFd == -1 || wakeFd == -1)
+    {
+        LOGM_ERROR(TAG, "Failed to initialize the local shadow server: %s", strerror(errno));
+        closeDescriptors();
+        return false;
+    }
+
+    // Remove a socket left behind by a previous run
+    unlink(path.c_str());
+    if (::bind(listenFd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == -1 ||
+        chmod(path.c_str(), SOCKET_PERMISSIONS) == -1 || listen(listenFd, LISTEN_BACKLOG) == -1)
+    {
+        LOGM_ERROR(TAG, "Failed to listen on local shadow socket %s: %s", Sanitize(path).c_str(), strerror(errno));
+        closeDescriptors();
+        unlink(path.c_str());
+        return false;
+    }
+    socketPath = path;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    for (int fd : {listenFd, wakeFd})
+    {
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1)
+        {
+            LOGM_ERROR(TAG, "Failed to add descriptor to epoll: %s", strerror(errno));
+            closeDescriptors();
+            unlink(socketPath.c_str());
+            return false;
+        }
+    }
+
+    running.store(true);
+    serverThread = thread(&LocalShadowServer::run, this);
+    LOGM_INFO(TAG, "Serving local shadow cache on %s", Sanitize(socketPath).c_str());
+    return true;
+}
+
+void LocalShadowServer::Stop()
+{
+    if (running.exchange(false))
+    {
+        uint64_t value = 1;
+        if (write(wakeFd, &value, sizeof(value)) != sizeof(value))
+        {
+            LOGM_WARN(TAG, "Failed to wake up the local shadow server thread: %s", strerror(errno));
+        }
+    }
+    if (serverThread.joinable())
+    {
+        serverThread.join();
+    }
+
+    for (const auto &client : clients)
+    {
+        close(client.first);
+    }
+    clients.clear();
+    if (listenFd != -1)
+    {
+        unlink(socketPath.c_str());
+    }
+    closeDescriptors();
+}
+
+void LocalShadowServer::NotifyShadowChanged(const std::string &shadowName, const std::string &document)
+{
+    if (!running.load())
+    {
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(notificationLock);
+        notifications.emplace_back(shadowName, document);
+    }
+    uint64_t value = 1;
+    if (write(wakeFd, &value, sizeof(value)) != sizeof(value))
+    {
+        LOGM_WARN(TAG, "Failed to wake up the local shadow server thread: %s", strerror(errno));
+    }
+}
+
+void LocalShadowServer::run()
+{
+    constexpr int MAX_EPOLL_EVENTS = 16;
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+
+    while (running.load())
+    {
+        int count = epoll_wait(epollFd, events, MAX_EPOLL_EVENTS, getTimeoutMillis());
+        if (count == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            LOGM_ERROR(TAG, "Local shadow server stopped after epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == listenFd)
+            {
+                acceptClients();
+            }
+            else if (fd == wakeFd)
+            {
+                uint64_t value;
+                while (read(wakeFd, &value, sizeof(value)) > 0)
+                {
+                }
+                sendNotifications();
+            }
+            else
+            {
+                readClient(fd);
+            }
+        }
+
+        if (!pendingUpdates.empty() && chrono::steady_clock::now() >= batchDeadline)
+        {
+            flushUpdates();
+        }
+    }
+
+    // Don't lose updates that local clients were told are queued
+    flushUpdates();
+}
+
+int LocalShadowServer::getTimeoutMillis() const
+{
+    if (pendingUpdates.empty())
+    {
+        return -1;
+    }
+
+    auto remaining = chrono::duration_cast<chrono::milliseconds>(batchDeadline - chrono::steady_clock::now()).count();
+    // Round up so that we don't wake up just before the deadline and spin
+    return remaining < 0 ? 0 : static_cast<int>(remaining) + 1;
+}
+
+void LocalShadowServer::acceptClients()
+{
+    int fd;
+    while ((fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1)
+    {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1)
+        {
+            LOGM_ERROR(TAG, "Failed to add local shadow client to epoll: %s", strerror(errno));
+            close(fd);
+            continue;
+        }
+        clients[fd];
+        LOGM_DEBUG(TAG, "Local shadow client connected on descriptor %d", fd);
+    }
+
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        LOGM_ERROR(TAG, "Failed to accept local shadow client: %s", strerror(errno));
+    }
+}
+
+void LocalShadowServer::readClient(int fd)
+{
+    auto entry = clients.find(fd);
+    if (entry == clients.end())
+    {
+        return;
+    }
+    Client &client = entry->second;
+
+    char buf[4096];
+    ssize_t len;
+    while ((len = recv(fd, buf, sizeof(buf), 0)) > 0)
+    {
+        client.input.append(buf, static_cast<size_t>(len));
+    }
+    bool disconnected = len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+
+    size_t start = 0;
+    size_t end;
+    while ((end = client.input.find('\n', start)) != string::npos)
+    {
+        string line = client.input.substr(start, end - start);
+        start = end + 1;
+        if (!line.empty())
+        {
+            handleRequest(fd, client, line);
+            if (clients.find(fd) == clients.end())
+            {
+                return;
+            }
+        }
+    }
+    client.input.erase(0, start);
+
+    if (client.input.size() > MAX_REQUEST_SIZE)
+    {
+        LOGM_WARN(
+            TAG, "Disconnecting local shadow client %d after a request larger than %zu bytes", fd, MAX_REQUEST_SIZE);
+        disconnected = true;
+    }
+
+    if (disconnected)
+    {
+        closeClient(fd);
+    }
+}
+
+void LocalShadowServer::handleRequest(int fd, Client &client, const std::string &line)
+{
+    JsonObject request(line.c_str());
+    if (!request.WasParseSuccessful())
+    {
+        sendError(fd, "", "", "Invalid JSON request");
+        return;
+    }
+
+    JsonView view = request.View();
+    string op = GetStringField(view, "op");
+    string shadowName = GetStringField(view, "shadow");
+    if (!cache->IsTracked(shadowName))
+    {
+        sendError(fd, op, shadowName, "Unknown shadow");
+        return;
+    }
+
+    string document;
+    if (op == OP_GET)
+    {
+        if (!cache->Get(shadowName, document))
+        {
+            sendError(fd, op, shadowName, "Shadow document not received yet");
+            return;
+        }
+        sendMessage(fd, ToMessage(OP_GET, document));
+    }
+    else if (op == OP_WATCH)
+    {
+        client.watchedShadows.insert(shadowName);
+        if (cache->Get(shadowName, document))
+        {
+            sendMessage(fd, ToMessage(OP_WATCH, document));
+        }
+        else
+        {
+            JsonObject response;
+            response.WithString("op", op.c_str());
+            response.WithString("shadow", shadowName.c_str());
+            sendMessage(fd, response.View().WriteCompact().c_str());
+        }
+    }
+    else if (op == OP_UPDATE)
+    {
+        if (!view.ValueExists("state") || !view.GetJsonObject("state").ValueExists("reported") ||
+            !view.GetJsonObject("state").GetJsonObject("reported").IsObject())
+        {
+            sendError(fd, op, shadowName, "Update must contain a state.reported object");
+            return;
+        }
+
+        JsonView reported = view.GetJsonObject("state").GetJsonObject("reported");
+        auto pending = pendingUpdates.find(shadowName);
+        if (pending == pendingUpdates.end())
+        {
+            if (pendingUpdates.empty())
+            {
+                batchDeadline = chrono::steady_clock::now() + batchInterval;
+            }
+            pendingUpdates[shadowName] = reported.Materialize();
+        }
+        else
+        {
+            pending->second = ShadowCache::MergePatch(pending->second.View(), reported, true);
+        }
+
+        JsonObject response;
+        response.WithString("op", op.c_str());
+        response.WithString("shadow", shadowName.c_str());
+        response.WithBool("queued", true);
+        sendMessage(fd, response.View().WriteCompact().c_str());
+    }
+    else
+    {
+        sendError(fd, op, shadowName, "Unsupported operation");
+    }
+}
+
+void LocalShadowServer::sendNotifications()
+{
+    vector<pair<string, string>> pending;
+    {
+        lock_guard<mutex> lock(notificationLock);
+        pending.swap(notifications);
+    }
+
+    vector<int> slowClients;
+    for (const auto &notification : pending)
+    {
+        string message = ToMessage(OP_CHANGED, notification.second);
+        for (const auto &client : clients)
+        {
+            if (client.second.watchedShadows.count(notification.first) && !sendMessage(client.first, message))
+            {
+                slowClients.push_back(client.first);
+            }
+        }
+    }
+
+    for (int fd : slowClients)
+    {
+        closeClient(fd);
+    }
+}
+
+void LocalShadowServer::flushUpdates()
+{
+    map<string, JsonObject> updates;
+    updates.swap(pendingUpdates);
+    for (const auto &update : updates)
+    {
+        LOGM_DEBUG(TAG, "Publishing batched local update of %s shadow", update.first.c_str());
+        onReportedUpdate(update.first, update.second);
+    }
+}
+
+bool LocalShadowServer::sendMessage(int fd, const std::string &message)
+{
+    string line = message + "\n";
+    size_t sent = 0;
+    while (sent < line.size())
+    {
+        ssize_t len = send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+        if (len == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            LOGM_WARN(TAG, "Failed to send message to local shadow client %d: %s", fd, strerror(errno));
+            // A partially sent message can't be recovered from, so make the next read close the client
+            shutdown(fd, SHUT_RDWR);
+            return false;
+        }
+        sent += static_cast<size_t>(len);
+    }
+    return true;
+}
+
+void LocalShadowServer::sendError(int fd, const std::string &op, const std::string &shadowName, const char *error)
+{
+    JsonObject response;
+    response.WithString("op", op.c_str());
+    response.WithString("shadow", shadowName.c_str());
+    response.WithString("error", error);
+    sendMessage(fd, response.View().WriteCompact().c_str());
+}
+
+void LocalShadowServer::closeClient(int fd)
+{
+    LOGM_DEBUG(TAG, "Local shadow client on descriptor %d disconnected", fd);
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients.erase(fd);
+}
+
+void LocalShadowServer::closeDescriptors()
+{
+    for (int *fd : {&listenFd, &epollFd, &wakeFd})
+    {
+        if (*fd != -1)
+        {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
@@ -0,0 +1,142 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_LOCALSHADOWSERVER_H
+#define AWS_IOT_DEVICE_CLIENT_LOCALSHADOWSERVER_H
+
+#include "ShadowCache.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Shadow
+            {
+                /**
+                 * \brief Serves a ShadowCache to on-device applications over a Unix domain socket
+                 *
+                 * Clients send one JSON request per line and receive one JSON message per line:
+                 *  - {"op":"get","shadow":"<name>"} returns the cached document of the shadow
+                 *  - {"op":"watch","shadow":"<name>"} returns the cached document of the shadow, if any, and then a
+                 *    {"op":"changed",...} message every time the cached document changes
+                 *  - {"op":"update","shadow":"<name>","state":{"reported":{...}}} queues a reported state update.
+                 *    Updates received within the batch interval are merged and published to the cloud together.
+                 *
+                 * Failed requests are answered with {"op":"<op>","shadow":"<name>","error":"<message>"}. Clients that
+                 * don't read their messages fast enough are disconnected.
+                 */
+                class LocalShadowServer
+                {
+                  public:
+                    /**
+                     * \brief Called on the server thread with the merged reported state updates of a shadow
+                     */
+                    using OnReportedUpdateFn =
+                        std::function<void(const std::string &shadowName, const Crt::JsonObject &reported)>;
+
+                    static constexpr std::chrono::milliseconds DEFAULT_BATCH_INTERVAL{100};
+                    /**
+                     * \brief Maximum size of a single request. The shadow service limits the state of a shadow
+                     * document to 8 KB.
+                     */
+                    static constexpr size_t MAX_REQUEST_SIZE = 16 * 1024;
+
+                    LocalShadowServer(
+                        std::shared_ptr<ShadowCache> cache,
+                        const OnReportedUpdateFn &onReportedUpdate,
+                        std::chrono::milliseconds batchInterval = DEFAULT_BATCH_INTERVAL);
+                    ~LocalShadowServer();
+
+                    // Non-copyable.
+                    LocalShadowServer(const LocalShadowServer &) = delete;
+                    LocalShadowServer &operator=(const LocalShadowServer &) = delete;
+
+                    /**
+                     * \brief Start listening on the given socket path. An existing file at this path is removed.
+                     *
+                     * @param path the path of the Unix domain socket
+                     * @return true if the server is listening
+                     */
+                    bool Start(const std::string &path);
+
+                    /**
+                     * \brief Stop the server, publish updates that are still queued and remove the socket
+                     */
+                    void Stop();
+
+                    /**
+                     * \brief Send the new document of a shadow to the clients watching it. Safe to call from any
+                     * thread.
+                     */
+                    void NotifyShadowChanged(const std::string &shadowName, const std::string &document);
+
+                  private:
+                    static constexpr char TAG[] = "LocalShadowServer.cpp";
+                    static constexpr int SOCKET_PERMISSIONS = 0600;
+                    static constexpr int LISTEN_BACKLOG = 16;
+
+                    struct Client
+                    {
+                        std::string input;
+                        std::set<std::string> watchedShadows;
+                    };
+
+                    std::shared_ptr<ShadowCache> cache;
+                    OnReportedUpdateFn onReportedUpdate;
+                    std::chrono::milliseconds batchInterval;
+
+                    std::string socketPath;
+                    int listenFd{-1};
+                    int epollFd{-1};
+                    /**
+                     * \brief eventfd used to wake up the server thread for notifications and when it should stop
+                     */
+                    int wakeFd{-1};
+                    std::atomic<bool> running{false};
+                    std::thread serverThread;
+
+                    /**
+                     * \brief Connected clients keyed by socket. Only accessed from the server thread.
+                     */
+                    std::map<int, Client> clients;
+                    /**
+                     * \brief Reported state updates waiting for the end of the batch interval. Only accessed from
+                     * the server thread.
+                     */
+                    std::map<std::string, Crt::JsonObject> pendingUpdates;
+                    std::chrono::steady_clock::time_point batchDeadline;
+
+                    std::mutex notificationLock;
+                    std::vector<std::pair<std::string, std::string>> notifications;
+
+                    void run();
+                    int getTimeoutMillis() const;
+                    void acceptClients();
+                    void readClient(int fd);
+                    void handleRequest(int fd, Client &client, const std::string &line);
+                    void sendNotifications();
+                    void flushUpdates();
+                    bool sendMessage(int fd, const std::string &message);
+                    void sendError(int fd, const std::string &op, const std::string &shadowName, const char *error);
+                    void closeClient(int fd);
+                    void closeDescriptors();
+                };
+            } // namespace Shadow
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_LOCALSHADOWSERVER_H
@@ -3,10 +3,14 @@
 
 #include "SampleShadowFeature.h"
 #include "../logging/LoggerFactory.h"
+#include "../util/FileWatcher.h"
 #include <aws/common/byte_buf.h>
 #include <aws/crt/UUID.h>
 #include <aws/iotdevicecommon/IotDevice.h>
+#include <cctype>
 #include <chrono>
+#include <dirent.h>
+#include <future>
 #include <iostream>
 #include <string>
 #include <sys/stat.h>
@@ -25,12 +29,11 @@
 #include <aws/iotshadow/UpdateShadowRequest.h>
 #include <aws/iotshadow/UpdateShadowResponse.h>
 
-#include <sys/inotify.h>
-
 using namespace std;
 using namespace Aws;
 using namespace Aws::Iot;
 using namespace Aws::Crt;
+using namespace Aws::Crt::Mqtt;
 using namespace Aws::Iotshadow;
 using namespace Aws::Iot::DeviceClient::Shadow;
 using namespace Aws::Iot::DeviceClient::Util;
@@ -41,16 +44,26 @@ constexpr char SampleShadowFeature::NAME[];
 constexpr char SampleShadowFeature::DEFAULT_SAMPLE_SHADOW_DOCUMENT_FILE[];
 constexpr int SampleShadowFeature::DEFAULT_WAIT_TIME_SECONDS;
 
-constexpr int MAX_EVENTS = 1000;                  /* Maximum number of events to process*/
-constexpr int LEN_NAME = 16;                      /* Assuming that the length of the filename won't exceed 16 bytes*/
-#define EVENT_SIZE (sizeof(struct inotify_event)) /*size of one event*/
-#define EVENT_BUFSIZE (MAX_EVENTS * (EVENT_SIZE + LEN_NAME)) /*size of buffer used to store the data of events*/
+constexpr size_t SampleShadowFeature::MAX_SHADOW_DOCUMENT_SIZE_BYTES;
+constexpr size_t SampleShadowFeature::MAX_SHADOW_NAME_LENGTH;
+constexpr char SampleShadowFeature::SHADOW_DOCUMENT_FILE_EXTENSION[];
+constexpr char SampleShadowFeature::UPDATE_ACCEPTED_TOPIC_SUFFIX[];
+constexpr char SampleShadowFeature::UPDATE_REJECTED_TOPIC_SUFFIX[];
+constexpr char SampleShadowFeature::UPDATE_DOCUMENTS_TOPIC_SUFFIX[];
+constexpr char SampleShadowFeature::UPDATE_DELTA_TOPIC_SUFFIX[];
 
 string SampleShadowFeature::getName()
 {
     return NAME;
 }
 
+SampleShadowFeature::~SampleShadowFeature()
+{
+    // Waits for a completion callback that is running right now
+    std::lock_guard<std::mutex> lock(liveness->lock);
+    liveness->alive = false;
+}
+
 int SampleShadowFeature::init(
     shared_ptr<SharedCrtResourceManager> manager,
     shared_ptr<ClientBaseNotifier> notifier,
@@ -59,6 +72,27 @@ int SampleShadowFeature::init(
     resourceManager = manager;
     baseNotifier = notifier;
     thingName = *config.thingName;
+    namedShadowTopicPrefix = "$aws/things/" + thingName + "/shadow/name/";
+    if (config.sampleShadow.shadowLocalSocket.has_value())
+    {
+        localSocket = config.sampleShadow.shadowLocalSocket.value();
+    }
+
+    if (config.sampleShadow.shadowInputDirectory.has_value())
+    {
+        inputDirectory = config.sampleShadow.shadowInputDirectory.value();
+        outputDirectory = FileUtils::ExtractExpandedPath(DeviceClient::Config::DEFAULT_SAMPLE_SHADOW_OUTPUT_DIR);
+        if (config.sampleShadow.shadowOutputDirectory.has_value())
+        {
+            outputDirectory = config.sampleShadow.shadowOutputDirectory.value();
+        }
+        if (outputDirectory.back() != '/')
+        {
+            outputDirectory += '/';
+        }
+        return AWS_OP_SUCCESS;
+    }
+
     shadowName = config.sampleShadow.shadowName.value();
     if (config.sampleShadow.shadowInputFile.has_value())
     {
@@ -69,10 +103,20 @@ int SampleShadowFeature::init(
     {
         outputFile = config.sampleShadow.shadowOutputFile.value();
     }
+    registerShadow(shadowName, outputFile);
 
     return AWS_OP_SUCCESS;
 }
 
+void SampleShadowFeature::registerShadow(const std::string &targetShadowName, const std::string &shadowOutputFile)
+{
+    {
+        std::lock_guard<std::mutex> lock(trackedShadowsLock);
+        trackedShadows[targetShadowName].outputFile = shadowOutputFile;
+    }
+    shadowCache->AddShadow(targetShadowName);
+}
+
 void SampleShadowFeature::updateNamedShadowAcceptedHandler(Iotshadow::UpdateShadowResponse *response, int ioError) const
 {
     if (ioError)
@@ -81,7 +125,10 @@ void SampleShadowFeature::updateNamedShadowAcceptedHandler(Iotshadow::UpdateShad
     }
 }
 
-void SampleShadowFeature::updateNamedShadowRejectedHandler(Iotshadow::ErrorResponse *errorResponse, int ioError) const
+void SampleShadowFeature::updateNamedShadowRejectedHandler(
+    const std::string &targetShadowName,
+    Iotshadow::ErrorResponse *errorResponse,
+    int ioError)
 {
     if (ioError)
     {
@@ -89,14 +136,26 @@ void SampleShadowFeature::updateNamedShadowRejectedHandler(Iotshadow::ErrorRespo
         return;
     }
 
+    {
+        // The shadow no longer matches what we last published, so the next update must carry the whole document
+        std::lock_guard<std::mutex> lock(trackedShadowsLock);
+        trackedShadows[targetShadowName].hasReportedState = false;
+    }
+
     if (errorResponse->Message.has_value())
     {
-        LOGM_ERROR(TAG, "UpdateNamedShadowRequest gets rejected: %s", errorResponse->Message->c_str());
+        LOGM_ERROR(
+            TAG,
+            "UpdateNamedShadowRequest for %s shadow gets rejected: %s",
+            targetShadowName.c_str(),
+            errorResponse->Message->c_str());
     }
 }
 
-void SampleShadowFeature::updateNamedShadowEventHandler(Iotshadow::ShadowUpdatedEvent *shadowUpdatedEvent, int ioError)
-    const
+void SampleShadowFeature::updateNamedShadowEventHandler(
+    const std::string &targetShadowName,
+    Iotshadow::ShadowUpdatedEvent *shadowUpdatedEvent,
+    int ioError)
 {
     if (ioError)
     {
@@ -104,20 +163,37 @@ void SampleShadowFeature::updateNamedShadowEventHandler(Iotshadow::ShadowUpdated
         return;
     }
 
+    string shadowOutputFile;
+    {
+        std::lock_guard<std::mutex> lock(trackedShadowsLock);
+        shadowOutputFile = trackedShadows[targetShadowName].outputFile;
+    }
+
     // write the response to output file
     Crt::JsonObject object;
     shadowUpdatedEvent->SerializeToObject(object);
-    if (FileUtils::StoreValueInFile(object.View().WriteReadable(true).c_str(), outputFile))
+    if (FileUtils::StoreValueInFile(object.View().WriteReadable(true).c_str(), shadowOutputFile))
     {
-        LOGM_INFO(TAG, "Stored the latest %s shadow document to local successfully", shadowName.c_str());
+        LOGM_INFO(TAG, "Stored the latest %s shadow document to local successfully", targetShadowName.c_str());
     }
     else
     {
-        LOGM_ERROR(TAG, "Failed to store latest %s shadow document to local", shadowName.c_str());
+        LOGM_ERROR(TAG, "Failed to store latest %s shadow document to local", targetShadowName.c_str());
+    }
+
+    if (shadowUpdatedEvent->Current.has_value() && shadowUpdatedEvent->Current->State.has_value() &&
+        shadowUpdatedEvent->Current->Version.has_value())
+    {
+        shadowCache->Replace(
+            targetShadowName,
+            shadowUpdatedEvent->Current->State->Desired,
+            shadowUpdatedEvent->Current->State->Reported,
+            shadowUpdatedEvent->Current->Version.value());
     }
 }
 
 void SampleShadowFeature::updateNamedShadowDeltaHandler(
+    const std::string &targetShadowName,
     Iotshadow::ShadowDeltaUpdatedEvent *shadowDeltaUpdatedEvent,
     int ioError)
 {
@@ -127,25 +203,84 @@ void SampleShadowFeature::updateNamedShadowDeltaHandler(
         return;
     }
 
+    if (shadowDeltaUpdatedEvent->State.has_value() && shadowDeltaUpdatedEvent->Version.has_value())
+    {
+        shadowCache->ApplyDesiredDelta(
+            targetShadowName, shadowDeltaUpdatedEvent->State->View(), shadowDeltaUpdatedEvent->Version.value());
+    }
+
+    {
+        // The reported state no longer matches what was last published from the input file, so the next update from
+        // it must carry the whole document
+        std::lock_guard<std::mutex> lock(trackedShadowsLock);
+        trackedShadows[targetShadowName].hasReportedState = false;
+    }
+
     // do the shadow sync
     UpdateNamedShadowRequest updateNamedShadowRequest;
     updateNamedShadowRequest.ThingName = thingName.c_str();
-    updateNamedShadowRequest.ShadowName = shadowName.c_str();
+    updateNamedShadowRequest.ShadowName = targetShadowName.c_str();
     ShadowState state;
     state.Reported = shadowDeltaUpdatedEvent->State.value();
     updateNamedShadowRequest.State = state;
     Aws::Crt::UUID uuid;
     updateNamedShadowRequest.ClientToken = uuid.ToString();
 
-    shadowClient->PublishUpdateNamedShadow(
-        updateNamedShadowRequest,
-        AWS_MQTT_QOS_AT_LEAST_ONCE,
-        std::bind(&SampleShadowFeature::ackUpdateNamedShadowStatus, this, std::placeholders::_1));
+    // Runs on the event loop, which must not wait for the journal to be flushed
+    publishUpdateRequest(targetShadowName, updateNamedShadowRequest, false);
 }
 
-void SampleShadowFeature::ackUpdateNamedShadowStatus(int ioError) const
+void SampleShadowFeature::publishUpdateRequest(
+    const std::string &targetShadowName,
+    const UpdateNamedShadowRequest &updateNamedShadowRequest,
+    bool durable)
 {
-    LOGM_DEBUG(TAG, "Ack received for updateNamedShadowStatus with code {%d}", ioError);
+    // Publishes can complete after a config reload destroyed this feature
+    shared_ptr<Liveness> guard = liveness;
+    auto onComplete = [this, guard, targetShadowName](int errorCode) {
+        std::lock_guard<std::mutex> lock(guard->lock);
+        if (guard->alive)
+        {
+            ackUpdateNamedShadowStatus(targetShadowName, errorCode);
+        }
+    };
+    if (!resourceManager->getPublishGateway())
+    {
+        shadowClient->PublishUpdateNamedShadow(updateNamedShadowRequest, AWS_MQTT_QOS_AT_LEAST_ONCE, onComplete);
+        return;
+    }
+
+    // Published on the topic the shadow client would use, but through the resource manager so it can be journaled
+    JsonObject payload;
+    updateNamedShadowRequest.SerializeToObject(payload);
+    string document = payload.View().WriteCompact().c_str();
+    string topic = namedShadowTopicPrefix + targetShadowName + "/update";
+    auto onPublishComplete = [onComplete](MqttConnection &, uint16_t, int errorCode) { onComplete(errorCode); };
+    if (!resourceManager->publish(
+            topic,
+            AWS_MQTT_QOS_AT_LEAST_ONCE,
+            aws_byte_cursor_from_array(document.data(), document.size()),
+            PublishGateway::Priority::TELEMETRY,
+            onPublishComplete,
+            durable))
+    {
+        LOGM_WARN(TAG, "Update of %s shadow was dropped by the publish gateway", targetShadowName.c_str());
+        // The next update must carry the whole document
+        std::lock_guard<std::mutex> lock(trackedShadowsLock);
+        trackedShadows[targetShadowName].hasReportedState = false;
+    }
+}
+
+void SampleShadowFeature::ackUpdateNamedShadowStatus(const std::string &targetShadowName, int ioError)
+{
+    LOGM_DEBUG(
+        TAG, "Ack received for updateNamedShadowStatus of %s shadow with code {%d}", targetShadowName.c_str(), ioError);
+    if (ioError)
+    {
+        // The update may never have reached IoT Core, so the next update must carry the whole document
+        std::lock_guard<std::mutex> lock(trackedShadowsLock);
+        trackedShadows[targetShadowName].hasReportedState = false;
+    }
 }
 
 void SampleShadowFeature::ackSubscribeToUpdateNamedShadowAccepted(int ioError)
@@ -196,93 +331,6 @@ void SampleShadowFeature::ackSubscribeToUpdateDelta(int ioError)
     subscribeShadowUpdateDeltaPromise.set_value(ioError == AWS_OP_SUCCESS);
 }
 
-void SampleShadowFeature::runFileMonitor()
-{
-    ssize_t len = 0;
-    string fileDir = FileUtils::ExtractParentDirectory(inputFile.c_str());
-    string fileName = inputFile.substr(fileDir.length());
-    char buf[EVENT_BUFSIZE];
-
-    int fd = 0;
-    int dir_wd = 0;
-    int file_wd = 0;
-
-    fd = inotify_init();
-
-    if (fd == -1)
-    {
-        LOGM_ERROR(TAG, "Encounter error %d while initializing the inode notify system return s%", fd);
-        return;
-    }
-
-    dir_wd = inotify_add_watch(fd, fileDir.c_str(), IN_CREATE);
-    if (dir_wd == -1)
-    {
-        LOGM_ERROR(TAG, "Encounter error %d while adding the watch for input file's parent directory", fd);
-        goto exit;
-    }
-
-    file_wd = inotify_add_watch(fd, inputFile.c_str(), IN_CLOSE_WRITE);
-    if (file_wd == -1)
-    {
-        LOGM_ERROR(TAG, "Encounter error %d while adding the watch for target file", fd);
-        goto exit;
-    }
-
-    while (!needStop.load())
-    {
-        len = read(fd, buf, EVENT_BUFSIZE);
-        if (len <= 0)
-        {
-            LOG_WARN(TAG, "Couldn't monitor any more target file modify events as it reaches max read buffer size");
-            goto exit;
-        }
-
-        for (int i = 0; i < len;)
-        {
-            auto *e = (struct inotify_event *)&buf[i];
-
-            if (e->mask & IN_CREATE)
-            {
-                if (strcmp(e->name, fileName.c_str()) != 0)
-                    goto next;
-
-                if (e->mask & IN_ISDIR)
-                    goto next;
-
-                LOG_DEBUG(TAG, "New file is created with the same name of target file, start updating the shadow");
-                readAndUpdateShadowFromFile();
-                file_wd = inotify_add_watch(fd, inputFile.c_str(), IN_CLOSE_WRITE | IN_DELETE_SELF);
-            }
-
-            if (e->mask & IN_CLOSE_WRITE)
-            {
-                LOG_DEBUG(TAG, "The target file is modified, start updating the shadow");
-                readAndUpdateShadowFromFile();
-            }
-
-            if (e->mask & IN_DELETE_SELF)
-            {
-                if (e->mask & IN_ISDIR)
-                    goto next;
-
-                LOG_DEBUG(TAG, "The target file is deleted by itself, removing the watch");
-                inotify_rm_watch(fd, file_wd);
-            }
-
-        next:
-            i += EVENT_SIZE + e->len;
-        }
-
-        this_thread::sleep_for(std::chrono::milliseconds(500));
-    }
-
-exit:
-    inotify_rm_watch(fd, file_wd);
-    inotify_rm_watch(fd, dir_wd);
-    close(fd);
-}
-
 bool SampleShadowFeature::subscribeToPertinentShadowTopics()
 {
     UpdateNamedShadowSubscriptionRequest updateNamedShadowSubscriptionRequest;
@@ -300,7 +348,11 @@ bool SampleShadowFeature::subscribeToPertinentShadowTopics()
         updateNamedShadowSubscriptionRequest,
         AWS_MQTT_QOS_AT_LEAST_ONCE,
         std::bind(
-            &SampleShadowFeature::updateNamedShadowRejectedHandler, this, std::placeholders::_1, std::placeholders::_2),
+            &SampleShadowFeature::updateNamedShadowRejectedHandler,
+            this,
+            shadowName,
+            std::placeholders::_1,
+            std::placeholders::_2),
         std::bind(&SampleShadowFeature::ackSubscribeToUpdateNamedShadowRejected, this, std::placeholders::_1));
 
     NamedShadowUpdatedSubscriptionRequest namedShadowUpdatedSubscriptionRequest;
@@ -311,7 +363,11 @@ bool SampleShadowFeature::subscribeToPertinentShadowTopics()
         namedShadowUpdatedSubscriptionRequest,
         AWS_MQTT_QOS_AT_LEAST_ONCE,
         std::bind(
-            &SampleShadowFeature::updateNamedShadowEventHandler, this, std::placeholders::_1, std::placeholders::_2),
+            &SampleShadowFeature::updateNamedShadowEventHandler,
+            this,
+            shadowName,
+            std::placeholders::_1,
+            std::placeholders::_2),
         std::bind(&SampleShadowFeature::ackSubscribeToUpdateEvent, this, std::placeholders::_1));
 
     NamedShadowDeltaUpdatedSubscriptionRequest namedShadowDeltaUpdatedSubscriptionRequest;
@@ -322,7 +378,11 @@ bool SampleShadowFeature::subscribeToPertinentShadowTopics()
         namedShadowDeltaUpdatedSubscriptionRequest,
         AWS_MQTT_QOS_AT_LEAST_ONCE,
         std::bind(
-            &SampleShadowFeature::updateNamedShadowDeltaHandler, this, std::placeholders::_1, std::placeholders::_2),
+            &SampleShadowFeature::updateNamedShadowDeltaHandler,
+            this,
+            shadowName,
+            std::placeholders::_1,
+            std::placeholders::_2),
         std::bind(&SampleShadowFeature::ackSubscribeToUpdateDelta, this, std::placeholders::_1));
 
     // check if we have subscribed all update topic successfully before making the call
@@ -353,54 +413,390 @@ bool SampleShadowFeature::subscribeToPertinentShadowTopics()
     return true;
 }
 
-void SampleShadowFeature::readAndUpdateShadowFromFile()
+bool SampleShadowFeature::subscribeToWildcardShadowTopics()
 {
+    // update/accepted echoes every accepted document in full and nothing is done with it, so only the topics that
+    // carry information are subscribed to
+    vector<future<bool>> subAcks;
+    for (const char *suffix : {UPDATE_REJECTED_TOPIC_SUFFIX, UPDATE_DOCUMENTS_TOPIC_SUFFIX, UPDATE_DELTA_TOPIC_SUFFIX})
+    {
+        string topic = namedShadowTopicPrefix + "+" + suffix;
+        auto subAck = make_shared<promise<bool>>();
+        subAcks.push_back(subAck->get_future());
 
-    Crt::JsonObject jsonObj;
+        auto onSubAck = [this, subAck, topic](const MqttConnection &, uint16_t, const String &, QOS, int errorCode) {
+            LOGM_DEBUG(TAG, "Ack received for subscription to %s with code {%d}", topic.c_str(), errorCode);
+            if (errorCode)
+            {
+                string errorMessage = "Encountered an ioError while attempting to subscribe to " + topic;
+                LOG_ERROR(TAG, errorMessage.c_str());
+                baseNotifier->onError(this, ClientBaseErrorNotification::SUBSCRIPTION_FAILED, errorMessage);
+            }
+            subAck->set_value(errorCode == AWS_OP_SUCCESS);
+        };
+        auto onMessage = [this](const MqttConnection &, const String &messageTopic, const ByteBuf &payload) {
+            onWildcardShadowMessage(messageTopic.c_str(), payload);
+        };
+        resourceManager->getConnection()->Subscribe(topic.c_str(), AWS_MQTT_QOS_AT_LEAST_ONCE, onMessage, onSubAck);
+    }
 
-    if (inputFile.empty())
+    for (auto &subAck : subAcks)
     {
-        jsonObj.WithString("welcome", "aws-iot");
+        if (subAck.wait_for(std::chrono::seconds(DEFAULT_WAIT_TIME_SECONDS)) == future_status::timeout)
+        {
+            LOG_ERROR(TAG, "Subscribing to wildcard shadowUpdate topics timed out");
+            return false;
+        }
+        if (!subAck.get())
+        {
+            return false;
+        }
     }
-    else
+
+    return true;
+}
+
+void SampleShadowFeature::unsubscribeFromPertinentShadowTopics()
+{
+    vector<string> topics;
+    for (const char *suffix : {UPDATE_ACCEPTED_TOPIC_SUFFIX,
+                               UPDATE_REJECTED_TOPIC_SUFFIX,
+                               UPDATE_DOCUMENTS_TOPIC_SUFFIX,
+                               UPDATE_DELTA_TOPIC_SUFFIX})
     {
-        string expandedPath = inputFile;
+        topics.push_back(namedShadowTopicPrefix + shadowName + suffix);
+    }
+    unsubscribe(topics);
+}
 
-        ifstream setting(expandedPath.c_str());
-        if (!setting.is_open())
+void SampleShadowFeature::unsubscribeFromWildcardShadowTopics()
+{
+    vector<string> topics;
+    for (const char *suffix : {UPDATE_REJECTED_TOPIC_SUFFIX, UPDATE_DOCUMENTS_TOPIC_SUFFIX, UPDATE_DELTA_TOPIC_SUFFIX})
+    {
+        topics.push_back(namedShadowTopicPrefix + "+" + suffix);
+    }
+    unsubscribe(topics);
+}
+
+void SampleShadowFeature::unsubscribe(const vector<string> &topics)
+{
+    shared_ptr<MqttConnection> connection = resourceManager->getConnection();
+    if (!connection)
+    {
+        return;
+    }
+
+    vector<future<void>> acks;
+    for (const string &topic : topics)
+    {
+        // Not tied to this feature, the ack can arrive after the wait below timed out
+        auto unsubscribed = make_shared<promise<void>>();
+        acks.push_back(unsubscribed->get_future());
+        auto onUnsubscribe = [unsubscribed](const MqttConnection &, uint16_t packetId, int errorCode) -> void {
+            LOGM_DEBUG(TAG, "Unsubscribing: PacketId:%u, ErrorCode:%d", packetId, errorCode);
+            unsubscribed->set_value();
+        };
+        if (!connection->Unsubscribe(topic.c_str(), onUnsubscribe))
         {
-            LOGM_ERROR(TAG, "Unable to open file: '%s'", Sanitize(expandedPath).c_str());
+            LOGM_WARN(TAG, "Failed to unsubscribe from %s", topic.c_str());
+            acks.pop_back();
+        }
+    }
+
+    // Handlers bound to this feature may run until the unsubscribe was acknowledged
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(DEFAULT_WAIT_TIME_SECONDS);
+    for (future<void> &ack : acks)
+    {
+        if (ack.wait_until(deadline) == future_status::timeout)
+        {
+            LOGM_WARN(TAG, "Timed out waiting for an unsubscribe from the shadow topics to be acknowledged");
             return;
         }
+    }
+}
 
-        std::string contents((std::istreambuf_iterator<char>(setting)), std::istreambuf_iterator<char>());
-        jsonObj = Aws::Crt::JsonObject(contents.c_str());
-        if (!jsonObj.WasParseSuccessful())
+void SampleShadowFeature::onWildcardShadowMessage(const std::string &topic, const Crt::ByteBuf &payload)
+{
+    size_t nameEnd = topic.find('/', namedShadowTopicPrefix.size());
+    if (topic.compare(0, namedShadowTopicPrefix.size(), namedShadowTopicPrefix) != 0 || nameEnd == string::npos)
+    {
+        LOGM_WARN(TAG, "Ignoring message received on unexpected topic %s", Sanitize(topic).c_str());
+        return;
+    }
+
+    string targetShadowName = topic.substr(namedShadowTopicPrefix.size(), nameEnd - namedShadowTopicPrefix.size());
+    {
+        std::lock_guard<std::mutex> lock(trackedShadowsLock);
+        if (trackedShadows.find(targetShadowName) == trackedShadows.end())
+        {
+            // Another application of the device owns this shadow
+            return;
+        }
+    }
+
+    Crt::JsonObject json(String(reinterpret_cast<const char *>(payload.buffer), payload.len));
+    if (!json.WasParseSuccessful())
+    {
+        LOGM_ERROR(
+            TAG,
+            "Couldn't parse message of %s shadow. GetErrorMessage returns: %s",
+            targetShadowName.c_str(),
+            json.GetErrorMessage().c_str());
+        return;
+    }
+
+    string suffix = topic.substr(nameEnd);
+    if (suffix == UPDATE_REJECTED_TOPIC_SUFFIX)
+    {
+        ErrorResponse errorResponse(json.View());
+        updateNamedShadowRejectedHandler(targetShadowName, &errorResponse, AWS_OP_SUCCESS);
+    }
+    else if (suffix == UPDATE_DOCUMENTS_TOPIC_SUFFIX)
+    {
+        ShadowUpdatedEvent shadowUpdatedEvent(json.View());
+        updateNamedShadowEventHandler(targetShadowName, &shadowUpdatedEvent, AWS_OP_SUCCESS);
+    }
+    else if (suffix == UPDATE_DELTA_TOPIC_SUFFIX)
+    {
+        ShadowDeltaUpdatedEvent shadowDeltaUpdatedEvent(json.View());
+        updateNamedShadowDeltaHandler(targetShadowName, &shadowDeltaUpdatedEvent, AWS_OP_SUCCESS);
+    }
+}
+
+bool SampleShadowFeature::shadowNameFromFileName(const std::string &fileName, std::string &name)
+{
+    const string extension = SHADOW_DOCUMENT_FILE_EXTENSION;
+    if (fileName.size() <= extension.size() ||
+        fileName.compare(fileName.size() - extension.size(), extension.size(), extension) != 0)
+    {
+        return false;
+    }
+
+    string stem = fileName.substr(0, fileName.size() - extension.size());
+    if (stem.size() > MAX_SHADOW_NAME_LENGTH)
+    {
+        return false;
+    }
+    for (char c : stem)
+    {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != ':' && c != '_' && c != '-')
+        {
+            return false;
+        }
+    }
+
+    name = stem;
+    return true;
+}
+
+void SampleShadowFeature::loadInputDirectory()
+{
+    DIR *dir = opendir(inputDirectory.c_str());
+    if (dir == nullptr)
+    {
+        LOGM_ERROR(TAG, "Unable to open shadow input directory: '%s'", Sanitize(inputDirectory).c_str());
+        return;
+    }
+
+    vector<string> fileNames;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        string name;
+        if (entry->d_type == DT_REG && shadowNameFromFileName(entry->d_name, name))
+        {
+            fileNames.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+
+    for (const auto &fileName : fileNames)
+    {
+        string path = inputDirectory + "/" + fileName;
+        size_t fileSize = FileUtils::GetFileSize(path);
+        if (fileSize > MAX_SHADOW_DOCUMENT_SIZE_BYTES)
         {
             LOGM_ERROR(
                 TAG,
-                "Couldn't parse JSON shadow data file. GetErrorMessage returns: %s",
-                jsonObj.GetErrorMessage().c_str());
-            return;
+                "Refusing to publish %s, file size %zu bytes is greater than allowable limit of %zu bytes",
+                Sanitize(path).c_str(),
+                fileSize,
+                MAX_SHADOW_DOCUMENT_SIZE_BYTES);
+            continue;
         }
-        setting.close();
+
+        ifstream setting(path.c_str());
+        if (!setting.is_open())
+        {
+            LOGM_ERROR(TAG, "Unable to open file: '%s'", Sanitize(path).c_str());
+            continue;
+        }
+        std::string contents((std::istreambuf_iterator<char>(setting)), std::istreambuf_iterator<char>());
+        onInputDirectoryChanged(fileName, contents);
+    }
+}
+
+void SampleShadowFeature::onInputDirectoryChanged(const std::string &fileName, const std::string &contents)
+{
+    string targetShadowName;
+    if (!shadowNameFromFileName(fileName, targetShadowName))
+    {
+        LOGM_DEBUG(TAG, "Ignoring %s, it is not named after a shadow", Sanitize(fileName).c_str());
+        return;
+    }
+
+    bool isTracked;
+    {
+        std::lock_guard<std::mutex> lock(trackedShadowsLock);
+        isTracked = trackedShadows.find(targetShadowName) != trackedShadows.end();
+    }
+    if (!isTracked)
+    {
+        registerShadow(targetShadowName, outputDirectory + targetShadowName + SHADOW_DOCUMENT_FILE_EXTENSION);
+    }
+    updateShadowFromContent(targetShadowName, contents);
+}
+
+void SampleShadowFeature::readAndUpdateShadowFromFile()
+{
+    if (inputFile.empty())
+    {
+        Crt::JsonObject jsonObj;
+        jsonObj.WithString("welcome", "aws-iot");
+        updateShadow(shadowName, jsonObj);
+        return;
+    }
+
+    string expandedPath = inputFile;
+
+    ifstream setting(expandedPath.c_str());
+    if (!setting.is_open())
+    {
+        LOGM_ERROR(TAG, "Unable to open file: '%s'", Sanitize(expandedPath).c_str());
+        return;
+    }
+
+    std::string contents((std::istreambuf_iterator<char>(setting)), std::istreambuf_iterator<char>());
+    setting.close();
+    updateShadowFromContent(shadowName, contents);
+}
+
+void SampleShadowFeature::updateShadowFromContent(const std::string &targetShadowName, const std::string &contents)
+{
+    Crt::JsonObject jsonObj(contents.c_str());
+    if (!jsonObj.WasParseSuccessful())
+    {
+        LOGM_ERROR(
+            TAG,
+            "Couldn't parse JSON shadow data file of %s shadow. GetErrorMessage returns: %s",
+            targetShadowName.c_str(),
+            jsonObj.GetErrorMessage().c_str());
+        return;
+    }
+    updateShadow(targetShadowName, jsonObj);
+}
+
+void SampleShadowFeature::updateShadow(const std::string &targetShadowName, const Crt::JsonObject &jsonObj)
+{
+
+    ShadowState state;
+    {
+        std::lock_guard<std::mutex> lock(trackedShadowsLock);
+        TrackedShadow &shadow = trackedShadows[targetShadowName];
+        if (shadow.hasReportedState)
+        {
+            Crt::JsonObject delta;
+            if (!computeReportedStateDelta(shadow.lastReportedState.View(), jsonObj.View(), delta))
+            {
+                LOGM_DEBUG(TAG, "Reported state of %s shadow is unchanged, skipping update", targetShadowName.c_str());
+                return;
+            }
+            state.Reported = delta;
+        }
+        else
+        {
+            state.Reported = jsonObj;
+        }
+
+        // Assume the update will be accepted. If it is rejected the cached state is discarded and the next update
+        // publishes the whole document again.
+        shadow.lastReportedState = jsonObj;
+        shadow.hasReportedState = true;
     }
 
     UpdateNamedShadowRequest updateNamedShadowRequest;
     updateNamedShadowRequest.ThingName = thingName.c_str();
-    updateNamedShadowRequest.ShadowName = shadowName.c_str();
+    updateNamedShadowRequest.ShadowName = targetShadowName.c_str();
+    updateNamedShadowRequest.State = state;
 
+    Aws::Crt::UUID uuid;
+    updateNamedShadowRequest.ClientToken = uuid.ToString();
+
+    publishUpdateRequest(targetShadowName, updateNamedShadowRequest, true);
+}
+
+void SampleShadowFeature::publishLocalUpdate(const std::string &targetShadowName, const Crt::JsonObject &reported)
+{
+    {
+        // As for a delta, the next update from the input file must carry the whole document
+        std::lock_guard<std::mutex> lock(trackedShadowsLock);
+        trackedShadows[targetShadowName].hasReportedState = false;
+    }
+
+    UpdateNamedShadowRequest updateNamedShadowRequest;
+    updateNamedShadowRequest.ThingName = thingName.c_str();
+    updateNamedShadowRequest.ShadowName = targetShadowName.c_str();
     ShadowState state;
-    state.Reported = jsonObj;
+    state.Reported = reported;
     updateNamedShadowRequest.State = state;
-
     Aws::Crt::UUID uuid;
     updateNamedShadowRequest.ClientToken = uuid.ToString();
 
-    shadowClient->PublishUpdateNamedShadow(
-        updateNamedShadowRequest,
-        AWS_MQTT_QOS_AT_LEAST_ONCE,
-        std::bind(&SampleShadowFeature::ackUpdateNamedShadowStatus, this, std::placeholders::_1));
+    publishUpdateRequest(targetShadowName, updateNamedShadowRequest, true);
+}
+
+bool SampleShadowFeature::computeReportedStateDelta(
+    const Crt::JsonView &previous,
+    const Crt::JsonView &current,
+    Crt::JsonObject &delta)
+{
+    bool changed = false;
+    auto previousValues = previous.GetAllObjects();
+    auto currentValues = current.GetAllObjects();
+
+    for (const auto &entry : currentValues)
+    {
+        auto previousEntry = previousValues.find(entry.first);
+        if (previousEntry != previousValues.end() && previousEntry->second.IsObject() && entry.second.IsObject())
+        {
+            Crt::JsonObject nestedDelta;
+            if (computeReportedStateDelta(previousEntry->second, entry.second, nestedDelta))
+            {
+                delta.WithObject(entry.first, nestedDelta);
+                changed = true;
+            }
+        }
+        else if (
+            previousEntry == previousValues.end() ||
+            previousEntry->second.WriteCompact(false) != entry.second.WriteCompact(false))
+        {
+            delta.WithObject(entry.first, entry.second.Materialize());
+            changed = true;
+        }
+    }
+
+    for (const auto &entry : previousValues)
+    {
+        if (currentValues.find(entry.first) == currentValues.end())
+        {
+            // A null value removes the key from the shadow document
+            delta.WithObject(entry.first, Crt::JsonObject("null"));
+            changed = true;
+        }
+    }
+
+    return changed;
 }
 
 int SampleShadowFeature::start()
@@ -409,18 +805,79 @@ int SampleShadowFeature::start()
 
     shadowClient = unique_ptr<IotShadowClient>(new IotShadowClient(resourceManager.get()->getConnection()));
 
-    if (!subscribeToPertinentShadowTopics())
+    if (!inputDirectory.empty())
+    {
+        if (!subscribeToWildcardShadowTopics())
+        {
+            LOG_ERROR(TAG, "Failed to subscribe to wildcard shadow topics");
+            this->stop();
+        }
+
+        // Watched before the initial load so no change made in between is missed. A file changed meanwhile
+        // is published twice, which only repeats the same update.
+        fileWatchId = FileWatcher::GetInstance().WatchDirectory(
+            inputDirectory,
+            FileWatcher::DEFAULT_DEBOUNCE,
+            MAX_SHADOW_DOCUMENT_SIZE_BYTES,
+            std::bind(
+                &SampleShadowFeature::onInputDirectoryChanged, this, std::placeholders::_1, std::placeholders::_2));
+        if (fileWatchId == -1)
+        {
+            LOGM_WARN(
+                TAG,
+                "Unable to monitor %s, changes to it won't update shadows",
+                Sanitize(inputDirectory).c_str());
+        }
+
+        loadInputDirectory();
+    }
+    else
     {
-        LOGM_ERROR(TAG, "Failed to subscribe to related %s shadow topics", shadowName.c_str());
-        this->stop();
+        if (!subscribeToPertinentShadowTopics())
+        {
+            LOGM_ERROR(TAG, "Failed to subscribe to related %s shadow topics", shadowName.c_str());
+            this->stop();
+        }
+
+        readAndUpdateShadowFromFile();
     }
 
-    readAndUpdateShadowFromFile();
+    if (!inputFile.empty() && inputDirectory.empty())
+    {
+        fileWatchId = FileWatcher::GetInstance().Watch(
+            inputFile,
+            FileWatcher::DEFAULT_DEBOUNCE,
+            MAX_SHADOW_DOCUMENT_SIZE_BYTES,
+            std::bind(&SampleShadowFeature::updateShadowFromContent, this, shadowName, std::placeholders::_1));
+        if (fileWatchId == -1)
+        {
+            LOGM_WARN(
+                TAG,
+                "Unable to monitor %s, changes to it won't update the %s shadow",
+                Sanitize(inputFile).c_str(),
+                shadowName.c_str());
+        }
+    }
 
-    if (!inputFile.empty())
+    if (!localSocket.empty())
     {
-        thread file_monitor_thread(&SampleShadowFeature::runFileMonitor, this);
-        file_monitor_thread.detach();
+        localShadowServer = unique_ptr<LocalShadowServer>(new LocalShadowServer(
+            shadowCache,
+            std::bind(
+                &SampleShadowFeature::publishLocalUpdate, this, std::placeholders::_1, std::placeholders::_2)));
+        if (localShadowServer->Start(localSocket))
+        {
+            // stop() clears the callback, which waits for calls in progress, before it destroys the server
+            LocalShadowServer *server = localShadowServer.get();
+            shadowCache->SetOnShadowChanged([server](const std::string &name, const std::string &document) {
+                server->NotifyShadowChanged(name, document);
+            });
+        }
+        else
+        {
+            LOG_WARN(TAG, "Unable to serve shadows on the local socket");
+            localShadowServer.reset();
+        }
     }
 
     baseNotifier->onEvent(static_cast<Feature *>(this), ClientBaseEventNotification::FEATURE_STARTED);
@@ -429,7 +886,27 @@ int SampleShadowFeature::start()
 
 int SampleShadowFeature::stop()
 {
-    needStop.store(true);
+    if (fileWatchId != -1)
+    {
+        FileWatcher::GetInstance().Unwatch(fileWatchId);
+        fileWatchId = -1;
+    }
+
+    if (!inputDirectory.empty())
+    {
+        unsubscribeFromWildcardShadowTopics();
+    }
+    else
+    {
+        unsubscribeFromPertinentShadowTopics();
+    }
+
+    if (localShadowServer)
+    {
+        shadowCache->SetOnShadowChanged(nullptr);
+        localShadowServer->Stop();
+        localShadowServer.reset();
+    }
     baseNotifier->onEvent(static_cast<Feature *>(this), ClientBaseEventNotification::FEATURE_STOPPED);
     return AWS_OP_SUCCESS;
 }
\ No newline at end of file
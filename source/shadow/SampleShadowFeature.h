@@ -9,7 +9,13 @@
 #include "../SharedCrtResourceManager.h"
 #include "../config/Config.h"
 #include "../util/FileUtils.h"
+#include "LocalShadowServer.h"
+#include "ShadowCache.h"
 #include <aws/iotshadow/IotShadowClient.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace Aws
 {
@@ -36,6 +42,37 @@ namespace Aws
 
                     int stop() override;
 
+                    ~SampleShadowFeature() override;
+
+                    /**
+                     * \brief Compute the changes needed to turn one reported state into another
+                     *
+                     * Nested objects are compared key by key; any other value that differs is copied as a whole.
+                     * Keys that no longer exist in the current state are set to null, which removes them from the
+                     * shadow.
+                     *
+                     * @param previous the reported state that was last published
+                     * @param current the reported state that should be published now
+                     * @param delta receives only the keys that changed between the two states
+                     * @return true if anything changed, false otherwise
+                     */
+                    static bool computeReportedStateDelta(
+                        const Crt::JsonView &previous,
+                        const Crt::JsonView &current,
+                        Crt::JsonObject &delta);
+
+                    /**
+                     * \brief Get the name of the shadow a file of the input directory is published to
+                     *
+                     * Only files named <shadow-name>.json where the shadow name is a valid named shadow name are
+                     * published, so editor swap files and other temporary files in the directory are ignored.
+                     *
+                     * @param fileName the name of the file within the input directory
+                     * @param name receives the name of the shadow
+                     * @return true if the file holds a shadow document
+                     */
+                    static bool shadowNameFromFileName(const std::string &fileName, std::string &name);
+
                   private:
                     /**
                      * \brief the ThingName to use
@@ -53,9 +90,9 @@ namespace Aws
                      */
                     std::shared_ptr<ClientBaseNotifier> baseNotifier;
                     /**
-                     * \brief Whether the DeviceClient base has requested this feature to stop
+                     * \brief Id of the watch on the input file or directory, or -1 if nothing is watched
                      */
-                    std::atomic<bool> needStop{false};
+                    int fileWatchId{-1};
                     /**
                      * \brief Name of shadow
                      */
@@ -68,6 +105,68 @@ namespace Aws
                      * \brief Location of file to write the latest shadow document to
                      */
                     std::string outputFile;
+                    /**
+                     * \brief Directory of shadow documents, one named shadow per file. Empty if a single shadow is
+                     * published from inputFile.
+                     */
+                    std::string inputDirectory;
+                    /**
+                     * \brief Directory the latest document of each shadow of the input directory is written to
+                     */
+                    std::string outputDirectory;
+
+                    struct TrackedShadow
+                    {
+                        /**
+                         * \brief Location of file to write the latest shadow document to
+                         */
+                        std::string outputFile;
+                        /**
+                         * \brief The reported state most recently published from the input file. Used to publish
+                         * only the keys that changed since then.
+                         */
+                        Crt::JsonObject lastReportedState;
+                        /**
+                         * \brief Whether lastReportedState holds a state that IoT Core has not rejected, and that no
+                         * delta sync or local update has reported over since
+                         */
+                        bool hasReportedState{false};
+                    };
+                    /**
+                     * \brief Shadows published by this feature keyed by shadow name. Responses received on the
+                     * wildcard shadow topics are routed through this map.
+                     */
+                    std::unordered_map<std::string, TrackedShadow> trackedShadows;
+                    /**
+                     * \brief Lock protecting trackedShadows
+                     */
+                    std::mutex trackedShadowsLock;
+                    struct Liveness
+                    {
+                        std::mutex lock;
+                        bool alive{true};
+                    };
+                    /**
+                     * \brief Shared with the completion callbacks of update publishes, which can still run after a
+                     * config reload destroyed this feature. They call back into it only while alive is set.
+                     */
+                    std::shared_ptr<Liveness> liveness{std::make_shared<Liveness>()};
+                    /**
+                     * \brief Topic prefix shared by the named shadows of this thing, $aws/things/<thing>/shadow/name/
+                     */
+                    std::string namedShadowTopicPrefix;
+                    /**
+                     * \brief Versioned in-memory copy of the shadow, served to on-device applications
+                     */
+                    std::shared_ptr<ShadowCache> shadowCache{std::make_shared<ShadowCache>()};
+                    /**
+                     * \brief Path of the Unix domain socket the shadow cache is served on, empty if it isn't served
+                     */
+                    std::string localSocket;
+                    /**
+                     * \brief Serves the shadow cache on the local socket
+                     */
+                    std::unique_ptr<LocalShadowServer> localShadowServer;
                     /**
                      * \brief Default name of shadow document file
                      */
@@ -77,6 +176,19 @@ namespace Aws
                      * initialized. These promise variables will be initialized in respective callback methods
                      */
                     static constexpr int DEFAULT_WAIT_TIME_SECONDS = 10;
+                    /**
+                     * \brief Maximum size of a shadow document accepted by the AWS IoT Shadow service
+                     */
+                    static constexpr size_t MAX_SHADOW_DOCUMENT_SIZE_BYTES = 8 * 1024;
+                    /**
+                     * \brief Maximum length of a shadow name accepted by the AWS IoT Shadow service
+                     */
+                    static constexpr size_t MAX_SHADOW_NAME_LENGTH = 64;
+                    static constexpr char SHADOW_DOCUMENT_FILE_EXTENSION[] = ".json";
+                    static constexpr char UPDATE_ACCEPTED_TOPIC_SUFFIX[] = "/update/accepted";
+                    static constexpr char UPDATE_REJECTED_TOPIC_SUFFIX[] = "/update/rejected";
+                    static constexpr char UPDATE_DOCUMENTS_TOPIC_SUFFIX[] = "/update/documents";
+                    static constexpr char UPDATE_DELTA_TOPIC_SUFFIX[] = "/update/delta";
                     /**
                      * \brief an IotShadowClient used to make calls to the AWS IoT Shadow service
                      */
@@ -106,6 +218,34 @@ namespace Aws
                      * update/accepted)
                      */
                     bool subscribeToPertinentShadowTopics();
+                    /**
+                     * \brief Subscribe to the update/rejected, update/documents and update/delta topics of every named
+                     * shadow of the thing at once, using the + wildcard in place of the shadow name
+                     */
+                    bool subscribeToWildcardShadowTopics();
+                    /**
+                     * \brief Unsubscribe from the topics subscribed to by subscribeToPertinentShadowTopics
+                     */
+                    void unsubscribeFromPertinentShadowTopics();
+                    /**
+                     * \brief Unsubscribe from the topics subscribed to by subscribeToWildcardShadowTopics
+                     */
+                    void unsubscribeFromWildcardShadowTopics();
+                    /**
+                     * \brief Unsubscribe from the given topics and wait until IoT Core acknowledged each, after which
+                     * no handler bound to this feature is invoked for them anymore
+                     *
+                     * @param topics the topics to unsubscribe from
+                     */
+                    void unsubscribe(const std::vector<std::string> &topics);
+                    /**
+                     * \brief Route a message received on a wildcard shadow topic to the handler of its shadow.
+                     * Messages of shadows that aren't tracked are dropped.
+                     *
+                     * @param topic the topic the message was received on
+                     * @param payload the JSON payload of the message
+                     */
+                    void onWildcardShadowMessage(const std::string &topic, const Crt::ByteBuf &payload);
                     /**
                      * \brief Executed if our request to UpdateNamedShadow is accepted
                      *
@@ -116,29 +256,38 @@ namespace Aws
                     /**
                      * \brief Executed if our request to UpdateNamedShadow is rejected
                      *
+                     * @param targetShadowName the shadow the request was made for
                      * @param rejectedError information about the rejection
                      * @param ioError a non-zero error code indicates a problem
                      */
-                    void updateNamedShadowRejectedHandler(Iotshadow::ErrorResponse *errorResponse, int ioError) const;
+                    void updateNamedShadowRejectedHandler(
+                        const std::string &targetShadowName,
+                        Iotshadow::ErrorResponse *errorResponse,
+                        int ioError);
                     /**
                      * \brief Executed if our request to UpdateNamedShadow is accepted
                      * The response received on the shadow/update/document topic will be writen to the output file
                      *
+                     * @param targetShadowName the shadow that was updated
                      * @param response information about the latest shadow document
                      * @param ioError a non-zero error code indicates a problem
                      */
-                    void updateNamedShadowEventHandler(Iotshadow::ShadowUpdatedEvent *shadowUpdatedEvent, int ioError)
-                        const;
+                    void updateNamedShadowEventHandler(
+                        const std::string &targetShadowName,
+                        Iotshadow::ShadowUpdatedEvent *shadowUpdatedEvent,
+                        int ioError);
                     /**
                      * \brief Executed if our request to UpdateNamedShadow is accepted and the delta exists in current
                      * shadow Will do the shadow sync after receiving the message from update/shadow/delta topic so a
                      * request will be sent to update the reported value to match desired ones
                      *
+                     * @param targetShadowName the shadow the delta was computed for
                      * @param response information including only the desired attributes that differ between the desired
                      * and reported sections in current shadow state.
                      * @param ioError a non-zero error code indicates a problem
                      */
                     void updateNamedShadowDeltaHandler(
+                        const std::string &targetShadowName,
                         Iotshadow::ShadowDeltaUpdatedEvent *shadowDeltaUpdatedEvent,
                         int ioError);
                     /**
@@ -172,21 +321,69 @@ namespace Aws
                     /**
                      * \brief Acknowledgement that IoT Core has received our UpdateNamedShadow Request
                      *
+                     * @param targetShadowName the shadow the request was made for
                      * @param ioError a non-zero code here indicates a problem. Turn on logging in IoT Core
                      * and check CloudWatch for more insights on errors
                      */
-                    void ackUpdateNamedShadowStatus(int ioError) const;
+                    void ackUpdateNamedShadowStatus(const std::string &targetShadowName, int ioError);
+                    /**
+                     * \brief Publish an UpdateNamedShadow request through the publish gateway of the resource manager
+                     *
+                     * @param targetShadowName the shadow the request is made for
+                     * @param updateNamedShadowRequest the request to publish
+                     * @param durable whether to journal the request so it is published again after a restart
+                     */
+                    void publishUpdateRequest(
+                        const std::string &targetShadowName,
+                        const Iotshadow::UpdateNamedShadowRequest &updateNamedShadowRequest,
+                        bool durable);
                     /**
                      * \brief A function used to read and publish input data file to shadow
-                     * @return true if readAndUpdateShadowFromFile successfully
                      */
                     void readAndUpdateShadowFromFile();
                     /**
-                     * \brief A file monitor to detect any changes related with input file and its parent directory
-                     * Once the any data is modified in input file, the shadow will be updated to sync with data in
-                     * input file
+                     * \brief Parse the content of an input file and publish it to shadow. Called by the file watcher
+                     * once the input file has changed.
+                     *
+                     * @param targetShadowName the shadow the input file is published to
+                     * @param contents the content of the input file
+                     */
+                    void updateShadowFromContent(const std::string &targetShadowName, const std::string &contents);
+                    /**
+                     * \brief Publish a reported state to shadow. Once a reported state has been published, only the
+                     * keys that changed since then are published, and nothing is published when the state is
+                     * unchanged.
+                     *
+                     * @param targetShadowName the shadow to publish to
+                     * @param jsonObj the reported state read from the input file
+                     */
+                    void updateShadow(const std::string &targetShadowName, const Crt::JsonObject &jsonObj);
+                    /**
+                     * \brief Start tracking a shadow so that its responses are routed and its documents cached
+                     *
+                     * @param targetShadowName the name of the shadow
+                     * @param shadowOutputFile location of file to write the latest shadow document to
+                     */
+                    void registerShadow(const std::string &targetShadowName, const std::string &shadowOutputFile);
+                    /**
+                     * \brief Publish every shadow document of the input directory
+                     */
+                    void loadInputDirectory();
+                    /**
+                     * \brief Publish a file of the input directory to its shadow, tracking the shadow first if the
+                     * file is new. Called by the file watcher once a file of the input directory has changed.
+                     *
+                     * @param fileName the name of the file within the input directory
+                     * @param contents the content of the file
+                     */
+                    void onInputDirectoryChanged(const std::string &fileName, const std::string &contents);
+                    /**
+                     * \brief Publish a batch of reported state updates received from local clients
+                     *
+                     * @param targetShadowName the shadow the local clients updated
+                     * @param reported the merged reported state updates
                      */
-                    void runFileMonitor();
+                    void publishLocalUpdate(const std::string &targetShadowName, const Crt::JsonObject &reported);
                 };
             } // namespace Shadow
         }     // namespace DeviceClient
@@ -0,0 +1,182 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ShadowCache.h"
+
+using namespace std;
+using namespace Aws;
+using namespace Aws::Crt;
+using namespace Aws::Iot::DeviceClient::Shadow;
+
+void ShadowCache::AddShadow(const std::string &shadowName)
+{
+    lock_guard<mutex> lock(cacheLock);
+    shadows[shadowName];
+}
+
+bool ShadowCache::IsTracked(const std::string &shadowName) const
+{
+    lock_guard<mutex> lock(cacheLock);
+    return shadows.find(shadowName) != shadows.end();
+}
+
+void ShadowCache::SetOnShadowChanged(const OnShadowChangedFn &callback)
+{
+    unique_lock<mutex> lock(cacheLock);
+    onShadowChanged = callback;
+    callbacksReturned.wait(lock, [this]() { return runningCallbacks == 0; });
+}
+
+void ShadowCache::CallOnShadowChanged(
+    const OnShadowChangedFn &callback,
+    const std::string &shadowName,
+    const std::string &document)
+{
+    callback(shadowName, document);
+
+    {
+        lock_guard<mutex> lock(cacheLock);
+        runningCallbacks--;
+    }
+    callbacksReturned.notify_all();
+}
+
+bool ShadowCache::Replace(
+    const std::string &shadowName,
+    const Crt::Optional<Crt::JsonObject> &desired,
+    const Crt::Optional<Crt::JsonObject> &reported,
+    int64_t version)
+{
+    string document;
+    OnShadowChangedFn callback;
+    {
+        lock_guard<mutex> lock(cacheLock);
+        auto entry = shadows.find(shadowName);
+        // update/documents carries the complete state, so it also replaces a delta of the same version
+        if (entry == shadows.end() || (entry->second.hasDocument && version < entry->second.version))
+        {
+            return false;
+        }
+
+        CachedShadow &shadow = entry->second;
+        shadow.desired = desired.has_value() ? desired.value() : JsonObject();
+        shadow.reported = reported.has_value() ? reported.value() : JsonObject();
+        shadow.version = version;
+        shadow.hasDocument = true;
+        SerializeDocument(shadowName, shadow);
+
+        document = shadow.document;
+        if (onShadowChanged)
+        {
+            callback = onShadowChanged;
+            runningCallbacks++;
+        }
+    }
+
+    if (callback)
+    {
+        CallOnShadowChanged(callback, shadowName, document);
+    }
+    return true;
+}
+
+bool ShadowCache::ApplyDesiredDelta(const std::string &shadowName, const Crt::JsonView &delta, int64_t version)
+{
+    string document;
+    OnShadowChangedFn callback;
+    {
+        lock_guard<mutex> lock(cacheLock);
+        auto entry = shadows.find(shadowName);
+        if (entry == shadows.end() || (entry->second.hasDocument && version <= entry->second.version))
+        {
+            return false;
+        }
+
+        CachedShadow &shadow = entry->second;
+        shadow.desired = MergePatch(shadow.desired.View(), delta, false);
+        shadow.version = version;
+        shadow.hasDocument = true;
+        SerializeDocument(shadowName, shadow);
+
+        document = shadow.document;
+        if (onShadowChanged)
+        {
+            callback = onShadowChanged;
+            runningCallbacks++;
+        }
+    }
+
+    if (callback)
+    {
+        CallOnShadowChanged(callback, shadowName, document);
+    }
+    return true;
+}
+
+bool ShadowCache::Get(const std::string &shadowName, std::string &document) const
+{
+    lock_guard<mutex> lock(cacheLock);
+    auto entry = shadows.find(shadowName);
+    if (entry == shadows.end() || !entry->second.hasDocument)
+    {
+        return false;
+    }
+
+    document = entry->second.document;
+    return true;
+}
+
+Crt::JsonObject ShadowCache::MergePatch(const Crt::JsonView &target, const Crt::JsonView &patch, bool keepNulls)
+{
+    JsonObject result;
+    auto targetValues = target.GetAllObjects();
+    auto patchValues = patch.GetAllObjects();
+
+    for (const auto &entry : targetValues)
+    {
+        if (patchValues.find(entry.first) == patchValues.end())
+        {
+            result.WithObject(entry.first, entry.second.Materialize());
+        }
+    }
+
+    for (const auto &entry : patchValues)
+    {
+        if (entry.second.IsNull() && !keepNulls)
+        {
+            continue;
+        }
+
+        if (entry.second.IsObject())
+        {
+            auto targetEntry = targetValues.find(entry.first);
+            JsonObject empty;
+            result.WithObject(
+                entry.first,
+                MergePatch(
+                    targetEntry != targetValues.end() && targetEntry->second.IsObject() ? targetEntry->second
+                                                                                        : empty.View(),
+                    entry.second,
+                    keepNulls));
+        }
+        else
+        {
+            result.WithObject(entry.first, entry.second.Materialize());
+        }
+    }
+
+    return result;
+}
+
+void ShadowCache::SerializeDocument(const std::string &shadowName, CachedShadow &shadow)
+{
+    JsonObject state;
+    state.WithObject("desired", shadow.desired);
+    state.WithObject("reported", shadow.reported);
+
+    JsonObject document;
+    document.WithString("shadow", shadowName.c_str());
+    document.WithObject("state", state);
+    document.WithInt64("version", shadow.version);
+    shadow.document = document.View().WriteCompact().c_str();
+}
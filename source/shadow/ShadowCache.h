@@ -0,0 +1,151 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_SHADOWCACHE_H
+#define AWS_IOT_DEVICE_CLIENT_SHADOWCACHE_H
+
+#include <aws/crt/JsonObject.h>
+#include <aws/crt/Optional.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Shadow
+            {
+                /**
+                 * \brief Versioned in-memory copy of the desired and reported state of named shadows
+                 *
+                 * The cache is fed from the shadow update/documents and update/delta topics. Each shadow is kept as a
+                 * serialized document of the form {"shadow":"<name>","state":{"desired":{},"reported":{}},
+                 * "version":<version>} so that reads only need to copy a string.
+                 */
+                class ShadowCache
+                {
+                  public:
+                    /**
+                     * \brief Called after the cached document of a shadow changed
+                     */
+                    using OnShadowChangedFn =
+                        std::function<void(const std::string &shadowName, const std::string &document)>;
+
+                    /**
+                     * \brief Start tracking a named shadow. Only tracked shadows are cached.
+                     *
+                     * @param shadowName the name of the shadow
+                     */
+                    void AddShadow(const std::string &shadowName);
+
+                    /**
+                     * \brief Whether the given shadow is tracked by this cache
+                     */
+                    bool IsTracked(const std::string &shadowName) const;
+
+                    /**
+                     * \brief Set the function called after the cached document of a shadow changed
+                     *
+                     * Waits for calls of the previous function that are in progress to return, so that whatever it
+                     * refers to can be destroyed once this returns. Must not be called from the function itself.
+                     */
+                    void SetOnShadowChanged(const OnShadowChangedFn &callback);
+
+                    /**
+                     * \brief Replace the cached state of a shadow with the state of a shadow document
+                     *
+                     * @param shadowName the name of the shadow
+                     * @param desired the complete desired state, if any
+                     * @param reported the complete reported state, if any
+                     * @param version the version of the shadow document
+                     * @return true if the cache was updated, false if the shadow isn't tracked or the cache already
+                     * holds a newer version
+                     */
+                    bool Replace(
+                        const std::string &shadowName,
+                        const Crt::Optional<Crt::JsonObject> &desired,
+                        const Crt::Optional<Crt::JsonObject> &reported,
+                        int64_t version);
+
+                    /**
+                     * \brief Merge the state of a delta event into the cached desired state of a shadow
+                     *
+                     * @param shadowName the name of the shadow
+                     * @param delta the desired attributes that differ from the reported state
+                     * @param version the version of the shadow document the delta was computed from
+                     * @return true if the cache was updated, false if the shadow isn't tracked or the cache already
+                     * holds this or a newer version
+                     */
+                    bool ApplyDesiredDelta(const std::string &shadowName, const Crt::JsonView &delta, int64_t version);
+
+                    /**
+                     * \brief Get the cached document of a shadow
+                     *
+                     * @param shadowName the name of the shadow
+                     * @param document receives the cached document
+                     * @return true if a document is cached for this shadow
+                     */
+                    bool Get(const std::string &shadowName, std::string &document) const;
+
+                    /**
+                     * \brief Apply a JSON merge patch to a JSON object
+                     *
+                     * Objects in the patch are merged recursively into the target, and any other value replaces the
+                     * value of the target.
+                     *
+                     * @param target the object to patch
+                     * @param patch the patch to apply
+                     * @param keepNulls if false, null values in the patch remove the key from the result. If true, they
+                     * are kept, which is how two patches are combined into one.
+                     * @return the patched object
+                     */
+                    static Crt::JsonObject MergePatch(
+                        const Crt::JsonView &target,
+                        const Crt::JsonView &patch,
+                        bool keepNulls);
+
+                  private:
+                    struct CachedShadow
+                    {
+                        bool hasDocument{false};
+                        int64_t version{0};
+                        Crt::JsonObject desired;
+                        Crt::JsonObject reported;
+                        std::string document;
+                    };
+
+                    /**
+                     * \brief Rebuild the serialized document of a shadow from its state
+                     */
+                    static void SerializeDocument(const std::string &shadowName, CachedShadow &shadow);
+
+                    /**
+                     * \brief Call a copy of onShadowChanged taken while runningCallbacks was incremented
+                     */
+                    void CallOnShadowChanged(
+                        const OnShadowChangedFn &callback,
+                        const std::string &shadowName,
+                        const std::string &document);
+
+                    mutable std::mutex cacheLock;
+                    std::map<std::string, CachedShadow> shadows;
+                    OnShadowChangedFn onShadowChanged;
+                    /**
+                     * \brief Calls of onShadowChanged in progress, guarded by cacheLock and signaled through
+                     * callbacksReturned when they return
+                     */
+                    int runningCallbacks{0};
+                    std::condition_variable callbacksReturned;
+                };
+            } // namespace Shadow
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_SHADOWCACHE_H
@@ -143,6 +143,10 @@ namespace Aws
                 void SecureTunnelingContext::OnConnectionComplete() const
                 {
                     LOG_DEBUG(TAG, "SecureTunnelingContext::OnConnectionComplete");
+                    LOGM_INFO(
+                        TAG,
+                        "Connected to secure tunnel %lld ms after the tunnel was requested",
+                        GetMillisSinceCreation());
                 }
 
                 void SecureTunnelingContext::OnConnectionShutdown()
@@ -163,6 +167,13 @@ namespace Aws
                 void SecureTunnelingContext::OnDataReceive(const Crt::ByteBuf &data) const
                 {
                     LOGM_DEBUG(TAG, "SecureTunnelingContext::OnDataReceive data.len=%zu", data.len);
+                    if (!mReceivedFirstByte.exchange(true))
+                    {
+                        LOGM_INFO(
+                            TAG,
+                            "Received first data from secure tunnel %lld ms after the tunnel was requested",
+                            GetMillisSinceCreation());
+                    }
                     mTcpForward->SendData(aws_byte_cursor_from_buf(&data));
                 }
 
@@ -196,6 +207,13 @@ namespace Aws
                     mSecureTunnel->Shutdown();
                 }
 
+                long long SecureTunnelingContext::GetMillisSinceCreation() const
+                {
+                    return static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                      std::chrono::steady_clock::now() - mCreationTime)
+                                                      .count());
+                }
+
                 std::shared_ptr<SecureTunnelWrapper> SecureTunnelingContext::CreateSecureTunnel(
                     const Aws::Iotsecuretunneling::OnConnectionComplete &onConnectionComplete,
                     const Aws::Iotsecuretunneling::OnConnectionShutdown &onConnectionShutdown,
@@ -210,7 +228,7 @@ namespace Aws
                         LOGM_INFO(TAG, "Creating Secure Tunneling with proxy to: %s", mProxyOptions.HostName.c_str());
                         return std::make_shared<SecureTunnelWrapper>(
                             mSharedCrtResourceManager->getAllocator(),
-                            mSharedCrtResourceManager->getClientBootstrap(),
+                            mSharedCrtResourceManager->getClientBootstrap(EventLoopRole::DATA_PLANE),
                             Crt::Io::SocketOptions(),
                             mProxyOptions,
                             mAccessToken,
@@ -229,7 +247,7 @@ namespace Aws
                     {
                         return std::make_shared<SecureTunnelWrapper>(
                             mSharedCrtResourceManager->getAllocator(),
-                            mSharedCrtResourceManager->getClientBootstrap(),
+                            mSharedCrtResourceManager->getClientBootstrap(EventLoopRole::DATA_PLANE),
                             Crt::Io::SocketOptions(),
                             mAccessToken,
                             AWS_SECURE_TUNNELING_DESTINATION_MODE,
@@ -9,6 +9,8 @@
 #include <aws/crt/Types.h>
 #include <aws/iotsecuretunneling/SecureTunnel.h>
 #include <aws/iotsecuretunneling/SecureTunnelingNotifyResponse.h>
+#include <atomic>
+#include <chrono>
 #include <string>
 
 namespace Aws
@@ -173,6 +175,11 @@ namespace Aws
                      * \brief Callback when secure tunnel session_reset is received
                      */
                     void OnSessionReset();
+
+                    /**
+                     * \brief Milliseconds elapsed since this context was created, i.e. since the tunnel was requested
+                     */
+                    long long GetMillisSinceCreation() const;
                     //
                     // Member variables
                     //
@@ -233,6 +240,17 @@ namespace Aws
                      * notifications.
                      */
                     Aws::Crt::Optional<Aws::Iotsecuretunneling::SecureTunnelingNotifyResponse> mLastSeenNotifyResponse;
+
+                    /**
+                     * \brief When this context was created. Used to report how long it takes from a tunnel request to
+                     * the tunnel being connected and to the first byte of data being received.
+                     */
+                    std::chrono::steady_clock::time_point mCreationTime{std::chrono::steady_clock::now()};
+
+                    /**
+                     * \brief Whether data has been received from the secure tunnel yet
+                     */
+                    mutable std::atomic<bool> mReceivedFirstByte{false};
                 };
             } // namespace SecureTunneling
         }     // namespace DeviceClient
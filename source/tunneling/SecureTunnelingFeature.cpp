@@ -7,7 +7,9 @@
 #include "TcpForward.h"
 #include <aws/crt/mqtt/MqttClient.h>
 #include <aws/iotsecuretunneling/SubscribeToTunnelsNotifyRequest.h>
+#include <chrono>
 #include <csignal>
+#include <cstring>
 #include <map>
 #include <memory>
 #include <thread>
@@ -28,11 +30,12 @@ namespace Aws
                 constexpr char SecureTunnelingFeature::TAG[];
                 constexpr char SecureTunnelingFeature::NAME[];
                 constexpr char SecureTunnelingFeature::DEFAULT_PROXY_ENDPOINT_HOST_FORMAT[];
+                constexpr int SecureTunnelingFeature::PREWARM_REFRESH_INTERVAL_SECONDS;
                 std::map<std::string, uint16_t> SecureTunnelingFeature::mServiceToPortMap;
 
                 SecureTunnelingFeature::SecureTunnelingFeature() = default;
 
-                SecureTunnelingFeature::~SecureTunnelingFeature() = default;
+                SecureTunnelingFeature::~SecureTunnelingFeature() { StopPrewarm(); }
 
                 int SecureTunnelingFeature::init(
                     shared_ptr<SharedCrtResourceManager> sharedCrtResourceManager,
@@ -54,6 +57,10 @@ namespace Aws
                 int SecureTunnelingFeature::start()
                 {
                     RunSecureTunneling();
+                    if (mPrewarm && mSubscribeNotification)
+                    {
+                        StartPrewarm();
+                    }
                     auto self = static_cast<Feature *>(this);
                     mClientBaseNotifier->onEvent(self, ClientBaseEventNotification::FEATURE_STARTED);
                     return 0;
@@ -62,6 +69,7 @@ namespace Aws
                 int SecureTunnelingFeature::stop()
                 {
                     LOG_DEBUG(TAG, "SecureTunnelingFeature::stop");
+                    StopPrewarm();
                     for (auto &c : mContexts)
                     {
                         c->StopSecureTunnel();
@@ -92,6 +100,26 @@ namespace Aws
 
                 bool SecureTunnelingFeature::IsValidPort(int port) { return 1 <= port && port <= 65535; }
 
+                string SecureTunnelingFeature::GetRegionFromIotEndpoint(const string &endpoint)
+                {
+                    // AWS IoT Core endpoints have the form <prefix>.iot.<region>.amazonaws.com[.cn]
+                    static constexpr char IOT_DOMAIN_SEGMENT[] = ".iot.";
+                    size_t start = endpoint.find(IOT_DOMAIN_SEGMENT);
+                    if (start == string::npos)
+                    {
+                        return "";
+                    }
+                    start += strlen(IOT_DOMAIN_SEGMENT);
+
+                    size_t end = endpoint.find('.', start);
+                    if (end == string::npos || end == start)
+                    {
+                        return "";
+                    }
+
+                    return endpoint.substr(start, end - start);
+                }
+
                 void SecureTunnelingFeature::LoadFromConfig(const PlainConfig &config)
                 {
                     PlainConfig::HttpProxyConfig proxyConfig = config.httpProxyConfig;
@@ -130,6 +158,11 @@ namespace Aws
                     mRootCa = config.rootCa;
                     mSubscribeNotification = config.tunneling.subscribeNotification;
                     mEndpoint = config.tunneling.endpoint;
+                    mPrewarm = config.tunneling.prewarm;
+                    if (config.endpoint.has_value())
+                    {
+                        mIotEndpoint = config.endpoint.value();
+                    }
 
                     if (!config.tunneling.subscribeNotification)
                     {
@@ -266,6 +299,13 @@ namespace Aws
                         return mEndpoint.value();
                     }
 
+                    std::lock_guard<std::mutex> lock(mEndpointCacheLock);
+                    auto cached = mEndpointCache.find(region);
+                    if (cached != mEndpointCache.end())
+                    {
+                        return cached->second;
+                    }
+
                     string endpoint = FormatMessage(DEFAULT_PROXY_ENDPOINT_HOST_FORMAT, region.c_str());
 
                     if (region.substr(0, 3) == "cn-")
@@ -276,9 +316,100 @@ namespace Aws
                         endpoint = endpoint + ".cn";
                     }
 
+                    mEndpointCache[region] = endpoint;
                     return endpoint;
                 }
 
+                void SecureTunnelingFeature::ResolveEndpoint(const string &endpoint)
+                {
+                    Aws::Crt::Io::HostResolver *resolver = mSharedCrtResourceManager->getHostResolver();
+                    if (!resolver)
+                    {
+                        return;
+                    }
+
+                    auto onHostResolved = [endpoint](
+                                              Aws::Crt::Io::HostResolver &,
+                                              const Aws::Crt::Vector<Aws::Crt::Io::HostAddress> &addresses,
+                                              int errorCode) {
+                        if (errorCode)
+                        {
+                            LOGM_WARN(
+                                TAG,
+                                "Failed to resolve secure tunneling endpoint %s: %s",
+                                endpoint.c_str(),
+                                Aws::Crt::ErrorDebugString(errorCode));
+                            return;
+                        }
+                        LOGM_DEBUG(
+                            TAG,
+                            "Resolved secure tunneling endpoint %s to %zu address(es)",
+                            endpoint.c_str(),
+                            addresses.size());
+                    };
+
+                    if (!resolver->ResolveHost(endpoint.c_str(), onHostResolved))
+                    {
+                        LOGM_WARN(TAG, "Unable to start resolving secure tunneling endpoint %s", endpoint.c_str());
+                    }
+                }
+
+                void SecureTunnelingFeature::StartPrewarm()
+                {
+                    string endpoint;
+                    if (mEndpoint.has_value())
+                    {
+                        endpoint = mEndpoint.value();
+                    }
+                    else
+                    {
+                        string region = GetRegionFromIotEndpoint(mIotEndpoint);
+                        if (region.empty())
+                        {
+                            LOGM_WARN(
+                                TAG,
+                                "Unable to determine the AWS region from endpoint %s, secure tunneling endpoint will "
+                                "not be pre-warmed",
+                                mIotEndpoint.c_str());
+                            return;
+                        }
+                        endpoint = GetEndpoint(region);
+                    }
+
+                    std::lock_guard<std::mutex> lock(mPrewarmLock);
+                    if (mPrewarmRunning)
+                    {
+                        return;
+                    }
+                    mPrewarmRunning = true;
+
+                    LOGM_INFO(TAG, "Pre-warming secure tunneling endpoint %s", endpoint.c_str());
+                    mPrewarmThread = thread([this, endpoint] {
+                        std::unique_lock<std::mutex> prewarmLock(mPrewarmLock);
+                        while (mPrewarmRunning)
+                        {
+                            ResolveEndpoint(endpoint);
+                            mPrewarmCondition.wait_for(
+                                prewarmLock,
+                                std::chrono::seconds(PREWARM_REFRESH_INTERVAL_SECONDS),
+                                [this] { return !mPrewarmRunning; });
+                        }
+                    });
+                }
+
+                void SecureTunnelingFeature::StopPrewarm()
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mPrewarmLock);
+                        mPrewarmRunning = false;
+                    }
+                    mPrewarmCondition.notify_all();
+                    if (mPrewarmThread.joinable())
+                    {
+                        mPrewarmThread.join();
+                    }
+                }
+
                 std::unique_ptr<SecureTunnelingContext> SecureTunnelingFeature::createContext(
                     const std::string &accessToken,
                     const std::string &region,
@@ -12,6 +12,10 @@
 #include "aws/crt/http/HttpProxyStrategy.h"
 #include <aws/iotdevicecommon/IotDevice.h>
 #include <aws/iotsecuretunneling/SecureTunnelingNotifyResponse.h>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
 
 namespace Aws
 {
@@ -74,6 +78,14 @@ namespace Aws
                      */
                     static bool IsValidPort(int port);
 
+                    /**
+                     * \brief Extract the AWS region from an AWS IoT Core endpoint
+                     *
+                     * @param endpoint the AWS IoT Core endpoint, e.g. xxxxxxxxxxxxxx-ats.iot.us-east-1.amazonaws.com
+                     * @return the region, or an empty string if the endpoint does not follow the AWS IoT Core format
+                     */
+                    static std::string GetRegionFromIotEndpoint(const std::string &endpoint);
+
                   private:
                     /**
                      * \brief Load configuration data from the config object
@@ -116,6 +128,24 @@ namespace Aws
                      */
                     std::string GetEndpoint(const std::string &region);
 
+                    /**
+                     * \brief Ask the shared host resolver to resolve the given endpoint so that the address is
+                     * already cached when a secure tunnel connects to it
+                     *
+                     * @param endpoint Secure Tunneling data plain endpoint
+                     */
+                    void ResolveEndpoint(const std::string &endpoint);
+
+                    /**
+                     * \brief Start the thread that keeps the data plain endpoint for this device's region resolved
+                     */
+                    void StartPrewarm();
+
+                    /**
+                     * \brief Stop the thread started by StartPrewarm()
+                     */
+                    void StopPrewarm();
+
                     /**
                      * \brief Get the IotSecureTunneling client
                      */
@@ -153,6 +183,12 @@ namespace Aws
                      */
                     static constexpr char DEFAULT_PROXY_ENDPOINT_HOST_FORMAT[] = "data.tunneling.iot.%s.amazonaws.com";
 
+                    /**
+                     * \brief How often the pre-warmed endpoint is resolved again. This must stay below the maximum TTL
+                     * of the shared host resolver so that cached addresses never expire between refreshes.
+                     */
+                    static constexpr int PREWARM_REFRESH_INTERVAL_SECONDS = 20;
+
                     /**
                      * \brief A map for converting supported services to their port numbers
                      */
@@ -204,6 +240,39 @@ namespace Aws
                      */
                     Aws::Crt::Optional<std::string> mEndpoint;
 
+                    /**
+                     * \brief The AWS IoT Core endpoint the device is connected to. Used to determine which region's
+                     * data plain endpoint to pre-warm.
+                     */
+                    std::string mIotEndpoint;
+
+                    /**
+                     * \brief Should the data plain endpoint be resolved ahead of the first tunnel notification?
+                     */
+                    bool mPrewarm{false};
+
+                    /**
+                     * \brief Data plain endpoints that have already been computed, keyed by region
+                     */
+                    std::map<std::string, std::string> mEndpointCache;
+
+                    /**
+                     * \brief Lock protecting mEndpointCache
+                     */
+                    std::mutex mEndpointCacheLock;
+
+                    /**
+                     * \brief Thread that periodically resolves the pre-warmed endpoint
+                     */
+                    std::thread mPrewarmThread;
+
+                    /**
+                     * \brief Lock and condition variable used to wake the pre-warm thread when the feature stops
+                     */
+                    std::mutex mPrewarmLock;
+                    std::condition_variable mPrewarmCondition;
+                    bool mPrewarmRunning{false};
+
                     /**
                      * \brief A vector of SecureTunnelingContext. Each context represents an active secure tunneling
                      * session.
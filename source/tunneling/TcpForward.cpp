@@ -56,8 +56,7 @@ namespace Aws
                     snprintf(endpoint.address, AWS_ADDRESS_MAX_LEN, "%s", localhost.c_str());
                     endpoint.port = mPort;
 
-                    aws_event_loop *eventLoop = aws_event_loop_group_get_next_loop(
-                        mSharedCrtResourceManager->getEventLoopGroup()->GetUnderlyingHandle());
+                    aws_event_loop *eventLoop = mSharedCrtResourceManager->getNextEventLoop(EventLoopRole::DATA_PLANE);
 
                     aws_socket_connect(&mSocket, &endpoint, eventLoop, sOnConnectionResult, this);
 
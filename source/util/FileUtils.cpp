@@ -6,6 +6,7 @@
 
 #include <errno.h>
 #include <iostream>
+#include <mutex>
 
 #include <fcntl.h>
 #include <limits.h> /* PATH_MAX */
@@ -21,6 +22,38 @@ using namespace Aws::Iot::DeviceClient::Logging;
 
 constexpr char FileUtils::TAG[];
 
+namespace
+{
+    mutex checkedPathsLock;
+    bool recordingCheckedPaths{false};
+    set<string> checkedPaths;
+} // namespace
+
+void FileUtils::StartRecordingCheckedPaths()
+{
+    lock_guard<mutex> lock(checkedPathsLock);
+    recordingCheckedPaths = true;
+    checkedPaths.clear();
+}
+
+set<string> FileUtils::StopRecordingCheckedPaths()
+{
+    lock_guard<mutex> lock(checkedPathsLock);
+    recordingCheckedPaths = false;
+    set<string> paths;
+    paths.swap(checkedPaths);
+    return paths;
+}
+
+void FileUtils::RecordCheckedPath(const string &path)
+{
+    lock_guard<mutex> lock(checkedPathsLock);
+    if (recordingCheckedPaths)
+    {
+        checkedPaths.insert(path);
+    }
+}
+
 int FileUtils::Mkdirs(const std::string &path)
 {
     if (path.length() < 1)
@@ -137,6 +170,7 @@ int FileUtils::WriteToFile(const std::string &pathToFile, const aws_byte_buf *da
 
 int FileUtils::GetFilePermissions(const std::string &path)
 {
+    RecordCheckedPath(path);
     struct stat file_info;
     if (stat(path.c_str(), &file_info) == -1)
     {
@@ -150,6 +184,7 @@ int FileUtils::GetFilePermissions(const std::string &path)
 
 bool FileUtils::ValidateFileOwnershipPermissions(const std::string &path)
 {
+    RecordCheckedPath(path);
     struct stat file_info;
     if (stat(path.c_str(), &file_info) == -1)
     {
@@ -256,6 +291,7 @@ int FileUtils::PermissionsMaskToInt(mode_t mask)
 size_t FileUtils::GetFileSize(const std::string &filePath)
 {
     string expandedPath = ExtractExpandedPath(filePath);
+    RecordCheckedPath(expandedPath);
 
     struct stat file_info;
     if (stat(expandedPath.c_str(), &file_info) == 0)
@@ -318,6 +354,7 @@ bool FileUtils::CreateDirectoryWithPermissions(const char *dirPath, mode_t permi
 bool FileUtils::DirectoryExists(const std::string &dirPath)
 {
     auto expandedDirPath = ExtractExpandedPath(dirPath);
+    RecordCheckedPath(expandedDirPath);
     struct stat dirInfo;
     if (stat(expandedDirPath.c_str(), &dirInfo) != 0)
     {
@@ -349,6 +386,7 @@ bool FileUtils::CreateEmptyFileWithPermissions(const string &filename, mode_t pe
 bool FileUtils::FileExists(const string &filename)
 {
     string expandedPath = FileUtils::ExtractExpandedPath(filename);
+    RecordCheckedPath(expandedPath);
     ifstream f(expandedPath);
     return f.good();
 }
@@ -5,6 +5,7 @@
 #define AWS_IOT_DEVICE_CLIENT_FILEUTILS_H
 
 #include <aws/common/byte_buf.h>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <sys/stat.h>
@@ -166,6 +167,22 @@ namespace Aws
                      * @return True if the filepath is valid. False otherwise.
                      */
                     static bool IsValidFilePath(const std::string &filePath);
+
+                    /**
+                     * \brief Start recording the paths examined by the existence, ownership and permission checks of
+                     * this class, so that the files a validated configuration depends on can be fingerprinted
+                     */
+                    static void StartRecordingCheckedPaths();
+
+                    /**
+                     * \brief Stop recording the paths examined by the checks of this class
+                     *
+                     * @return the expanded paths examined since StartRecordingCheckedPaths was called
+                     */
+                    static std::set<std::string> StopRecordingCheckedPaths();
+
+                  private:
+                    static void RecordCheckedPath(const std::string &path);
                 };
 
                 struct wordexp_fail_error : std::runtime_error
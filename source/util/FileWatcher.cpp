@@ -0,0 +1,421 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "FileWatcher.h"
+#include "../logging/LoggerFactory.h"
+#include "FileUtils.h"
+#include "StringUtils.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Util;
+using namespace Aws::Iot::DeviceClient::Logging;
+
+constexpr char FileWatcher::TAG[];
+constexpr std::chrono::milliseconds FileWatcher::DEFAULT_DEBOUNCE;
+constexpr int FileWatcher::MAX_DEBOUNCE_FACTOR;
+
+constexpr uint32_t DIRECTORY_EVENTS = IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_ONLYDIR;
+// Large enough for several events carrying a file name of maximum length
+constexpr size_t EVENT_BUFSIZE = 16 * (sizeof(struct inotify_event) + NAME_MAX + 1);
+
+FileWatcher::FileWatcher()
+{
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotifyFd == -1 || epollFd == -1 || wakeFd == -1)
+    {
+        LOGM_ERROR(TAG, "Failed to initialize the file watcher: %s", strerror(errno));
+        return;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = inotifyFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, inotifyFd, &event) == -1)
+    {
+        LOGM_ERROR(TAG, "Failed to add the inotify descriptor to epoll: %s", strerror(errno));
+        return;
+    }
+    event.data.fd = wakeFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) == -1)
+    {
+        LOGM_ERROR(TAG, "Failed to add the wake up descriptor to epoll: %s", strerror(errno));
+        return;
+    }
+
+    running.store(true);
+    watcherThread = thread(&FileWatcher::run, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (running.exchange(false))
+    {
+        uint64_t value = 1;
+        if (write(wakeFd, &value, sizeof(value)) != sizeof(value))
+        {
+            LOGM_WARN(TAG, "Failed to wake up the file watcher thread: %s", strerror(errno));
+        }
+    }
+    if (watcherThread.joinable())
+    {
+        watcherThread.join();
+    }
+
+    for (int fd : {inotifyFd, epollFd, wakeFd})
+    {
+        if (fd != -1)
+        {
+            close(fd);
+        }
+    }
+}
+
+FileWatcher &FileWatcher::GetInstance()
+{
+    static FileWatcher instance;
+    return instance;
+}
+
+int FileWatcher::Watch(
+    const std::string &path,
+    std::chrono::milliseconds debounce,
+    size_t maxFileSize,
+    const OnFileChangedFn &callback)
+{
+    FileWatch watch;
+    watch.directory = FileUtils::ExtractParentDirectory(path);
+    size_t rightMostSlash = path.rfind('/');
+    watch.fileName = rightMostSlash == string::npos ? path : path.substr(rightMostSlash + 1);
+    watch.debounce = debounce;
+    watch.maxFileSize = maxFileSize;
+    watch.callback = [callback](const std::string &, const std::string &content) { callback(content); };
+    if (watch.fileName.empty())
+    {
+        LOGM_ERROR(TAG, "Cannot watch %s, it is not a file path", Sanitize(path).c_str());
+        return -1;
+    }
+
+    return addWatch(std::move(watch));
+}
+
+int FileWatcher::WatchDirectory(
+    const std::string &directory,
+    std::chrono::milliseconds debounce,
+    size_t maxFileSize,
+    const OnDirectoryChangedFn &callback)
+{
+    FileWatch watch;
+    watch.directory = directory.empty() || directory.back() != '/' ? directory + "/" : directory;
+    watch.debounce = debounce;
+    watch.maxFileSize = maxFileSize;
+    watch.callback = callback;
+
+    return addWatch(std::move(watch));
+}
+
+int FileWatcher::addWatch(FileWatch &&watch)
+{
+    if (!running.load())
+    {
+        LOGM_ERROR(
+            TAG,
+            "Cannot watch %s%s, the file watcher is not running",
+            Sanitize(watch.directory).c_str(),
+            Sanitize(watch.fileName).c_str());
+        return -1;
+    }
+
+    lock_guard<mutex> lock(watchLock);
+    if (directoryDescriptors.find(watch.directory) == directoryDescriptors.end())
+    {
+        int wd = inotify_add_watch(inotifyFd, watch.directory.c_str(), DIRECTORY_EVENTS);
+        if (wd == -1)
+        {
+            LOGM_ERROR(
+                TAG,
+                "Failed to watch directory %s: %s",
+                Sanitize(watch.directory).c_str(),
+                strerror(errno));
+            return -1;
+        }
+        directoryDescriptors[watch.directory] = wd;
+        directories[wd] = watch.directory;
+    }
+
+    int watchId = nextWatchId++;
+    LOGM_DEBUG(TAG, "Watching %s%s", Sanitize(watch.directory).c_str(), Sanitize(watch.fileName).c_str());
+    watches[watchId] = std::move(watch);
+    return watchId;
+}
+
+void FileWatcher::Unwatch(int watchId)
+{
+    // Waiting for callbacks to finish from within a callback would deadlock
+    unique_lock<mutex> callbacksDone(callbackLock, defer_lock);
+    if (this_thread::get_id() != watcherThread.get_id())
+    {
+        callbacksDone.lock();
+    }
+
+    lock_guard<mutex> lock(watchLock);
+    auto watch = watches.find(watchId);
+    if (watch == watches.end())
+    {
+        return;
+    }
+    string directory = watch->second.directory;
+    watches.erase(watch);
+
+    for (const auto &entry : watches)
+    {
+        if (entry.second.directory == directory)
+        {
+            return;
+        }
+    }
+
+    auto descriptor = directoryDescriptors.find(directory);
+    if (descriptor != directoryDescriptors.end())
+    {
+        inotify_rm_watch(inotifyFd, descriptor->second);
+        directories.erase(descriptor->second);
+        directoryDescriptors.erase(descriptor);
+    }
+}
+
+void FileWatcher::run()
+{
+    constexpr int MAX_EPOLL_EVENTS = 2;
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+
+    while (running.load())
+    {
+        int count = epoll_wait(epollFd, events, MAX_EPOLL_EVENTS, getTimeoutMillis());
+        if (count == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            LOGM_ERROR(TAG, "File watcher stopped after epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            if (events[i].data.fd == inotifyFd)
+            {
+                readEvents();
+            }
+        }
+
+        dispatchDueWatches();
+    }
+}
+
+void FileWatcher::readEvents()
+{
+    alignas(struct inotify_event) char buf[EVENT_BUFSIZE];
+    auto now = chrono::steady_clock::now();
+
+    ssize_t len;
+    while ((len = read(inotifyFd, buf, sizeof(buf))) > 0)
+    {
+        lock_guard<mutex> lock(watchLock);
+        for (ssize_t i = 0; i < len;)
+        {
+            const auto *e = reinterpret_cast<const struct inotify_event *>(&buf[i]);
+            i += sizeof(struct inotify_event) + e->len;
+
+            if (e->mask & IN_Q_OVERFLOW)
+            {
+                LOG_WARN(TAG, "Inotify event queue overflowed, re-reading all watched files");
+                for (auto &entry : watches)
+                {
+                    AddOverflowChanges(entry.second, now);
+                }
+                continue;
+            }
+            else if (e->mask & IN_IGNORED)
+            {
+                auto directory = directories.find(e->wd);
+                if (directory != directories.end())
+                {
+                    LOGM_WARN(
+                        TAG,
+                        "Directory %s is no longer watched, changes to files in it will be missed",
+                        Sanitize(directory->second).c_str());
+                    directoryDescriptors.erase(directory->second);
+                    directories.erase(directory);
+                }
+                continue;
+            }
+            else if (e->len == 0 || (e->mask & IN_ISDIR))
+            {
+                continue;
+            }
+
+            auto directory = directories.find(e->wd);
+            if (directory == directories.end())
+            {
+                continue;
+            }
+            for (auto &entry : watches)
+            {
+                FileWatch &watch = entry.second;
+                if (watch.directory == directory->second && (watch.fileName.empty() || watch.fileName == e->name))
+                {
+                    AddPendingChange(watch, e->name, now);
+                }
+            }
+        }
+    }
+
+    if (len == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        LOGM_ERROR(TAG, "Failed to read inotify events: %s", strerror(errno));
+    }
+}
+
+void FileWatcher::AddPendingChange(
+    FileWatch &watch,
+    const std::string &fileName,
+    std::chrono::steady_clock::time_point now)
+{
+    auto pending = watch.pendingChanges.find(fileName);
+    if (pending == watch.pendingChanges.end())
+    {
+        pending = watch.pendingChanges.insert(make_pair(fileName, PendingChange{now, now})).first;
+    }
+    pending->second.deadline =
+        min(now + watch.debounce, pending->second.firstEvent + watch.debounce * MAX_DEBOUNCE_FACTOR);
+}
+
+void FileWatcher::AddOverflowChanges(FileWatch &watch, std::chrono::steady_clock::time_point now)
+{
+    if (!watch.fileName.empty())
+    {
+        AddPendingChange(watch, watch.fileName, now);
+        return;
+    }
+
+    DIR *dir = opendir(watch.directory.c_str());
+    if (dir == nullptr)
+    {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        if (entry->d_type == DT_REG)
+        {
+            AddPendingChange(watch, entry->d_name, now);
+        }
+    }
+    closedir(dir);
+}
+
+int FileWatcher::getTimeoutMillis()
+{
+    lock_guard<mutex> lock(watchLock);
+    bool hasPending = false;
+    chrono::steady_clock::time_point earliest;
+    for (const auto &entry : watches)
+    {
+        for (const auto &pending : entry.second.pendingChanges)
+        {
+            if (!hasPending || pending.second.deadline < earliest)
+            {
+                earliest = pending.second.deadline;
+                hasPending = true;
+            }
+        }
+    }
+
+    if (!hasPending)
+    {
+        return -1;
+    }
+
+    auto remaining = chrono::duration_cast<chrono::milliseconds>(earliest - chrono::steady_clock::now()).count();
+    // Round up so that we don't wake up just before the deadline and spin
+    return remaining < 0 ? 0 : static_cast<int>(remaining) + 1;
+}
+
+void FileWatcher::dispatchDueWatches()
+{
+    lock_guard<mutex> callbacksRunning(callbackLock);
+
+    vector<DueChange> due;
+    {
+        lock_guard<mutex> lock(watchLock);
+        auto now = chrono::steady_clock::now();
+        for (auto &entry : watches)
+        {
+            FileWatch &watch = entry.second;
+            for (auto pending = watch.pendingChanges.begin(); pending != watch.pendingChanges.end();)
+            {
+                if (pending->second.deadline > now)
+                {
+                    ++pending;
+                    continue;
+                }
+                due.push_back(
+                    DueChange{pending->first, watch.directory + pending->first, watch.maxFileSize, watch.callback});
+                pending = watch.pendingChanges.erase(pending);
+            }
+        }
+    }
+
+    for (const auto &change : due)
+    {
+        string content;
+        if (ReadFile(change.path, change.maxFileSize, content))
+        {
+            LOGM_DEBUG(TAG, "File %s changed, notifying its watcher", Sanitize(change.path).c_str());
+            change.callback(change.fileName, content);
+        }
+    }
+}
+
+bool FileWatcher::ReadFile(const std::string &path, size_t maxFileSize, std::string &content)
+{
+    if (!FileUtils::FileExists(path))
+    {
+        // The file was removed again before the end of the burst
+        return false;
+    }
+
+    size_t fileSize = FileUtils::GetFileSize(path);
+    if (fileSize > maxFileSize)
+    {
+        LOGM_ERROR(
+            TAG, "File %s is too large: %zu > %zu bytes, skipping it", Sanitize(path).c_str(), fileSize, maxFileSize);
+        return false;
+    }
+
+    ifstream file(path.c_str(), ios::binary);
+    if (!file.is_open())
+    {
+        LOGM_ERROR(TAG, "Unable to open file: '%s'", Sanitize(path).c_str());
+        return false;
+    }
+
+    content.assign((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    return true;
+}
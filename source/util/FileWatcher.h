@@ -0,0 +1,192 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_FILEWATCHER_H
+#define AWS_IOT_DEVICE_CLIENT_FILEWATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Util
+            {
+                /**
+                 * \brief Watches files for changes on a single epoll driven thread and calls back with the content of
+                 * each changed file.
+                 *
+                 * Files can be watched on their own or together with every other file of their directory. Events are
+                 * coalesced per file: a burst of writes results in a single callback carrying the content read once
+                 * the file has been quiet for the debounce window of its watch. A file that keeps changing is
+                 * still read at least every MAX_DEBOUNCE_FACTOR debounce windows.
+                 *
+                 * The parent directory of each file is watched rather than the file itself, so files that are deleted
+                 * and created again, or replaced through a rename, keep being watched.
+                 */
+                class FileWatcher
+                {
+                  public:
+                    /**
+                     * \brief Called on the watcher thread with the content of a watched file after it changed
+                     */
+                    using OnFileChangedFn = std::function<void(const std::string &content)>;
+                    /**
+                     * \brief Called on the watcher thread with the name and content of a file of a watched directory
+                     * after it changed
+                     */
+                    using OnDirectoryChangedFn =
+                        std::function<void(const std::string &fileName, const std::string &content)>;
+
+                    /**
+                     * \brief Debounce window used by features that don't need a specific one
+                     */
+                    static constexpr std::chrono::milliseconds DEFAULT_DEBOUNCE{100};
+                    /**
+                     * \brief Upper bound, in debounce windows since the first pending event, on how long a file that
+                     * keeps changing can go without being read
+                     */
+                    static constexpr int MAX_DEBOUNCE_FACTOR = 4;
+
+                    FileWatcher();
+                    ~FileWatcher();
+
+                    // Non-copyable.
+                    FileWatcher(const FileWatcher &) = delete;
+                    FileWatcher &operator=(const FileWatcher &) = delete;
+
+                    /**
+                     * \brief The file watcher shared by all features of the process
+                     */
+                    static FileWatcher &GetInstance();
+
+                    /**
+                     * \brief Start watching a file
+                     *
+                     * @param path absolute path of the file to watch. The file does not need to exist yet, but its
+                     * parent directory does.
+                     * @param debounce how long the file must be quiet before it is read
+                     * @param maxFileSize files larger than this are not read and the change is skipped
+                     * @param callback called with the content of the file after each burst of changes
+                     * @return an id that can be passed to Unwatch, or -1 if the file cannot be watched
+                     */
+                    int Watch(
+                        const std::string &path,
+                        std::chrono::milliseconds debounce,
+                        size_t maxFileSize,
+                        const OnFileChangedFn &callback);
+
+                    /**
+                     * \brief Start watching every file of a directory. Changes are coalesced per file.
+                     *
+                     * @param directory path of the directory to watch
+                     * @param debounce how long a file must be quiet before it is read
+                     * @param maxFileSize files larger than this are not read and the change is skipped
+                     * @param callback called with the name and content of a file after each burst of changes to it
+                     * @return an id that can be passed to Unwatch, or -1 if the directory cannot be watched
+                     */
+                    int WatchDirectory(
+                        const std::string &directory,
+                        std::chrono::milliseconds debounce,
+                        size_t maxFileSize,
+                        const OnDirectoryChangedFn &callback);
+
+                    /**
+                     * \brief Stop watching a file or directory. Once this returns the callback of the watch is not
+                     * running and will not be called again.
+                     *
+                     * @param watchId the id returned by Watch or WatchDirectory
+                     */
+                    void Unwatch(int watchId);
+
+                  private:
+                    static constexpr char TAG[] = "FileWatcher.cpp";
+
+                    struct PendingChange
+                    {
+                        std::chrono::steady_clock::time_point firstEvent;
+                        std::chrono::steady_clock::time_point deadline;
+                    };
+
+                    struct FileWatch
+                    {
+                        /**
+                         * \brief Watched directory, ending with a slash
+                         */
+                        std::string directory;
+                        /**
+                         * \brief Name of the watched file, or empty if every file of the directory is watched
+                         */
+                        std::string fileName;
+                        std::chrono::milliseconds debounce;
+                        size_t maxFileSize;
+                        OnDirectoryChangedFn callback;
+                        /**
+                         * \brief Files with changes that haven't been read yet, keyed by file name
+                         */
+                        std::map<std::string, PendingChange> pendingChanges;
+                    };
+
+                    struct DueChange
+                    {
+                        std::string fileName;
+                        std::string path;
+                        size_t maxFileSize;
+                        OnDirectoryChangedFn callback;
+                    };
+
+                    int inotifyFd{-1};
+                    int epollFd{-1};
+                    /**
+                     * \brief eventfd used to wake up the watcher thread when it should stop
+                     */
+                    int wakeFd{-1};
+                    std::atomic<bool> running{false};
+                    std::thread watcherThread;
+
+                    /**
+                     * \brief Lock protecting the watches and directories
+                     */
+                    std::mutex watchLock;
+                    /**
+                     * \brief Held while callbacks run so that Unwatch can wait for a running callback to finish. Must
+                     * be acquired before watchLock.
+                     */
+                    std::mutex callbackLock;
+                    int nextWatchId{0};
+                    std::map<int, FileWatch> watches;
+                    /**
+                     * \brief Watched directories keyed by their inotify watch descriptor
+                     */
+                    std::map<int, std::string> directories;
+                    /**
+                     * \brief Inotify watch descriptors keyed by watched directory
+                     */
+                    std::map<std::string, int> directoryDescriptors;
+
+                    int addWatch(FileWatch &&watch);
+                    static void AddPendingChange(
+                        FileWatch &watch,
+                        const std::string &fileName,
+                        std::chrono::steady_clock::time_point now);
+                    static void AddOverflowChanges(FileWatch &watch, std::chrono::steady_clock::time_point now);
+                    void run();
+                    void readEvents();
+                    void dispatchDueWatches();
+                    int getTimeoutMillis();
+                    static bool ReadFile(const std::string &path, size_t maxFileSize, std::string &content);
+                };
+            } // namespace Util
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_FILEWATCHER_H
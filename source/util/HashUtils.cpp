@@ -0,0 +1,31 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "HashUtils.h"
+
+using namespace std;
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Util
+            {
+                uint64_t Fnv1aBytes(const void *data, size_t size, uint64_t hash)
+                {
+                    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+                    for (size_t i = 0; i < size; i++)
+                    {
+                        hash ^= bytes[i];
+                        hash *= FNV1A_PRIME;
+                    }
+                    return hash;
+                }
+
+                uint64_t Fnv1a(const string &data, uint64_t hash) { return Fnv1aBytes(data.data(), data.size(), hash); }
+            } // namespace Util
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
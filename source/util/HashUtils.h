@@ -0,0 +1,42 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_HASHUTILS_H
+#define AWS_IOT_DEVICE_CLIENT_HASHUTILS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Util
+            {
+                constexpr uint64_t FNV1A_OFFSET_BASIS = 14695981039346656037ULL;
+                constexpr uint64_t FNV1A_PRIME = 1099511628211ULL;
+
+                /**
+                 * \brief 64-bit FNV-1a hash, which unlike std::hash is the same across builds and platforms, so it
+                 * can be persisted or used to seed random number generators
+                 *
+                 * @param data the bytes to hash
+                 * @param size the number of bytes
+                 * @param hash the hash of the bytes preceding these, to hash a sequence of values incrementally
+                 * @return the hash of the preceding bytes followed by these
+                 */
+                uint64_t Fnv1aBytes(const void *data, size_t size, uint64_t hash = FNV1A_OFFSET_BASIS);
+
+                /**
+                 * \brief 64-bit FNV-1a hash of the bytes of a string
+                 */
+                uint64_t Fnv1a(const std::string &data, uint64_t hash = FNV1A_OFFSET_BASIS);
+            } // namespace Util
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_HASHUTILS_H
@@ -0,0 +1,384 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "PoolAllocator.h"
+#include "../logging/LoggerFactory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Util;
+using namespace Aws::Iot::DeviceClient::Logging;
+
+constexpr size_t PoolAllocator::SLAB_SIZE;
+constexpr size_t PoolAllocator::MAX_POOLED_SIZE;
+constexpr size_t PoolAllocator::THREAD_CACHE_SIZE;
+
+namespace
+{
+    constexpr char TAG[] = "PoolAllocator.cpp";
+
+    constexpr size_t SIZE_CLASSES[] = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096};
+    constexpr size_t CLASS_COUNT = sizeof(SIZE_CLASSES) / sizeof(SIZE_CLASSES[0]);
+    constexpr uint32_t LARGE_CLASS = UINT32_MAX;
+    constexpr uint32_t BLOCK_MAGIC = 0x504f4f4c;
+
+    /**
+     * Precedes every allocation, keeping the payload aligned to 16 bytes like the default allocator
+     */
+    struct BlockHeader
+    {
+        uint32_t sizeClass;
+        uint32_t magic;
+        uint64_t size;
+    };
+    static_assert(sizeof(BlockHeader) == 16, "allocations must stay aligned to 16 bytes");
+
+    /**
+     * A block that is not allocated, overlaying its header
+     */
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    size_t classFor(size_t size)
+    {
+        return static_cast<size_t>(lower_bound(SIZE_CLASSES, SIZE_CLASSES + CLASS_COUNT, size) - SIZE_CLASSES);
+    }
+
+    atomic<uint64_t> nextPoolId{1};
+} // namespace
+
+struct PoolAllocator::Pool : public enable_shared_from_this<PoolAllocator::Pool>
+{
+    aws_allocator allocator;
+    aws_allocator *backing;
+    uint64_t id;
+
+    mutex lock;
+    FreeBlock *freeLists[CLASS_COUNT];
+    vector<void *> slabs;
+
+    atomic<size_t> reservedBytes{0};
+    atomic<size_t> requestedBytes{0};
+    atomic<size_t> liveAllocations{0};
+    atomic<size_t> largeAllocations{0};
+
+    explicit Pool(aws_allocator *backing);
+    ~Pool();
+
+    void *acquire(size_t size);
+    void release(void *ptr);
+    void *reallocate(void *ptr, size_t newSize);
+    /** Take up to count blocks of a size class from the shared free list, carving a new slab if it is empty **/
+    FreeBlock *takeBlocks(size_t sizeClass, size_t count, size_t &taken);
+    void returnBlocks(size_t sizeClass, FreeBlock *head, FreeBlock *tail);
+};
+
+namespace
+{
+    /**
+     * Blocks freed on a thread, kept for the allocations of the same thread
+     */
+    struct ThreadCache
+    {
+        shared_ptr<PoolAllocator::Pool> pool;
+        FreeBlock *heads[CLASS_COUNT]{};
+        size_t counts[CLASS_COUNT]{};
+
+        ~ThreadCache()
+        {
+            if (pool == nullptr)
+            {
+                return;
+            }
+            for (size_t sizeClass = 0; sizeClass < CLASS_COUNT; sizeClass++)
+            {
+                FreeBlock *tail = heads[sizeClass];
+                while (tail != nullptr && tail->next != nullptr)
+                {
+                    tail = tail->next;
+                }
+                if (tail != nullptr)
+                {
+                    pool->returnBlocks(sizeClass, heads[sizeClass], tail);
+                }
+            }
+        }
+    };
+
+    thread_local unordered_map<uint64_t, ThreadCache> threadCaches;
+    thread_local uint64_t lastPoolId{0};
+    thread_local ThreadCache *lastCache{nullptr};
+
+    ThreadCache &cacheFor(PoolAllocator::Pool *pool)
+    {
+        if (lastPoolId != pool->id)
+        {
+            ThreadCache &cache = threadCaches[pool->id];
+            if (cache.pool == nullptr)
+            {
+                cache.pool = pool->shared_from_this();
+            }
+            lastPoolId = pool->id;
+            lastCache = &cache;
+        }
+        return *lastCache;
+    }
+
+    void *poolAcquire(aws_allocator *allocator, size_t size)
+    {
+        return static_cast<PoolAllocator::Pool *>(allocator->impl)->acquire(size);
+    }
+
+    void poolRelease(aws_allocator *allocator, void *ptr)
+    {
+        static_cast<PoolAllocator::Pool *>(allocator->impl)->release(ptr);
+    }
+
+    void *poolRealloc(aws_allocator *allocator, void *oldptr, size_t, size_t newsize)
+    {
+        return static_cast<PoolAllocator::Pool *>(allocator->impl)->reallocate(oldptr, newsize);
+    }
+} // namespace
+
+PoolAllocator::Pool::Pool(aws_allocator *backing) : backing(backing), id(nextPoolId++)
+{
+    memset(&allocator, 0, sizeof(allocator));
+    allocator.mem_acquire = poolAcquire;
+    allocator.mem_release = poolRelease;
+    allocator.mem_realloc = poolRealloc;
+    // aws_mem_calloc falls back to acquiring and clearing the memory
+    allocator.mem_calloc = nullptr;
+    allocator.impl = this;
+    fill(freeLists, freeLists + CLASS_COUNT, nullptr);
+}
+
+PoolAllocator::Pool::~Pool()
+{
+    for (void *slab : slabs)
+    {
+        aws_mem_release(backing, slab);
+    }
+}
+
+FreeBlock *PoolAllocator::Pool::takeBlocks(size_t sizeClass, size_t count, size_t &taken)
+{
+    lock_guard<mutex> guard(lock);
+    if (freeLists[sizeClass] == nullptr)
+    {
+        void *slab = aws_mem_acquire(backing, SLAB_SIZE);
+        if (slab == nullptr)
+        {
+            taken = 0;
+            return nullptr;
+        }
+        slabs.push_back(slab);
+        reservedBytes += SLAB_SIZE;
+
+        size_t stride = sizeof(BlockHeader) + SIZE_CLASSES[sizeClass];
+        char *block = static_cast<char *>(slab);
+        for (size_t i = 0; i < SLAB_SIZE / stride; i++, block += stride)
+        {
+            auto freeBlock = reinterpret_cast<FreeBlock *>(block);
+            freeBlock->next = freeLists[sizeClass];
+            freeLists[sizeClass] = freeBlock;
+        }
+    }
+
+    FreeBlock *head = freeLists[sizeClass];
+    FreeBlock *tail = head;
+    taken = 1;
+    while (taken < count && tail->next != nullptr)
+    {
+        tail = tail->next;
+        taken++;
+    }
+    freeLists[sizeClass] = tail->next;
+    tail->next = nullptr;
+    return head;
+}
+
+void PoolAllocator::Pool::returnBlocks(size_t sizeClass, FreeBlock *head, FreeBlock *tail)
+{
+    lock_guard<mutex> guard(lock);
+    tail->next = freeLists[sizeClass];
+    freeLists[sizeClass] = head;
+}
+
+void *PoolAllocator::Pool::acquire(size_t size)
+{
+    size_t sizeClass = classFor(size);
+    BlockHeader *header;
+    if (sizeClass == CLASS_COUNT)
+    {
+        header = static_cast<BlockHeader *>(aws_mem_acquire(backing, sizeof(BlockHeader) + size));
+        if (header == nullptr)
+        {
+            return nullptr;
+        }
+        header->sizeClass = LARGE_CLASS;
+        reservedBytes += sizeof(BlockHeader) + size;
+        largeAllocations++;
+    }
+    else
+    {
+        ThreadCache &cache = cacheFor(this);
+        if (cache.heads[sizeClass] == nullptr)
+        {
+            cache.heads[sizeClass] = takeBlocks(sizeClass, THREAD_CACHE_SIZE / 2, cache.counts[sizeClass]);
+            if (cache.heads[sizeClass] == nullptr)
+            {
+                return nullptr;
+            }
+        }
+        FreeBlock *block = cache.heads[sizeClass];
+        cache.heads[sizeClass] = block->next;
+        cache.counts[sizeClass]--;
+
+        header = reinterpret_cast<BlockHeader *>(block);
+        header->sizeClass = static_cast<uint32_t>(sizeClass);
+    }
+    header->magic = BLOCK_MAGIC;
+    header->size = size;
+    requestedBytes += size;
+    liveAllocations++;
+    return header + 1;
+}
+
+void PoolAllocator::Pool::release(void *ptr)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+    BlockHeader *header = static_cast<BlockHeader *>(ptr) - 1;
+    if (header->magic != BLOCK_MAGIC)
+    {
+        LOG_ERROR(TAG, "Ignoring the release of memory that was not allocated by the pool or was already released");
+        return;
+    }
+    header->magic = 0;
+    requestedBytes -= header->size;
+    liveAllocations--;
+
+    if (header->sizeClass == LARGE_CLASS)
+    {
+        reservedBytes -= sizeof(BlockHeader) + header->size;
+        largeAllocations--;
+        aws_mem_release(backing, header);
+        return;
+    }
+
+    size_t sizeClass = header->sizeClass;
+    ThreadCache &cache = cacheFor(this);
+    auto block = reinterpret_cast<FreeBlock *>(header);
+    block->next = cache.heads[sizeClass];
+    cache.heads[sizeClass] = block;
+    if (++cache.counts[sizeClass] > THREAD_CACHE_SIZE)
+    {
+        // Keep half of the cache for this thread and hand the other half to threads that allocate more than they free
+        FreeBlock *tail = cache.heads[sizeClass];
+        for (size_t i = 1; i < THREAD_CACHE_SIZE / 2; i++)
+        {
+            tail = tail->next;
+        }
+        FreeBlock *returned = tail->next;
+        tail->next = nullptr;
+        cache.counts[sizeClass] = THREAD_CACHE_SIZE / 2;
+
+        FreeBlock *returnedTail = returned;
+        while (returnedTail->next != nullptr)
+        {
+            returnedTail = returnedTail->next;
+        }
+        returnBlocks(sizeClass, returned, returnedTail);
+    }
+}
+
+void *PoolAllocator::Pool::reallocate(void *ptr, size_t newSize)
+{
+    if (ptr == nullptr)
+    {
+        return acquire(newSize);
+    }
+    if (newSize == 0)
+    {
+        release(ptr);
+        return nullptr;
+    }
+
+    BlockHeader *header = static_cast<BlockHeader *>(ptr) - 1;
+    if (header->sizeClass != LARGE_CLASS && classFor(newSize) == header->sizeClass)
+    {
+        // The block already has room for the new size
+        requestedBytes += newSize;
+        requestedBytes -= header->size;
+        header->size = newSize;
+        return ptr;
+    }
+
+    void *moved = acquire(newSize);
+    if (moved == nullptr)
+    {
+        return nullptr;
+    }
+    memcpy(moved, ptr, min<size_t>(header->size, newSize));
+    release(ptr);
+    return moved;
+}
+
+PoolAllocator::PoolAllocator(aws_allocator *backing) : pool(make_shared<Pool>(backing)) {}
+
+PoolAllocator::~PoolAllocator()
+{
+    // Blocks cached by other threads are returned when those threads exit, which keeps the pool alive until then
+    if (lastPoolId == pool->id)
+    {
+        lastPoolId = 0;
+        lastCache = nullptr;
+    }
+    threadCaches.erase(pool->id);
+
+    if (pool->liveAllocations > 0)
+    {
+        LOGM_WARN(
+            TAG,
+            "Leaving the pool allocator behind since %zu allocations have not been released",
+            pool->liveAllocations.load());
+        new shared_ptr<Pool>(pool);
+    }
+}
+
+aws_allocator *PoolAllocator::GetAllocator()
+{
+    return &pool->allocator;
+}
+
+PoolAllocator::Stats PoolAllocator::GetStats() const
+{
+    Stats stats;
+    stats.reservedBytes = pool->reservedBytes;
+    stats.requestedBytes = pool->requestedBytes;
+    stats.liveAllocations = pool->liveAllocations;
+    stats.largeAllocations = pool->largeAllocations;
+    lock_guard<mutex> guard(pool->lock);
+    stats.slabs = pool->slabs.size();
+    return stats;
+}
+
+double PoolAllocator::GetFragmentation() const
+{
+    Stats stats = GetStats();
+    if (stats.reservedBytes == 0)
+    {
+        return 0;
+    }
+    return 1.0 - static_cast<double>(stats.requestedBytes) / static_cast<double>(stats.reservedBytes);
+}
@@ -0,0 +1,86 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_POOLALLOCATOR_H
+#define AWS_IOT_DEVICE_CLIENT_POOLALLOCATOR_H
+
+#include <aws/common/allocator.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Util
+            {
+                /**
+                 * \brief An aws_allocator that serves small allocations from pools of fixed size blocks.
+                 *
+                 * Allocations of up to MAX_POOLED_SIZE bytes are rounded up to one of a few size classes. Each size
+                 * class carves its blocks out of slabs of SLAB_SIZE bytes taken from the backing allocator, so blocks
+                 * of different sizes never interleave and the holes left by a long running mix of allocation sizes can
+                 * always be reused. Freed blocks go to a cache of the calling thread first, which allocations on that
+                 * thread take from without locking, and only overflow to the shared free lists of the pool. Larger
+                 * allocations go straight to the backing allocator.
+                 *
+                 * Slabs are kept until the allocator is destroyed. If allocations are still outstanding at that point,
+                 * the pool is left behind so that they can still be released.
+                 */
+                class PoolAllocator
+                {
+                  public:
+                    static constexpr size_t SLAB_SIZE = 64 * 1024;
+                    static constexpr size_t MAX_POOLED_SIZE = 4096;
+                    /** Blocks a thread caches per size class before returning half of them to the pool **/
+                    static constexpr size_t THREAD_CACHE_SIZE = 64;
+
+                    struct Stats
+                    {
+                        /** Bytes taken from the backing allocator, including slabs and large allocations **/
+                        size_t reservedBytes{0};
+                        /** Bytes requested by the allocations that have not been released **/
+                        size_t requestedBytes{0};
+                        size_t liveAllocations{0};
+                        /** Live allocations too large to be pooled **/
+                        size_t largeAllocations{0};
+                        size_t slabs{0};
+                    };
+
+                    /**
+                     * @param backing the allocator slabs and large allocations are taken from
+                     */
+                    explicit PoolAllocator(aws_allocator *backing);
+                    ~PoolAllocator();
+
+                    // Non-copyable.
+                    PoolAllocator(const PoolAllocator &) = delete;
+                    PoolAllocator &operator=(const PoolAllocator &) = delete;
+
+                    /**
+                     * \brief The aws_allocator to hand to the CRT, valid for the lifetime of this object
+                     */
+                    aws_allocator *GetAllocator();
+
+                    Stats GetStats() const;
+
+                    /**
+                     * \brief The share of reserved bytes that is not used by live allocations, from 0 to 1
+                     */
+                    double GetFragmentation() const;
+
+                    /** State shared with the thread caches, which may outlive this object **/
+                    struct Pool;
+
+                  private:
+                    std::shared_ptr<Pool> pool;
+                };
+            } // namespace Util
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_POOLALLOCATOR_H
@@ -0,0 +1,168 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "PublishGateway.h"
+#include "../logging/LoggerFactory.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Util;
+using namespace Aws::Iot::DeviceClient::Logging;
+
+constexpr size_t PublishGateway::PRIORITY_COUNT;
+constexpr char PublishGateway::TAG[];
+
+static const char *PRIORITY_NAMES[PublishGateway::PRIORITY_COUNT] = {"control", "telemetry", "bulk"};
+
+PublishGateway::PublishGateway(uint32_t messagesPerSecond, uint32_t bytesPerSecond, size_t maxQueueDepth)
+    : messagesPerSecond(messagesPerSecond), bytesPerSecond(bytesPerSecond), maxQueueDepth(maxQueueDepth),
+      messageTokens(messagesPerSecond), byteTokens(bytesPerSecond), lastRefill(chrono::steady_clock::now())
+{
+    gatewayThread = thread(&PublishGateway::run, this);
+}
+
+PublishGateway::~PublishGateway()
+{
+    uint64_t discarded = 0;
+    {
+        lock_guard<mutex> lock(gatewayLock);
+        running = false;
+        for (const auto &queue : queues)
+        {
+            discarded += queue.size();
+        }
+    }
+    gatewayCondition.notify_all();
+    gatewayThread.join();
+
+    if (discarded > 0)
+    {
+        LOGM_WARN(TAG, "Discarded %llu queued message(s) on shutdown", static_cast<unsigned long long>(discarded));
+    }
+}
+
+bool PublishGateway::Submit(Priority priority, size_t size, SendFn send)
+{
+    auto index = static_cast<size_t>(priority);
+    {
+        unique_lock<mutex> lock(gatewayLock);
+        if (!running)
+        {
+            metrics[index].dropped++;
+            return false;
+        }
+
+        if (!hasQueuedMessages() && takeTokens(size) == chrono::steady_clock::duration::zero())
+        {
+            metrics[index].sent++;
+            lock.unlock();
+            send();
+            return true;
+        }
+
+        if (queues[index].size() >= maxQueueDepth)
+        {
+            metrics[index].dropped++;
+            lock.unlock();
+            LOGM_WARN(
+                TAG,
+                "Dropped %s message of %zu bytes, %zu messages are already waiting",
+                PRIORITY_NAMES[index],
+                size,
+                maxQueueDepth);
+            return false;
+        }
+
+        queues[index].push_back({size, move(send)});
+        metrics[index].maxQueueDepth = max(metrics[index].maxQueueDepth, queues[index].size());
+    }
+    gatewayCondition.notify_one();
+    return true;
+}
+
+PublishGateway::Metrics PublishGateway::GetMetrics(Priority priority) const
+{
+    auto index = static_cast<size_t>(priority);
+    lock_guard<mutex> lock(gatewayLock);
+    Metrics result = metrics[index];
+    result.queueDepth = queues[index].size();
+    return result;
+}
+
+void PublishGateway::run()
+{
+    unique_lock<mutex> lock(gatewayLock);
+    while (running)
+    {
+        auto queue = find_if(begin(queues), end(queues), [](const deque<QueuedMessage> &q) { return !q.empty(); });
+        if (queue == end(queues))
+        {
+            gatewayCondition.wait(lock);
+            continue;
+        }
+
+        auto wait = takeTokens(queue->front().size);
+        if (wait != chrono::steady_clock::duration::zero())
+        {
+            // Woken early by a new message, which may be of a higher priority than the one waiting
+            gatewayCondition.wait_for(lock, wait);
+            continue;
+        }
+
+        SendFn send = move(queue->front().send);
+        queue->pop_front();
+        metrics[queue - begin(queues)].sent++;
+
+        lock.unlock();
+        send();
+        lock.lock();
+    }
+}
+
+void PublishGateway::refill(chrono::steady_clock::time_point now)
+{
+    double elapsed = chrono::duration<double>(now - lastRefill).count();
+    lastRefill = now;
+    // Buckets hold at most one second worth of tokens
+    messageTokens = min(messagesPerSecond, messageTokens + elapsed * messagesPerSecond);
+    byteTokens = min(bytesPerSecond, byteTokens + elapsed * bytesPerSecond);
+}
+
+chrono::steady_clock::duration PublishGateway::takeTokens(size_t size)
+{
+    refill(chrono::steady_clock::now());
+
+    // A message larger than the byte bucket can hold goes out once the bucket is full, leaving it in debt
+    double bytesNeeded = min(static_cast<double>(size), bytesPerSecond);
+    double waitSeconds = 0;
+    if (messagesPerSecond > 0 && messageTokens < 1)
+    {
+        waitSeconds = (1 - messageTokens) / messagesPerSecond;
+    }
+    if (bytesPerSecond > 0 && byteTokens < bytesNeeded)
+    {
+        waitSeconds = max(waitSeconds, (bytesNeeded - byteTokens) / bytesPerSecond);
+    }
+
+    if (waitSeconds > 0)
+    {
+        auto wait = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(waitSeconds));
+        return max(wait, chrono::steady_clock::duration(1));
+    }
+
+    if (messagesPerSecond > 0)
+    {
+        messageTokens -= 1;
+    }
+    if (bytesPerSecond > 0)
+    {
+        byteTokens -= static_cast<double>(size);
+    }
+    return chrono::steady_clock::duration::zero();
+}
+
+bool PublishGateway::hasQueuedMessages() const
+{
+    return any_of(begin(queues), end(queues), [](const deque<QueuedMessage> &q) { return !q.empty(); });
+}
@@ -0,0 +1,131 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_PUBLISHGATEWAY_H
+#define AWS_IOT_DEVICE_CLIENT_PUBLISHGATEWAY_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Util
+            {
+                /**
+                 * \brief Rate limits the publishes of every feature sharing the MQTT connection and sends them in
+                 * strict priority order.
+                 *
+                 * A token bucket limits both the number of messages and the number of bytes sent per second, holding
+                 * up to one second worth of each so that short bursts go out without delay. Publishes that find
+                 * tokens available and nothing queued ahead of them are sent immediately on the calling thread. The
+                 * others are queued per priority and sent from the gateway thread as tokens become available, always
+                 * draining higher priorities first.
+                 */
+                class PublishGateway
+                {
+                  public:
+                    enum class Priority
+                    {
+                        /** Job status updates and other messages the device relies on to be managed **/
+                        CONTROL = 0,
+                        /** Shadow updates and sample publishes **/
+                        TELEMETRY = 1,
+                        /** Sensor batches and other high volume data **/
+                        BULK = 2
+                    };
+                    static constexpr size_t PRIORITY_COUNT = 3;
+
+                    /**
+                     * \brief Hands a message to the MQTT connection. Called at most once, either on the thread that
+                     * submitted the message or on the gateway thread.
+                     */
+                    using SendFn = std::function<void()>;
+
+                    struct Metrics
+                    {
+                        /** Messages waiting for tokens **/
+                        size_t queueDepth{0};
+                        /** Largest queue depth seen since the gateway was created **/
+                        size_t maxQueueDepth{0};
+                        uint64_t sent{0};
+                        /** Messages rejected because the queue was full **/
+                        uint64_t dropped{0};
+                    };
+
+                    /**
+                     * \brief Create a gateway and start its thread
+                     *
+                     * @param messagesPerSecond sustained message rate, or 0 for no limit
+                     * @param bytesPerSecond sustained payload rate, or 0 for no limit
+                     * @param maxQueueDepth number of messages each priority can hold before new ones are rejected
+                     */
+                    PublishGateway(uint32_t messagesPerSecond, uint32_t bytesPerSecond, size_t maxQueueDepth);
+                    ~PublishGateway();
+
+                    // Non-copyable.
+                    PublishGateway(const PublishGateway &) = delete;
+                    PublishGateway &operator=(const PublishGateway &) = delete;
+
+                    /**
+                     * \brief Send a message as soon as the rate limits and higher priority messages allow it
+                     *
+                     * @param priority the priority class of the message
+                     * @param size size of the message payload in bytes
+                     * @param send called when the message may be sent
+                     * @return false if the queue of the priority is full and the message was dropped
+                     */
+                    bool Submit(Priority priority, size_t size, SendFn send);
+
+                    Metrics GetMetrics(Priority priority) const;
+
+                  private:
+                    static constexpr char TAG[] = "PublishGateway.cpp";
+
+                    struct QueuedMessage
+                    {
+                        size_t size;
+                        SendFn send;
+                    };
+
+                    const double messagesPerSecond;
+                    const double bytesPerSecond;
+                    const size_t maxQueueDepth;
+
+                    /**
+                     * \brief Lock protecting the token buckets, queues and metrics
+                     */
+                    mutable std::mutex gatewayLock;
+                    std::condition_variable gatewayCondition;
+                    bool running{true};
+                    double messageTokens;
+                    double byteTokens;
+                    std::chrono::steady_clock::time_point lastRefill;
+                    std::deque<QueuedMessage> queues[PRIORITY_COUNT];
+                    Metrics metrics[PRIORITY_COUNT];
+                    std::thread gatewayThread;
+
+                    void run();
+                    void refill(std::chrono::steady_clock::time_point now);
+                    /**
+                     * \brief Take the tokens of a message if enough are available
+                     *
+                     * @return zero if the tokens were taken, otherwise how long until enough are available
+                     */
+                    std::chrono::steady_clock::duration takeTokens(size_t size);
+                    bool hasQueuedMessages() const;
+                };
+            } // namespace Util
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_PUBLISHGATEWAY_H
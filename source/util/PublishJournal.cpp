@@ -0,0 +1,470 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "PublishJournal.h"
+#include "../logging/LoggerFactory.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Util;
+using namespace Aws::Iot::DeviceClient::Logging;
+
+constexpr size_t PublishJournal::MAX_SEGMENT_SIZE;
+constexpr char PublishJournal::TAG[];
+
+constexpr char SEGMENT_PREFIX[] = "segment-";
+constexpr char SEGMENT_SUFFIX[] = ".log";
+constexpr char RECORD_PUBLISH = 'P';
+constexpr char RECORD_ACKNOWLEDGE = 'A';
+// Body length and CRC-32 of the type and body
+constexpr size_t RECORD_HEADER_SIZE = 8;
+
+static void PutUint(string &out, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++)
+    {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static uint64_t GetUint(const char *in, size_t bytes)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++)
+    {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    }
+    return value;
+}
+
+static bool WriteAll(int fd, const string &data)
+{
+    size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t result = write(fd, data.data() + written, data.size() - written);
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+PublishJournal::PublishJournal(const std::string &directory, size_t maxSize)
+    : directory(directory.back() == '/' ? directory : directory + "/"), maxSize(maxSize),
+      segmentSize(min(MAX_SEGMENT_SIZE, max<size_t>(maxSize / 4, 1)))
+{
+}
+
+PublishJournal::~PublishJournal()
+{
+    {
+        lock_guard<mutex> lock(journalLock);
+        running = false;
+    }
+    writerCondition.notify_all();
+    committedCondition.notify_all();
+    if (writerThread.joinable())
+    {
+        writerThread.join();
+    }
+    if (segmentFd != -1)
+    {
+        close(segmentFd);
+    }
+}
+
+bool PublishJournal::Open()
+{
+    vector<uint64_t> indices;
+    DIR *dir = opendir(directory.c_str());
+    if (dir == nullptr)
+    {
+        LOGM_ERROR(TAG, "Failed to open publish journal directory %s: %s", directory.c_str(), strerror(errno));
+        return false;
+    }
+    const size_t prefixLength = strlen(SEGMENT_PREFIX);
+    while (struct dirent *entry = readdir(dir))
+    {
+        string name = entry->d_name;
+        uint64_t index;
+        if (name.compare(0, prefixLength, SEGMENT_PREFIX) == 0 &&
+            sscanf(name.c_str() + prefixLength, "%" SCNu64, &index) == 1 &&
+            name == segmentPath(index).substr(directory.size()))
+        {
+            indices.push_back(index);
+        }
+    }
+    closedir(dir);
+    sort(indices.begin(), indices.end());
+
+    lock_guard<mutex> lock(journalLock);
+    for (uint64_t index : indices)
+    {
+        segments.push_back({index, 0, 0});
+        if (!loadSegment(segments.back()))
+        {
+            return false;
+        }
+    }
+    if (!pending.empty())
+    {
+        LOGM_INFO(TAG, "Loaded %zu unacknowledged publish(es) from the publish journal", pending.size());
+    }
+    committedSequence = nextSequence;
+
+    // Never append to a segment left by a previous run, whose last record may be torn
+    if (!openSegment(segments.empty() ? 1 : segments.back().index + 1))
+    {
+        return false;
+    }
+    deleteAcknowledgedSegments();
+
+    running = true;
+    writerThread = thread(&PublishJournal::run, this);
+    return true;
+}
+
+uint64_t PublishJournal::Append(const Record &record)
+{
+    string body;
+    unique_lock<mutex> lock(journalLock);
+    if (!running || failed)
+    {
+        return 0;
+    }
+
+    uint64_t sequence = nextSequence;
+    PutUint(body, sequence, 8);
+    PutUint(body, static_cast<uint64_t>(record.qos), 1);
+    PutUint(body, static_cast<uint64_t>(record.priority), 1);
+    PutUint(body, record.topic.size(), 4);
+    body.append(record.topic);
+    body.append(record.payload);
+
+    if (diskSize() + RECORD_HEADER_SIZE + 1 + body.size() > maxSize)
+    {
+        LOGM_WARN(TAG, "Publish journal is full, not journaling publish to %s", record.topic.c_str());
+        return 0;
+    }
+
+    nextSequence++;
+    AppendRecord(batch, RECORD_PUBLISH, body);
+    batchSequences.push_back(sequence);
+    pending[sequence] = {0, true, record};
+    writerCondition.notify_one();
+
+    committedCondition.wait(lock, [this, sequence] { return committedSequence > sequence || failed || !running; });
+    if (committedSequence > sequence)
+    {
+        return sequence;
+    }
+    pending.erase(sequence);
+    return 0;
+}
+
+void PublishJournal::Acknowledge(uint64_t sequence)
+{
+    lock_guard<mutex> lock(journalLock);
+    auto publish = pending.find(sequence);
+    if (publish == pending.end())
+    {
+        return;
+    }
+
+    for (auto &segment : segments)
+    {
+        if (segment.index == publish->second.segment)
+        {
+            segment.unacknowledged--;
+            break;
+        }
+    }
+    pending.erase(publish);
+
+    string body;
+    PutUint(body, sequence, 8);
+    AppendRecord(batch, RECORD_ACKNOWLEDGE, body);
+    writerCondition.notify_one();
+}
+
+void PublishJournal::Release(uint64_t sequence)
+{
+    lock_guard<mutex> lock(journalLock);
+    auto publish = pending.find(sequence);
+    if (publish != pending.end())
+    {
+        publish->second.inFlight = false;
+    }
+}
+
+void PublishJournal::Replay(const ReplayFn &callback)
+{
+    vector<pair<uint64_t, Record>> replayed;
+    {
+        lock_guard<mutex> lock(journalLock);
+        for (auto &publish : pending)
+        {
+            if (!publish.second.inFlight)
+            {
+                publish.second.inFlight = true;
+                replayed.emplace_back(publish.first, publish.second.record);
+            }
+        }
+    }
+
+    if (!replayed.empty())
+    {
+        LOGM_INFO(TAG, "Replaying %zu publish(es) from the publish journal", replayed.size());
+    }
+    for (const auto &publish : replayed)
+    {
+        callback(publish.first, publish.second);
+    }
+}
+
+size_t PublishJournal::GetPendingCount() const
+{
+    lock_guard<mutex> lock(journalLock);
+    return pending.size();
+}
+
+void PublishJournal::run()
+{
+    unique_lock<mutex> lock(journalLock);
+    while (true)
+    {
+        writerCondition.wait(lock, [this] { return !batch.empty() || !running; });
+        if (batch.empty())
+        {
+            break;
+        }
+
+        if (segments.back().size > 0 && segments.back().size + batch.size() > segmentSize &&
+            !openSegment(segments.back().index + 1))
+        {
+            failed = true;
+            committedCondition.notify_all();
+            break;
+        }
+
+        string data;
+        data.swap(batch);
+        vector<uint64_t> sequences;
+        sequences.swap(batchSequences);
+        int fd = segmentFd;
+
+        // Appends made while this batch is written are committed together with the next one
+        lock.unlock();
+        bool written = WriteAll(fd, data);
+        // Acknowledgements alone are not worth a flush, they only prevent duplicates after a restart
+        if (written && !sequences.empty())
+        {
+            written = fdatasync(fd) == 0;
+        }
+        int error = errno;
+        lock.lock();
+
+        if (!written)
+        {
+            LOGM_ERROR(TAG, "Failed to write to the publish journal: %s", strerror(error));
+            failed = true;
+            committedCondition.notify_all();
+            break;
+        }
+
+        Segment &segment = segments.back();
+        segment.size += data.size();
+        for (uint64_t sequence : sequences)
+        {
+            auto publish = pending.find(sequence);
+            if (publish != pending.end())
+            {
+                publish->second.segment = segment.index;
+                segment.unacknowledged++;
+            }
+        }
+        if (!sequences.empty())
+        {
+            committedSequence = sequences.back() + 1;
+        }
+        deleteAcknowledgedSegments();
+        committedCondition.notify_all();
+    }
+}
+
+bool PublishJournal::openSegment(uint64_t index)
+{
+    string path = segmentPath(index);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd == -1)
+    {
+        LOGM_ERROR(TAG, "Failed to create publish journal segment %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    // Make the new segment itself durable, not only what is written to it
+    int dirFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd != -1)
+    {
+        fsync(dirFd);
+        close(dirFd);
+    }
+
+    if (segmentFd != -1)
+    {
+        close(segmentFd);
+    }
+    segmentFd = fd;
+    segments.push_back({index, 0, 0});
+    return true;
+}
+
+void PublishJournal::deleteAcknowledgedSegments()
+{
+    // Oldest first, since acknowledgements of a segment's publishes may be logged in the segments after it
+    while (segments.size() > 1 && segments.front().unacknowledged == 0)
+    {
+        string path = segmentPath(segments.front().index);
+        if (remove(path.c_str()) != 0)
+        {
+            LOGM_WARN(TAG, "Failed to delete publish journal segment %s: %s", path.c_str(), strerror(errno));
+        }
+        segments.pop_front();
+    }
+}
+
+bool PublishJournal::loadSegment(Segment &segment)
+{
+    string path = segmentPath(segment.index);
+    ifstream file(path, ios::binary);
+    if (!file)
+    {
+        LOGM_ERROR(TAG, "Failed to read publish journal segment %s", path.c_str());
+        return false;
+    }
+    string content((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    segment.size = content.size();
+
+    size_t offset = 0;
+    while (offset + RECORD_HEADER_SIZE + 1 <= content.size())
+    {
+        auto length = static_cast<size_t>(GetUint(content.data() + offset, 4));
+        auto crc = static_cast<uint32_t>(GetUint(content.data() + offset + 4, 4));
+        const char *record = content.data() + offset + RECORD_HEADER_SIZE;
+        if (offset + RECORD_HEADER_SIZE + 1 + length > content.size() || Crc32(record, length + 1) != crc)
+        {
+            break;
+        }
+
+        const char *body = record + 1;
+        uint64_t sequence = length >= 8 ? GetUint(body, 8) : 0;
+        if (*record == RECORD_PUBLISH && length >= 14 && 14 + GetUint(body + 10, 4) <= length)
+        {
+            auto topicLength = static_cast<size_t>(GetUint(body + 10, 4));
+            PendingPublish publish{segment.index, false, Record()};
+            publish.record.qos = static_cast<int>(GetUint(body + 8, 1));
+            publish.record.priority = static_cast<PublishGateway::Priority>(
+                min<uint64_t>(GetUint(body + 9, 1), PublishGateway::PRIORITY_COUNT - 1));
+            publish.record.topic.assign(body + 14, topicLength);
+            publish.record.payload.assign(body + 14 + topicLength, length - 14 - topicLength);
+            pending[sequence] = publish;
+            segment.unacknowledged++;
+            nextSequence = max(nextSequence, sequence + 1);
+        }
+        else if (*record == RECORD_ACKNOWLEDGE && length == 8)
+        {
+            auto publish = pending.find(sequence);
+            if (publish != pending.end())
+            {
+                for (auto &loadedSegment : segments)
+                {
+                    if (loadedSegment.index == publish->second.segment)
+                    {
+                        loadedSegment.unacknowledged--;
+                        break;
+                    }
+                }
+                pending.erase(publish);
+            }
+        }
+        offset += RECORD_HEADER_SIZE + 1 + length;
+    }
+
+    if (offset != content.size())
+    {
+        LOGM_WARN(
+            TAG,
+            "Ignoring %zu bytes of incomplete or corrupt records at the end of publish journal segment %s",
+            content.size() - offset,
+            path.c_str());
+    }
+    return true;
+}
+
+size_t PublishJournal::diskSize() const
+{
+    size_t size = batch.size();
+    for (const auto &segment : segments)
+    {
+        size += segment.size;
+    }
+    return size;
+}
+
+std::string PublishJournal::segmentPath(uint64_t index) const
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%s%020" PRIu64 "%s", SEGMENT_PREFIX, index, SEGMENT_SUFFIX);
+    return directory + name;
+}
+
+void PublishJournal::AppendRecord(std::string &batch, char type, const std::string &body)
+{
+    string record;
+    record.push_back(type);
+    record.append(body);
+    PutUint(batch, body.size(), 4);
+    PutUint(batch, Crc32(record.data(), record.size()), 4);
+    batch.append(record);
+}
+
+uint32_t PublishJournal::Crc32(const char *data, size_t length)
+{
+    static const vector<uint32_t> table = [] {
+        vector<uint32_t> entries(256);
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            entries[i] = crc;
+        }
+        return entries;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
@@ -0,0 +1,164 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_PUBLISHJOURNAL_H
+#define AWS_IOT_DEVICE_CLIENT_PUBLISHJOURNAL_H
+
+#include "PublishGateway.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Util
+            {
+                /**
+                 * \brief Durable journal of outbound publishes that survives restarts of the Device Client.
+                 *
+                 * Publishes are appended to a log split into segment files and are replayed until they are
+                 * acknowledged. Appends are group committed: a single writer thread writes and fsyncs everything
+                 * appended while the previous fsync was in progress, so concurrent appenders share the cost of a
+                 * flush. Acknowledgements are logged as well so that acknowledged publishes are not replayed after a
+                 * restart; since they are not flushed on their own, a crash may replay a few publishes that had been
+                 * acknowledged. Segments are deleted, oldest first, once every publish in them is acknowledged.
+                 */
+                class PublishJournal
+                {
+                  public:
+                    struct Record
+                    {
+                        std::string topic;
+                        int qos{1};
+                        PublishGateway::Priority priority{PublishGateway::Priority::TELEMETRY};
+                        std::string payload;
+                    };
+
+                    /**
+                     * \brief Called for each publish to replay with its sequence number
+                     */
+                    using ReplayFn = std::function<void(uint64_t sequence, const Record &record)>;
+
+                    /**
+                     * \brief Largest segment file, unless the journal is too small to hold several of them
+                     */
+                    static constexpr size_t MAX_SEGMENT_SIZE = 1024 * 1024;
+
+                    /**
+                     * @param directory directory holding the segment files, which must exist
+                     * @param maxSize bytes the segment files may take up before new publishes are rejected
+                     */
+                    PublishJournal(const std::string &directory, size_t maxSize);
+                    ~PublishJournal();
+
+                    // Non-copyable.
+                    PublishJournal(const PublishJournal &) = delete;
+                    PublishJournal &operator=(const PublishJournal &) = delete;
+
+                    /**
+                     * \brief Load the publishes left unacknowledged by previous runs and start the writer thread
+                     *
+                     * @return false if the journal cannot be written to
+                     */
+                    bool Open();
+
+                    /**
+                     * \brief Durably append a publish. Blocks until the publish has been flushed to disk.
+                     *
+                     * @return the sequence number of the publish, or 0 if the journal is full or could not be written
+                     */
+                    uint64_t Append(const Record &record);
+
+                    /**
+                     * \brief Drop a publish from the journal once the broker has acknowledged it
+                     */
+                    void Acknowledge(uint64_t sequence);
+
+                    /**
+                     * \brief Make a publish that failed eligible for the next replay
+                     */
+                    void Release(uint64_t sequence);
+
+                    /**
+                     * \brief Call back, in append order, for every unacknowledged publish that is not already being
+                     * published, and consider them being published until they are acknowledged or released
+                     */
+                    void Replay(const ReplayFn &callback);
+
+                    /**
+                     * \brief Number of unacknowledged publishes
+                     */
+                    size_t GetPendingCount() const;
+
+                  private:
+                    static constexpr char TAG[] = "PublishJournal.cpp";
+
+                    struct Segment
+                    {
+                        uint64_t index;
+                        size_t size;
+                        /** Number of publishes in the segment that have not been acknowledged **/
+                        size_t unacknowledged;
+                    };
+
+                    struct PendingPublish
+                    {
+                        uint64_t segment;
+                        bool inFlight;
+                        Record record;
+                    };
+
+                    const std::string directory;
+                    const size_t maxSize;
+                    const size_t segmentSize;
+
+                    /**
+                     * \brief Lock protecting everything below
+                     */
+                    mutable std::mutex journalLock;
+                    std::condition_variable writerCondition;
+                    std::condition_variable committedCondition;
+                    bool running{false};
+                    bool failed{false};
+                    int segmentFd{-1};
+                    /** Oldest first, the last one being written to **/
+                    std::deque<Segment> segments;
+                    std::map<uint64_t, PendingPublish> pending;
+                    uint64_t nextSequence{1};
+                    /** Sequence numbers below this one are on disk **/
+                    uint64_t committedSequence{1};
+                    /** Records appended since the last write, and the sequence numbers of the publishes among them **/
+                    std::string batch;
+                    std::vector<uint64_t> batchSequences;
+                    std::thread writerThread;
+
+                    void run();
+                    bool openSegment(uint64_t index);
+                    void deleteAcknowledgedSegments();
+                    /**
+                     * \brief Load the publishes and acknowledgements of a segment, up to its first torn or corrupt
+                     * record
+                     */
+                    bool loadSegment(Segment &segment);
+                    size_t diskSize() const;
+                    std::string segmentPath(uint64_t index) const;
+                    static void AppendRecord(std::string &batch, char type, const std::string &body);
+                    static uint32_t Crc32(const char *data, size_t length);
+                };
+            } // namespace Util
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_PUBLISHJOURNAL_H
@@ -3,6 +3,8 @@
 
 #include "Retry.h"
 #include "../logging/LoggerFactory.h"
+#include "HashUtils.h"
+#include <algorithm>
 #include <thread>
 
 using namespace std;
@@ -11,6 +13,40 @@ using namespace Aws::Iot::DeviceClient::Util;
 
 const char *Retry::TAG = "Retry.cpp";
 
+Retry::BackoffSchedule::BackoffSchedule(const ExponentialRetryConfig &config)
+    : startingBackoffMillis(config.startingBackoffMillis), maxBackoffMillis(config.maxBackoffMillis),
+      jitter(config.jitter), backoffMillis(config.startingBackoffMillis),
+      generator(config.seed != 0 ? config.seed : random_device()())
+{
+}
+
+long Retry::BackoffSchedule::next()
+{
+    long sleepMillis = backoffMillis;
+    switch (jitter)
+    {
+        case Jitter::NONE:
+            backoffMillis = backoffMillis * 2 > maxBackoffMillis ? maxBackoffMillis : backoffMillis * 2;
+            break;
+        case Jitter::FULL:
+            sleepMillis = uniform_int_distribution<long>(0, backoffMillis)(generator);
+            backoffMillis = backoffMillis * 2 > maxBackoffMillis ? maxBackoffMillis : backoffMillis * 2;
+            break;
+        case Jitter::DECORRELATED:
+            sleepMillis = uniform_int_distribution<long>(
+                startingBackoffMillis, max(startingBackoffMillis, backoffMillis * 3))(generator);
+            sleepMillis = sleepMillis > maxBackoffMillis ? maxBackoffMillis : sleepMillis;
+            backoffMillis = sleepMillis;
+            break;
+    }
+    return sleepMillis;
+}
+
+uint64_t Retry::seedFrom(const string &identity)
+{
+    return Fnv1a(identity);
+}
+
 bool Retry::exponentialBackoff(
     const ExponentialRetryConfig &config,
     const function<bool()> &retryableFunction,
@@ -40,7 +76,7 @@ bool Retry::exponentialBackoff(
     }
 
     bool successful = false;
-    long backoffMillis = config.startingBackoffMillis;
+    BackoffSchedule backoff(config);
     long retriesSoFar = 0;
     while (!successful && !needToStop && (config.maxRetries < 0 || retriesSoFar < config.maxRetries))
     {
@@ -54,9 +90,9 @@ bool Retry::exponentialBackoff(
 
         if (!successful && (config.maxRetries < 0 || retriesSoFar < config.maxRetries))
         {
+            long backoffMillis = backoff.next();
             LOGM_DEBUG(TAG, "Retryable function returned unsuccessfully, sleeping for %ld milliseconds", backoffMillis);
             this_thread::sleep_for(std::chrono::milliseconds(backoffMillis));
-            backoffMillis = backoffMillis * 2 > config.maxBackoffMillis ? config.maxBackoffMillis : backoffMillis * 2;
         }
 
         if (config.needStopFlag != nullptr)
@@ -5,8 +5,11 @@
 #define DEVICE_CLIENT_RETRY_H
 
 #include <atomic>
+#include <cstdint>
 #include <functional>
 #include <future>
+#include <random>
+#include <string>
 #include <thread>
 
 namespace Aws
@@ -26,6 +29,20 @@ namespace Aws
                     static const char *TAG;
 
                   public:
+                    /**
+                     * \brief Randomization applied to the time between retries, so that many devices failing at the
+                     * same time do not all retry at the same time
+                     */
+                    enum class Jitter
+                    {
+                        /** Double the time between retries, up to the maximum **/
+                        NONE,
+                        /** Sleep a random time between zero and the doubled time between retries **/
+                        FULL,
+                        /** Sleep a random time between the starting backoff and three times the previous sleep **/
+                        DECORRELATED
+                    };
+
                     /**
                      * \brief Used for passing an exponential retry configuration to the exponentialBackoff function
                      */
@@ -47,7 +64,48 @@ namespace Aws
                         long maxRetries;
 
                         std::atomic<bool> *needStopFlag;
+
+                        /**
+                         * \brief The randomization applied to the time between retries, none if omitted
+                         */
+                        Jitter jitter;
+                        /**
+                         * \brief Seed of the random times between retries. If omitted or zero, a random seed is used.
+                         */
+                        uint64_t seed;
                     };
+
+                    /**
+                     * \brief Computes the successive times between retries of an ExponentialRetryConfig
+                     */
+                    class BackoffSchedule
+                    {
+                      public:
+                        explicit BackoffSchedule(const ExponentialRetryConfig &config);
+
+                        /**
+                         * \brief The time to sleep before the next retry in milliseconds
+                         */
+                        long next();
+
+                      private:
+                        long startingBackoffMillis;
+                        long maxBackoffMillis;
+                        Jitter jitter;
+                        /**
+                         * \brief The doubled time between retries, or the previous sleep for decorrelated jitter
+                         */
+                        long backoffMillis;
+                        std::mt19937_64 generator;
+                    };
+
+                    /**
+                     * \brief Derive a seed for the random times between retries from a string identifying the device,
+                     * such as its thing name, so that the retries of a device are reproducible while those of
+                     * different devices are spread out
+                     */
+                    static uint64_t seedFrom(const std::string &identity);
+
                     /**
                      * \brief Performs an exponential backoff of the provided function based on the specified
                      * ExponentialRetryConfig
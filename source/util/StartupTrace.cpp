@@ -0,0 +1,107 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "StartupTrace.h"
+#include "../logging/LoggerFactory.h"
+#include "StringUtils.h"
+
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Util;
+using namespace Aws::Iot::DeviceClient::Logging;
+
+constexpr char StartupTrace::TAG[];
+
+StartupTrace::StartupTrace() : origin(chrono::steady_clock::now()) {}
+
+void StartupTrace::Begin(const string &phase)
+{
+    auto begin = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - origin);
+    lock_guard<mutex> lock(traceLock);
+    auto thread = threads.insert(make_pair(this_thread::get_id(), threads.size())).first->second;
+    phases.push_back({phase, thread, begin, chrono::microseconds(0), false});
+}
+
+void StartupTrace::End(const string &phase)
+{
+    auto end = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - origin);
+    lock_guard<mutex> lock(traceLock);
+    for (auto it = phases.rbegin(); it != phases.rend(); ++it)
+    {
+        if (it->name == phase && !it->completed)
+        {
+            it->duration = end - it->begin;
+            it->completed = true;
+            return;
+        }
+    }
+    LOGM_DEBUG(TAG, "Ignoring the end of startup phase %s, which was not begun", phase.c_str());
+}
+
+void StartupTrace::LogSummary() const
+{
+    lock_guard<mutex> lock(traceLock);
+    for (const auto &phase : phases)
+    {
+        if (phase.completed)
+        {
+            LOGM_INFO(
+                TAG,
+                "Startup phase %s took %lld ms, starting at %lld ms",
+                phase.name.c_str(),
+                static_cast<long long>(phase.duration.count() / 1000),
+                static_cast<long long>(phase.begin.count() / 1000));
+        }
+    }
+}
+
+string StartupTrace::ToChromeTrace() const
+{
+    lock_guard<mutex> lock(traceLock);
+    ostringstream trace;
+    trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto &phase : phases)
+    {
+        if (!phase.completed)
+        {
+            continue;
+        }
+        trace << (first ? "" : ",") << "{\"name\":\"";
+        for (char c : phase.name)
+        {
+            if (c == '"' || c == '\\')
+            {
+                trace << '\\';
+            }
+            trace << c;
+        }
+        trace << "\",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":" << phase.begin.count()
+              << ",\"dur\":" << phase.duration.count() << ",\"pid\":" << getpid() << ",\"tid\":" << phase.thread
+              << "}";
+        first = false;
+    }
+    trace << "]}";
+    return trace.str();
+}
+
+bool StartupTrace::WriteChromeTrace(const string &path) const
+{
+    ofstream file(path);
+    if (!file.is_open())
+    {
+        LOGM_ERROR(TAG, "Unable to open startup trace file %s", Sanitize(path).c_str());
+        return false;
+    }
+    file << ToChromeTrace();
+    if (!file)
+    {
+        LOGM_ERROR(TAG, "Unable to write startup trace file %s", Sanitize(path).c_str());
+        return false;
+    }
+    LOGM_INFO(TAG, "Wrote startup trace to %s", Sanitize(path).c_str());
+    return true;
+}
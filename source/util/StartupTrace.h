@@ -0,0 +1,84 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef AWS_IOT_DEVICE_CLIENT_STARTUPTRACE_H
+#define AWS_IOT_DEVICE_CLIENT_STARTUPTRACE_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Aws
+{
+    namespace Iot
+    {
+        namespace DeviceClient
+        {
+            namespace Util
+            {
+                /**
+                 * \brief Records how long each phase of the startup of the Device Client takes.
+                 *
+                 * Phases are timed with a monotonic clock relative to the creation of the trace and may run on
+                 * different threads. The trace can be logged as a summary or written in the Chrome trace event format,
+                 * which chrome://tracing and Perfetto can display.
+                 */
+                class StartupTrace
+                {
+                  public:
+                    StartupTrace();
+
+                    /**
+                     * \brief Record the start of a phase on the calling thread
+                     */
+                    void Begin(const std::string &phase);
+
+                    /**
+                     * \brief Record the end of a phase. Phases that were never begun are ignored.
+                     */
+                    void End(const std::string &phase);
+
+                    /**
+                     * \brief Log how long each completed phase took
+                     */
+                    void LogSummary() const;
+
+                    /**
+                     * \brief The completed phases as a Chrome trace event JSON document
+                     */
+                    std::string ToChromeTrace() const;
+
+                    /**
+                     * \brief Write the completed phases to a file as a Chrome trace event JSON document
+                     *
+                     * @return false if the file could not be written
+                     */
+                    bool WriteChromeTrace(const std::string &path) const;
+
+                  private:
+                    static constexpr char TAG[] = "StartupTrace.cpp";
+
+                    struct Phase
+                    {
+                        std::string name;
+                        /** Index of the thread the phase began on, in order of first appearance **/
+                        size_t thread;
+                        std::chrono::microseconds begin;
+                        std::chrono::microseconds duration;
+                        bool completed;
+                    };
+
+                    std::chrono::steady_clock::time_point origin;
+                    mutable std::mutex traceLock;
+                    std::vector<Phase> phases;
+                    std::map<std::thread::id, size_t> threads;
+                };
+            } // namespace Util
+        }     // namespace DeviceClient
+    }         // namespace Iot
+} // namespace Aws
+
+#endif // AWS_IOT_DEVICE_CLIENT_STARTUPTRACE_H
@@ -118,7 +118,8 @@ TEST_F(ConfigTestFixture, AllFeaturesEnabled)
         "file": "./aws-iot-device-client.log"
     },
     "jobs": {
-        "enabled": true
+        "enabled": true,
+        "progress-interval": 60
     },
     "tunneling": {
         "enabled": true
@@ -176,6 +177,7 @@ TEST_F(ConfigTestFixture, AllFeaturesEnabled)
     ASSERT_STREQ("./aws-iot-device-client.log", config.logConfig.deviceClientLogFile.c_str());
     ASSERT_EQ(3, config.logConfig.deviceClientlogLevel); // Expect DEBUG log level, which is 3
     ASSERT_TRUE(config.jobs.enabled);
+    ASSERT_EQ(60, config.jobs.progressInterval);
     ASSERT_TRUE(config.tunneling.enabled);
     ASSERT_TRUE(config.deviceDefender.enabled);
     ASSERT_TRUE(config.fleetProvisioning.enabled);
@@ -207,6 +209,7 @@ TEST_F(ConfigTestFixture, AllFeaturesEnabled)
     JsonObject jobs;
     config.jobs.SerializeToObject(jobs);
     ASSERT_TRUE(jobs.View().GetBool(config.jobs.JSON_KEY_ENABLED));
+    ASSERT_EQ(60, jobs.View().GetInteger(config.jobs.JSON_KEY_PROGRESS_INTERVAL));
 
     JsonObject deviceDefender;
     config.deviceDefender.SerializeToObject(deviceDefender);
@@ -716,6 +719,31 @@ TEST_F(ConfigTestFixture, SecureTunnelingMinimumConfig)
     ASSERT_TRUE(config.tunneling.subscribeNotification);
 }
 
+TEST_F(ConfigTestFixture, SecureTunnelingPrewarm)
+{
+    constexpr char jsonString[] = R"(
+{
+    "endpoint": "endpoint value",
+    "cert": "/tmp/aws-iot-device-client-test-file",
+    "root-ca": "/tmp/aws-iot-device-client-test/AmazonRootCA1.pem",
+    "key": "/tmp/aws-iot-device-client-test-file",
+    "thing-name": "thing-name value",
+    "tunneling": {
+        "enabled": true,
+        "prewarm": true
+    }
+})";
+    JsonObject jsonObject(jsonString);
+    JsonView jsonView = jsonObject.View();
+
+    PlainConfig config;
+    config.LoadFromJson(jsonView);
+
+    ASSERT_TRUE(config.Validate());
+    ASSERT_TRUE(config.tunneling.enabled);
+    ASSERT_TRUE(config.tunneling.prewarm);
+}
+
 TEST_F(ConfigTestFixture, SecureTunnelingCli)
 {
     constexpr char jsonString[] = R"(
@@ -1684,3 +1712,381 @@ TEST_F(ConfigTestFixture, HTTPProxyConfigNoAuth)
     ASSERT_FALSE(httpProxyConfig.httpProxyAuthEnabled);
     ASSERT_STREQ("None", httpProxyConfig.proxyAuthMethod->c_str());
 }
+
+TEST_F(ConfigTestFixture, EventLoopsHappy)
+{
+    constexpr char jsonString[] = R"(
+{
+    "control-plane": {
+        "threads": 1,
+        "cpu-affinity": [0],
+        "nice": -5
+    },
+    "data-plane": {
+        "threads": 2,
+        "cpu-affinity": [1, 2],
+        "nice": 5
+    }
+})";
+    JsonObject jsonObject(jsonString);
+    JsonView jsonView = jsonObject.View();
+
+    PlainConfig::EventLoops eventLoops;
+    eventLoops.LoadFromJson(jsonView);
+
+    ASSERT_TRUE(eventLoops.Validate());
+    ASSERT_EQ(1, eventLoops.controlPlane.threads);
+    ASSERT_EQ(vector<int>({0}), eventLoops.controlPlane.cpuAffinity);
+    ASSERT_EQ(-5, eventLoops.controlPlane.nice.value());
+    ASSERT_TRUE(eventLoops.dataPlane.has_value());
+    ASSERT_EQ(2, eventLoops.dataPlane->threads);
+    ASSERT_EQ(vector<int>({1, 2}), eventLoops.dataPlane->cpuAffinity);
+    ASSERT_EQ(5, eventLoops.dataPlane->nice.value());
+}
+
+TEST_F(ConfigTestFixture, EventLoopsDefaultSharesControlPlane)
+{
+    PlainConfig config;
+    ASSERT_EQ(1, config.eventLoops.controlPlane.threads);
+    ASSERT_TRUE(config.eventLoops.controlPlane.cpuAffinity.empty());
+    ASSERT_FALSE(config.eventLoops.controlPlane.nice.has_value());
+    ASSERT_FALSE(config.eventLoops.dataPlane.has_value());
+}
+
+TEST_F(ConfigTestFixture, EventLoopsInvalid)
+{
+    constexpr char jsonString[] = R"(
+{
+    "data-plane": {
+        "threads": 0
+    }
+})";
+    JsonObject jsonObject(jsonString);
+    PlainConfig::EventLoops eventLoops;
+    eventLoops.LoadFromJson(jsonObject.View());
+    ASSERT_FALSE(eventLoops.Validate());
+
+    constexpr char affinityString[] = R"({"control-plane": {"cpu-affinity": ["first"]}})";
+    JsonObject affinityObject(affinityString);
+    PlainConfig::EventLoops affinity;
+    affinity.LoadFromJson(affinityObject.View());
+    ASSERT_FALSE(affinity.Validate());
+
+    constexpr char niceString[] = R"({"control-plane": {"nice": 20}})";
+    JsonObject niceObject(niceString);
+    PlainConfig::EventLoops niceLevel;
+    niceLevel.LoadFromJson(niceObject.View());
+    ASSERT_FALSE(niceLevel.Validate());
+}
+
+TEST_F(ConfigTestFixture, PublishLimits)
+{
+    PlainConfig config;
+    ASSERT_EQ(PlainConfig::PublishLimits::DEFAULT_MESSAGES_PER_SECOND, config.publishLimits.messagesPerSecond);
+    ASSERT_EQ(PlainConfig::PublishLimits::DEFAULT_BYTES_PER_SECOND, config.publishLimits.bytesPerSecond);
+    ASSERT_EQ(PlainConfig::PublishLimits::DEFAULT_MAX_QUEUE_DEPTH, config.publishLimits.maxQueueDepth);
+
+    constexpr char jsonString[] = R"(
+{
+    "messages-per-second": 50,
+    "bytes-per-second": 0,
+    "max-queue-depth": 10
+})";
+    JsonObject jsonObject(jsonString);
+    PlainConfig::PublishLimits publishLimits;
+    publishLimits.LoadFromJson(jsonObject.View());
+
+    ASSERT_TRUE(publishLimits.Validate());
+    ASSERT_EQ(50, publishLimits.messagesPerSecond);
+    ASSERT_EQ(0, publishLimits.bytesPerSecond);
+    ASSERT_EQ(10, publishLimits.maxQueueDepth);
+
+    constexpr char invalidString[] = R"({"max-queue-depth": 0})";
+    JsonObject invalidObject(invalidString);
+    PlainConfig::PublishLimits invalid;
+    invalid.LoadFromJson(invalidObject.View());
+    ASSERT_FALSE(invalid.Validate());
+}
+
+TEST_F(ConfigTestFixture, PublishJournal)
+{
+    PlainConfig config;
+    ASSERT_FALSE(config.publishJournal.enabled);
+    ASSERT_TRUE(config.publishJournal.Validate());
+
+    constexpr char jsonString[] = R"(
+{
+    "enabled": true,
+    "max-size-bytes": 1024
+})";
+    JsonObject jsonObject(jsonString);
+    PlainConfig::PublishJournalConfig publishJournal;
+    publishJournal.LoadFromJson(jsonObject.View());
+
+    ASSERT_TRUE(publishJournal.enabled);
+    ASSERT_FALSE(publishJournal.directory.has_value());
+    ASSERT_EQ(1024, publishJournal.maxSize);
+    // Too small to hold more than a few publishes
+    ASSERT_FALSE(publishJournal.Validate());
+
+    publishJournal.maxSize = PlainConfig::PublishJournalConfig::DEFAULT_MAX_SIZE;
+    ASSERT_TRUE(publishJournal.Validate());
+}
+
+TEST_F(ConfigTestFixture, JobsCgroupIsolation)
+{
+    PlainConfig config;
+    ASSERT_FALSE(config.jobs.cgroupIsolation);
+
+    constexpr char jsonString[] = R"(
+{
+    "cgroup-isolation": true,
+    "cgroup-parent": "/sys/fs/cgroup/jobs",
+    "cgroup-cpu-max": "50000 100000",
+    "cgroup-memory-max": "256M",
+    "cgroup-io-weight": 50
+})";
+    JsonObject jsonObject(jsonString);
+    PlainConfig::Jobs jobs;
+    jobs.LoadFromJson(jsonObject.View());
+
+    ASSERT_TRUE(jobs.Validate());
+    ASSERT_TRUE(jobs.cgroupIsolation);
+    ASSERT_STREQ("/sys/fs/cgroup/jobs", jobs.cgroupParent->c_str());
+    ASSERT_STREQ("50000 100000", jobs.cgroupCpuMax->c_str());
+    ASSERT_STREQ("256M", jobs.cgroupMemoryMax->c_str());
+    ASSERT_EQ(50, jobs.cgroupIoWeight.value());
+
+    JsonObject serialized;
+    jobs.SerializeToObject(serialized);
+    ASSERT_TRUE(serialized.View().GetBool(PlainConfig::Jobs::JSON_KEY_CGROUP_ISOLATION));
+    ASSERT_STREQ("256M", serialized.View().GetString(PlainConfig::Jobs::JSON_KEY_CGROUP_MEMORY_MAX).c_str());
+
+    for (const char *invalidString :
+         {R"({"cgroup-parent": "jobs"})",
+          R"({"cgroup-cpu-max": "half"})",
+          R"({"cgroup-memory-max": "256MB"})",
+          R"({"cgroup-io-weight": 0})"})
+    {
+        JsonObject invalidObject(invalidString);
+        PlainConfig::Jobs invalid;
+        invalid.LoadFromJson(invalidObject.View());
+        ASSERT_FALSE(invalid.Validate()) << invalidString;
+    }
+}
+
+TEST_F(ConfigTestFixture, Startup)
+{
+    PlainConfig config;
+    ASSERT_FALSE(config.startup.fastStart);
+    ASSERT_FALSE(config.startup.traceFile.has_value());
+    ASSERT_TRUE(config.startup.Validate());
+
+    constexpr char jsonString[] = R"(
+{
+    "trace-file": "/tmp/device-client-startup-trace.json",
+    "fast-start": true
+})";
+    JsonObject jsonObject(jsonString);
+    PlainConfig::Startup startup;
+    startup.LoadFromJson(jsonObject.View());
+
+    ASSERT_TRUE(startup.fastStart);
+    ASSERT_STREQ("/tmp/device-client-startup-trace.json", startup.traceFile->c_str());
+    ASSERT_TRUE(startup.Validate());
+
+    startup.traceFile = "/tmp/device-client-missing-directory/startup-trace.json";
+    ASSERT_FALSE(startup.Validate());
+}
+
+TEST_F(ConfigTestFixture, ChangedSections)
+{
+    constexpr char jsonString[] = R"(
+{
+    "endpoint": "endpoint value",
+    "cert": "/tmp/aws-iot-device-client-test-file",
+    "key": "/tmp/aws-iot-device-client-test-file",
+    "root-ca": "/tmp/aws-iot-device-client-test/AmazonRootCA1.pem",
+    "thing-name": "thing-name value",
+    "jobs": {
+        "enabled": true
+    },
+    "tunneling": {
+        "enabled": true
+    }
+})";
+    JsonObject jsonObject(jsonString);
+    PlainConfig running;
+    running.LoadFromJson(jsonObject.View());
+
+    PlainConfig reloaded = running;
+    ASSERT_TRUE(running.HasSameConnectionSettings(reloaded));
+    ASSERT_TRUE(running.ChangedSections(reloaded).empty());
+
+    reloaded.jobs.enabled = false;
+    reloaded.publishLimits.messagesPerSecond = 10;
+    ASSERT_TRUE(running.HasSameConnectionSettings(reloaded));
+    vector<string> changed = running.ChangedSections(reloaded);
+    ASSERT_EQ(2u, changed.size());
+    ASSERT_STREQ(PlainConfig::JSON_KEY_JOBS, changed[0].c_str());
+    ASSERT_STREQ(PlainConfig::JSON_KEY_PUBLISH_LIMITS, changed[1].c_str());
+
+    reloaded = running;
+    reloaded.pubSub.enabled = true;
+    changed = running.ChangedSections(reloaded);
+    ASSERT_EQ(1u, changed.size());
+    ASSERT_STREQ(PlainConfig::JSON_KEY_PUB_SUB, changed[0].c_str());
+
+    reloaded = running;
+    reloaded.endpoint = "other endpoint value";
+    ASSERT_FALSE(running.HasSameConnectionSettings(reloaded));
+    ASSERT_TRUE(running.ChangedSections(reloaded).empty());
+
+    reloaded = running;
+    reloaded.httpProxyConfig.httpProxyEnabled = true;
+    ASSERT_FALSE(running.HasSameConnectionSettings(reloaded));
+}
+
+TEST_F(ConfigTestFixture, ChangedSectionsIncludesEveryKey)
+{
+    PlainConfig running;
+    PlainConfig reloaded = running;
+
+    reloaded.tunneling.prewarm = true;
+    vector<string> changed = running.ChangedSections(reloaded);
+    ASSERT_EQ(vector<string>({PlainConfig::JSON_KEY_TUNNELING}), changed);
+
+    reloaded = running;
+    reloaded.sampleShadow.shadowLocalSocket = "/run/aws-iot-device-client/shadow.sock";
+    changed = running.ChangedSections(reloaded);
+    ASSERT_EQ(vector<string>({PlainConfig::JSON_KEY_SAMPLE_SHADOW}), changed);
+
+    reloaded = running;
+    reloaded.sampleShadow.shadowInputDirectory = "/tmp/shadow-input";
+    changed = running.ChangedSections(reloaded);
+    ASSERT_EQ(vector<string>({PlainConfig::JSON_KEY_SAMPLE_SHADOW}), changed);
+
+    reloaded = running;
+    reloaded.sampleShadow.shadowOutputDirectory = "/tmp/shadow-output";
+    changed = running.ChangedSections(reloaded);
+    ASSERT_EQ(vector<string>({PlainConfig::JSON_KEY_SAMPLE_SHADOW}), changed);
+}
+
+TEST_F(ConfigTestFixture, JobsResumeJobs)
+{
+    PlainConfig config;
+    ASSERT_TRUE(config.jobs.resumeJobs);
+
+    JsonObject jsonObject(R"({"resume-jobs": false})");
+    PlainConfig::Jobs jobs;
+    jobs.LoadFromJson(jsonObject.View());
+
+    ASSERT_TRUE(jobs.Validate());
+    ASSERT_FALSE(jobs.resumeJobs);
+
+    JsonObject serialized;
+    jobs.SerializeToObject(serialized);
+    ASSERT_FALSE(serialized.View().GetBool(PlainConfig::Jobs::JSON_KEY_RESUME_JOBS));
+}
+
+TEST_F(ConfigTestFixture, JobsResidentHandlers)
+{
+    JsonObject jsonObject(R"({"resident-handlers": ["health-check.sh", "inventory"]})");
+    PlainConfig::Jobs jobs;
+    jobs.LoadFromJson(jsonObject.View());
+
+    ASSERT_TRUE(jobs.Validate());
+    ASSERT_EQ(vector<string>({"health-check.sh", "inventory"}), jobs.residentHandlers);
+
+    JsonObject serialized;
+    jobs.SerializeToObject(serialized);
+    ASSERT_EQ(2u, serialized.View().GetArray(PlainConfig::Jobs::JSON_KEY_RESIDENT_HANDLERS).size());
+
+    for (const char *invalidString :
+         {R"({"resident-handlers": ["../health-check.sh"]})",
+          R"({"resident-handlers": [""]})",
+          R"({"resident-handlers": [1]})"})
+    {
+        JsonObject invalidObject(invalidString);
+        PlainConfig::Jobs invalid;
+        invalid.LoadFromJson(invalidObject.View());
+        ASSERT_FALSE(invalid.Validate()) << invalidString;
+    }
+}
+
+TEST_F(ConfigTestFixture, JobsDownloadDirectory)
+{
+    JsonObject jsonObject(R"({"download-directory": "/var/lib/aws-iot-device-client/downloads"})");
+    PlainConfig::Jobs jobs;
+    jobs.LoadFromJson(jsonObject.View());
+
+    ASSERT_TRUE(jobs.Validate());
+    ASSERT_STREQ("/var/lib/aws-iot-device-client/downloads", jobs.downloadDir.c_str());
+
+    JsonObject serialized;
+    jobs.SerializeToObject(serialized);
+    ASSERT_STREQ(
+        "/var/lib/aws-iot-device-client/downloads",
+        serialized.View().GetString(PlainConfig::Jobs::JSON_KEY_DOWNLOAD_DIR).c_str());
+
+    JsonObject relativeObject(R"({"download-directory": "downloads"})");
+    PlainConfig::Jobs relative;
+    relative.LoadFromJson(relativeObject.View());
+    ASSERT_FALSE(relative.Validate());
+}
+
+TEST_F(ConfigTestFixture, JobsDeviceAttributes)
+{
+    JsonObject jsonObject(R"({"device-attributes": {"operatingSystem": "ubuntu", "OS": "16.0"}})");
+    PlainConfig::Jobs jobs;
+    jobs.LoadFromJson(jsonObject.View());
+
+    ASSERT_TRUE(jobs.Validate());
+    ASSERT_EQ((map<string, string>{{"OS", "16.0"}, {"operatingSystem", "ubuntu"}}), jobs.deviceAttributes);
+
+    JsonObject serialized;
+    jobs.SerializeToObject(serialized);
+    ASSERT_STREQ(
+        "ubuntu",
+        serialized.View()
+            .GetJsonObject(PlainConfig::Jobs::JSON_KEY_DEVICE_ATTRIBUTES)
+            .GetString("operatingSystem")
+            .c_str());
+
+    for (const char *invalidString :
+         {R"({"device-attributes": {"operatingSystem": ""}})", R"({"device-attributes": {"operatingSystem": 1}})"})
+    {
+        JsonObject invalidObject(invalidString);
+        PlainConfig::Jobs invalid;
+        invalid.LoadFromJson(invalidObject.View());
+        ASSERT_FALSE(invalid.Validate()) << invalidString;
+    }
+}
+
+TEST_F(ConfigTestFixture, DeviceDefenderNativeCollector)
+{
+    JsonObject jsonObject(R"({"enabled": true, "collector": "native", "custom-metrics": ["cpu-usage", "disk-usage"]})");
+    PlainConfig::DeviceDefender deviceDefender;
+    deviceDefender.LoadFromJson(jsonObject.View());
+
+    ASSERT_TRUE(deviceDefender.Validate());
+    ASSERT_EQ(PlainConfig::DeviceDefender::COLLECTOR_NATIVE, deviceDefender.collector);
+    ASSERT_EQ(vector<string>({"cpu-usage", "disk-usage"}), deviceDefender.customMetrics);
+
+    JsonObject serialized;
+    deviceDefender.SerializeToObject(serialized);
+    ASSERT_STREQ("native", serialized.View().GetString(PlainConfig::DeviceDefender::JSON_KEY_COLLECTOR).c_str());
+    ASSERT_EQ(2u, serialized.View().GetArray(PlainConfig::DeviceDefender::JSON_KEY_CUSTOM_METRICS).size());
+
+    for (const char *invalidString :
+         {R"({"enabled": true, "collector": "other"})",
+          R"({"enabled": true, "custom-metrics": ["cpu-usage"]})",
+          R"({"enabled": true, "collector": "native", "custom-metrics": ["fan-speed"]})",
+          R"({"enabled": true, "collector": "native", "custom-metrics": [1]})"})
+    {
+        JsonObject invalidObject(invalidString);
+        PlainConfig::DeviceDefender invalid;
+        invalid.LoadFromJson(invalidObject.View());
+        ASSERT_FALSE(invalid.Validate()) << invalidString;
+    }
+}
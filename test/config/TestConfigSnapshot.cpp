@@ -0,0 +1,155 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/SharedCrtResourceManager.h"
+#include "../../source/config/Config.h"
+#include "../../source/config/ConfigSnapshot.h"
+#include "../../source/util/FileUtils.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient;
+using namespace Aws::Iot::DeviceClient::Util;
+
+class ConfigSnapshotFixture : public ::testing::Test
+{
+  public:
+    const string snapshotFile = "/tmp/device-client-config-snapshot-test";
+    const string configFile = "/tmp/device-client-config-snapshot-test.conf";
+    const string certFile = "/tmp/device-client-config-snapshot-test.crt";
+    /** Home directory of Config::init, which keeps its config snapshot under ~/.aws-iot-device-client/ **/
+    const string homeDir = "/tmp/device-client-config-snapshot-test-home";
+    const string configDir = homeDir + "/.aws-iot-device-client";
+    const string defaultSnapshotFile = configDir + "/config-snapshot";
+    string previousHome;
+    SharedCrtResourceManager resourceManager;
+
+    void SetUp() override
+    {
+        // Initializing allocator, so we can use CJSON lib from SDK in our unit tests.
+        resourceManager.initializeAllocator();
+
+        ofstream(configFile) << "{\"thing-name\": \"thing\"}";
+        ofstream(certFile) << "certificate";
+        chmod(certFile.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+        const char *home = getenv("HOME");
+        previousHome = home == nullptr ? "" : home;
+        FileUtils::CreateDirectoryWithPermissions(homeDir.c_str(), S_IRWXU);
+        FileUtils::CreateDirectoryWithPermissions(configDir.c_str(), S_IRWXU);
+        setenv("HOME", homeDir.c_str(), 1);
+    }
+
+    void TearDown() override
+    {
+        setenv("HOME", previousHome.c_str(), 1);
+        remove(defaultSnapshotFile.c_str());
+        remove(configDir.c_str());
+        remove(homeDir.c_str());
+        remove(snapshotFile.c_str());
+        remove(configFile.c_str());
+        remove(certFile.c_str());
+    }
+
+    ConfigSnapshot snapshotOf(const string &thingName) const
+    {
+        ConfigSnapshot snapshot(snapshotFile);
+        snapshot.AddFileInput(configFile);
+        snapshot.AddInput("--thing-name", thingName);
+        return snapshot;
+    }
+
+    /** Stand-in for validating a configuration, examining a certificate the way Config does **/
+    set<string> validate() const
+    {
+        FileUtils::StartRecordingCheckedPaths();
+        FileUtils::FileExists(certFile);
+        FileUtils::ValidateFileOwnershipPermissions(certFile);
+        FileUtils::GetFilePermissions(certFile);
+        return FileUtils::StopRecordingCheckedPaths();
+    }
+};
+
+TEST_F(ConfigSnapshotFixture, MatchesAfterStore)
+{
+    ASSERT_FALSE(snapshotOf("thing").Matches());
+
+    set<string> checkedPaths = validate();
+    ASSERT_EQ(1u, checkedPaths.count(certFile));
+    ASSERT_TRUE(snapshotOf("thing").Store(checkedPaths));
+
+    ASSERT_TRUE(snapshotOf("thing").Matches());
+    ASSERT_EQ(600, FileUtils::GetFilePermissions(snapshotFile));
+}
+
+TEST_F(ConfigSnapshotFixture, DoesNotMatchWhenInputsChange)
+{
+    ASSERT_TRUE(snapshotOf("thing").Store(validate()));
+
+    ASSERT_FALSE(snapshotOf("other-thing").Matches());
+
+    ofstream(configFile) << "{\"thing-name\": \"other-thing\"}";
+    ASSERT_FALSE(snapshotOf("thing").Matches());
+}
+
+TEST_F(ConfigSnapshotFixture, DoesNotMatchWhenCheckedPathChanges)
+{
+    ASSERT_TRUE(snapshotOf("thing").Store(validate()));
+
+    chmod(certFile.c_str(), S_IRUSR | S_IWUSR);
+    ASSERT_FALSE(snapshotOf("thing").Matches());
+
+    ASSERT_TRUE(snapshotOf("thing").Store(validate()));
+    remove(certFile.c_str());
+    ASSERT_FALSE(snapshotOf("thing").Matches());
+}
+
+TEST_F(ConfigSnapshotFixture, IgnoresSnapshotInUnknownFormat)
+{
+    ofstream(snapshotFile) << "not a snapshot\n";
+    chmod(snapshotFile.c_str(), S_IRUSR | S_IWUSR);
+    ASSERT_FALSE(snapshotOf("thing").Matches());
+}
+
+TEST_F(ConfigSnapshotFixture, TimesConfigInitWithAndWithoutSnapshot)
+{
+    const int iterations = 100;
+    // Checking the snapshot is on the startup path of every fast start, so it must stay below a millisecond
+    const long maxMicrosPerMatchingInit = 1000;
+    ofstream(configFile) << "{\"endpoint\": \"endpoint\", \"cert\": \"" << certFile << "\", \"key\": \"" << certFile
+                         << "\", \"thing-name\": \"thing\", \"startup\": {\"config-snapshot\": true}}";
+    CliArgs cliArgs{{Config::CLI_CONFIG_FILE, configFile}};
+
+    chrono::steady_clock::duration validating = chrono::steady_clock::duration::zero();
+    for (int i = 0; i < iterations; i++)
+    {
+        // Without a stored snapshot init validates the configuration, then stores one
+        remove(defaultSnapshotFile.c_str());
+        Config config;
+        auto start = chrono::steady_clock::now();
+        ASSERT_TRUE(config.init(cliArgs));
+        validating += chrono::steady_clock::now() - start;
+    }
+    ASSERT_TRUE(FileUtils::FileExists(defaultSnapshotFile));
+
+    chrono::steady_clock::duration matching = chrono::steady_clock::duration::zero();
+    for (int i = 0; i < iterations; i++)
+    {
+        Config config;
+        auto start = chrono::steady_clock::now();
+        ASSERT_TRUE(config.init(cliArgs));
+        matching += chrono::steady_clock::now() - start;
+    }
+
+    auto microsPerValidatingInit = chrono::duration_cast<chrono::microseconds>(validating).count() / iterations;
+    auto microsPerMatchingInit = chrono::duration_cast<chrono::microseconds>(matching).count() / iterations;
+    RecordProperty("microsPerInitWithoutSnapshot", static_cast<int>(microsPerValidatingInit));
+    RecordProperty("microsPerInitWithMatchingSnapshot", static_cast<int>(microsPerMatchingInit));
+    ASSERT_LT(microsPerMatchingInit, maxMicrosPerMatchingInit);
+}
@@ -0,0 +1,176 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/config/Config.h"
+#include "../../source/devicedefender/MetricsCollector.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient;
+using namespace Aws::Iot::DeviceClient::DeviceDefender;
+
+namespace
+{
+    const string root = "/tmp/device-client-metrics-test";
+
+    const string socketsHeading =
+        "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n";
+
+    const string devHeading = "Inter-|   Receive                                                |  Transmit\n"
+                              " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs "
+                              "drop fifo colls carrier compressed\n";
+
+    string devContents(int eth0Bytes)
+    {
+        return devHeading + "    lo:  900000    9000    0    0    0     0          0         0   900000    9000    0 "
+                            "   0    0     0       0          0\n" +
+               "  eth0: " + to_string(eth0Bytes) +
+               "     100    0    0    0     0          0         0   " + to_string(eth0Bytes / 2) +
+               "      50    0    0    0     0       0          0\n";
+    }
+
+    void writeFile(const string &path, const string &contents) { ofstream(root + path) << contents; }
+} // namespace
+
+class TestMetricsCollector : public ::testing::Test
+{
+  public:
+    void SetUp() override
+    {
+        ASSERT_EQ(0, system(("rm -rf " + root + " && mkdir -p " + root + "/proc/net " + root +
+                             "/sys/class/thermal/thermal_zone0")
+                                .c_str()));
+        writeFile(
+            "/proc/net/tcp",
+            socketsHeading +
+                "   0: 00000000:0016 00000000:0000 0A 00000000:00000000 00:00000000 00000000     0        0 1 1\n"
+                "   1: 0F02000A:A2B4 0100A8C0:1F40 01 00000000:00000000 00:00000000 00000000  1000        0 2 1\n");
+        writeFile(
+            "/proc/net/tcp6",
+            socketsHeading + "   0: 00000000000000000000000000000000:0016 00000000000000000000000000000000:0000 0A "
+                             "00000000:00000000 00:00000000 00000000     0        0 3 1\n"
+                             "   1: 00000000000000000000000000000000:01BB 00000000000000000000000000000000:0000 0A "
+                             "00000000:00000000 00:00000000 00000000     0        0 4 1\n"
+                             "   2: 00000000000000000000000000000000:C000 B80D0120000000000000000001000000:1F40 01 "
+                             "00000000:00000000 00:00000000 00000000     0        0 5 1\n");
+        writeFile(
+            "/proc/net/udp",
+            socketsHeading +
+                "   0: 00000000:0035 00000000:0000 07 00000000:00000000 00:00000000 00000000     0        0 6 2\n");
+        writeFile("/proc/net/udp6", socketsHeading);
+        writeFile("/proc/net/dev", devContents(1000));
+        writeFile("/proc/stat", "cpu  100 0 100 700 100 0 0 0 0 0\ncpu0 100 0 100 700 100 0 0 0 0 0\n");
+        writeFile("/proc/meminfo", "MemTotal:        1000 kB\nMemFree:          100 kB\nMemAvailable:     250 kB\n");
+        writeFile("/proc/loadavg", "0.10 0.20 0.30 2/143 4567\n");
+        writeFile("/sys/class/thermal/thermal_zone0/temp", "45500\n");
+    }
+
+    void TearDown() override { ASSERT_EQ(0, system(("rm -rf " + root).c_str())); }
+};
+
+TEST_F(TestMetricsCollector, ReportsListeningPortsAndConnections)
+{
+    MetricsCollector collector({}, root);
+    MetricsCollector::Sample sample = collector.sample();
+
+    ASSERT_EQ(vector<uint16_t>({22, 443}), sample.listeningTcpPorts);
+    ASSERT_EQ(vector<uint16_t>({53}), sample.listeningUdpPorts);
+    ASSERT_EQ(2u, sample.establishedConnections.size());
+    ASSERT_EQ(41652, sample.establishedConnections[0].localPort);
+    ASSERT_EQ("192.168.0.1:8000", sample.establishedConnections[0].remoteAddress);
+    ASSERT_EQ("[2001:db8::1]:8000", sample.establishedConnections[1].remoteAddress);
+    ASSERT_TRUE(sample.customMetrics.empty());
+}
+
+TEST_F(TestMetricsCollector, ReportsTrafficSincePreviousSample)
+{
+    MetricsCollector collector({}, root);
+    writeFile("/proc/net/dev", devContents(5000));
+    MetricsCollector::Sample first = collector.sample();
+    writeFile("/proc/net/dev", devContents(6000));
+    MetricsCollector::Sample second = collector.sample();
+
+    // Loopback traffic is left out
+    ASSERT_EQ(4000u, first.bytesIn);
+    ASSERT_EQ(2000u, first.bytesOut);
+    ASSERT_EQ(0u, first.packetsIn);
+    ASSERT_EQ(1000u, second.bytesIn);
+    ASSERT_EQ(500u, second.bytesOut);
+}
+
+TEST_F(TestMetricsCollector, ReportsConfiguredCustomMetrics)
+{
+    MetricsCollector collector(
+        {PlainConfig::DeviceDefender::CUSTOM_METRIC_CPU_USAGE,
+         PlainConfig::DeviceDefender::CUSTOM_METRIC_MEMORY_USAGE,
+         PlainConfig::DeviceDefender::CUSTOM_METRIC_DISK_USAGE,
+         PlainConfig::DeviceDefender::CUSTOM_METRIC_TEMPERATURE,
+         PlainConfig::DeviceDefender::CUSTOM_METRIC_THREAD_COUNT},
+        root);
+    // 300 of the 1000 ticks since the collector was created were busy
+    writeFile("/proc/stat", "cpu  300 0 200 1300 200 0 0 0 0 0\n");
+    MetricsCollector::Sample sample = collector.sample();
+
+    ASSERT_DOUBLE_EQ(30.0, sample.customMetrics.at(PlainConfig::DeviceDefender::CUSTOM_METRIC_CPU_USAGE));
+    ASSERT_DOUBLE_EQ(75.0, sample.customMetrics.at(PlainConfig::DeviceDefender::CUSTOM_METRIC_MEMORY_USAGE));
+    ASSERT_DOUBLE_EQ(45.5, sample.customMetrics.at(PlainConfig::DeviceDefender::CUSTOM_METRIC_TEMPERATURE));
+    ASSERT_DOUBLE_EQ(143.0, sample.customMetrics.at(PlainConfig::DeviceDefender::CUSTOM_METRIC_THREAD_COUNT));
+    double diskUsage = sample.customMetrics.at(PlainConfig::DeviceDefender::CUSTOM_METRIC_DISK_USAGE);
+    ASSERT_GE(diskUsage, 0.0);
+    ASSERT_LE(diskUsage, 100.0);
+}
+
+TEST_F(TestMetricsCollector, LeavesOutMetricsOfMissingFiles)
+{
+    ASSERT_EQ(0, system(("rm -rf " + root + "/proc " + root + "/sys").c_str()));
+    MetricsCollector collector(
+        {PlainConfig::DeviceDefender::CUSTOM_METRIC_CPU_USAGE, PlainConfig::DeviceDefender::CUSTOM_METRIC_TEMPERATURE},
+        root);
+    MetricsCollector::Sample sample = collector.sample();
+
+    ASSERT_TRUE(sample.listeningTcpPorts.empty());
+    ASSERT_TRUE(sample.establishedConnections.empty());
+    ASSERT_EQ(0u, sample.bytesIn);
+    ASSERT_TRUE(sample.customMetrics.empty());
+}
+
+TEST_F(TestMetricsCollector, GrowsBufferToFitLargeFiles)
+{
+    string sockets = socketsHeading;
+    for (int i = 0; i < 1000; i++)
+    {
+        sockets += "   0: 00000000:0016 00000000:0000 0A 00000000:00000000 00:00000000 00000000     0        0 1 1\n";
+    }
+    sockets += "   0: 00000000:0050 00000000:0000 0A 00000000:00000000 00:00000000 00000000     0        0 1 1\n";
+    writeFile("/proc/net/tcp", sockets);
+    MetricsCollector collector({}, root);
+
+    ASSERT_EQ(vector<uint16_t>({22, 80, 443}), collector.sample().listeningTcpPorts);
+}
+
+TEST_F(TestMetricsCollector, SamplesProcCheaply)
+{
+    // A microbenchmark of sampling the metrics of this machine, with the files kept open between samples
+    MetricsCollector collector(
+        {PlainConfig::DeviceDefender::CUSTOM_METRIC_CPU_USAGE,
+         PlainConfig::DeviceDefender::CUSTOM_METRIC_MEMORY_USAGE,
+         PlainConfig::DeviceDefender::CUSTOM_METRIC_DISK_USAGE,
+         PlainConfig::DeviceDefender::CUSTOM_METRIC_THREAD_COUNT});
+    constexpr int samples = 100;
+    long cpuMicros = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < samples; i++)
+    {
+        cpuMicros += collector.sample().cpuMicros;
+    }
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+    RecordProperty("microsPerSample", static_cast<int>(elapsed.count() / samples));
+    RecordProperty("cpuMicrosPerSample", static_cast<int>(cpuMicros / samples));
+    ASSERT_GE(cpuMicros, 0);
+}
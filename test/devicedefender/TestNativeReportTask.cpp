@@ -0,0 +1,73 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/devicedefender/NativeReportTask.h"
+#include "gtest/gtest.h"
+
+#include <aws/crt/JsonObject.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+using namespace std;
+using namespace Aws::Crt;
+using namespace Aws::Iot::DeviceClient::DeviceDefender;
+
+TEST(NativeReportTask, BuildsReportInDeviceDefenderFormat)
+{
+    MetricsCollector::Sample sample;
+    sample.listeningTcpPorts = {22, 443};
+    sample.establishedConnections.push_back({41652, "192.168.0.1:8000"});
+    sample.bytesIn = 4000;
+    sample.packetsOut = 50;
+    sample.customMetrics["cpu-usage"] = 12.5;
+
+    JsonObject report(NativeReportTask::buildReport(sample, 1530304554).c_str());
+    ASSERT_TRUE(report.WasParseSuccessful());
+    JsonView view = report.View();
+    ASSERT_EQ(1530304554, view.GetJsonObject("header").GetInt64("report_id"));
+    ASSERT_STREQ("1.0", view.GetJsonObject("header").GetString("version").c_str());
+
+    JsonView metrics = view.GetJsonObject("metrics");
+    ASSERT_EQ(2, metrics.GetJsonObject("listening_tcp_ports").GetInteger("total"));
+    ASSERT_EQ(443, metrics.GetJsonObject("listening_tcp_ports").GetArray("ports")[1].GetInteger("port"));
+    ASSERT_EQ(0, metrics.GetJsonObject("listening_udp_ports").GetInteger("total"));
+    ASSERT_EQ(4000, metrics.GetJsonObject("network_stats").GetInt64("bytes_in"));
+    ASSERT_EQ(50, metrics.GetJsonObject("network_stats").GetInt64("packets_out"));
+    JsonView connections = metrics.GetJsonObject("tcp_connections").GetJsonObject("established_connections");
+    ASSERT_EQ(1, connections.GetInteger("total"));
+    ASSERT_STREQ("192.168.0.1:8000", connections.GetArray("connections")[0].GetString("remote_addr").c_str());
+
+    ASSERT_DOUBLE_EQ(12.5, view.GetJsonObject("custom_metrics").GetArray("cpu-usage")[0].GetDouble("number"));
+}
+
+TEST(NativeReportTask, LeavesOutCustomMetricsWhenThereAreNone)
+{
+    JsonObject report(NativeReportTask::buildReport(MetricsCollector::Sample(), 1).c_str());
+    ASSERT_FALSE(report.View().ValueExists("custom_metrics"));
+}
+
+TEST(NativeReportTask, PublishesReportEveryInterval)
+{
+    mutex lock;
+    condition_variable published;
+    vector<string> reports;
+    NativeReportTask task(
+        1, unique_ptr<MetricsCollector>(new MetricsCollector({})), [&](const string &payload) {
+            lock_guard<mutex> guard(lock);
+            reports.push_back(payload);
+            published.notify_all();
+            return true;
+        });
+    ASSERT_EQ(0, task.StartTask());
+    {
+        unique_lock<mutex> guard(lock);
+        ASSERT_TRUE(published.wait_for(guard, chrono::seconds(5), [&] { return !reports.empty(); }));
+    }
+    task.StopTask();
+
+    JsonObject report(reports.front().c_str());
+    ASSERT_TRUE(report.WasParseSuccessful());
+    ASSERT_TRUE(report.View().ValueExists("metrics"));
+}
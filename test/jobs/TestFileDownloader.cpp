@@ -0,0 +1,339 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/jobs/FileDownloader.h"
+#include "../../source/util/FileUtils.h"
+#include "gtest/gtest.h"
+
+#include <aws/crt/crypto/Hash.h>
+#include <aws/crt/io/EventLoopGroup.h>
+#include <aws/crt/io/HostResolver.h>
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <netinet/in.h>
+#include <random>
+#include <sstream>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace Aws::Crt;
+using namespace Aws::Iot::DeviceClient::Jobs;
+using namespace Aws::Iot::DeviceClient::Util;
+
+/**
+ * A minimal HTTP/1.1 server on the loopback interface serving one file at /file, with support for Range and If-Range
+ * requests, a redirect from /redirect to /file, and a connection dropped part way through the body
+ */
+class LocalHttpServer
+{
+  public:
+    explicit LocalHttpServer(const string &body) : body(body)
+    {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+        listen(listenFd, 8);
+        socklen_t length = sizeof(address);
+        getsockname(listenFd, reinterpret_cast<sockaddr *>(&address), &length);
+        port = ntohs(address.sin_port);
+        server = thread(&LocalHttpServer::serve, this);
+    }
+
+    ~LocalHttpServer()
+    {
+        stopping = true;
+        shutdown(listenFd, SHUT_RDWR);
+        close(listenFd);
+        server.join();
+    }
+
+    string url(const string &path) const { return "http://127.0.0.1:" + to_string(port) + path; }
+
+    vector<string> getRequests()
+    {
+        lock_guard<mutex> guard(requestsLock);
+        return requests;
+    }
+
+    const string etag = "\"v1\"";
+    /** Closes the connection of the next request after this many bytes of the body, if not zero **/
+    atomic<size_t> dropAfterBytes{0};
+
+  private:
+    static string headerValue(const string &request, const string &name)
+    {
+        size_t start = request.find("\r\n" + name + ": ");
+        if (start == string::npos)
+        {
+            return "";
+        }
+        start += name.size() + 4;
+        return request.substr(start, request.find("\r\n", start) - start);
+    }
+
+    void serve()
+    {
+        while (!stopping)
+        {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0)
+            {
+                continue;
+            }
+            string request;
+            char buffer[4096];
+            ssize_t count;
+            while (request.find("\r\n\r\n") == string::npos && (count = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+            {
+                request.append(buffer, static_cast<size_t>(count));
+            }
+            {
+                lock_guard<mutex> guard(requestsLock);
+                requests.push_back(request);
+            }
+            respond(fd, request);
+            close(fd);
+        }
+    }
+
+    void respond(int fd, const string &request)
+    {
+        string path = request.substr(4, request.find(' ', 4) - 4);
+        ostringstream head;
+        size_t start = 0;
+        if (path == "/redirect")
+        {
+            head << "HTTP/1.1 302 Found\r\nLocation: /file\r\nContent-Length: 0\r\n";
+        }
+        else if (path != "/file")
+        {
+            head << "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n";
+        }
+        else
+        {
+            string range = headerValue(request, "Range");
+            string ifRange = headerValue(request, "If-Range");
+            if (!range.empty() && (ifRange.empty() || ifRange == etag))
+            {
+                start = stoul(range.substr(range.find('=') + 1));
+            }
+            if (start >= body.size())
+            {
+                head << "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Length: 0\r\n";
+                start = body.size();
+            }
+            else if (start > 0)
+            {
+                head << "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes " << start << "-" << body.size() - 1
+                     << "/" << body.size() << "\r\nContent-Length: " << body.size() - start << "\r\n";
+            }
+            else
+            {
+                head << "HTTP/1.1 200 OK\r\nContent-Length: " << body.size() << "\r\n";
+            }
+            head << "ETag: " << etag << "\r\n";
+        }
+        head << "Connection: close\r\n\r\n";
+
+        size_t end = body.size();
+        if (path == "/file" && dropAfterBytes > 0)
+        {
+            end = min(end, start + dropAfterBytes.exchange(0));
+        }
+        string response = head.str();
+        if (path == "/file")
+        {
+            response += body.substr(start, end - start);
+        }
+        size_t sent = 0;
+        while (sent < response.size())
+        {
+            ssize_t count = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (count <= 0)
+            {
+                return;
+            }
+            sent += static_cast<size_t>(count);
+        }
+    }
+
+    string body;
+    int listenFd;
+    uint16_t port;
+    atomic<bool> stopping{false};
+    thread server;
+    mutex requestsLock;
+    vector<string> requests;
+};
+
+class FileDownloaderFixture : public ::testing::Test
+{
+  public:
+    const string destination = "/tmp/device-client-download-test";
+    string body;
+    string bodySha256;
+
+    unique_ptr<ApiHandle> apiHandle;
+    unique_ptr<Io::EventLoopGroup> eventLoopGroup;
+    unique_ptr<Io::DefaultHostResolver> hostResolver;
+    unique_ptr<Io::ClientBootstrap> bootstrap;
+    unique_ptr<LocalHttpServer> server;
+
+    void SetUp() override
+    {
+        apiHandle = unique_ptr<ApiHandle>(new ApiHandle());
+        eventLoopGroup = unique_ptr<Io::EventLoopGroup>(new Io::EventLoopGroup(1));
+        hostResolver = unique_ptr<Io::DefaultHostResolver>(new Io::DefaultHostResolver(*eventLoopGroup, 8, 30));
+        bootstrap = unique_ptr<Io::ClientBootstrap>(new Io::ClientBootstrap(*eventLoopGroup, *hostResolver));
+        bootstrap->EnableBlockingShutdown();
+
+        mt19937 random(42);
+        body.resize(512 * 1024);
+        for (char &c : body)
+        {
+            c = static_cast<char>(random());
+        }
+        uint8_t digest[Crypto::SHA256_DIGEST_SIZE];
+        ByteBuf digestBuffer = aws_byte_buf_from_empty_array(digest, sizeof(digest));
+        ByteCursor bodyCursor = ByteCursorFromArray(reinterpret_cast<const uint8_t *>(body.data()), body.size());
+        Crypto::ComputeSHA256(ApiAllocator(), bodyCursor, digestBuffer);
+        char hex[3];
+        for (uint8_t byte : digest)
+        {
+            snprintf(hex, sizeof(hex), "%02x", byte);
+            bodySha256 += hex;
+        }
+
+        server = unique_ptr<LocalHttpServer>(new LocalHttpServer(body));
+    }
+
+    void TearDown() override
+    {
+        server.reset();
+        remove(destination.c_str());
+        remove((destination + FileDownloader::PART_FILE_SUFFIX).c_str());
+        remove((destination + FileDownloader::PART_INFO_SUFFIX).c_str());
+    }
+
+    FileDownloader::Request requestFor(const string &path) const
+    {
+        FileDownloader::Request request;
+        request.url = server->url(path);
+        request.destination = destination;
+        request.sha256 = bodySha256;
+        return request;
+    }
+
+    string readDestination() const
+    {
+        ifstream file(destination, ios::binary);
+        return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    }
+
+    /** Leaves a part file as if an earlier download of the file was interrupted **/
+    void writePartFile(size_t length, const string &validator) const
+    {
+        ofstream(destination + FileDownloader::PART_FILE_SUFFIX, ios::binary) << body.substr(0, length);
+        ofstream(destination + FileDownloader::PART_INFO_SUFFIX) << server->url("/file") << '\n'
+                                                                 << validator << '\n';
+    }
+};
+
+TEST_F(FileDownloaderFixture, DownloadsFileAndVerifiesDigest)
+{
+    FileDownloader downloader(bootstrap.get());
+    ASSERT_TRUE(downloader.download(requestFor("/file"))) << downloader.getError();
+
+    ASSERT_EQ(body, readDestination());
+    ASSERT_EQ(bodySha256, downloader.getSha256());
+    ASSERT_FALSE(FileUtils::FileExists(destination + FileDownloader::PART_FILE_SUFFIX));
+    ASSERT_FALSE(FileUtils::FileExists(destination + FileDownloader::PART_INFO_SUFFIX));
+}
+
+TEST_F(FileDownloaderFixture, ResumesAfterConnectionDrops)
+{
+    server->dropAfterBytes = 200 * 1024;
+    FileDownloader downloader(bootstrap.get(), ApiAllocator(), 3, 10);
+    ASSERT_TRUE(downloader.download(requestFor("/file"))) << downloader.getError();
+
+    ASSERT_EQ(body, readDestination());
+    vector<string> requests = server->getRequests();
+    ASSERT_EQ(2u, requests.size());
+    ASSERT_EQ(string::npos, requests[0].find("Range: "));
+    ASSERT_NE(string::npos, requests[1].find("Range: bytes="));
+    ASSERT_NE(string::npos, requests[1].find("If-Range: " + server->etag));
+}
+
+TEST_F(FileDownloaderFixture, ResumesPartFileOfEarlierDownload)
+{
+    writePartFile(1000, server->etag);
+    FileDownloader downloader(bootstrap.get());
+    ASSERT_TRUE(downloader.download(requestFor("/file"))) << downloader.getError();
+
+    ASSERT_EQ(body, readDestination());
+    ASSERT_NE(string::npos, server->getRequests()[0].find("Range: bytes=1000-"));
+}
+
+TEST_F(FileDownloaderFixture, RestartsWhenFileChangedOnServer)
+{
+    writePartFile(1000, "\"v0\"");
+    FileDownloader downloader(bootstrap.get());
+    ASSERT_TRUE(downloader.download(requestFor("/file"))) << downloader.getError();
+
+    ASSERT_EQ(body, readDestination());
+}
+
+TEST_F(FileDownloaderFixture, RejectsDigestMismatch)
+{
+    FileDownloader::Request request = requestFor("/file");
+    request.sha256 = string(64, '0');
+    FileDownloader downloader(bootstrap.get());
+    ASSERT_FALSE(downloader.download(request));
+
+    ASSERT_NE(string::npos, downloader.getError().find("does not match"));
+    ASSERT_FALSE(FileUtils::FileExists(destination));
+    ASSERT_FALSE(FileUtils::FileExists(destination + FileDownloader::PART_FILE_SUFFIX));
+}
+
+TEST_F(FileDownloaderFixture, FollowsRedirects)
+{
+    FileDownloader downloader(bootstrap.get());
+    ASSERT_TRUE(downloader.download(requestFor("/redirect"))) << downloader.getError();
+
+    ASSERT_EQ(body, readDestination());
+    ASSERT_EQ(2u, server->getRequests().size());
+}
+
+TEST_F(FileDownloaderFixture, DoesNotRetryClientErrors)
+{
+    FileDownloader downloader(bootstrap.get(), ApiAllocator(), 3, 10);
+    ASSERT_FALSE(downloader.download(requestFor("/missing")));
+
+    ASSERT_EQ(1u, server->getRequests().size());
+    ASSERT_FALSE(FileUtils::FileExists(destination));
+}
+
+TEST_F(FileDownloaderFixture, LimitsBandwidth)
+{
+    FileDownloader::Request request = requestFor("/file");
+    request.maxBytesPerSecond = 1024 * 1024;
+    FileDownloader downloader(bootstrap.get());
+
+    auto start = chrono::steady_clock::now();
+    ASSERT_TRUE(downloader.download(request)) << downloader.getError();
+    auto elapsed = chrono::steady_clock::now() - start;
+
+    // Half a MiB at one MiB per second
+    ASSERT_GE(elapsed, chrono::milliseconds(450));
+    ASSERT_EQ(body, readDestination());
+}
@@ -3,6 +3,7 @@
 
 #include "../../source/SharedCrtResourceManager.h"
 #include "../../source/jobs/JobDocument.h"
+#include "../../source/util/StringUtils.h"
 #include "../../source/util/UniqueString.h"
 
 #include "gtest/gtest.h"
@@ -662,4 +663,124 @@ TEST(JobDocument, oldJobDocumentCompatibility)
     jobDocument.LoadFromJobDocument(jsonView);
 
     ASSERT_TRUE(jobDocument.Validate());
-}
\ No newline at end of file
+}
+TEST(JobDocument, DownloadAction)
+{
+    constexpr char jsonString[] = R"(
+{
+    "version": "1.0",
+    "steps": [
+        {
+            "action": {
+                "name": "downloadFirmware",
+                "type": "download",
+                "input": {
+                    "url": "https://example.com/firmware.bin",
+                    "path": "firmware/firmware.bin",
+                    "sha256": "E3B0C44298FC1C149AFBF4C8996FB92427AE41E4649B934CA495991B7852B855",
+                    "maxBytesPerSecond": 65536
+                }
+            }
+        }
+    ]
+})";
+
+    // Initializing allocator, so we can use CJSON lib from SDK in our unit tests.
+    SharedCrtResourceManager resourceManager;
+    resourceManager.initializeAllocator();
+
+    JsonObject jsonObject(jsonString);
+    JsonView jsonView = jsonObject.View();
+
+    PlainJobDocument jobDocument;
+    jobDocument.LoadFromJobDocument(jsonView);
+
+    ASSERT_TRUE(jobDocument.Validate());
+    const auto &input = jobDocument.steps[0].downloadInput;
+    ASSERT_TRUE(input.has_value());
+    ASSERT_STREQ("https://example.com/firmware.bin", input->url.c_str());
+    ASSERT_STREQ("firmware/firmware.bin", input->path.c_str());
+    ASSERT_EQ(65536, input->maxBytesPerSecond.value());
+}
+
+TEST(JobDocument, DownloadActionWithInvalidInput)
+{
+    constexpr char jsonTemplate[] = R"(
+{
+    "version": "1.0",
+    "steps": [
+        {
+            "action": {
+                "name": "downloadFirmware",
+                "type": "download",
+                "input": %s
+            }
+        }
+    ]
+})";
+    const vector<string> invalidInputs = {
+        R"({"url": "ftp://example.com/firmware.bin", "path": "/tmp/firmware.bin"})",
+        R"({"url": "https://example.com/firmware.bin", "path": ""})",
+        R"({"url": "https://example.com/firmware.bin", "path": "firmware/"})",
+        R"({"url": "https://example.com/firmware.bin", "path": "../firmware.bin"})",
+        R"({"url": "https://example.com/firmware.bin", "path": "firmware/../../etc/sudoers"})",
+        R"({"url": "https://example.com/firmware.bin", "path": "/var/lib/downloads/.."})",
+        R"({"url": "https://example.com/firmware.bin", "path": "/tmp/firmware.bin", "sha256": "abc"})",
+        R"({"url": "https://example.com/firmware.bin", "path": "/tmp/firmware.bin", "maxBytesPerSecond": 0})"};
+
+    // Initializing allocator, so we can use CJSON lib from SDK in our unit tests.
+    SharedCrtResourceManager resourceManager;
+    resourceManager.initializeAllocator();
+
+    for (const auto &input : invalidInputs)
+    {
+        JsonObject jsonObject(Aws::Iot::DeviceClient::Util::FormatMessage(jsonTemplate, input.c_str()).c_str());
+        JsonView jsonView = jsonObject.View();
+
+        PlainJobDocument jobDocument;
+        jobDocument.LoadFromJobDocument(jsonView);
+
+        ASSERT_FALSE(jobDocument.Validate()) << input;
+    }
+}
+
+TEST(JobDocument, Timeouts)
+{
+    constexpr char jsonString[] = R"(
+{
+    "version": "1.0",
+    "timeoutSeconds": 3600,
+    "steps": [
+        {
+            "action": {
+                "name": "installPackages",
+                "type": "runHandler",
+                "input": {
+                    "handler": "install-packages.sh"
+                },
+                "timeoutSeconds": 1800
+            }
+        }
+    ]
+})";
+
+    // Initializing allocator, so we can use CJSON lib from SDK in our unit tests.
+    SharedCrtResourceManager resourceManager;
+    resourceManager.initializeAllocator();
+
+    JsonObject jsonObject(jsonString);
+    JsonView jsonView = jsonObject.View();
+
+    PlainJobDocument jobDocument;
+    jobDocument.LoadFromJobDocument(jsonView);
+
+    ASSERT_TRUE(jobDocument.Validate());
+    ASSERT_EQ(3600, jobDocument.timeoutSeconds.value());
+    ASSERT_EQ(1800, jobDocument.steps[0].timeoutSeconds.value());
+
+    jobDocument.steps[0].timeoutSeconds = 0;
+    ASSERT_FALSE(jobDocument.Validate());
+    jobDocument.steps[0].timeoutSeconds = 1800;
+    jobDocument.timeoutSeconds = -1;
+    ASSERT_FALSE(jobDocument.Validate());
+}
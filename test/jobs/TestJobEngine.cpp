@@ -4,7 +4,9 @@
 #include "../../source/jobs/JobEngine.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include <chrono>
 #include <fstream>
+#include <thread>
 
 using namespace std;
 using namespace Aws;
@@ -74,6 +76,7 @@ const string testHandlerDirectoryPath = "/tmp/device-client-tests";
 const string successHandlerPath = testHandlerDirectoryPath + "/successHandler";
 const string errorHandlerPath = testHandlerDirectoryPath + "/errorHandler";
 const string successCreatedFile = testHandlerDirectoryPath + "/test-success";
+const string backgroundPidFile = testHandlerDirectoryPath + "/background-pid";
 
 const string testStdout = "This is test stdout";
 const string testStderr = "This is test stderr";
@@ -101,6 +104,7 @@ class TestJobEngine : public testing::Test
         std::remove(successHandlerPath.c_str());
         std::remove(errorHandlerPath.c_str());
         std::remove(successCreatedFile.c_str());
+        std::remove(backgroundPidFile.c_str());
         std::remove(testHandlerDirectoryPath.c_str());
     }
 };
@@ -138,6 +142,26 @@ TEST_F(TestJobEngine, ExecuteSucceedThenFail)
     ASSERT_STREQ(jobEngine.getStdErr().c_str(), std::string(testStderr + "\n").c_str());
 }
 
+TEST_F(TestJobEngine, TracksCurrentStep)
+{
+    vector<PlainJobDocument::JobAction> steps;
+    vector<std::string> args;
+    vector<std::string> command;
+    steps.push_back(createJobAction(
+        "firstAction", "runHandler", "successHandler", args, command, "/tmp/device-client-tests/", nullptr, false));
+    PlainJobDocument::JobAction finalStep = createJobAction(
+        "finalAction", "runHandler", "successHandler", args, command, "/tmp/device-client-tests/", nullptr, false);
+    PlainJobDocument jobDocument = createTestJobDocument(steps, finalStep, true);
+    JobEngine jobEngine;
+    ASSERT_EQ(0u, jobEngine.getStepProgress().step);
+
+    ASSERT_EQ(0, jobEngine.exec_steps(jobDocument, testHandlerDirectoryPath));
+    JobEngine::StepProgress progress = jobEngine.getStepProgress();
+    ASSERT_EQ(2u, progress.step);
+    ASSERT_EQ(2u, progress.totalSteps);
+    ASSERT_STREQ("finalAction", progress.name.c_str());
+}
+
 TEST_F(TestJobEngine, ExecuteFinalStepOnly)
 {
     vector<PlainJobDocument::JobAction> steps;
@@ -227,4 +251,293 @@ TEST_F(TestJobEngine, ExecuteRunCommandWithUser)
     int executionStatus = jobEngine.exec_steps(jobDocument, testHandlerDirectoryPath);
     ASSERT_EQ(executionStatus, 0);
     ASSERT_TRUE(FileUtils::FileExists(successCreatedFile));
-}
\ No newline at end of file
+}
+TEST_F(TestJobEngine, ExecuteDownloadWithoutBootstrap)
+{
+    PlainJobDocument::JobAction action;
+    action.name = "testDownload";
+    action.type = "download";
+    PlainJobDocument::JobAction::ActionDownloadInput input;
+    input.url = "http://127.0.0.1/file";
+    input.path = testHandlerDirectoryPath + "/downloaded";
+    action.downloadInput = input;
+    PlainJobDocument jobDocument = createTestJobDocument({action}, true);
+    JobEngine jobEngine;
+
+    int executionStatus = jobEngine.exec_steps(jobDocument, testHandlerDirectoryPath);
+    ASSERT_NE(executionStatus, 0);
+    ASSERT_NE(jobEngine.getStdErr().length(), 0);
+    ASSERT_FALSE(FileUtils::FileExists(input.path));
+}
+
+TEST_F(TestJobEngine, ConfinesDownloadsToDownloadDirectory)
+{
+    const string downloadDir = testHandlerDirectoryPath + "/downloads";
+    const string firmwareDir = downloadDir + "/firmware";
+    const string escapeLink = downloadDir + "/escape";
+    string resolved;
+    string error;
+
+    // The download directory is created the first time it is needed
+    ASSERT_TRUE(JobEngine::resolveDownloadPath("firmware.bin", downloadDir, resolved, error)) << error;
+    ASSERT_EQ(downloadDir + "/firmware.bin", resolved);
+    ASSERT_EQ(700, FileUtils::GetFilePermissions(downloadDir));
+
+    mkdir(firmwareDir.c_str(), 0700);
+    ASSERT_TRUE(JobEngine::resolveDownloadPath(firmwareDir + "/firmware.bin", downloadDir, resolved, error)) << error;
+    ASSERT_EQ(firmwareDir + "/firmware.bin", resolved);
+
+    ASSERT_EQ(0, symlink("/etc", escapeLink.c_str()));
+    for (const string &path : {string("/etc/sudoers"), string("escape/sudoers"), string("missing/firmware.bin")})
+    {
+        ASSERT_FALSE(JobEngine::resolveDownloadPath(path, downloadDir, resolved, error)) << path;
+        ASSERT_FALSE(error.empty());
+    }
+    ASSERT_FALSE(JobEngine::resolveDownloadPath("firmware.bin", "", resolved, error));
+
+    std::remove(escapeLink.c_str());
+    std::remove(firmwareDir.c_str());
+    std::remove(downloadDir.c_str());
+}
+
+namespace
+{
+    /** Whether a process is alive, which a killed process that has not been reaped by its parent is not **/
+    bool isRunning(int pid)
+    {
+        ifstream stat("/proc/" + to_string(pid) + "/stat");
+        string skip;
+        string state;
+        return stat >> skip >> skip >> state && state != "Z";
+    }
+
+    /** A step running a shell that starts a process in the background and waits for it **/
+    PlainJobDocument::JobAction createBackgroundSleepAction(const string &name)
+    {
+        vector<std::string> command = {
+            "/bin/sh", "-c", "sleep 30 & echo $! > " + backgroundPidFile + "; echo started; wait"};
+        return createJobAction(name, "runCommand", "", {}, command, "", nullptr, false);
+    }
+} // namespace
+
+TEST_F(TestJobEngine, StepTimeoutKillsProcessGroup)
+{
+    vector<PlainJobDocument::JobAction> steps;
+    steps.push_back(createBackgroundSleepAction("hangingAction"));
+    steps[0].timeoutSeconds = 1;
+    PlainJobDocument jobDocument = createTestJobDocument(steps, true);
+    JobEngine jobEngine;
+
+    auto start = chrono::steady_clock::now();
+    int executionStatus = jobEngine.exec_steps(jobDocument, testHandlerDirectoryPath);
+    ASSERT_LT(chrono::steady_clock::now() - start, chrono::seconds(5));
+
+    ASSERT_NE(0, executionStatus);
+    ASSERT_STREQ("Step hangingAction timed out after 1 seconds", jobEngine.getReason(executionStatus).c_str());
+    ASSERT_STREQ("started\n", jobEngine.getStdOut().c_str());
+    int backgroundPid = 0;
+    ifstream(backgroundPidFile) >> backgroundPid;
+    ASSERT_NE(0, backgroundPid);
+    ASSERT_FALSE(isRunning(backgroundPid));
+}
+
+TEST_F(TestJobEngine, JobTimeoutSkipsRemainingSteps)
+{
+    vector<std::string> command = {"touch", successCreatedFile};
+    vector<PlainJobDocument::JobAction> steps;
+    steps.push_back(createBackgroundSleepAction("hangingAction"));
+    steps.push_back(createJobAction("testCreateFile", "runCommand", "", {}, command, "", nullptr, false));
+    // The step failing would end the job anyway
+    steps[0].ignoreStepFailure = true;
+    PlainJobDocument jobDocument = createTestJobDocument(steps, true);
+    jobDocument.timeoutSeconds = 1;
+    JobEngine jobEngine;
+
+    int executionStatus = jobEngine.exec_steps(jobDocument, testHandlerDirectoryPath);
+
+    ASSERT_NE(0, executionStatus);
+    ASSERT_STREQ("Job timed out after 1 seconds", jobEngine.getReason(executionStatus).c_str());
+    ASSERT_FALSE(FileUtils::FileExists(successCreatedFile));
+}
+
+TEST_F(TestJobEngine, CancelStopsRunningStep)
+{
+    vector<PlainJobDocument::JobAction> steps;
+    steps.push_back(createBackgroundSleepAction("hangingAction"));
+    PlainJobDocument jobDocument = createTestJobDocument(steps, true);
+    JobEngine jobEngine;
+
+    thread canceler([&jobEngine]() {
+        this_thread::sleep_for(chrono::milliseconds(500));
+        jobEngine.cancel();
+    });
+    auto start = chrono::steady_clock::now();
+    int executionStatus = jobEngine.exec_steps(jobDocument, testHandlerDirectoryPath);
+    canceler.join();
+    ASSERT_LT(chrono::steady_clock::now() - start, chrono::seconds(5));
+
+    ASSERT_NE(0, executionStatus);
+    ASSERT_TRUE(jobEngine.isCanceled());
+    ASSERT_STREQ("Job was canceled", jobEngine.getReason(executionStatus).c_str());
+}
+
+TEST_F(TestJobEngine, RecordsResourceUsageOfIsolatedSteps)
+{
+    // Laid out like a cgroup v2 hierarchy with the groups of both steps, since real cgroups may not be available
+    const string parent = testHandlerDirectoryPath + "/cgroup";
+    mkdir(parent.c_str(), 0700);
+    ofstream(parent + "/cgroup.controllers") << "cpu memory\n";
+    ofstream(parent + "/cgroup.subtree_control");
+    const vector<pair<string, string>> stepUsages = {
+        {"usage_usec 1000000\n", "300\n"}, {"usage_usec 500000\n", "200\n"}};
+    vector<string> stepPaths;
+    for (const auto &stepUsage : stepUsages)
+    {
+        string path = parent + "/" + StepCgroups::STEP_GROUP_PREFIX + to_string(getpid()) + "-" +
+                      to_string(stepPaths.size() + 1);
+        mkdir(path.c_str(), 0700);
+        ofstream(path + "/cgroup.procs");
+        ofstream(path + "/cgroup.events") << "populated 0\n";
+        ofstream(path + "/cpu.stat") << stepUsage.first;
+        ofstream(path + "/memory.peak") << stepUsage.second;
+        stepPaths.push_back(path);
+    }
+    auto cgroups = make_shared<StepCgroups>(StepCgroups::Limits(), parent);
+    ASSERT_TRUE(cgroups->init());
+
+    vector<PlainJobDocument::JobAction> steps;
+    vector<std::string> args;
+    vector<std::string> command;
+    steps.push_back(createJobAction(
+        "firstAction", "runHandler", "successHandler", args, command, "/tmp/device-client-tests/", nullptr, false));
+    steps.push_back(createJobAction(
+        "secondAction", "runHandler", "successHandler", args, command, "/tmp/device-client-tests/", nullptr, false));
+    PlainJobDocument jobDocument = createTestJobDocument(steps, true);
+    JobEngine jobEngine(nullptr, cgroups);
+    ASSERT_FALSE(jobEngine.getResourceUsage().has_value());
+
+    int executionStatus = jobEngine.exec_steps(jobDocument, testHandlerDirectoryPath);
+    ASSERT_EQ(0, executionStatus);
+    Crt::Optional<StepCgroups::Usage> usage = jobEngine.getResourceUsage();
+    ASSERT_TRUE(usage.has_value());
+    ASSERT_EQ(1500000u, usage->cpuTimeMicros);
+    ASSERT_EQ(300u, usage->peakMemoryBytes.value());
+    for (const string &path : stepPaths)
+    {
+        // Written by the child process of the step to move itself into the group
+        ifstream procs(path + "/cgroup.procs");
+        ASSERT_EQ("0", string(istreambuf_iterator<char>(procs), istreambuf_iterator<char>()));
+        for (const char *file : {"cgroup.procs", "cgroup.events", "cpu.stat", "memory.peak"})
+        {
+            std::remove((path + "/" + file).c_str());
+        }
+        rmdir(path.c_str());
+    }
+    for (const char *file : {"cgroup.controllers", "cgroup.subtree_control"})
+    {
+        std::remove((parent + "/" + file).c_str());
+    }
+    rmdir(parent.c_str());
+}
+
+TEST_F(TestJobEngine, ResumesAfterJournaledSteps)
+{
+    const string journalFile = testHandlerDirectoryPath + "/job-journal";
+    auto journal = make_shared<JobJournal>(journalFile);
+    JobJournal::Entry entry;
+    entry.jobId = "job";
+    entry.completedSteps = 1;
+    entry.stdOut = "before restart\n";
+
+    vector<PlainJobDocument::JobAction> steps;
+    vector<std::string> args;
+    vector<std::string> command;
+    // Fails the job if it is run again
+    steps.push_back(createJobAction(
+        "firstAction", "runHandler", "errorHandler", args, command, "/tmp/device-client-tests/", nullptr, false));
+    steps.push_back(createJobAction(
+        "secondAction", "runHandler", "successHandler", args, command, "/tmp/device-client-tests/", nullptr, false));
+    PlainJobDocument jobDocument = createTestJobDocument(steps, true);
+    JobEngine jobEngine;
+    jobEngine.useJournal(journal, entry);
+
+    int executionStatus = jobEngine.exec_steps(jobDocument, testHandlerDirectoryPath);
+    ASSERT_EQ(0, executionStatus);
+    ASSERT_EQ("before restart\n" + testStdout + "\n", jobEngine.getStdOut());
+
+    JobJournal::Entry journaled;
+    ASSERT_TRUE(journal->load(journaled));
+    ASSERT_EQ(2u, journaled.completedSteps);
+    ASSERT_EQ(0, journaled.executionStatus);
+    ASSERT_EQ(jobEngine.getStdOut(), journaled.stdOut);
+    std::remove(journalFile.c_str());
+}
+
+TEST_F(TestJobEngine, JournaledFailureEndsResumedJob)
+{
+    const string journalFile = testHandlerDirectoryPath + "/job-journal";
+    JobJournal::Entry entry;
+    entry.jobId = "job";
+    entry.completedSteps = 1;
+    entry.executionStatus = 1;
+
+    vector<PlainJobDocument::JobAction> steps;
+    vector<std::string> args;
+    vector<std::string> command;
+    steps.push_back(createJobAction(
+        "firstAction", "runHandler", "errorHandler", args, command, "/tmp/device-client-tests/", nullptr, false));
+    steps.push_back(createJobAction(
+        "secondAction", "runHandler", "successHandler", args, command, "/tmp/device-client-tests/", nullptr, false));
+    PlainJobDocument jobDocument = createTestJobDocument(steps, true);
+    JobEngine jobEngine;
+    jobEngine.useJournal(make_shared<JobJournal>(journalFile), entry);
+
+    int executionStatus = jobEngine.exec_steps(jobDocument, testHandlerDirectoryPath);
+    ASSERT_EQ(1, executionStatus);
+    ASSERT_TRUE(jobEngine.getStdOut().empty());
+    std::remove(journalFile.c_str());
+}
+
+TEST_F(TestJobEngine, SendsStepsToResidentHandler)
+{
+    // Responds to each step with its process ID on stdout and its arguments on stderr
+    const string residentHandlerPath = testHandlerDirectoryPath + "/residentHandler";
+    ofstream(residentHandlerPath) << R"(#!/bin/bash
+export LC_ALL=C
+while read -r count; do
+    args=()
+    for ((i = 0; i < count; i++)); do
+        read -r length
+        IFS= read -r -N "$length" arg
+        read -r
+        args+=("$arg")
+    done
+    out="$$"$'\n'
+    err="${args[*]}"$'\n'
+    printf '0 %d %d\n%s%s' "${#out}" "${#err}" "$out" "$err"
+done
+)";
+    chmod(residentHandlerPath.c_str(), 0700);
+
+    vector<PlainJobDocument::JobAction> steps;
+    vector<std::string> command;
+    steps.push_back(createJobAction(
+        "firstAction", "runHandler", "residentHandler", {"a"}, command, "/tmp/device-client-tests/", nullptr, false));
+    steps.push_back(createJobAction(
+        "secondAction", "runHandler", "residentHandler", {"b"}, command, "/tmp/device-client-tests/", nullptr, false));
+    PlainJobDocument jobDocument = createTestJobDocument(steps, true);
+    {
+        auto residentHandlers =
+            make_shared<ResidentHandlers>(testHandlerDirectoryPath, vector<string>{"residentHandler"});
+        JobEngine jobEngine(nullptr, nullptr, residentHandlers);
+
+        int executionStatus = jobEngine.exec_steps(jobDocument, testHandlerDirectoryPath);
+        ASSERT_EQ(0, executionStatus);
+        // Both steps were served by the same process
+        string stdOut = jobEngine.getStdOut();
+        ASSERT_EQ(stdOut.substr(0, stdOut.size() / 2), stdOut.substr(stdOut.size() / 2));
+        ASSERT_EQ(" a\n b\n", jobEngine.getStdErr());
+        ASSERT_EQ(2, jobEngine.hasErrors());
+    }
+    std::remove(residentHandlerPath.c_str());
+}
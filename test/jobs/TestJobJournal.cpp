@@ -0,0 +1,97 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/jobs/JobJournal.h"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Jobs;
+
+class JobJournalFixture : public ::testing::Test
+{
+  public:
+    const string file = "/tmp/device-client-job-journal-test";
+
+    void TearDown() override { remove(file.c_str()); }
+
+    static JobJournal::Entry createEntry()
+    {
+        JobJournal::Entry entry;
+        entry.jobId = "job-1";
+        entry.executionNumber = 3;
+        entry.documentHash = JobJournal::formatDigest(0x0123456789abcdefULL);
+        entry.completedSteps = 2;
+        entry.executionStatus = 0;
+        entry.stdOut = "first line\nsecond line\n";
+        entry.stdErr = "";
+        entry.errors = 1;
+        return entry;
+    }
+};
+
+TEST_F(JobJournalFixture, StoresAndLoadsEntry)
+{
+    JobJournal journal(file);
+    JobJournal::Entry stored = createEntry();
+    ASSERT_TRUE(journal.store(stored));
+
+    JobJournal::Entry loaded;
+    ASSERT_TRUE(journal.load(loaded));
+    ASSERT_TRUE(loaded.isSameExecution(stored));
+    ASSERT_EQ(2u, loaded.completedSteps);
+    ASSERT_EQ(0, loaded.executionStatus);
+    ASSERT_EQ(stored.stdOut, loaded.stdOut);
+    ASSERT_EQ(stored.stdErr, loaded.stdErr);
+    ASSERT_EQ(1, loaded.errors);
+
+    struct stat info;
+    ASSERT_EQ(0, stat(file.c_str(), &info));
+    ASSERT_EQ(static_cast<mode_t>(S_IRUSR | S_IWUSR), info.st_mode & 0777);
+}
+
+TEST_F(JobJournalFixture, LoadWithoutEntry)
+{
+    JobJournal journal(file);
+    JobJournal::Entry loaded;
+    ASSERT_FALSE(journal.load(loaded));
+}
+
+TEST_F(JobJournalFixture, IgnoresTruncatedEntry)
+{
+    JobJournal journal(file);
+    ASSERT_TRUE(journal.store(createEntry()));
+    ifstream input(file);
+    string contents(istreambuf_iterator<char>(input), (istreambuf_iterator<char>()));
+    ofstream(file, ios::trunc) << contents.substr(0, contents.size() - 5);
+
+    JobJournal::Entry loaded;
+    ASSERT_FALSE(journal.load(loaded));
+}
+
+TEST_F(JobJournalFixture, ClearRemovesEntry)
+{
+    JobJournal journal(file);
+    ASSERT_TRUE(journal.store(createEntry()));
+    journal.clear();
+
+    JobJournal::Entry loaded;
+    ASSERT_FALSE(journal.load(loaded));
+}
+
+TEST_F(JobJournalFixture, DistinguishesExecutions)
+{
+    JobJournal::Entry entry = createEntry();
+    JobJournal::Entry nextExecution = createEntry();
+    nextExecution.executionNumber++;
+    JobJournal::Entry changedDocument = createEntry();
+    changedDocument.documentHash = JobJournal::formatDigest(0x0123456789abcdeeULL);
+
+    ASSERT_FALSE(entry.isSameExecution(nextExecution));
+    ASSERT_FALSE(entry.isSameExecution(changedDocument));
+    ASSERT_EQ("0123456789abcdef", entry.documentHash);
+}
@@ -0,0 +1,167 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/jobs/JobPlan.h"
+#include "../../source/util/FileUtils.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient;
+using namespace Aws::Iot::DeviceClient::Jobs;
+
+namespace
+{
+    const string handlerDir = "/tmp/device-client-plan-tests";
+    const string handlerPath = handlerDir + "/handler.sh";
+
+    PlainJobDocument::JobAction handlerAction(const string &name, const string &path, const vector<string> &args)
+    {
+        PlainJobDocument::JobAction action;
+        action.name = name;
+        action.type = PlainJobDocument::ACTION_TYPE_RUN_HANDLER;
+        action.runAsUser = "user";
+        PlainJobDocument::JobAction::ActionHandlerInput input;
+        input.handler = "handler.sh";
+        input.path = path;
+        input.args = args;
+        action.handlerInput = input;
+        return action;
+    }
+
+    PlainJobDocument::JobCondition condition(const string &key, const vector<string> &values, const string &type)
+    {
+        PlainJobDocument::JobCondition jobCondition;
+        jobCondition.conditionKey = key;
+        jobCondition.conditionValue = values;
+        jobCondition.type = type;
+        return jobCondition;
+    }
+
+    vector<string> argvOf(const vector<const char *> &argv)
+    {
+        EXPECT_EQ(nullptr, argv.back());
+        return vector<string>(argv.begin(), prev(argv.end()));
+    }
+} // namespace
+
+class TestJobPlan : public ::testing::Test
+{
+  public:
+    void SetUp() override
+    {
+        Util::FileUtils::CreateDirectoryWithPermissions(handlerDir.c_str(), 0700);
+        ofstream(handlerPath) << "echo handled" << endl;
+        chmod(handlerPath.c_str(), 0700);
+        document.version = "1.0";
+    }
+
+    void TearDown() override
+    {
+        remove(handlerPath.c_str());
+        rmdir(handlerDir.c_str());
+    }
+
+    PlainJobDocument document;
+};
+
+TEST_F(TestJobPlan, ResolvesHandlersAndBuildsTheirArgv)
+{
+    document.steps.push_back(handlerAction("default", "default", {"a b", "c"}));
+    document.steps.push_back(handlerAction("supplied", "/opt/handlers", {}));
+    document.finalStep = handlerAction("final", "", {"d"});
+    JobPlan plan(document, handlerDir);
+
+    ASSERT_EQ(3u, plan.getTotalSteps());
+    const auto &steps = plan.getSteps();
+    ASSERT_EQ(handlerPath, steps[0].command);
+    ASSERT_TRUE(steps[0].error.empty());
+    ASSERT_EQ(vector<string>({handlerPath, "user", "a b", "c"}), argvOf(steps[0].argv));
+    ASSERT_EQ(handlerPath + " user a b c ", steps[0].description);
+    ASSERT_EQ(vector<string>({"/opt/handlers/handler.sh", "user"}), argvOf(steps[1].argv));
+    ASSERT_NE(nullptr, plan.getFinalStep());
+    ASSERT_EQ(vector<string>({"handler.sh", "user", "d"}), argvOf(plan.getFinalStep()->argv));
+}
+
+TEST_F(TestJobPlan, BuildsArgvOfCommandsWithAndWithoutSudo)
+{
+    PlainJobDocument::JobAction action;
+    action.name = "command";
+    action.type = PlainJobDocument::ACTION_TYPE_RUN_COMMAND;
+    action.runAsUser = "user";
+    PlainJobDocument::JobAction::ActionCommandInput input;
+    input.command = {"echo", "hello"};
+    action.commandInput = input;
+    document.steps.push_back(action);
+    JobPlan plan(document, handlerDir);
+
+    const auto &step = plan.getSteps().front();
+    ASSERT_EQ("echo", step.command);
+    ASSERT_EQ(vector<string>({"echo", "hello"}), argvOf(step.argv));
+    ASSERT_EQ(vector<string>({"sudo", "-u", "user", "-n", "echo", "hello"}), argvOf(step.sudoArgv));
+    ASSERT_EQ(nullptr, plan.getFinalStep());
+}
+
+TEST_F(TestJobPlan, RecordsHandlerWithUnacceptablePermissions)
+{
+    chmod(handlerPath.c_str(), 0755);
+    document.steps.push_back(handlerAction("default", "default", {}));
+    JobPlan plan(document, handlerDir);
+
+    const auto &step = plan.getSteps().front();
+    ASSERT_FALSE(step.error.empty());
+    ASSERT_TRUE(step.argv.empty());
+}
+
+TEST_F(TestJobPlan, EvaluatesConditionsOnKnownAttributes)
+{
+    document.steps.push_back(handlerAction("default", "default", {}));
+    document.conditions = vector<PlainJobDocument::JobCondition>(
+        {condition("operatingSystem", {"ubuntu", "redhat"}, JobPlan::CONDITION_TYPE_STRING_EQUAL),
+         condition("OS", {"16.0"}, JobPlan::CONDITION_TYPE_STRING_EQUAL)});
+
+    ASSERT_TRUE(JobPlan(document, handlerDir).areConditionsMet());
+    ASSERT_TRUE(JobPlan(document, handlerDir, {{"operatingSystem", "redhat"}}).areConditionsMet());
+
+    JobPlan unmet(document, handlerDir, {{"operatingSystem", "redhat"}, {"OS", "18.0"}});
+    ASSERT_FALSE(unmet.areConditionsMet());
+    ASSERT_EQ("Attribute OS of the device is 18.0, which the condition does not allow", unmet.getUnmetCondition());
+
+    document.conditions->front().type = "stringNotEqual";
+    ASSERT_FALSE(JobPlan(document, handlerDir, {{"operatingSystem", "debian"}}).areConditionsMet());
+}
+
+TEST_F(TestJobPlan, CompilesFiftyStepDocument)
+{
+    // A microbenchmark of the work moved out of the steps: resolving 50 handlers, checking their permissions and
+    // building their argv and log lines
+    constexpr size_t stepCount = 50;
+    constexpr int compilations = 100;
+    for (size_t i = 0; i < stepCount; i++)
+    {
+        document.steps.push_back(handlerAction("step" + to_string(i), "default", {to_string(i), "--verbose"}));
+    }
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < compilations; i++)
+    {
+        JobPlan plan(document, handlerDir);
+        ASSERT_EQ(stepCount, plan.getTotalSteps());
+    }
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+    RecordProperty("microsPerPlan", static_cast<int>(elapsed.count() / compilations));
+
+    JobPlan plan(document, handlerDir);
+    for (size_t i = 0; i < stepCount; i++)
+    {
+        const auto &step = plan.getSteps()[i];
+        ASSERT_TRUE(step.error.empty());
+        ASSERT_EQ(vector<string>({handlerPath, "user", to_string(i), "--verbose"}), argvOf(step.argv));
+    }
+}
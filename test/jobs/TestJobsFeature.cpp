@@ -4,6 +4,8 @@
 #include "../../source/Feature.h"
 #include "../../source/jobs/JobsFeature.h"
 #include <aws/iotjobs/IotJobsClient.h>
+#include <aws/iotjobs/JobExecutionState.h>
+#include <aws/iotjobs/NextJobExecutionChangedEvent.h>
 #include <aws/iotjobs/NextJobExecutionChangedSubscriptionRequest.h>
 #include <aws/iotjobs/StartNextPendingJobExecutionRequest.h>
 #include <aws/iotjobs/StartNextPendingJobExecutionSubscriptionRequest.h>
@@ -15,6 +17,9 @@
 #include <aws/iotjobs/RejectedError.h>
 #include <aws/iotjobs/StartNextJobExecutionResponse.h>
 #include <aws/iotjobs/UpdateJobExecutionResponse.h>
+#include <atomic>
+#include <future>
+#include <thread>
 
 using namespace std;
 using namespace testing;
@@ -228,12 +233,16 @@ class MockNotifier : public Aws::Iot::DeviceClient::ClientBaseNotifier
 class MockJobEngine : public JobEngine
 {
   public:
-    MOCK_METHOD(void, processCmdOutput, (int fd, bool isStdErr, int childPID), (override));
-    MOCK_METHOD(int, exec_steps, (PlainJobDocument jobDocument, const std::string &jobHandlerDir), (override));
+    MOCK_METHOD(void, processCmdOutput, (const string &line, bool isStdErr, int childPID), (override));
+    MOCK_METHOD(int, exec_steps, (std::shared_ptr<const JobPlan> plan), (override));
     MOCK_METHOD(int, hasErrors, (), (override));
     MOCK_METHOD(string, getReason, (int statusCode), (override));
     MOCK_METHOD(string, getStdOut, (), (override));
     MOCK_METHOD(string, getStdErr, (), (override));
+    MOCK_METHOD(StepProgress, getStepProgress, (), (override));
+    MOCK_METHOD(void, cancel, (), (override));
+    MOCK_METHOD(bool, isCanceled, (), (override));
+    MOCK_METHOD(Aws::Crt::Optional<StepCgroups::Usage>, getResourceUsage, (), (override));
 };
 
 class MockJobsFeature : public JobsFeature
@@ -369,7 +378,7 @@ TEST_F(TestJobsFeature, ExecuteJobHappy)
     string stdoutput = "test output";
 
     EXPECT_CALL(*jobsMock, createJobEngine()).Times(1).WillOnce(Return(mockEngine));
-    EXPECT_CALL(*mockEngine, exec_steps(_, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mockEngine, exec_steps(_)).WillOnce(Return(0));
     EXPECT_CALL(*mockEngine, hasErrors()).WillOnce(Return(1));
     EXPECT_CALL(*mockEngine, getReason(_)).WillOnce(Return(""));
     EXPECT_CALL(*mockEngine, getStdOut()).WillOnce(Return(stdoutput));
@@ -426,6 +435,66 @@ TEST_F(TestJobsFeature, ExecuteJobHappy)
     EXPECT_EQ(std::future_status::ready, promise.get_future().wait_for(std::chrono::seconds(3)));
 }
 
+TEST_F(TestJobsFeature, ReportsResourceUsageOfSteps)
+{
+    /**
+     * Verifies the CPU time and peak memory of steps run in cgroups are included in the status details of the final
+     * job execution update
+     */
+    const JobExecutionData job = getSampleJobExecution("job1", 1);
+    startNextJobExecutionResponse->Execution = Aws::Crt::Optional<JobExecutionData>(job);
+
+    std::promise<void> promise;
+    auto setPromise = [&promise]() -> void { promise.set_value(); };
+    Aws::Crt::Map<Aws::Crt::String, Aws::Crt::String> statusDetails;
+
+    StepCgroups::Usage usage;
+    usage.cpuTimeMicros = 2500000;
+    usage.peakMemoryBytes = 64 * 1024 * 1024;
+
+    EXPECT_CALL(*jobsMock, createJobEngine()).Times(1).WillOnce(Return(mockEngine));
+    EXPECT_CALL(*mockEngine, exec_steps(_)).WillOnce(Return(0));
+    EXPECT_CALL(*mockEngine, hasErrors()).WillOnce(Return(0));
+    EXPECT_CALL(*mockEngine, getReason(_)).WillOnce(Return(""));
+    EXPECT_CALL(*mockEngine, getStdOut()).WillOnce(Return(""));
+    EXPECT_CALL(*mockEngine, getStdErr()).WillOnce(Return(""));
+    EXPECT_CALL(*mockEngine, getResourceUsage()).WillOnce(Return(Aws::Crt::Optional<StepCgroups::Usage>(usage)));
+
+    EXPECT_CALL(*jobsMock, createJobsClient()).Times(1).WillOnce(Return(mockClient));
+    EXPECT_CALL(*mockClient, SubscribeToStartNextPendingJobExecutionAccepted(_, _, _, _))
+        .WillOnce(DoAll(InvokeArgument<3>(0), InvokeArgument<2>(startNextJobExecutionResponse.get(), 0)));
+    EXPECT_CALL(*mockClient, SubscribeToStartNextPendingJobExecutionRejected(_, _, _, _))
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(*mockClient, SubscribeToNextJobExecutionChangedEvents(_, _, _, _)).WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(*mockClient, SubscribeToUpdateJobExecutionAccepted(_, _, _, _)).WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(*mockClient, SubscribeToUpdateJobExecutionRejected(_, _, _, _)).WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(*mockClient, PublishStartNextPendingJobExecution(_, _, _)).WillOnce(InvokeArgument<2>(0));
+
+    EXPECT_CALL(
+        *jobsMock,
+        publishUpdateJobExecutionStatusWithRetry(
+            JobExecutionEq(job),
+            StatusInfoEq(JobsFeature::JobExecutionStatusInfo(Iotjobs::JobStatus::IN_PROGRESS, "", "", "")),
+            IsEmpty(),
+            IsNull()))
+        .Times(1);
+    EXPECT_CALL(
+        *jobsMock,
+        publishUpdateJobExecutionStatusWithRetry(
+            JobExecutionEq(job),
+            StatusInfoEq(JobsFeature::JobExecutionStatusInfo(Iotjobs::JobStatus::SUCCEEDED, "", "", "")),
+            _,
+            _))
+        .WillOnce(DoAll(SaveArg<2>(&statusDetails), InvokeWithoutArgs(setPromise)));
+
+    jobsMock->init(std::shared_ptr<Mqtt::MqttConnection>(), notifier, config);
+    jobsMock->invokeRunJobs();
+
+    ASSERT_EQ(std::future_status::ready, promise.get_future().wait_for(std::chrono::seconds(3)));
+    ASSERT_STREQ("2500", statusDetails["cpuTimeMillis"].c_str());
+    ASSERT_STREQ("67108864", statusDetails["peakMemoryBytes"].c_str());
+}
+
 TEST_F(TestJobsFeature, ExecuteJobStderror)
 {
     /**
@@ -446,7 +515,7 @@ TEST_F(TestJobsFeature, ExecuteJobStderror)
 
     EXPECT_CALL(*jobsMock, createJobEngine()).Times(1).WillOnce(Return(mockEngine));
 
-    EXPECT_CALL(*mockEngine, exec_steps(_, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mockEngine, exec_steps(_)).WillOnce(Return(0));
     EXPECT_CALL(*mockEngine, hasErrors()).WillOnce(Return(1));
     EXPECT_CALL(*mockEngine, getReason(_)).WillOnce(Return(""));
     EXPECT_CALL(*mockEngine, getStdOut()).WillOnce(Return(""));
@@ -524,7 +593,7 @@ TEST_F(TestJobsFeature, ExecuteJobStdOutAndStderror)
 
     EXPECT_CALL(*jobsMock, createJobEngine()).Times(1).WillOnce(Return(mockEngine));
 
-    EXPECT_CALL(*mockEngine, exec_steps(_, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mockEngine, exec_steps(_)).WillOnce(Return(0));
     EXPECT_CALL(*mockEngine, hasErrors()).WillOnce(Return(1));
     EXPECT_CALL(*mockEngine, getReason(_)).WillOnce(Return(""));
     EXPECT_CALL(*mockEngine, getStdOut()).WillOnce(Return(stdoutput));
@@ -597,7 +666,7 @@ TEST_F(TestJobsFeature, ExecuteJobDuplicateNotificaton)
     string stdoutput = "test output";
 
     EXPECT_CALL(*jobsMock, createJobEngine()).Times(1).WillOnce(Return(mockEngine));
-    EXPECT_CALL(*mockEngine, exec_steps(_, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mockEngine, exec_steps(_)).WillOnce(Return(0));
     EXPECT_CALL(*mockEngine, hasErrors()).WillOnce(Return(1));
     EXPECT_CALL(*mockEngine, getReason(_)).WillOnce(Return(""));
     EXPECT_CALL(*mockEngine, getStdOut()).WillOnce(Return(stdoutput));
@@ -710,3 +779,316 @@ TEST_F(TestJobsFeature, InvalidJobDocument)
     jobsMock->init(std::shared_ptr<Mqtt::MqttConnection>(), notifier, config);
     jobsMock->invokeRunJobs();
 }
+
+TEST_F(TestJobsFeature, RejectsJobWhoseConditionsAreNotMet)
+{
+    /**
+     * Invoke handler callback with a job whose conditions do not allow the operating system of the device, expect
+     * JobExecution rejected without any step being executed
+     */
+    const JobExecutionData job = getSampleJobExecution("job1", 1);
+    startNextJobExecutionResponse->Execution = Aws::Crt::Optional<JobExecutionData>(job);
+    config.jobs.deviceAttributes["operatingSystem"] = "debian";
+
+    EXPECT_CALL(*jobsMock, createJobEngine()).Times(0);
+    EXPECT_CALL(*jobsMock, createJobsClient()).Times(1).WillOnce(Return(mockClient));
+
+    EXPECT_CALL(
+        *mockClient,
+        SubscribeToStartNextPendingJobExecutionAccepted(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(DoAll(InvokeArgument<3>(0), InvokeArgument<2>(startNextJobExecutionResponse.get(), 0)));
+    EXPECT_CALL(
+        *mockClient,
+        SubscribeToStartNextPendingJobExecutionRejected(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(
+        *mockClient, SubscribeToNextJobExecutionChangedEvents(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(
+        *mockClient, SubscribeToUpdateJobExecutionAccepted(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(
+        *mockClient, SubscribeToUpdateJobExecutionRejected(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(*mockClient, PublishStartNextPendingJobExecution(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<2>(0));
+
+    EXPECT_CALL(
+        *jobsMock,
+        publishUpdateJobExecutionStatusWithRetry(
+            JobExecutionEq(job),
+            StatusInfoEq(JobsFeature::JobExecutionStatusInfo(
+                Iotjobs::JobStatus::REJECTED,
+                "Unable to execute job, the device does not meet its conditions: Attribute operatingSystem of the "
+                "device is debian, which the condition does not allow",
+                "",
+                "")),
+            _,
+            _))
+        .Times(1);
+
+    jobsMock->init(std::shared_ptr<Mqtt::MqttConnection>(), notifier, config);
+    jobsMock->invokeRunJobs();
+}
+
+TEST_F(TestJobsFeature, ReportsProgressWhileStepsRun)
+{
+    /**
+     * Runs a job whose steps take long enough for two progress updates, responding to each with the next version
+     * of the job execution. Verifies the progress is reported and the second update expects the version returned
+     * by the first one
+     */
+    config.jobs.progressInterval = 1;
+    const JobExecutionData job = getSampleJobExecution("job1", 1);
+    startNextJobExecutionResponse->Execution = Aws::Crt::Optional<JobExecutionData>(job);
+
+    std::promise<void> promise;
+    auto setPromise = [&promise]() -> void { promise.set_value(); };
+
+    string stdoutput(300, 'o');
+    JobEngine::StepProgress stepProgress;
+    stepProgress.step = 1;
+    stepProgress.totalSteps = 2;
+    stepProgress.name = "install";
+
+    EXPECT_CALL(*jobsMock, createJobEngine()).Times(1).WillOnce(Return(mockEngine));
+    EXPECT_CALL(*mockEngine, exec_steps(_)).WillOnce(InvokeWithoutArgs([]() {
+        this_thread::sleep_for(chrono::milliseconds(2500));
+        return 0;
+    }));
+    EXPECT_CALL(*mockEngine, hasErrors()).WillOnce(Return(0));
+    EXPECT_CALL(*mockEngine, getReason(_)).WillOnce(Return(""));
+    EXPECT_CALL(*mockEngine, getStepProgress()).WillRepeatedly(Return(stepProgress));
+    EXPECT_CALL(*mockEngine, getStdOut()).WillRepeatedly(Return(stdoutput));
+    EXPECT_CALL(*mockEngine, getStdErr()).WillRepeatedly(Return(""));
+
+    EXPECT_CALL(*jobsMock, createJobsClient()).Times(1).WillOnce(Return(mockClient));
+
+    Iotjobs::OnSubscribeToUpdateJobExecutionAcceptedResponse acceptedHandler;
+    EXPECT_CALL(
+        *mockClient,
+        SubscribeToStartNextPendingJobExecutionAccepted(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(DoAll(InvokeArgument<3>(0), InvokeArgument<2>(startNextJobExecutionResponse.get(), 0)));
+    EXPECT_CALL(
+        *mockClient,
+        SubscribeToStartNextPendingJobExecutionRejected(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(
+        *mockClient, SubscribeToNextJobExecutionChangedEvents(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(
+        *mockClient, SubscribeToUpdateJobExecutionAccepted(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(DoAll(SaveArg<2>(&acceptedHandler), InvokeArgument<3>(0)));
+    EXPECT_CALL(
+        *mockClient, SubscribeToUpdateJobExecutionRejected(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(*mockClient, PublishStartNextPendingJobExecution(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<2>(0));
+
+    vector<UpdateJobExecutionRequest> progressUpdates;
+    int32_t version = 5;
+    EXPECT_CALL(*mockClient, PublishUpdateJobExecution(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _))
+        .Times(AtLeast(2))
+        .WillRepeatedly(Invoke([&](const UpdateJobExecutionRequest &request, Mqtt::QOS, const OnPublishComplete &) {
+            progressUpdates.push_back(request);
+            JobExecutionState state;
+            state.VersionNumber = version++;
+            UpdateJobExecutionResponse response;
+            response.ClientToken = request.ClientToken;
+            response.ExecutionState = state;
+            acceptedHandler(&response, 0);
+        }));
+
+    EXPECT_CALL(
+        *jobsMock,
+        publishUpdateJobExecutionStatusWithRetry(
+            JobExecutionEq(job),
+            StatusInfoEq(JobsFeature::JobExecutionStatusInfo(Iotjobs::JobStatus::IN_PROGRESS, "", "", "")),
+            IsEmpty(),
+            IsNull()))
+        .Times(1);
+    EXPECT_CALL(
+        *jobsMock,
+        publishUpdateJobExecutionStatusWithRetry(
+            JobExecutionEq(job),
+            StatusInfoEq(JobsFeature::JobExecutionStatusInfo(Iotjobs::JobStatus::SUCCEEDED, "", stdoutput, "")),
+            _,
+            _))
+        .WillOnce(InvokeWithoutArgs(setPromise));
+
+    jobsMock->init(std::shared_ptr<Mqtt::MqttConnection>(), notifier, config);
+    jobsMock->invokeRunJobs();
+
+    ASSERT_EQ(std::future_status::ready, promise.get_future().wait_for(std::chrono::seconds(5)));
+    ASSERT_LE(2u, progressUpdates.size());
+    ASSERT_EQ(JobStatus::IN_PROGRESS, progressUpdates[0].Status.value());
+    ASSERT_TRUE(progressUpdates[0].IncludeJobExecutionState.value());
+    ASSERT_FALSE(progressUpdates[0].ExpectedVersion.has_value());
+    ASSERT_EQ(5, progressUpdates[1].ExpectedVersion.value());
+
+    auto statusDetails = progressUpdates[0].StatusDetails.value();
+    ASSERT_STREQ("1/2", statusDetails["step"].c_str());
+    ASSERT_STREQ("install", statusDetails["stepName"].c_str());
+    ASSERT_EQ(256u, statusDetails["stdout"].size());
+    ASSERT_EQ(0u, statusDetails.count("stderr"));
+}
+
+TEST_F(TestJobsFeature, CancelsRunningJob)
+{
+    /**
+     * Runs a job whose steps only return once the engine is canceled, then notifies the Jobs feature that there is no
+     * next job anymore, as happens when the job is canceled in the service. Verifies the engine is canceled and no
+     * final update is published for the canceled job
+     */
+    const JobExecutionData job = getSampleJobExecution("job1", 1);
+    startNextJobExecutionResponse->Execution = Aws::Crt::Optional<JobExecutionData>(job);
+
+    std::promise<void> started;
+    std::promise<void> canceled;
+    std::promise<void> stopped;
+
+    EXPECT_CALL(*jobsMock, createJobEngine()).Times(1).WillOnce(Return(mockEngine));
+    EXPECT_CALL(*mockEngine, exec_steps(_)).WillOnce(InvokeWithoutArgs([&started, &canceled]() {
+        started.set_value();
+        canceled.get_future().wait_for(std::chrono::seconds(3));
+        return 143;
+    }));
+    EXPECT_CALL(*mockEngine, cancel()).WillOnce(InvokeWithoutArgs([&canceled]() { canceled.set_value(); }));
+    EXPECT_CALL(*mockEngine, isCanceled()).WillOnce(Return(true));
+
+    EXPECT_CALL(*jobsMock, createJobsClient()).Times(1).WillOnce(Return(mockClient));
+
+    Iotjobs::OnSubscribeToNextJobExecutionChangedEventsResponse nextJobChangedHandler;
+    EXPECT_CALL(
+        *mockClient,
+        SubscribeToStartNextPendingJobExecutionAccepted(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(DoAll(InvokeArgument<3>(0), InvokeArgument<2>(startNextJobExecutionResponse.get(), 0)));
+    EXPECT_CALL(
+        *mockClient,
+        SubscribeToStartNextPendingJobExecutionRejected(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(
+        *mockClient, SubscribeToNextJobExecutionChangedEvents(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(DoAll(SaveArg<2>(&nextJobChangedHandler), InvokeArgument<3>(0)));
+    EXPECT_CALL(
+        *mockClient, SubscribeToUpdateJobExecutionAccepted(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(
+        *mockClient, SubscribeToUpdateJobExecutionRejected(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(*mockClient, PublishStartNextPendingJobExecution(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<2>(0));
+
+    // Only the job being started is published
+    EXPECT_CALL(
+        *jobsMock,
+        publishUpdateJobExecutionStatusWithRetry(
+            JobExecutionEq(job),
+            StatusInfoEq(JobsFeature::JobExecutionStatusInfo(Iotjobs::JobStatus::IN_PROGRESS, "", "", "")),
+            IsEmpty(),
+            IsNull()))
+        .Times(1);
+    // Stopping the feature waits for the canceled job to end
+    EXPECT_CALL(*notifier, onEvent(_, ClientBaseEventNotification::FEATURE_STOPPED))
+        .WillOnce(InvokeWithoutArgs([&stopped]() { stopped.set_value(); }));
+
+    jobsMock->init(std::shared_ptr<Mqtt::MqttConnection>(), notifier, config);
+    jobsMock->invokeRunJobs();
+    ASSERT_EQ(std::future_status::ready, started.get_future().wait_for(std::chrono::seconds(3)));
+
+    NextJobExecutionChangedEvent event;
+    nextJobChangedHandler(&event, 0);
+    jobsMock->stop();
+
+    ASSERT_EQ(std::future_status::ready, stopped.get_future().wait_for(std::chrono::seconds(3)));
+}
+
+TEST_F(TestJobsFeature, StopCancelsAndWaitsForRunningJob)
+{
+    /**
+     * Stops the Jobs feature while a job runs, as a reload of the configuration does before it starts a new Jobs
+     * feature. Verifies the engine is canceled, stop() only returns once the job has ended, and the job is left
+     * in progress for the next Jobs feature to resume instead of being reported
+     */
+    const JobExecutionData job = getSampleJobExecution("job1", 1);
+    startNextJobExecutionResponse->Execution = Aws::Crt::Optional<JobExecutionData>(job);
+
+    std::promise<void> started;
+    std::promise<void> canceled;
+    std::atomic<bool> ended{false};
+
+    EXPECT_CALL(*jobsMock, createJobEngine()).Times(1).WillOnce(Return(mockEngine));
+    EXPECT_CALL(*mockEngine, exec_steps(_)).WillOnce(InvokeWithoutArgs([&started, &canceled, &ended]() {
+        started.set_value();
+        canceled.get_future().wait_for(std::chrono::seconds(3));
+        // Like the processes of a step exiting after SIGTERM
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        ended.store(true);
+        return 143;
+    }));
+    EXPECT_CALL(*mockEngine, cancel()).WillOnce(InvokeWithoutArgs([&canceled]() { canceled.set_value(); }));
+    EXPECT_CALL(*mockEngine, isCanceled()).WillOnce(Return(true));
+
+    EXPECT_CALL(*jobsMock, createJobsClient()).Times(1).WillOnce(Return(mockClient));
+    EXPECT_CALL(
+        *mockClient,
+        SubscribeToStartNextPendingJobExecutionAccepted(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(DoAll(InvokeArgument<3>(0), InvokeArgument<2>(startNextJobExecutionResponse.get(), 0)));
+    EXPECT_CALL(
+        *mockClient,
+        SubscribeToStartNextPendingJobExecutionRejected(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(
+        *mockClient, SubscribeToNextJobExecutionChangedEvents(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(
+        *mockClient, SubscribeToUpdateJobExecutionAccepted(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(
+        *mockClient, SubscribeToUpdateJobExecutionRejected(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<3>(0));
+    EXPECT_CALL(*mockClient, PublishStartNextPendingJobExecution(ThingNameEq(ThingName), AWS_MQTT_QOS_AT_LEAST_ONCE, _))
+        .Times(1)
+        .WillOnce(InvokeArgument<2>(0));
+
+    // Only the job being started is published
+    EXPECT_CALL(
+        *jobsMock,
+        publishUpdateJobExecutionStatusWithRetry(
+            JobExecutionEq(job),
+            StatusInfoEq(JobsFeature::JobExecutionStatusInfo(Iotjobs::JobStatus::IN_PROGRESS, "", "", "")),
+            IsEmpty(),
+            IsNull()))
+        .Times(1);
+    EXPECT_CALL(*notifier, onEvent(_, ClientBaseEventNotification::FEATURE_STOPPED)).Times(1);
+
+    jobsMock->init(std::shared_ptr<Mqtt::MqttConnection>(), notifier, config);
+    jobsMock->invokeRunJobs();
+    ASSERT_EQ(std::future_status::ready, started.get_future().wait_for(std::chrono::seconds(3)));
+
+    jobsMock->stop();
+    ASSERT_TRUE(ended.load());
+}
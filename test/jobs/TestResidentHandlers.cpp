@@ -0,0 +1,188 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/jobs/ResidentHandlers.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Jobs;
+
+/**
+ * A resident handler that responds with its process ID and arguments, unless its first argument after the user asks
+ * it to fail, exit or hang
+ */
+const string residentHandlerScript = R"(#!/bin/bash
+export LC_ALL=C
+[ "$1" = "--resident" ] || exit 2
+while read -r count; do
+    args=()
+    for ((i = 0; i < count; i++)); do
+        read -r length
+        IFS= read -r -N "$length" arg
+        read -r
+        args+=("$arg")
+    done
+    case "${args[1]}" in
+        exit) exit 1 ;;
+        hang) sleep 30 ;;
+    esac
+    out="pid $$ args ${args[*]}"$'\n'
+    err=""
+    status=0
+    if [ "${args[1]}" = "fail" ]; then
+        err="failed"$'\n'
+        status=3
+    fi
+    printf '%d %d %d\n%s%s' "$status" "${#out}" "${#err}" "$out" "$err"
+done
+)";
+
+class ResidentHandlersFixture : public ::testing::Test
+{
+  public:
+    const string handlerDir = "/tmp/device-client-resident-test";
+    const string handlerPath = handlerDir + "/resident-handler";
+
+    void SetUp() override
+    {
+        mkdir(handlerDir.c_str(), 0700);
+        ofstream(handlerPath) << residentHandlerScript;
+        chmod(handlerPath.c_str(), 0700);
+        handlers = unique_ptr<ResidentHandlers>(new ResidentHandlers(handlerDir, {"resident-handler"}));
+    }
+
+    void TearDown() override
+    {
+        handlers.reset();
+        remove(handlerPath.c_str());
+        rmdir(handlerDir.c_str());
+    }
+
+    ResidentHandlers::Outcome invoke(
+        const vector<string> &args,
+        ResidentHandlers::Response &response,
+        chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max(),
+        int wakeUpFd = -1)
+    {
+        return handlers->invoke(handlerPath, args, deadline, wakeUpFd, response);
+    }
+
+    unique_ptr<ResidentHandlers> handlers;
+};
+
+TEST_F(ResidentHandlersFixture, HandlesConfiguredHandlersOnly)
+{
+    ASSERT_TRUE(handlers->handles(handlerPath));
+    ASSERT_FALSE(handlers->handles(handlerDir + "/other-handler"));
+}
+
+TEST_F(ResidentHandlersFixture, ServesStepsFromOneProcess)
+{
+    ResidentHandlers::Response first;
+    ASSERT_EQ(ResidentHandlers::Outcome::COMPLETED, invoke({"", "a b", "c"}, first));
+    ResidentHandlers::Response second;
+    ASSERT_EQ(ResidentHandlers::Outcome::COMPLETED, invoke({"user", "d\ne"}, second));
+
+    ASSERT_EQ(first.pid, second.pid);
+    ASSERT_EQ(0, first.status);
+    ASSERT_EQ("pid " + to_string(first.pid) + " args  a b c\n", first.stdOut);
+    ASSERT_EQ("pid " + to_string(first.pid) + " args user d\ne\n", second.stdOut);
+    ASSERT_TRUE(second.stdErr.empty());
+}
+
+TEST_F(ResidentHandlersFixture, ReportsStatusAndStderrOfStep)
+{
+    ResidentHandlers::Response response;
+    ASSERT_EQ(ResidentHandlers::Outcome::COMPLETED, invoke({"", "fail"}, response));
+
+    ASSERT_EQ(3, response.status);
+    ASSERT_EQ("failed\n", response.stdErr);
+}
+
+TEST_F(ResidentHandlersFixture, RestartsHandlerThatExited)
+{
+    ResidentHandlers::Response first;
+    ASSERT_EQ(ResidentHandlers::Outcome::COMPLETED, invoke({""}, first));
+    ResidentHandlers::Response exited;
+    ASSERT_EQ(ResidentHandlers::Outcome::FAILED, invoke({"", "exit"}, exited));
+    ResidentHandlers::Response restarted;
+    ASSERT_EQ(ResidentHandlers::Outcome::COMPLETED, invoke({""}, restarted));
+
+    ASSERT_NE(first.pid, restarted.pid);
+}
+
+TEST_F(ResidentHandlersFixture, StopsHandlerAtDeadline)
+{
+    ResidentHandlers::Response response;
+    auto start = chrono::steady_clock::now();
+    ASSERT_EQ(
+        ResidentHandlers::Outcome::STOPPED,
+        invoke({"", "hang"}, response, chrono::steady_clock::now() + chrono::milliseconds(100)));
+
+    ASSERT_LT(chrono::steady_clock::now() - start, chrono::seconds(ResidentHandlers::STOP_GRACE_PERIOD_MILLIS / 1000));
+}
+
+TEST_F(ResidentHandlersFixture, StopsHandlerWhenWokenUp)
+{
+    int wakeUp[2];
+    ASSERT_EQ(0, pipe(wakeUp));
+    ASSERT_EQ(1, write(wakeUp[1], "", 1));
+
+    ResidentHandlers::Response response;
+    ASSERT_EQ(
+        ResidentHandlers::Outcome::STOPPED,
+        invoke({"", "hang"}, response, chrono::steady_clock::time_point::max(), wakeUp[0]));
+
+    close(wakeUp[0]);
+    close(wakeUp[1]);
+}
+
+TEST_F(ResidentHandlersFixture, AttributesCpuTimeOfGroupToSteps)
+{
+    // Laid out like a cgroup v2 group, since the tests cannot count on being allowed to create real cgroups
+    const string parent = handlerDir + "/cgroup";
+    const string group = parent + "/" + StepCgroups::HANDLER_GROUP_PREFIX + to_string(getpid()) + "-1";
+    mkdir(parent.c_str(), 0755);
+    mkdir(group.c_str(), 0755);
+    ofstream(parent + "/cgroup.controllers") << "cpu io memory\n";
+    ofstream(parent + "/cgroup.subtree_control") << "";
+    ofstream(group + "/cgroup.procs") << "";
+    ofstream(group + "/cpu.stat") << "usage_usec 1000\n";
+    auto cgroups = make_shared<StepCgroups>(StepCgroups::Limits(), parent);
+    ASSERT_TRUE(cgroups->init());
+    handlers = unique_ptr<ResidentHandlers>(new ResidentHandlers(handlerDir, {"resident-handler"}, cgroups));
+
+    ResidentHandlers::Response first;
+    ASSERT_EQ(ResidentHandlers::Outcome::COMPLETED, invoke({""}, first));
+    ofstream(group + "/cpu.stat") << "usage_usec 1500\n";
+    ResidentHandlers::Response second;
+    ASSERT_EQ(ResidentHandlers::Outcome::COMPLETED, invoke({""}, second));
+
+    // The handler moved itself to its group
+    ifstream procs(group + "/cgroup.procs");
+    ASSERT_EQ("0", string(istreambuf_iterator<char>(procs), istreambuf_iterator<char>()));
+    ASSERT_TRUE(first.usage.has_value());
+    ASSERT_EQ(1000u, first.usage->cpuTimeMicros);
+    ASSERT_TRUE(second.usage.has_value());
+    ASSERT_EQ(500u, second.usage->cpuTimeMicros);
+    ASSERT_FALSE(second.usage->peakMemoryBytes.has_value());
+
+    handlers.reset();
+    for (const char *file : {"cgroup.procs", "cpu.stat"})
+    {
+        remove((group + "/" + file).c_str());
+    }
+    rmdir(group.c_str());
+    for (const char *file : {"cgroup.controllers", "cgroup.subtree_control"})
+    {
+        remove((parent + "/" + file).c_str());
+    }
+    rmdir(parent.c_str());
+}
@@ -0,0 +1,104 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/SharedCrtResourceManager.h"
+#include "../../source/jobs/SeenJobExecutions.h"
+
+#include "gtest/gtest.h"
+#include <aws/crt/JsonObject.h>
+
+using namespace std;
+using namespace Aws::Crt;
+using namespace Aws::Iot::DeviceClient;
+using namespace Aws::Iot::DeviceClient::Jobs;
+
+class SeenJobExecutionsFixture : public ::testing::Test
+{
+  public:
+    void SetUp() override
+    {
+        // Initializing allocator, so we can use CJSON lib from SDK in our unit tests.
+        resourceManager.initializeAllocator();
+    }
+
+    static SeenJobExecutions::Key keyOf(const string &jobId, int64_t executionNumber, const char *document)
+    {
+        Iotjobs::JobExecutionData job;
+        job.JobId = String(jobId.c_str());
+        job.ExecutionNumber = executionNumber;
+        job.JobDocument = JsonObject(document);
+        return SeenJobExecutions::keyOf(job);
+    }
+
+    SharedCrtResourceManager resourceManager;
+};
+
+TEST_F(SeenJobExecutionsFixture, DigestIgnoresKeyOrderAndFormatting)
+{
+    JsonObject document(R"({"version": "1.0", "steps": [{"name": "a", "retries": 2}], "includeStdOut": true})");
+    JsonObject reordered(R"({"includeStdOut":true,"steps":[{"retries":2,"name":"a"}],"version":"1.0"})");
+
+    ASSERT_EQ(SeenJobExecutions::digest(document.View()), SeenJobExecutions::digest(reordered.View()));
+}
+
+TEST_F(SeenJobExecutionsFixture, DigestDistinguishesDocuments)
+{
+    const char *documents[] = {
+        R"({"version": "1.0"})",
+        R"({"version": "1.1"})",
+        R"({"version": 1.0})",
+        R"({"version": ["1.0"]})",
+        R"({"version": null})",
+        R"({"versio": "n1.0"})",
+        R"({"steps": ["a", "b"]})",
+        R"({"steps": ["ab"]})"};
+    for (const char *document : documents)
+    {
+        for (const char *other : documents)
+        {
+            if (document != other)
+            {
+                ASSERT_NE(
+                    SeenJobExecutions::digest(JsonObject(document).View()),
+                    SeenJobExecutions::digest(JsonObject(other).View()))
+                    << document << " " << other;
+            }
+        }
+    }
+}
+
+TEST_F(SeenJobExecutionsFixture, ComparesJobIdExecutionNumberAndDocument)
+{
+    SeenJobExecutions seen;
+    seen.insert(keyOf("job1", 1, R"({"version": "1.0"})"));
+
+    ASSERT_TRUE(seen.contains(keyOf("job1", 1, R"({"version": "1.0"})")));
+    ASSERT_FALSE(seen.contains(keyOf("job2", 1, R"({"version": "1.0"})")));
+    ASSERT_FALSE(seen.contains(keyOf("job1", 2, R"({"version": "1.0"})")));
+    ASSERT_FALSE(seen.contains(keyOf("job1", 1, R"({"version": "1.1"})")));
+}
+
+TEST_F(SeenJobExecutionsFixture, RemembersSeveralExecutions)
+{
+    SeenJobExecutions seen;
+    seen.insert(keyOf("job1", 1, "{}"));
+    seen.insert(keyOf("job2", 1, "{}"));
+
+    // A notification of the first job arriving after that of the second is still a duplicate
+    ASSERT_TRUE(seen.contains(keyOf("job1", 1, "{}")));
+    ASSERT_TRUE(seen.contains(keyOf("job2", 1, "{}")));
+}
+
+TEST_F(SeenJobExecutionsFixture, ForgetsLeastRecentlySeenExecution)
+{
+    SeenJobExecutions seen(2);
+    seen.insert(keyOf("job1", 1, "{}"));
+    seen.insert(keyOf("job2", 1, "{}"));
+    // Seeing the first job again makes the second one the least recently seen
+    ASSERT_TRUE(seen.contains(keyOf("job1", 1, "{}")));
+    seen.insert(keyOf("job3", 1, "{}"));
+
+    ASSERT_TRUE(seen.contains(keyOf("job1", 1, "{}")));
+    ASSERT_FALSE(seen.contains(keyOf("job2", 1, "{}")));
+    ASSERT_TRUE(seen.contains(keyOf("job3", 1, "{}")));
+}
@@ -0,0 +1,179 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/jobs/StatusUpdateDispatcher.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Jobs;
+using namespace Aws::Iot::DeviceClient::Util;
+
+using Response = StatusUpdateDispatcher::Response;
+
+/**
+ * Records the requests the dispatcher publishes and the updates it completes, and answers each request with the next
+ * scripted response, or leaves it unanswered once the script runs out
+ */
+class StatusUpdateDispatcherFixture : public ::testing::Test
+{
+  public:
+    mutex lock;
+    condition_variable changed;
+    vector<string> published;
+    vector<string> completed;
+    vector<Response> script;
+    size_t answered{0};
+    atomic<bool> needStop{false};
+
+    StatusUpdateDispatcher::Update update(const string &jobId, const string &status, long maxRetries = -1)
+    {
+        StatusUpdateDispatcher::Update update;
+        update.jobId = jobId;
+        update.retryConfig = {10, 40, maxRetries, &needStop, Retry::Jitter::NONE, 0};
+        update.publish = [this, status](const string &clientToken) {
+            Response response;
+            {
+                lock_guard<mutex> guard(lock);
+                published.push_back(status);
+                changed.notify_all();
+                if (answered == script.size())
+                {
+                    return;
+                }
+                response = script[answered++];
+            }
+            dispatcher->respond(clientToken, response);
+        };
+        update.onComplete = [this, status]() {
+            lock_guard<mutex> guard(lock);
+            completed.push_back(status);
+            changed.notify_all();
+        };
+        return update;
+    }
+
+    bool waitFor(const function<bool()> &condition)
+    {
+        unique_lock<mutex> guard(lock);
+        return changed.wait_for(guard, chrono::seconds(5), condition);
+    }
+
+    unique_ptr<StatusUpdateDispatcher> dispatcher{new StatusUpdateDispatcher(2, chrono::milliseconds(50))};
+};
+
+TEST_F(StatusUpdateDispatcherFixture, CompletesAcceptedUpdate)
+{
+    script = {Response::ACCEPTED};
+    ASSERT_TRUE(dispatcher->submit(update("job", "SUCCEEDED")));
+
+    ASSERT_TRUE(waitFor([this] { return completed.size() == 1; }));
+    ASSERT_EQ(vector<string>({"SUCCEEDED"}), published);
+    ASSERT_EQ(0u, dispatcher->pendingCount());
+}
+
+TEST_F(StatusUpdateDispatcherFixture, RetriesAfterRetryableErrorAndTimeout)
+{
+    // The second request is left unanswered, so it times out before the third is accepted
+    script = {Response::RETRYABLE_ERROR};
+    ASSERT_TRUE(dispatcher->submit(update("job", "SUCCEEDED")));
+    ASSERT_TRUE(waitFor([this] { return published.size() == 2; }));
+    {
+        lock_guard<mutex> guard(lock);
+        script.push_back(Response::ACCEPTED);
+        script.push_back(Response::ACCEPTED);
+        answered = 2;
+    }
+
+    ASSERT_TRUE(waitFor([this] { return completed.size() == 1; }));
+    ASSERT_EQ(3u, published.size());
+}
+
+TEST_F(StatusUpdateDispatcherFixture, GivesUpOnNonRetryableError)
+{
+    script = {Response::NON_RETRYABLE_ERROR};
+    ASSERT_TRUE(dispatcher->submit(update("job", "SUCCEEDED")));
+
+    ASSERT_TRUE(waitFor([this] { return completed.size() == 1; }));
+    ASSERT_EQ(1u, published.size());
+}
+
+TEST_F(StatusUpdateDispatcherFixture, GivesUpAfterMaxRetries)
+{
+    script = {Response::RETRYABLE_ERROR, Response::RETRYABLE_ERROR, Response::RETRYABLE_ERROR};
+    ASSERT_TRUE(dispatcher->submit(update("job", "SUCCEEDED", 2)));
+
+    ASSERT_TRUE(waitFor([this] { return completed.size() == 1; }));
+    ASSERT_EQ(2u, published.size());
+}
+
+TEST_F(StatusUpdateDispatcherFixture, SendsOnlyLatestUpdateOfJob)
+{
+    // The first request stays in flight while two more updates of the job are submitted, and only the latest of them
+    // is sent once it times out
+    dispatcher.reset(new StatusUpdateDispatcher(2, chrono::milliseconds(500)));
+    ASSERT_TRUE(dispatcher->submit(update("job", "IN_PROGRESS")));
+    ASSERT_TRUE(waitFor([this] { return published.size() == 1; }));
+    {
+        lock_guard<mutex> guard(lock);
+        script = {Response::ACCEPTED, Response::ACCEPTED};
+        answered = 1;
+    }
+    ASSERT_TRUE(dispatcher->submit(update("job", "FAILED")));
+    ASSERT_TRUE(dispatcher->submit(update("job", "SUCCEEDED")));
+    ASSERT_EQ(1u, dispatcher->pendingCount());
+
+    ASSERT_TRUE(waitFor([this] { return completed.size() == 3; }));
+    ASSERT_EQ(vector<string>({"IN_PROGRESS", "SUCCEEDED"}), published);
+    ASSERT_EQ(vector<string>({"IN_PROGRESS", "FAILED", "SUCCEEDED"}), completed);
+}
+
+TEST_F(StatusUpdateDispatcherFixture, RejectsUpdatesBeyondCapacity)
+{
+    ASSERT_TRUE(dispatcher->submit(update("first", "SUCCEEDED")));
+    ASSERT_TRUE(dispatcher->submit(update("second", "SUCCEEDED")));
+    ASSERT_FALSE(dispatcher->submit(update("third", "SUCCEEDED")));
+    // Superseding the update of a job already pending takes no more room
+    ASSERT_TRUE(dispatcher->submit(update("first", "FAILED")));
+    ASSERT_EQ(2u, dispatcher->pendingCount());
+}
+
+TEST_F(StatusUpdateDispatcherFixture, CompletesWithoutRetryingOnceStopped)
+{
+    script = {Response::RETRYABLE_ERROR};
+    ASSERT_TRUE(dispatcher->submit(update("job", "SUCCEEDED")));
+    ASSERT_TRUE(waitFor([this] { return published.size() == 1; }));
+    needStop = true;
+
+    ASSERT_TRUE(waitFor([this] { return completed.size() == 1; }));
+    ASSERT_EQ(1u, published.size());
+}
+
+TEST_F(StatusUpdateDispatcherFixture, IgnoresResponseToUnknownClientToken)
+{
+    ASSERT_FALSE(dispatcher->respond("unknown", Response::ACCEPTED));
+}
+
+TEST_F(StatusUpdateDispatcherFixture, RetriesThrottledUpdatesFromOneThread)
+{
+    // Many jobs throttled at once wait on timers rather than on a thread each
+    dispatcher.reset(new StatusUpdateDispatcher(64, chrono::milliseconds(50)));
+    constexpr int jobs = 64;
+    for (int i = 0; i < jobs * 3; i++)
+    {
+        script.push_back(i < jobs * 2 ? Response::RETRYABLE_ERROR : Response::ACCEPTED);
+    }
+    for (int i = 0; i < jobs; i++)
+    {
+        ASSERT_TRUE(dispatcher->submit(update("job" + to_string(i), "SUCCEEDED")));
+    }
+
+    ASSERT_TRUE(waitFor([this] { return completed.size() == jobs; }));
+    ASSERT_EQ(0u, dispatcher->pendingCount());
+}
@@ -0,0 +1,160 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/jobs/StepCgroups.h"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace Aws::Crt;
+using namespace Aws::Iot::DeviceClient::Jobs;
+
+/**
+ * Lays out a directory like a cgroup v2 group, since the tests cannot count on being allowed to create real cgroups
+ */
+class StepCgroupsFixture : public ::testing::Test
+{
+  public:
+    const string parent = "/tmp/device-client-cgroup-test";
+
+    void SetUp() override
+    {
+        mkdir(parent.c_str(), 0755);
+        writeFile(parent + "/cgroup.controllers", "cpuset cpu io memory pids\n");
+        writeFile(parent + "/cgroup.subtree_control", "");
+    }
+
+    void TearDown() override { removeTree(parent); }
+
+    static void removeTree(const string &path)
+    {
+        DIR *dir = opendir(path.c_str());
+        if (dir == nullptr)
+        {
+            remove(path.c_str());
+            return;
+        }
+        while (dirent *entry = readdir(dir))
+        {
+            string name = entry->d_name;
+            if (name != "." && name != "..")
+            {
+                removeTree(path + "/" + name);
+            }
+        }
+        closedir(dir);
+        rmdir(path.c_str());
+    }
+
+    static void writeFile(const string &path, const string &contents) { ofstream(path) << contents; }
+
+    static string readFile(const string &path)
+    {
+        ifstream file(path);
+        return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    }
+
+    /**
+     * Creates the group of the first step ahead of time, with the interface files the kernel would create
+     */
+    string createFirstStepGroup(const string &cpuStat, const string &memoryPeak) const
+    {
+        string path = parent + "/" + StepCgroups::STEP_GROUP_PREFIX + to_string(getpid()) + "-1";
+        mkdir(path.c_str(), 0755);
+        for (const char *file : {"cpu.max", "memory.max", "io.weight", "cgroup.procs", "cgroup.kill"})
+        {
+            writeFile(path + "/" + file, "");
+        }
+        writeFile(path + "/cgroup.events", "populated 0\nfrozen 0\n");
+        writeFile(path + "/cpu.stat", cpuStat);
+        writeFile(path + "/memory.peak", memoryPeak);
+        return path;
+    }
+};
+
+TEST_F(StepCgroupsFixture, InitEnablesControllersOfLimits)
+{
+    StepCgroups::Limits limits;
+    limits.cpuMax = string("50000 100000");
+    StepCgroups cgroups(limits, parent);
+
+    ASSERT_TRUE(cgroups.init());
+    // The memory controller is enabled to track peak memory
+    ASSERT_EQ("+cpu +memory", readFile(parent + "/cgroup.subtree_control"));
+}
+
+TEST_F(StepCgroupsFixture, InitFailsWithoutControllerOfLimit)
+{
+    writeFile(parent + "/cgroup.controllers", "cpu memory\n");
+    StepCgroups::Limits limits;
+    limits.ioWeight = 100;
+    StepCgroups cgroups(limits, parent);
+
+    ASSERT_FALSE(cgroups.init());
+}
+
+TEST_F(StepCgroupsFixture, InitFailsOutsideCgroupV2)
+{
+    StepCgroups cgroups(StepCgroups::Limits(), parent + "/missing");
+
+    ASSERT_FALSE(cgroups.init());
+}
+
+TEST_F(StepCgroupsFixture, CreateStepAppliesLimits)
+{
+    string path = createFirstStepGroup("usage_usec 0\n", "0\n");
+    StepCgroups::Limits limits;
+    limits.cpuMax = string("50000 100000");
+    limits.memoryMax = string("256M");
+    limits.ioWeight = 50;
+    StepCgroups cgroups(limits, parent);
+    ASSERT_TRUE(cgroups.init());
+
+    StepCgroups::Step step;
+    ASSERT_TRUE(cgroups.createStep(step));
+    ASSERT_EQ(path, step.path);
+    ASSERT_LE(0, step.procsFd);
+    ASSERT_EQ("50000 100000", readFile(path + "/cpu.max"));
+    ASSERT_EQ("256M", readFile(path + "/memory.max"));
+    ASSERT_EQ("50", readFile(path + "/io.weight"));
+
+    cgroups.removeStep(step);
+    ASSERT_EQ(-1, step.procsFd);
+    ASSERT_TRUE(step.path.empty());
+}
+
+TEST_F(StepCgroupsFixture, RemoveStepReportsUsage)
+{
+    createFirstStepGroup("usage_usec 1500000\nuser_usec 1000000\nsystem_usec 500000\n", "1048576\n");
+    StepCgroups cgroups(StepCgroups::Limits(), parent);
+    ASSERT_TRUE(cgroups.init());
+
+    StepCgroups::Step step;
+    ASSERT_TRUE(cgroups.createStep(step));
+    StepCgroups::Usage usage = cgroups.removeStep(step);
+
+    ASSERT_EQ(1500000u, usage.cpuTimeMicros);
+    ASSERT_TRUE(usage.peakMemoryBytes.has_value());
+    ASSERT_EQ(1048576u, usage.peakMemoryBytes.value());
+}
+
+TEST_F(StepCgroupsFixture, RemoveStepWithoutPeakMemory)
+{
+    string path = createFirstStepGroup("usage_usec 2000\n", "");
+    remove((path + "/memory.peak").c_str());
+    StepCgroups cgroups(StepCgroups::Limits(), parent);
+    ASSERT_TRUE(cgroups.init());
+
+    StepCgroups::Step step;
+    ASSERT_TRUE(cgroups.createStep(step));
+    StepCgroups::Usage usage = cgroups.removeStep(step);
+
+    ASSERT_EQ(2000u, usage.cpuTimeMicros);
+    ASSERT_FALSE(usage.peakMemoryBytes.has_value());
+}
@@ -34,7 +34,7 @@ class FakeSharedCrtResourceManager : public SharedCrtResourceManager
 
     std::shared_ptr<Aws::Crt::Mqtt::MqttConnection> getConnection() override { return connection; }
 
-    aws_event_loop *getNextEventLoop() override { return eventLoop; }
+    aws_event_loop *getNextEventLoop(EventLoopRole) override { return eventLoop; }
 
     aws_allocator *getAllocator() override { return allocator; }
 
@@ -105,7 +105,7 @@ class FakeSensor : public Sensor
               settings,
               manager->getAllocator(),
               manager->getConnection(),
-              manager->getNextEventLoop(),
+              manager->getNextEventLoop(EventLoopRole::DATA_PLANE),
               std::make_shared<FakeSocket>())
     {
     }
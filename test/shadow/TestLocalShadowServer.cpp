@@ -0,0 +1,195 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/SharedCrtResourceManager.h"
+#include "../../source/shadow/LocalShadowServer.h"
+#include "gtest/gtest.h"
+#include <aws/crt/JsonObject.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace Aws::Crt;
+using namespace Aws::Iot::DeviceClient;
+using namespace Aws::Iot::DeviceClient::Shadow;
+
+namespace
+{
+    const string testDirectory = "/tmp/device-client-local-shadow-tests";
+    const string socketPath = testDirectory + "/shadow.sock";
+
+    /**
+     * A client of the local shadow socket, which reads one message per line
+     */
+    class LocalClient
+    {
+      public:
+        LocalClient()
+        {
+            struct sockaddr_un addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+            fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            connected = connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0;
+        }
+
+        ~LocalClient() { close(fd); }
+
+        bool isConnected() const { return connected; }
+
+        void sendLine(const string &line)
+        {
+            string message = line + "\n";
+            ASSERT_EQ(static_cast<ssize_t>(message.size()), send(fd, message.data(), message.size(), MSG_NOSIGNAL));
+        }
+
+        /**
+         * Returns the next message, or an empty string if none arrives in time
+         */
+        string readLine(chrono::milliseconds timeout = chrono::milliseconds(2000))
+        {
+            auto deadline = chrono::steady_clock::now() + timeout;
+            size_t end;
+            while ((end = input.find('\n')) == string::npos)
+            {
+                auto remaining = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now());
+                pollfd pollFd{fd, POLLIN, 0};
+                if (remaining.count() <= 0 || poll(&pollFd, 1, static_cast<int>(remaining.count())) <= 0)
+                {
+                    return "";
+                }
+                char buf[4096];
+                ssize_t len = recv(fd, buf, sizeof(buf), 0);
+                if (len <= 0)
+                {
+                    return "";
+                }
+                input.append(buf, static_cast<size_t>(len));
+            }
+            string line = input.substr(0, end);
+            input.erase(0, end + 1);
+            return line;
+        }
+
+      private:
+        int fd{-1};
+        bool connected{false};
+        string input;
+    };
+} // namespace
+
+class LocalShadowServerTestFixture : public ::testing::Test
+{
+  public:
+    void SetUp() override
+    {
+        // Initializing allocator, so we can use CJSON lib from SDK in our unit tests.
+        resourceManager.initializeAllocator();
+        mkdir(testDirectory.c_str(), 0700);
+
+        cache->AddShadow("sample");
+        server = unique_ptr<LocalShadowServer>(new LocalShadowServer(
+            cache,
+            [this](const string &shadowName, const JsonObject &reported) {
+                lock_guard<mutex> lock(updatesLock);
+                updates[shadowName].push_back(reported.View().WriteCompact().c_str());
+                updatesChanged.notify_all();
+            },
+            chrono::milliseconds(50)));
+        ASSERT_TRUE(server->Start(socketPath));
+        LocalShadowServer *notified = server.get();
+        cache->SetOnShadowChanged(
+            [notified](const string &name, const string &document) { notified->NotifyShadowChanged(name, document); });
+    }
+
+    void TearDown() override
+    {
+        cache->SetOnShadowChanged(nullptr);
+        server.reset();
+        rmdir(testDirectory.c_str());
+    }
+
+    SharedCrtResourceManager resourceManager;
+    shared_ptr<ShadowCache> cache = make_shared<ShadowCache>();
+    unique_ptr<LocalShadowServer> server;
+
+    mutex updatesLock;
+    condition_variable updatesChanged;
+    map<string, vector<string>> updates;
+};
+
+TEST_F(LocalShadowServerTestFixture, SocketIsOnlyAccessibleToOwner)
+{
+    struct stat socketStat;
+    ASSERT_EQ(0, stat(socketPath.c_str(), &socketStat));
+    ASSERT_TRUE(S_ISSOCK(socketStat.st_mode));
+    ASSERT_EQ(0600, socketStat.st_mode & 0777);
+}
+
+TEST_F(LocalShadowServerTestFixture, GetReturnsCachedDocument)
+{
+    LocalClient client;
+    ASSERT_TRUE(client.isConnected());
+
+    client.sendLine(R"({"op":"get","shadow":"sample"})");
+    ASSERT_STREQ(
+        R"({"op":"get","shadow":"sample","error":"Shadow document not received yet"})", client.readLine().c_str());
+
+    ASSERT_TRUE(cache->Replace("sample", JsonObject(R"({"a":1})"), JsonObject(R"({"b":2})"), 3));
+    client.sendLine(R"({"op":"get","shadow":"sample"})");
+    ASSERT_STREQ(
+        R"({"op":"get","shadow":"sample","state":{"desired":{"a":1},"reported":{"b":2}},"version":3})",
+        client.readLine().c_str());
+
+    client.sendLine(R"({"op":"get","shadow":"other"})");
+    ASSERT_STREQ(R"({"op":"get","shadow":"other","error":"Unknown shadow"})", client.readLine().c_str());
+}
+
+TEST_F(LocalShadowServerTestFixture, WatchNotifiesChanges)
+{
+    LocalClient watcher;
+    LocalClient other;
+    ASSERT_TRUE(watcher.isConnected());
+    ASSERT_TRUE(other.isConnected());
+
+    watcher.sendLine(R"({"op":"watch","shadow":"sample"})");
+    ASSERT_STREQ(R"({"op":"watch","shadow":"sample"})", watcher.readLine().c_str());
+
+    ASSERT_TRUE(cache->Replace("sample", JsonObject(R"({"a":1})"), JsonObject(), 1));
+    ASSERT_STREQ(
+        R"({"op":"changed","shadow":"sample","state":{"desired":{"a":1},"reported":{}},"version":1})",
+        watcher.readLine().c_str());
+
+    ASSERT_TRUE(cache->ApplyDesiredDelta("sample", JsonObject(R"({"a":2})").View(), 2));
+    ASSERT_STREQ(
+        R"({"op":"changed","shadow":"sample","state":{"desired":{"a":2},"reported":{}},"version":2})",
+        watcher.readLine().c_str());
+
+    // Only clients watching the shadow are notified
+    ASSERT_STREQ("", other.readLine(chrono::milliseconds(100)).c_str());
+}
+
+TEST_F(LocalShadowServerTestFixture, UpdatesAreBatched)
+{
+    LocalClient client;
+    ASSERT_TRUE(client.isConnected());
+
+    client.sendLine(R"({"op":"update","shadow":"sample","state":{"reported":{"a":1,"b":1}}})");
+    client.sendLine(R"({"op":"update","shadow":"sample","state":{"reported":{"b":2}}})");
+    ASSERT_STREQ(R"({"op":"update","shadow":"sample","queued":true})", client.readLine().c_str());
+    ASSERT_STREQ(R"({"op":"update","shadow":"sample","queued":true})", client.readLine().c_str());
+
+    unique_lock<mutex> lock(updatesLock);
+    ASSERT_TRUE(updatesChanged.wait_for(lock, chrono::seconds(2), [this]() { return !updates.empty(); }));
+    ASSERT_EQ(vector<string>{R"({"a":1,"b":2})"}, updates["sample"]);
+}
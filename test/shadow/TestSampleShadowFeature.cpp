@@ -3,14 +3,74 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "../../source/Feature.h"
+#include "../../source/SharedCrtResourceManager.h"
 #include "../../source/shadow/SampleShadowFeature.h"
 #include "gtest/gtest.h"
+#include <aws/crt/JsonObject.h>
 
 using namespace std;
+using namespace Aws::Crt;
+using namespace Aws::Iot::DeviceClient;
 using namespace Aws::Iot::DeviceClient::Shadow;
 
 TEST(SampleShadowFeature, getName)
 {
     SampleShadowFeature sampleShadowFeature;
     ASSERT_STREQ(sampleShadowFeature.getName().c_str(), "SampleShadow");
-}
\ No newline at end of file
+}
+
+TEST(SampleShadowFeature, reportedStateDeltaUnchanged)
+{
+    // Initializing allocator, so we can use CJSON lib from SDK in our unit tests.
+    SharedCrtResourceManager resourceManager;
+    resourceManager.initializeAllocator();
+
+    JsonObject previous(R"({"a": 1, "b": {"c": "d"}, "e": [1, 2]})");
+    JsonObject current(R"({"a": 1, "b": {"c": "d"}, "e": [1, 2]})");
+    JsonObject delta;
+
+    ASSERT_FALSE(SampleShadowFeature::computeReportedStateDelta(previous.View(), current.View(), delta));
+    ASSERT_STREQ("{}", delta.View().WriteCompact().c_str());
+}
+
+TEST(SampleShadowFeature, reportedStateDeltaOnlyChangedKeys)
+{
+    SharedCrtResourceManager resourceManager;
+    resourceManager.initializeAllocator();
+
+    JsonObject previous(R"({"a": 1, "b": {"c": "d", "f": "g"}, "e": [1, 2]})");
+    JsonObject current(R"({"a": 1, "b": {"c": "x", "f": "g"}, "e": [1, 2, 3]})");
+    JsonObject delta;
+
+    ASSERT_TRUE(SampleShadowFeature::computeReportedStateDelta(previous.View(), current.View(), delta));
+    ASSERT_STREQ(R"({"b":{"c":"x"},"e":[1,2,3]})", delta.View().WriteCompact().c_str());
+}
+
+TEST(SampleShadowFeature, reportedStateDeltaRemovedKeysAreNull)
+{
+    SharedCrtResourceManager resourceManager;
+    resourceManager.initializeAllocator();
+
+    JsonObject previous(R"({"a": 1, "b": {"c": "d", "f": "g"}})");
+    JsonObject current(R"({"b": {"c": "d"}, "h": true})");
+    JsonObject delta;
+
+    ASSERT_TRUE(SampleShadowFeature::computeReportedStateDelta(previous.View(), current.View(), delta));
+    ASSERT_STREQ(R"({"b":{"f":null},"h":true,"a":null})", delta.View().WriteCompact().c_str());
+}
+
+TEST(SampleShadowFeature, shadowNameFromFileName)
+{
+    string name;
+    ASSERT_TRUE(SampleShadowFeature::shadowNameFromFileName("sensor-1.json", name));
+    ASSERT_STREQ("sensor-1", name.c_str());
+    ASSERT_TRUE(SampleShadowFeature::shadowNameFromFileName("bay:2_pump.json", name));
+    ASSERT_STREQ("bay:2_pump", name.c_str());
+
+    ASSERT_FALSE(SampleShadowFeature::shadowNameFromFileName(".json", name));
+    ASSERT_FALSE(SampleShadowFeature::shadowNameFromFileName("sensor-1.json.swp", name));
+    ASSERT_FALSE(SampleShadowFeature::shadowNameFromFileName(".sensor-1.json", name));
+    ASSERT_FALSE(SampleShadowFeature::shadowNameFromFileName("sensor 1.json", name));
+    ASSERT_FALSE(SampleShadowFeature::shadowNameFromFileName(string(65, 'a') + ".json", name));
+    ASSERT_TRUE(SampleShadowFeature::shadowNameFromFileName(string(64, 'a') + ".json", name));
+}
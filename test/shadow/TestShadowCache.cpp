@@ -0,0 +1,136 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/SharedCrtResourceManager.h"
+#include "../../source/shadow/ShadowCache.h"
+#include "gtest/gtest.h"
+#include <aws/crt/JsonObject.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+using namespace std;
+using namespace Aws::Crt;
+using namespace Aws::Iot::DeviceClient;
+using namespace Aws::Iot::DeviceClient::Shadow;
+
+class ShadowCacheTestFixture : public ::testing::Test
+{
+  public:
+    void SetUp() override
+    {
+        // Initializing allocator, so we can use CJSON lib from SDK in our unit tests.
+        resourceManager.initializeAllocator();
+        cache.AddShadow("sample");
+    }
+
+    SharedCrtResourceManager resourceManager;
+    ShadowCache cache;
+};
+
+TEST_F(ShadowCacheTestFixture, UntrackedShadowIsIgnored)
+{
+    ASSERT_FALSE(cache.IsTracked("other"));
+    ASSERT_FALSE(cache.Replace("other", JsonObject(R"({"a": 1})"), JsonObject(), 1));
+
+    string document;
+    ASSERT_FALSE(cache.Get("other", document));
+}
+
+TEST_F(ShadowCacheTestFixture, NoDocumentBeforeFirstUpdate)
+{
+    ASSERT_TRUE(cache.IsTracked("sample"));
+
+    string document;
+    ASSERT_FALSE(cache.Get("sample", document));
+}
+
+TEST_F(ShadowCacheTestFixture, ReplaceStoresDocument)
+{
+    ASSERT_TRUE(cache.Replace("sample", JsonObject(R"({"a": 1})"), JsonObject(R"({"b": 2})"), 3));
+
+    string document;
+    ASSERT_TRUE(cache.Get("sample", document));
+    ASSERT_STREQ(
+        R"({"shadow":"sample","state":{"desired":{"a":1},"reported":{"b":2}},"version":3})", document.c_str());
+}
+
+TEST_F(ShadowCacheTestFixture, OlderVersionIsIgnored)
+{
+    ASSERT_TRUE(cache.Replace("sample", JsonObject(R"({"a": 2})"), JsonObject(), 5));
+    ASSERT_FALSE(cache.Replace("sample", JsonObject(R"({"a": 1})"), JsonObject(), 4));
+    ASSERT_FALSE(cache.ApplyDesiredDelta("sample", JsonObject(R"({"a": 3})").View(), 5));
+
+    string document;
+    ASSERT_TRUE(cache.Get("sample", document));
+    ASSERT_STREQ(R"({"shadow":"sample","state":{"desired":{"a":2},"reported":{}},"version":5})", document.c_str());
+}
+
+TEST_F(ShadowCacheTestFixture, DeltaMergesIntoDesired)
+{
+    ASSERT_TRUE(cache.Replace("sample", JsonObject(R"({"a": 1, "b": {"c": 1, "d": 1}})"), JsonObject(), 1));
+    ASSERT_TRUE(cache.ApplyDesiredDelta("sample", JsonObject(R"({"b": {"c": 2}})").View(), 2));
+
+    string document;
+    ASSERT_TRUE(cache.Get("sample", document));
+    ASSERT_STREQ(
+        R"({"shadow":"sample","state":{"desired":{"a":1,"b":{"d":1,"c":2}},"reported":{}},"version":2})",
+        document.c_str());
+}
+
+TEST_F(ShadowCacheTestFixture, ChangeCallback)
+{
+    string changedShadow;
+    string changedDocument;
+    cache.SetOnShadowChanged([&](const string &name, const string &document) {
+        changedShadow = name;
+        changedDocument = document;
+    });
+
+    ASSERT_TRUE(cache.Replace("sample", JsonObject(), JsonObject(R"({"b": 2})"), 1));
+
+    string document;
+    ASSERT_TRUE(cache.Get("sample", document));
+    ASSERT_STREQ("sample", changedShadow.c_str());
+    ASSERT_STREQ(document.c_str(), changedDocument.c_str());
+}
+
+TEST_F(ShadowCacheTestFixture, ClearingCallbackWaitsForCallsInProgress)
+{
+    promise<void> called;
+    atomic<bool> returned{false};
+    cache.SetOnShadowChanged([&](const string &, const string &) {
+        called.set_value();
+        this_thread::sleep_for(chrono::milliseconds(200));
+        returned.store(true);
+    });
+
+    thread update([this]() { cache.Replace("sample", JsonObject(), JsonObject(R"({"b": 2})"), 1); });
+    called.get_future().wait();
+    cache.SetOnShadowChanged(nullptr);
+    ASSERT_TRUE(returned.load());
+    update.join();
+
+    // Nothing is called once the callback is cleared
+    ASSERT_TRUE(cache.Replace("sample", JsonObject(), JsonObject(R"({"b": 3})"), 2));
+}
+
+TEST_F(ShadowCacheTestFixture, MergePatchRemovesNulls)
+{
+    JsonObject target(R"({"a": 1, "b": {"c": 1, "d": 1}})");
+    JsonObject patch(R"({"a": null, "b": {"c": null, "e": 1}})");
+
+    JsonObject merged = ShadowCache::MergePatch(target.View(), patch.View(), false);
+    ASSERT_STREQ(R"({"b":{"d":1,"e":1}})", merged.View().WriteCompact().c_str());
+}
+
+TEST_F(ShadowCacheTestFixture, MergePatchKeepsNulls)
+{
+    JsonObject first(R"({"a": 1, "b": {"c": 1}})");
+    JsonObject second(R"({"a": null, "b": {"d": null}})");
+
+    JsonObject merged = ShadowCache::MergePatch(first.View(), second.View(), true);
+    ASSERT_STREQ(R"({"a":null,"b":{"c":1,"d":null}})", merged.View().WriteCompact().c_str());
+}
@@ -391,3 +391,15 @@ TEST_F(TestSecureTunnelingFeature, SourceMode)
     secureTunnelingFeature->start();
     secureTunnelingFeature->stop();
 }
+
+TEST_F(TestSecureTunnelingFeature, GetRegionFromIotEndpoint)
+{
+    /**
+     * Extracts the region from well-formed AWS IoT Core endpoints and rejects anything else
+     */
+    ASSERT_EQ("us-west-2", SecureTunnelingFeature::GetRegionFromIotEndpoint("abc123-ats.iot.us-west-2.amazonaws.com"));
+    ASSERT_EQ(
+        "cn-north-1", SecureTunnelingFeature::GetRegionFromIotEndpoint("abc123.ats.iot.cn-north-1.amazonaws.com.cn"));
+    ASSERT_EQ("", SecureTunnelingFeature::GetRegionFromIotEndpoint("endpoint value"));
+    ASSERT_EQ("", SecureTunnelingFeature::GetRegionFromIotEndpoint("abc123-ats.iot."));
+}
@@ -1,7 +1,12 @@
 // Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
 // SPDX-License-Identifier: Apache-2.0
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "../../source/FeatureRegistry.h"
 #include "../../source/config/Config.h"
@@ -37,6 +42,41 @@ class FakeFeature : public Feature
     bool stopped;
 };
 
+/**
+ * A feature that takes a while to start and stop, and records the order in which features start and stop
+ */
+class SlowFeature : public Feature
+{
+  public:
+    SlowFeature(
+        const std::string &name,
+        std::chrono::milliseconds duration,
+        std::shared_ptr<std::vector<std::string>> events,
+        std::shared_ptr<std::mutex> eventsLock,
+        int result = Feature::SUCCESS)
+        : name(name), duration(duration), events(events), eventsLock(eventsLock), result(result)
+    {
+    }
+    int start() override { return record("start"); }
+    int stop() override { return record("stop"); }
+    std::string getName() override { return name; }
+
+  private:
+    int record(const std::string &action)
+    {
+        std::this_thread::sleep_for(duration);
+        std::lock_guard<std::mutex> lock(*eventsLock);
+        events->push_back(action + " " + name);
+        return result;
+    }
+
+    std::string name;
+    std::chrono::milliseconds duration;
+    std::shared_ptr<std::vector<std::string>> events;
+    std::shared_ptr<std::mutex> eventsLock;
+    int result;
+};
+
 class TestFeatureRegistry : public ::testing::Test
 {
   public:
@@ -44,6 +84,19 @@ class TestFeatureRegistry : public ::testing::Test
     shared_ptr<FakeFeature> feature1;
     shared_ptr<FakeFeature> feature2;
     shared_ptr<FakeFeature> feature3;
+    shared_ptr<vector<string>> events = make_shared<vector<string>>();
+    shared_ptr<mutex> eventsLock = make_shared<mutex>();
+
+    shared_ptr<SlowFeature> makeSlowFeature(const string &name, int millis, int result = Feature::SUCCESS)
+    {
+        return make_shared<SlowFeature>(name, chrono::milliseconds(millis), events, eventsLock, result);
+    }
+
+    vector<string> getEvents()
+    {
+        lock_guard<mutex> lock(*eventsLock);
+        return *events;
+    }
 
     void SetUp() override
     {
@@ -154,4 +207,132 @@ TEST_F(TestFeatureRegistry, StopAllFeatures)
     ASSERT_EQ(nullptr, features->get(feature1->getName()));
     ASSERT_EQ(nullptr, features->get(feature2->getName()));
     ASSERT_EQ(nullptr, features->get(feature3->getName()));
-}
\ No newline at end of file
+}
+
+TEST_F(TestFeatureRegistry, ReplaceStopsPreviousFeatureAndStartsNewOne)
+{
+    /**
+     * Tests that replacing a feature only restarts that feature, leaving the other features running
+     */
+    auto original = makeSlowFeature("reconfigured", 0);
+    auto untouched = makeSlowFeature("untouched", 0);
+    features->add("reconfigured", original);
+    features->add("untouched", untouched);
+    features->startAll();
+
+    auto replacement = make_shared<FakeFeature>("reconfigured");
+    features->replace("reconfigured", replacement);
+    ASSERT_EQ(replacement, features->get("reconfigured"));
+    ASSERT_TRUE(replacement->isStarted());
+
+    vector<string> events = getEvents();
+    ASSERT_EQ(1, count(events.begin(), events.end(), "stop reconfigured"));
+    ASSERT_EQ(0, count(events.begin(), events.end(), "stop untouched"));
+
+    features->replace("reconfigured", nullptr);
+    ASSERT_TRUE(replacement->isStopped());
+    ASSERT_EQ(nullptr, features->get("reconfigured"));
+}
+
+TEST_F(TestFeatureRegistry, StartAllStartsFeaturesConcurrently)
+{
+    /**
+     * Tests that independent features are started at the same time rather than one after another
+     */
+    for (int i = 0; i < 4; i++)
+    {
+        string name = "slow-" + to_string(i);
+        features->add(name, makeSlowFeature(name, 200));
+    }
+
+    auto start = chrono::steady_clock::now();
+    features->startAll();
+    auto elapsed = chrono::steady_clock::now() - start;
+
+    ASSERT_EQ(4u, getEvents().size());
+    ASSERT_LT(elapsed, chrono::milliseconds(600));
+}
+
+TEST_F(TestFeatureRegistry, StartAllStartsDependenciesFirst)
+{
+    /**
+     * Tests that a feature is started after the features it depends on and stopped before them
+     */
+    features->add("a-dependent", makeSlowFeature("a-dependent", 0), {"z-dependency"});
+    features->add("z-dependency", makeSlowFeature("z-dependency", 100));
+
+    features->startAll();
+    features->stopAll();
+
+    vector<string> expected = {"start z-dependency", "start a-dependent", "stop a-dependent", "stop z-dependency"};
+    ASSERT_EQ(expected, getEvents());
+}
+
+TEST_F(TestFeatureRegistry, StartAllSkipsFeaturesWhoseDependencyFailed)
+{
+    /**
+     * Tests that a feature is not started when a feature it depends on fails to start
+     */
+    features->add("dependent", makeSlowFeature("dependent", 0), {"failing"});
+    features->add("failing", makeSlowFeature("failing", 0, 1));
+    features->add("independent", makeSlowFeature("independent", 0));
+
+    features->startAll();
+
+    vector<string> actual = getEvents();
+    ASSERT_EQ(2u, actual.size());
+    ASSERT_EQ(actual.end(), find(actual.begin(), actual.end(), "start dependent"));
+}
+
+TEST_F(TestFeatureRegistry, StartAllDoesNotWaitPastDeadline)
+{
+    /**
+     * Tests that a feature taking longer than the deadline to start does not hold up the others
+     */
+    features = make_shared<FeatureRegistry>(FeatureRegistry::DEFAULT_MAX_CONCURRENCY, chrono::milliseconds(100));
+    features->add("stuck", makeSlowFeature("stuck", 1000));
+    features->add("dependent", makeSlowFeature("dependent", 0), {"stuck"});
+    features->add("fast", makeSlowFeature("fast", 0));
+
+    auto start = chrono::steady_clock::now();
+    features->startAll();
+    auto elapsed = chrono::steady_clock::now() - start;
+
+    ASSERT_LT(elapsed, chrono::milliseconds(800));
+    ASSERT_EQ(vector<string>{"start fast"}, getEvents());
+}
+
+TEST_F(TestFeatureRegistry, StartAllDoesNotWaitForQueuedFeaturesPastDeadline)
+{
+    /**
+     * Tests that features queued behind more stuck features than there are workers are still started
+     */
+    features = make_shared<FeatureRegistry>(2, chrono::milliseconds(100));
+    for (int i = 0; i < 3; i++)
+    {
+        string name = "stuck-" + to_string(i);
+        features->add(name, makeSlowFeature(name, 1000));
+    }
+    features->add("z-fast", makeSlowFeature("z-fast", 0));
+
+    auto start = chrono::steady_clock::now();
+    features->startAll();
+    auto elapsed = chrono::steady_clock::now() - start;
+
+    ASSERT_LT(elapsed, chrono::milliseconds(800));
+    ASSERT_EQ(vector<string>{"start z-fast"}, getEvents());
+}
+
+TEST_F(TestFeatureRegistry, StartAllSkipsCircularDependencies)
+{
+    /**
+     * Tests that features depending on each other are not started and do not hang the registry
+     */
+    features->add("first", makeSlowFeature("first", 0), {"second"});
+    features->add("second", makeSlowFeature("second", 0), {"first"});
+    features->add("independent", makeSlowFeature("independent", 0));
+
+    features->startAll();
+
+    ASSERT_EQ(vector<string>{"start independent"}, getEvents());
+}
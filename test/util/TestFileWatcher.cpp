@@ -0,0 +1,168 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/util/FileUtils.h"
+#include "../../source/util/FileWatcher.h"
+#include "gtest/gtest.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <vector>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Util;
+
+class FileWatcherTestFixture : public ::testing::Test
+{
+  public:
+    const string dir = "/tmp/device-client-file-watcher-test/";
+    const string filePath = dir + "watched.json";
+
+    void SetUp() override
+    {
+        FileUtils::CreateDirectoryWithPermissions(dir.c_str(), 0700);
+        remove(filePath.c_str());
+    }
+
+    void TearDown() override { remove(filePath.c_str()); }
+
+    void writeFile(const string &content) const
+    {
+        ofstream file(filePath);
+        file << content;
+    }
+
+    FileWatcher::OnFileChangedFn recordContent()
+    {
+        return [this](const string &content) {
+            lock_guard<mutex> lock(contentsLock);
+            contents.push_back(content);
+            contentsChanged.notify_all();
+        };
+    }
+
+    bool waitForContents(size_t count)
+    {
+        unique_lock<mutex> lock(contentsLock);
+        return contentsChanged.wait_for(lock, chrono::seconds(5), [this, count] { return contents.size() >= count; });
+    }
+
+    mutex contentsLock;
+    condition_variable contentsChanged;
+    vector<string> contents;
+};
+
+TEST_F(FileWatcherTestFixture, CoalescesBurstOfWrites)
+{
+    FileWatcher watcher;
+    int watchId = watcher.Watch(filePath, chrono::milliseconds(50), 1024, recordContent());
+    ASSERT_NE(-1, watchId);
+
+    for (int i = 0; i < 5; i++)
+    {
+        writeFile("content " + to_string(i));
+    }
+
+    ASSERT_TRUE(waitForContents(1));
+    this_thread::sleep_for(chrono::milliseconds(200));
+
+    lock_guard<mutex> lock(contentsLock);
+    ASSERT_EQ(1u, contents.size());
+    ASSERT_STREQ("content 4", contents.front().c_str());
+}
+
+TEST_F(FileWatcherTestFixture, IgnoresOtherFilesInDirectory)
+{
+    FileWatcher watcher;
+    int watchId = watcher.Watch(filePath, chrono::milliseconds(10), 1024, recordContent());
+    ASSERT_NE(-1, watchId);
+
+    string otherFilePath = dir + "other.json";
+    {
+        ofstream otherFile(otherFilePath);
+        otherFile << "other";
+    }
+    writeFile("watched");
+
+    ASSERT_TRUE(waitForContents(1));
+    this_thread::sleep_for(chrono::milliseconds(100));
+    remove(otherFilePath.c_str());
+
+    lock_guard<mutex> lock(contentsLock);
+    ASSERT_EQ(1u, contents.size());
+    ASSERT_STREQ("watched", contents.front().c_str());
+}
+
+TEST_F(FileWatcherTestFixture, SkipsFilesLargerThanMaximumSize)
+{
+    FileWatcher watcher;
+    int watchId = watcher.Watch(filePath, chrono::milliseconds(10), 4, recordContent());
+    ASSERT_NE(-1, watchId);
+
+    writeFile("too large");
+    this_thread::sleep_for(chrono::milliseconds(100));
+    writeFile("ok");
+
+    ASSERT_TRUE(waitForContents(1));
+
+    lock_guard<mutex> lock(contentsLock);
+    ASSERT_EQ(1u, contents.size());
+    ASSERT_STREQ("ok", contents.front().c_str());
+}
+
+TEST_F(FileWatcherTestFixture, NoCallbackAfterUnwatch)
+{
+    FileWatcher watcher;
+    int watchId = watcher.Watch(filePath, chrono::milliseconds(10), 1024, recordContent());
+    ASSERT_NE(-1, watchId);
+
+    watcher.Unwatch(watchId);
+    writeFile("unwatched");
+    this_thread::sleep_for(chrono::milliseconds(100));
+
+    lock_guard<mutex> lock(contentsLock);
+    ASSERT_TRUE(contents.empty());
+}
+
+TEST_F(FileWatcherTestFixture, RejectsMissingDirectory)
+{
+    FileWatcher watcher;
+    ASSERT_EQ(
+        -1,
+        watcher.Watch(
+            "/tmp/device-client-file-watcher-missing/file", chrono::milliseconds(10), 1024, recordContent()));
+}
+
+TEST_F(FileWatcherTestFixture, WatchesEveryFileOfDirectory)
+{
+    FileWatcher watcher;
+    mutex namesLock;
+    map<string, string> changes;
+    auto recordChange = [this, &namesLock, &changes](const string &fileName, const string &content) {
+        {
+            lock_guard<mutex> lock(namesLock);
+            changes[fileName] = content;
+        }
+        recordContent()(content);
+    };
+    int watchId = watcher.WatchDirectory(dir, chrono::milliseconds(10), 1024, recordChange);
+    ASSERT_NE(-1, watchId);
+
+    string otherFilePath = dir + "other.json";
+    {
+        ofstream otherFile(otherFilePath);
+        otherFile << "other";
+    }
+    writeFile("watched");
+
+    ASSERT_TRUE(waitForContents(2));
+    watcher.Unwatch(watchId);
+    remove(otherFilePath.c_str());
+
+    lock_guard<mutex> lock(namesLock);
+    ASSERT_EQ(2u, changes.size());
+    ASSERT_STREQ("other", changes["other.json"].c_str());
+    ASSERT_STREQ("watched", changes["watched.json"].c_str());
+}
@@ -0,0 +1,22 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/util/HashUtils.h"
+
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Util;
+
+TEST(HashUtils, Fnv1aMatchesReferenceValues)
+{
+    ASSERT_EQ(0xcbf29ce484222325ULL, Fnv1a(""));
+    ASSERT_EQ(0xaf63dc4c8601ec8cULL, Fnv1a("a"));
+    ASSERT_EQ(0x85944171f73967e8ULL, Fnv1a("foobar"));
+}
+
+TEST(HashUtils, Fnv1aHashesIncrementally)
+{
+    ASSERT_EQ(Fnv1a("foobar"), Fnv1a("bar", Fnv1a("foo")));
+    ASSERT_EQ(Fnv1a("foobar"), Fnv1aBytes("bar", 3, Fnv1aBytes("foo", 3)));
+}
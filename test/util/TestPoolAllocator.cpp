@@ -0,0 +1,202 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/util/PoolAllocator.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Util;
+
+namespace
+{
+    size_t residentBytes()
+    {
+        ifstream statm("/proc/self/statm");
+        size_t pages = 0;
+        size_t resident = 0;
+        statm >> pages >> resident;
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    /**
+     * Replaces random allocations of a live set with new ones of random sizes, the way publishes and socket frames
+     * come and go over a long uptime. Sizes are log-uniform between 16 bytes and 8 KiB.
+     */
+    void soak(aws_allocator *allocator, size_t iterations, size_t liveSetSize)
+    {
+        mt19937_64 random(42);
+        uniform_real_distribution<double> logSize(log(16.0), log(8192.0));
+        uniform_int_distribution<size_t> slot(0, liveSetSize - 1);
+        vector<void *> live(liveSetSize, nullptr);
+        for (size_t i = 0; i < iterations; i++)
+        {
+            size_t index = slot(random);
+            aws_mem_release(allocator, live[index]);
+            size_t size = static_cast<size_t>(exp(logSize(random)));
+            live[index] = aws_mem_acquire(allocator, size);
+            memset(live[index], 0xa5, size);
+        }
+        for (void *ptr : live)
+        {
+            aws_mem_release(allocator, ptr);
+        }
+    }
+} // namespace
+
+TEST(PoolAllocator, AllocationsAreAlignedAndAccounted)
+{
+    PoolAllocator pool(aws_default_allocator());
+    aws_allocator *allocator = pool.GetAllocator();
+
+    vector<void *> allocations;
+    for (size_t size = 1; size <= 10000; size += 37)
+    {
+        void *ptr = aws_mem_acquire(allocator, size);
+        ASSERT_NE(nullptr, ptr);
+        ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) % 16);
+        memset(ptr, 0xff, size);
+        allocations.push_back(ptr);
+    }
+    PoolAllocator::Stats stats = pool.GetStats();
+    ASSERT_EQ(allocations.size(), stats.liveAllocations);
+    ASSERT_LT(0u, stats.largeAllocations);
+    ASSERT_LE(stats.requestedBytes, stats.reservedBytes);
+
+    for (void *ptr : allocations)
+    {
+        aws_mem_release(allocator, ptr);
+    }
+    stats = pool.GetStats();
+    ASSERT_EQ(0u, stats.liveAllocations);
+    ASSERT_EQ(0u, stats.largeAllocations);
+    ASSERT_EQ(0u, stats.requestedBytes);
+}
+
+TEST(PoolAllocator, ReusesReleasedBlocks)
+{
+    PoolAllocator pool(aws_default_allocator());
+    aws_allocator *allocator = pool.GetAllocator();
+
+    for (int round = 0; round < 10; round++)
+    {
+        vector<void *> allocations;
+        for (int i = 0; i < 1000; i++)
+        {
+            allocations.push_back(aws_mem_acquire(allocator, 100));
+        }
+        for (void *ptr : allocations)
+        {
+            aws_mem_release(allocator, ptr);
+        }
+    }
+    // 1000 blocks of 128 bytes fit in 3 slabs
+    ASSERT_EQ(3u, pool.GetStats().slabs);
+}
+
+TEST(PoolAllocator, ReallocKeepsContents)
+{
+    PoolAllocator pool(aws_default_allocator());
+    aws_allocator *allocator = pool.GetAllocator();
+
+    void *ptr = aws_mem_acquire(allocator, 10);
+    strcpy(static_cast<char *>(ptr), "contents");
+    void *original = ptr;
+    ASSERT_EQ(AWS_OP_SUCCESS, aws_mem_realloc(allocator, &ptr, 10, 16));
+    // Both sizes fall in the same size class
+    ASSERT_EQ(original, ptr);
+
+    ASSERT_EQ(AWS_OP_SUCCESS, aws_mem_realloc(allocator, &ptr, 16, 5000));
+    ASSERT_STREQ("contents", static_cast<char *>(ptr));
+    ASSERT_EQ(1u, pool.GetStats().largeAllocations);
+    aws_mem_release(allocator, ptr);
+}
+
+TEST(PoolAllocator, BlocksReleasedOnOtherThreadsAreReused)
+{
+    PoolAllocator pool(aws_default_allocator());
+    aws_allocator *allocator = pool.GetAllocator();
+
+    vector<void *> allocations;
+    for (int i = 0; i < 2000; i++)
+    {
+        allocations.push_back(aws_mem_acquire(allocator, 64));
+    }
+    size_t slabs = pool.GetStats().slabs;
+
+    thread([&allocations, allocator]() {
+        for (void *ptr : allocations)
+        {
+            aws_mem_release(allocator, ptr);
+        }
+    }).join();
+
+    allocations.clear();
+    for (int i = 0; i < 2000; i++)
+    {
+        allocations.push_back(aws_mem_acquire(allocator, 64));
+    }
+    ASSERT_EQ(slabs, pool.GetStats().slabs);
+    for (void *ptr : allocations)
+    {
+        aws_mem_release(allocator, ptr);
+    }
+}
+
+TEST(PoolAllocator, SoakAgainstDefaultAllocator)
+{
+    // Set POOL_ALLOCATOR_SOAK_ITERATIONS to soak for longer, e.g. 100000000 for a run of several minutes
+    size_t iterations = 200000;
+    if (const char *configured = getenv("POOL_ALLOCATOR_SOAK_ITERATIONS"))
+    {
+        iterations = strtoull(configured, nullptr, 10);
+    }
+    const size_t liveSetSize = 5000;
+
+    size_t before = residentBytes();
+    auto start = chrono::steady_clock::now();
+    soak(aws_default_allocator(), iterations, liveSetSize);
+    auto defaultMillis = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    size_t defaultGrowth = residentBytes() - min(before, residentBytes());
+
+    PoolAllocator pool(aws_default_allocator());
+    before = residentBytes();
+    start = chrono::steady_clock::now();
+    soak(pool.GetAllocator(), iterations, liveSetSize);
+    auto poolMillis = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    size_t poolGrowth = residentBytes() - min(before, residentBytes());
+
+    // Measure fragmentation with a live set in place, which is what a long running process holds
+    mt19937_64 random(7);
+    uniform_real_distribution<double> logSize(log(16.0), log(4096.0));
+    vector<void *> live;
+    for (size_t i = 0; i < liveSetSize; i++)
+    {
+        live.push_back(aws_mem_acquire(pool.GetAllocator(), static_cast<size_t>(exp(logSize(random)))));
+    }
+    double fragmentation = pool.GetFragmentation();
+    for (void *ptr : live)
+    {
+        aws_mem_release(pool.GetAllocator(), ptr);
+    }
+
+    RecordProperty("iterations", to_string(iterations));
+    RecordProperty("defaultMillis", static_cast<int>(defaultMillis));
+    RecordProperty("defaultGrowthKiB", static_cast<int>(defaultGrowth / 1024));
+    RecordProperty("poolMillis", static_cast<int>(poolMillis));
+    RecordProperty("poolGrowthKiB", static_cast<int>(poolGrowth / 1024));
+    RecordProperty("poolReservedKiB", static_cast<int>(pool.GetStats().reservedBytes / 1024));
+    RecordProperty("poolSlabs", static_cast<int>(pool.GetStats().slabs));
+    RecordProperty("fragmentationPercent", static_cast<int>(fragmentation * 100));
+    ASSERT_EQ(0u, pool.GetStats().liveAllocations);
+    ASSERT_LT(fragmentation, 0.5);
+}
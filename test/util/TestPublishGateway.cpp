@@ -0,0 +1,114 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/util/PublishGateway.h"
+#include "gtest/gtest.h"
+
+#include <condition_variable>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Util;
+
+class PublishGatewayTestFixture : public ::testing::Test
+{
+  public:
+    PublishGateway::SendFn recordSend(const string &name)
+    {
+        return [this, name]() {
+            lock_guard<mutex> lock(sentLock);
+            sent.push_back(name);
+            sentChanged.notify_all();
+        };
+    }
+
+    bool waitForSent(size_t count)
+    {
+        unique_lock<mutex> lock(sentLock);
+        return sentChanged.wait_for(lock, chrono::seconds(5), [this, count] { return sent.size() >= count; });
+    }
+
+    size_t sentCount()
+    {
+        lock_guard<mutex> lock(sentLock);
+        return sent.size();
+    }
+
+    mutex sentLock;
+    condition_variable sentChanged;
+    vector<string> sent;
+};
+
+TEST_F(PublishGatewayTestFixture, SendsBurstImmediately)
+{
+    PublishGateway gateway(10, 0, 100);
+    for (int i = 0; i < 10; i++)
+    {
+        ASSERT_TRUE(gateway.Submit(PublishGateway::Priority::BULK, 10, recordSend("bulk")));
+    }
+
+    // The bucket starts full, so the whole burst is sent on the calling thread
+    ASSERT_EQ(10u, sentCount());
+    ASSERT_EQ(10u, gateway.GetMetrics(PublishGateway::Priority::BULK).sent);
+    ASSERT_EQ(0u, gateway.GetMetrics(PublishGateway::Priority::BULK).queueDepth);
+}
+
+TEST_F(PublishGatewayTestFixture, QueuesMessagesOverTheRateLimit)
+{
+    PublishGateway gateway(20, 0, 100);
+    for (int i = 0; i < 25; i++)
+    {
+        ASSERT_TRUE(gateway.Submit(PublishGateway::Priority::BULK, 10, recordSend("bulk")));
+    }
+
+    ASSERT_EQ(20u, sentCount());
+    ASSERT_EQ(5u, gateway.GetMetrics(PublishGateway::Priority::BULK).maxQueueDepth);
+
+    ASSERT_TRUE(waitForSent(25));
+    ASSERT_EQ(0u, gateway.GetMetrics(PublishGateway::Priority::BULK).queueDepth);
+}
+
+TEST_F(PublishGatewayTestFixture, LimitsBytesPerSecond)
+{
+    PublishGateway gateway(0, 1000, 100);
+    ASSERT_TRUE(gateway.Submit(PublishGateway::Priority::TELEMETRY, 800, recordSend("first")));
+    ASSERT_TRUE(gateway.Submit(PublishGateway::Priority::TELEMETRY, 800, recordSend("second")));
+
+    ASSERT_EQ(1u, sentCount());
+    ASSERT_EQ(1u, gateway.GetMetrics(PublishGateway::Priority::TELEMETRY).queueDepth);
+    ASSERT_TRUE(waitForSent(2));
+}
+
+TEST_F(PublishGatewayTestFixture, SendsQueuedMessagesInPriorityOrder)
+{
+    PublishGateway gateway(20, 0, 100);
+    for (int i = 0; i < 20; i++)
+    {
+        gateway.Submit(PublishGateway::Priority::BULK, 10, []() {});
+    }
+
+    ASSERT_TRUE(gateway.Submit(PublishGateway::Priority::BULK, 10, recordSend("bulk")));
+    ASSERT_TRUE(gateway.Submit(PublishGateway::Priority::TELEMETRY, 10, recordSend("telemetry")));
+    ASSERT_TRUE(gateway.Submit(PublishGateway::Priority::CONTROL, 10, recordSend("control")));
+
+    ASSERT_TRUE(waitForSent(3));
+    ASSERT_EQ((vector<string>{"control", "telemetry", "bulk"}), sent);
+}
+
+TEST_F(PublishGatewayTestFixture, DropsMessagesWhenQueueIsFull)
+{
+    PublishGateway gateway(1, 0, 2);
+    ASSERT_TRUE(gateway.Submit(PublishGateway::Priority::BULK, 10, recordSend("sent")));
+    ASSERT_TRUE(gateway.Submit(PublishGateway::Priority::BULK, 10, recordSend("queued")));
+    ASSERT_TRUE(gateway.Submit(PublishGateway::Priority::BULK, 10, recordSend("queued")));
+    ASSERT_FALSE(gateway.Submit(PublishGateway::Priority::BULK, 10, recordSend("dropped")));
+
+    // Each priority has a queue of its own
+    ASSERT_TRUE(gateway.Submit(PublishGateway::Priority::CONTROL, 10, recordSend("control")));
+
+    auto metrics = gateway.GetMetrics(PublishGateway::Priority::BULK);
+    ASSERT_EQ(2u, metrics.queueDepth);
+    ASSERT_EQ(1u, metrics.dropped);
+    ASSERT_EQ(1u, gateway.GetMetrics(PublishGateway::Priority::CONTROL).queueDepth);
+}
@@ -0,0 +1,191 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/util/FileUtils.h"
+#include "../../source/util/PublishJournal.h"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Util;
+
+class PublishJournalTestFixture : public ::testing::Test
+{
+  public:
+    const string dir = "/tmp/device-client-publish-journal-test/";
+
+    void SetUp() override
+    {
+        FileUtils::CreateDirectoryWithPermissions(dir.c_str(), 0700);
+        removeSegments();
+    }
+
+    void TearDown() override { removeSegments(); }
+
+    vector<string> listSegments() const
+    {
+        vector<string> segments;
+        DIR *directory = opendir(dir.c_str());
+        while (struct dirent *entry = readdir(directory))
+        {
+            if (string(entry->d_name).find("segment-") == 0)
+            {
+                segments.push_back(dir + entry->d_name);
+            }
+        }
+        closedir(directory);
+        return segments;
+    }
+
+    void removeSegments() const
+    {
+        for (const auto &segment : listSegments())
+        {
+            remove(segment.c_str());
+        }
+    }
+
+    static PublishJournal::Record makeRecord(const string &payload)
+    {
+        PublishJournal::Record record;
+        record.topic = "test/topic";
+        record.priority = PublishGateway::Priority::CONTROL;
+        record.payload = payload;
+        return record;
+    }
+
+    static vector<string> replayPayloads(PublishJournal &journal)
+    {
+        vector<string> payloads;
+        journal.Replay([&payloads](uint64_t, const PublishJournal::Record &record) {
+            payloads.push_back(record.payload);
+        });
+        return payloads;
+    }
+};
+
+TEST_F(PublishJournalTestFixture, ReplaysUnacknowledgedPublishesAfterRestart)
+{
+    {
+        PublishJournal journal(dir, 1024 * 1024);
+        ASSERT_TRUE(journal.Open());
+        uint64_t first = journal.Append(makeRecord("first"));
+        uint64_t second = journal.Append(makeRecord("second"));
+        ASSERT_NE(0u, journal.Append(makeRecord("third")));
+        ASSERT_LT(first, second);
+
+        journal.Acknowledge(second);
+        ASSERT_EQ(2u, journal.GetPendingCount());
+        // Publishes appended by this run are already being published
+        ASSERT_TRUE(replayPayloads(journal).empty());
+    }
+
+    PublishJournal journal(dir, 1024 * 1024);
+    ASSERT_TRUE(journal.Open());
+    ASSERT_EQ(2u, journal.GetPendingCount());
+
+    vector<PublishJournal::Record> records;
+    journal.Replay([&records](uint64_t, const PublishJournal::Record &record) { records.push_back(record); });
+    ASSERT_EQ(2u, records.size());
+    ASSERT_EQ("first", records[0].payload);
+    ASSERT_EQ("third", records[1].payload);
+    ASSERT_EQ("test/topic", records[0].topic);
+    ASSERT_EQ(PublishGateway::Priority::CONTROL, records[0].priority);
+
+    // Replayed publishes are not replayed again until released
+    ASSERT_TRUE(replayPayloads(journal).empty());
+}
+
+TEST_F(PublishJournalTestFixture, ReleasedPublishesAreReplayedAgain)
+{
+    PublishJournal journal(dir, 1024 * 1024);
+    ASSERT_TRUE(journal.Open());
+    uint64_t sequence = journal.Append(makeRecord("retry"));
+    journal.Release(sequence);
+
+    ASSERT_EQ(vector<string>{"retry"}, replayPayloads(journal));
+}
+
+TEST_F(PublishJournalTestFixture, IgnoresTornRecordAtEndOfSegment)
+{
+    {
+        PublishJournal journal(dir, 1024 * 1024);
+        ASSERT_TRUE(journal.Open());
+        journal.Append(makeRecord("complete"));
+    }
+
+    auto segments = listSegments();
+    ASSERT_EQ(1u, segments.size());
+    {
+        // A record header claiming more bytes than were written before a crash
+        const char torn[] = {0x20, 0, 0, 0, 0, 0, 0, 0, 'P', 't', 'o', 'r', 'n'};
+        ofstream segment(segments[0], ios::app | ios::binary);
+        segment.write(torn, sizeof(torn));
+    }
+
+    PublishJournal journal(dir, 1024 * 1024);
+    ASSERT_TRUE(journal.Open());
+    ASSERT_EQ(vector<string>{"complete"}, replayPayloads(journal));
+}
+
+TEST_F(PublishJournalTestFixture, DeletesAcknowledgedSegments)
+{
+    PublishJournal journal(dir, 4096);
+    ASSERT_TRUE(journal.Open());
+
+    vector<uint64_t> sequences;
+    for (int i = 0; i < 10; i++)
+    {
+        uint64_t sequence = journal.Append(makeRecord(string(200, 'x')));
+        ASSERT_NE(0u, sequence);
+        sequences.push_back(sequence);
+    }
+    ASSERT_LT(1u, listSegments().size());
+
+    for (uint64_t sequence : sequences)
+    {
+        journal.Acknowledge(sequence);
+    }
+    // Segments are deleted by the writer once the acknowledgements are written
+    journal.Append(makeRecord("last"));
+    ASSERT_EQ(1u, listSegments().size());
+}
+
+TEST_F(PublishJournalTestFixture, RejectsPublishesWhenFull)
+{
+    PublishJournal journal(dir, 1024);
+    ASSERT_TRUE(journal.Open());
+    ASSERT_NE(0u, journal.Append(makeRecord(string(600, 'x'))));
+    ASSERT_EQ(0u, journal.Append(makeRecord(string(600, 'x'))));
+}
+
+TEST_F(PublishJournalTestFixture, ConcurrentAppendsAreAllDurable)
+{
+    {
+        PublishJournal journal(dir, 1024 * 1024);
+        ASSERT_TRUE(journal.Open());
+        vector<thread> appenders;
+        for (int t = 0; t < 4; t++)
+        {
+            appenders.emplace_back([&journal]() {
+                for (int i = 0; i < 50; i++)
+                {
+                    journal.Append(makeRecord("payload"));
+                }
+            });
+        }
+        for (auto &appender : appenders)
+        {
+            appender.join();
+        }
+    }
+
+    PublishJournal journal(dir, 1024 * 1024);
+    ASSERT_TRUE(journal.Open());
+    ASSERT_EQ(200u, journal.GetPendingCount());
+}
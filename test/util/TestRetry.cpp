@@ -0,0 +1,153 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/util/Retry.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Util;
+
+namespace
+{
+    constexpr long STARTING_BACKOFF_MILLIS = 10 * 1000;
+    constexpr long MAX_BACKOFF_MILLIS = 900 * 1000;
+
+    Retry::ExponentialRetryConfig makeConfig(Retry::Jitter jitter, uint64_t seed)
+    {
+        return {STARTING_BACKOFF_MILLIS, MAX_BACKOFF_MILLIS, -1, nullptr, jitter, seed};
+    }
+
+    /**
+     * Models a fleet of devices that lose their connection at the same time and reconnect after backing off against a
+     * broker that accepts at most capacityPerSecond connections per second, rejecting the rest. Returns the highest
+     * number of connection attempts made within one second.
+     */
+    long simulatePeakConnectRate(Retry::Jitter jitter, int devices, long capacityPerSecond)
+    {
+        // Pending connection attempts by time in milliseconds
+        multimap<long, Retry::BackoffSchedule> attempts;
+        for (int device = 0; device < devices; device++)
+        {
+            Retry::BackoffSchedule schedule(makeConfig(jitter, Retry::seedFrom("thing-" + to_string(device))));
+            long attemptAt = schedule.next();
+            attempts.emplace(attemptAt, schedule);
+        }
+
+        map<long, long> attemptsPerSecond;
+        map<long, long> acceptedPerSecond;
+        while (!attempts.empty())
+        {
+            auto attempt = attempts.begin();
+            long second = attempt->first / 1000;
+            attemptsPerSecond[second]++;
+            if (acceptedPerSecond[second] < capacityPerSecond)
+            {
+                acceptedPerSecond[second]++;
+            }
+            else
+            {
+                Retry::BackoffSchedule schedule = attempt->second;
+                long retryAt = attempt->first + schedule.next();
+                attempts.emplace(retryAt, schedule);
+            }
+            attempts.erase(attempt);
+        }
+
+        long peak = 0;
+        for (const auto &second : attemptsPerSecond)
+        {
+            peak = max(peak, second.second);
+        }
+        return peak;
+    }
+} // namespace
+
+TEST(Retry, BackoffWithoutJitterDoublesUpToMaximum)
+{
+    Retry::BackoffSchedule schedule({1000, 5000, -1, nullptr});
+    ASSERT_EQ(1000, schedule.next());
+    ASSERT_EQ(2000, schedule.next());
+    ASSERT_EQ(4000, schedule.next());
+    ASSERT_EQ(5000, schedule.next());
+    ASSERT_EQ(5000, schedule.next());
+}
+
+TEST(Retry, FullJitterStaysBelowDoubledBackoff)
+{
+    Retry::BackoffSchedule schedule(makeConfig(Retry::Jitter::FULL, 42));
+    long ceiling = STARTING_BACKOFF_MILLIS;
+    for (int i = 0; i < 100; i++)
+    {
+        long backoff = schedule.next();
+        ASSERT_LE(0, backoff);
+        ASSERT_GE(ceiling, backoff);
+        ceiling = min(ceiling * 2, MAX_BACKOFF_MILLIS);
+    }
+}
+
+TEST(Retry, DecorrelatedJitterStaysWithinBounds)
+{
+    Retry::BackoffSchedule schedule(makeConfig(Retry::Jitter::DECORRELATED, 42));
+    long previous = STARTING_BACKOFF_MILLIS;
+    for (int i = 0; i < 100; i++)
+    {
+        long backoff = schedule.next();
+        ASSERT_LE(STARTING_BACKOFF_MILLIS, backoff);
+        ASSERT_GE(min(previous * 3, MAX_BACKOFF_MILLIS), backoff);
+        previous = backoff;
+    }
+}
+
+TEST(Retry, SameSeedGivesSameBackoffs)
+{
+    Retry::BackoffSchedule first(makeConfig(Retry::Jitter::DECORRELATED, Retry::seedFrom("thing")));
+    Retry::BackoffSchedule second(makeConfig(Retry::Jitter::DECORRELATED, Retry::seedFrom("thing")));
+    Retry::BackoffSchedule other(makeConfig(Retry::Jitter::DECORRELATED, Retry::seedFrom("other-thing")));
+    vector<long> firstBackoffs, secondBackoffs, otherBackoffs;
+    for (int i = 0; i < 10; i++)
+    {
+        firstBackoffs.push_back(first.next());
+        secondBackoffs.push_back(second.next());
+        otherBackoffs.push_back(other.next());
+    }
+    ASSERT_EQ(firstBackoffs, secondBackoffs);
+    ASSERT_NE(firstBackoffs, otherBackoffs);
+}
+
+TEST(Retry, ExponentialBackoffStopsAfterMaxRetries)
+{
+    int calls = 0;
+    bool completed = false;
+    Retry::ExponentialRetryConfig config = {1, 1, 3, nullptr, Retry::Jitter::FULL, 0};
+    ASSERT_FALSE(Retry::exponentialBackoff(
+        config,
+        [&calls]() {
+            calls++;
+            return false;
+        },
+        [&completed]() { completed = true; }));
+    ASSERT_EQ(3, calls);
+    ASSERT_TRUE(completed);
+}
+
+TEST(Retry, JitterLowersPeakConnectRateOfFleet)
+{
+    const int devices = 20000;
+    const long capacityPerSecond = 1000;
+    long peakWithoutJitter = simulatePeakConnectRate(Retry::Jitter::NONE, devices, capacityPerSecond);
+    long peakWithFullJitter = simulatePeakConnectRate(Retry::Jitter::FULL, devices, capacityPerSecond);
+    long peakWithDecorrelatedJitter = simulatePeakConnectRate(Retry::Jitter::DECORRELATED, devices, capacityPerSecond);
+    RecordProperty("devices", devices);
+    RecordProperty("peakWithoutJitter", static_cast<int>(peakWithoutJitter));
+    RecordProperty("peakWithFullJitter", static_cast<int>(peakWithFullJitter));
+    RecordProperty("peakWithDecorrelatedJitter", static_cast<int>(peakWithDecorrelatedJitter));
+
+    // Without jitter the whole fleet reconnects at the same time
+    ASSERT_EQ(devices, peakWithoutJitter);
+    ASSERT_GT(peakWithoutJitter / 4, peakWithFullJitter);
+    ASSERT_GT(peakWithoutJitter / 4, peakWithDecorrelatedJitter);
+}
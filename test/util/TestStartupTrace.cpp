@@ -0,0 +1,72 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../../source/util/StartupTrace.h"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+using namespace Aws::Iot::DeviceClient::Util;
+
+TEST(StartupTrace, ChromeTraceContainsCompletedPhases)
+{
+    StartupTrace trace;
+    trace.Begin("load-config");
+    this_thread::sleep_for(chrono::milliseconds(5));
+    trace.End("load-config");
+    trace.Begin("connect");
+
+    string json = trace.ToChromeTrace();
+    ASSERT_EQ(0u, json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[{\"name\":\"load-config\""));
+    ASSERT_NE(string::npos, json.find("\"ph\":\"X\""));
+    // Phases that have not ended yet are left out
+    ASSERT_EQ(string::npos, json.find("connect"));
+
+    size_t durationStart = json.find("\"dur\":") + 6;
+    long long duration = stoll(json.substr(durationStart, json.find(',', durationStart) - durationStart));
+    ASSERT_LE(5000, duration);
+}
+
+TEST(StartupTrace, PhasesOnOtherThreadsHaveTheirOwnThreadId)
+{
+    StartupTrace trace;
+    trace.Begin("startup");
+    thread([&trace]() {
+        trace.Begin("config-shadow");
+        trace.End("config-shadow");
+    }).join();
+    trace.End("startup");
+
+    string json = trace.ToChromeTrace();
+    ASSERT_NE(string::npos, json.find("\"name\":\"startup\""));
+    ASSERT_NE(string::npos, json.find("\"tid\":0}"));
+    ASSERT_NE(string::npos, json.find("\"tid\":1}"));
+}
+
+TEST(StartupTrace, IgnoresPhasesThatWereNotBegun)
+{
+    StartupTrace trace;
+    trace.End("never-begun");
+    ASSERT_EQ("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[]}", trace.ToChromeTrace());
+}
+
+TEST(StartupTrace, WritesChromeTraceToFile)
+{
+    const string path = "/tmp/device-client-startup-trace-test.json";
+    StartupTrace trace;
+    trace.Begin("startup");
+    trace.End("startup");
+    ASSERT_TRUE(trace.WriteChromeTrace(path));
+
+    ifstream file(path);
+    stringstream contents;
+    contents << file.rdbuf();
+    ASSERT_EQ(trace.ToChromeTrace(), contents.str());
+    remove(path.c_str());
+
+    ASSERT_FALSE(trace.WriteChromeTrace("/tmp/device-client-missing-directory/startup-trace.json"));
+}